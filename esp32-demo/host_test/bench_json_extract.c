@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+
+#include "host_test.h"
+#include "json_extract.h"
+#ifdef HOST_TEST_HAVE_CJSON
+#include "cJSON.h"
+#endif
+
+/*
+ * json_extract 与 cJSON 的对比：每条消息的堆分配次数、堆峰值和耗时
+ * malloc/calloc/realloc/free 通过 -Wl,--wrap 统计，cJSON 另外通过 cJSON_InitHooks 接入同一套计数，
+ * 系统库形式的 cJSON 也能统计到。json_extract 必须零分配。
+ */
+
+#define BENCH_ROUNDS        200000
+
+typedef struct {
+    const char *name;
+    const char *json;
+} bench_msg_t;
+
+static const bench_msg_t g_msgs[] = {
+    { "bind", "{\"cmdType\":1,\"ssid\":\"home-network-5g\",\"password\":\"correct horse battery\","
+              "\"token\":\"0123456789abcdef0123456789abcdef\"}" },
+    { "addTopic", "{\"code\":0,\"message\":\"OK\",\"data\":{\"code\":40000,\"docs\":\"https://cloud.bemfa.com/docs\","
+                  "\"list\":[{\"topic\":\"esp32switch01006\",\"type\":1},{\"topic\":\"light002\",\"type\":1}]}}" },
+    { "api", "{\"switch\":true}" },
+};
+
+#define BENCH_MSG_CNT   (sizeof(g_msgs) / sizeof(g_msgs[0]))
+
+typedef struct {
+    long cmd_type;
+    char ssid[33];
+    char token[33];
+    long data_code;
+    long sw;
+} bench_result_t;
+
+typedef struct {
+    uint64_t allocs;
+    size_t live;
+    size_t peak;
+} heap_stats_t;
+
+static heap_stats_t g_heap;
+static bool g_heap_counting;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static void heap_add(void *ptr)
+{
+    if (ptr && g_heap_counting) {
+        g_heap.allocs++;
+        g_heap.live += malloc_usable_size(ptr);
+        if (g_heap.live > g_heap.peak) {
+            g_heap.peak = g_heap.live;
+        }
+    }
+}
+
+static void heap_sub(void *ptr)
+{
+    if (ptr && g_heap_counting) {
+        g_heap.live -= malloc_usable_size(ptr);
+    }
+}
+
+void *__wrap_malloc(size_t size)
+{
+    void *ptr = __real_malloc(size);
+    heap_add(ptr);
+    return ptr;
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    void *ptr = __real_calloc(n, size);
+    heap_add(ptr);
+    return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    heap_sub(ptr);
+    void *out = __real_realloc(ptr, size);
+    heap_add(out ? out : ptr);
+    return out;
+}
+
+void __wrap_free(void *ptr)
+{
+    heap_sub(ptr);
+    __real_free(ptr);
+}
+
+static void heap_begin(void)
+{
+    memset(&g_heap, 0, sizeof(g_heap));
+    g_heap_counting = true;
+}
+
+static void heap_end(void)
+{
+    g_heap_counting = false;
+    CHECK(g_heap.live == 0);
+}
+
+static void parse_extract(const char *json, size_t len, bench_result_t *r)
+{
+    enum { F_CMD, F_SSID, F_TOKEN, F_CODE, F_SWITCH, F_NUM };
+    json_field_t fields[F_NUM] = {
+        [F_CMD]    = { .path = "cmdType",   .type = JSON_FIELD_INT },
+        [F_SSID]   = { .path = "ssid",      .type = JSON_FIELD_STR, .buf = r->ssid,  .buf_size = sizeof(r->ssid) },
+        [F_TOKEN]  = { .path = "token",     .type = JSON_FIELD_STR, .buf = r->token, .buf_size = sizeof(r->token) },
+        [F_CODE]   = { .path = "data.code", .type = JSON_FIELD_INT },
+        [F_SWITCH] = { .path = "switch",    .type = JSON_FIELD_INT },
+    };
+    json_extract_t ctx;
+
+    json_extract_init(&ctx, fields, F_NUM);
+    CHECK(json_extract_feed(&ctx, json, len) == 0);
+    CHECK(json_extract_finish(&ctx) == 0);
+
+    r->cmd_type = fields[F_CMD].found ? fields[F_CMD].value : -1;
+    r->data_code = fields[F_CODE].found ? fields[F_CODE].value : -1;
+    r->sw = fields[F_SWITCH].found ? fields[F_SWITCH].value : -1;
+}
+
+#ifdef HOST_TEST_HAVE_CJSON
+static void *cjson_malloc(size_t size)
+{
+    return __wrap_malloc(size);
+}
+
+static void cjson_free(void *ptr)
+{
+    __wrap_free(ptr);
+}
+
+static void cjson_copy_str(const cJSON *root, const char *name, char *buf, size_t size)
+{
+    const cJSON *item = cJSON_GetObjectItem(root, name);
+    buf[0] = '\0';
+    if (cJSON_IsString(item)) {
+        snprintf(buf, size, "%s", item->valuestring);
+    }
+}
+
+// 改动前 bemfa.c 和 user_http_api.c 的做法：整棵树解析后按名字取值
+static void parse_cjson(const char *json, size_t len, bench_result_t *r)
+{
+    cJSON *root = cJSON_ParseWithLength(json, len);
+    CHECK(root != NULL);
+
+    const cJSON *item = cJSON_GetObjectItem(root, "cmdType");
+    r->cmd_type = cJSON_IsNumber(item) ? item->valueint : -1;
+    cjson_copy_str(root, "ssid", r->ssid, sizeof(r->ssid));
+    cjson_copy_str(root, "token", r->token, sizeof(r->token));
+    item = cJSON_GetObjectItem(cJSON_GetObjectItem(root, "data"), "code");
+    r->data_code = cJSON_IsNumber(item) ? item->valueint : -1;
+    item = cJSON_GetObjectItem(root, "switch");
+    r->sw = cJSON_IsBool(item) ? cJSON_IsTrue(item) : -1;
+
+    cJSON_Delete(root);
+}
+#endif
+
+typedef void (*parse_fn_t)(const char *json, size_t len, bench_result_t *r);
+
+// 返回每条消息的耗时（ns），分配统计只取第一轮，避免计数本身拖慢计时
+static double bench_run(parse_fn_t parse, const bench_msg_t *msg, bench_result_t *r, heap_stats_t *heap)
+{
+    size_t len = strlen(msg->json);
+
+    heap_begin();
+    parse(msg->json, len, r);
+    heap_end();
+    *heap = g_heap;
+
+    int64_t start = host_now_us();
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        parse(msg->json, len, r);
+    }
+    int64_t elapsed = host_now_us() - start;
+
+    return elapsed * 1000.0 / BENCH_ROUNDS;
+}
+
+int main(void)
+{
+#ifdef HOST_TEST_HAVE_CJSON
+    cJSON_Hooks hooks = { .malloc_fn = cjson_malloc, .free_fn = cjson_free };
+    cJSON_InitHooks(&hooks);
+#else
+    printf("cJSON not found (set IDF_PATH or install libcjson), comparison skipped\n");
+#endif
+
+    printf("json_extract state %zu bytes on stack\n", sizeof(json_extract_t));
+
+    for (size_t i = 0; i < BENCH_MSG_CNT; i++) {
+        const bench_msg_t *msg = &g_msgs[i];
+        bench_result_t extract;
+        heap_stats_t heap;
+
+        double extract_ns = bench_run(parse_extract, msg, &extract, &heap);
+        CHECK(heap.allocs == 0 && heap.peak == 0);
+        printf("%-8s %3zu bytes: json_extract %6.1f ns, 0 allocs, 0 peak heap\n",
+               msg->name, strlen(msg->json), extract_ns);
+
+#ifdef HOST_TEST_HAVE_CJSON
+        bench_result_t cjson;
+        double cjson_ns = bench_run(parse_cjson, msg, &cjson, &heap);
+        printf("%-8s %3zu bytes: cJSON        %6.1f ns, %llu allocs, %zu peak heap\n",
+               msg->name, strlen(msg->json), cjson_ns, (unsigned long long)heap.allocs, heap.peak);
+        CHECK(heap.allocs > 0);
+
+        // 两条路径取出的值必须一致
+        CHECK(extract.cmd_type == cjson.cmd_type);
+        CHECK(strcmp(extract.ssid, cjson.ssid) == 0);
+        CHECK(strcmp(extract.token, cjson.token) == 0);
+        CHECK(extract.data_code == cjson.data_code);
+        CHECK(extract.sw == cjson.sw);
+#endif
+    }
+
+    printf("bench_json_extract ok\n");
+
+    return 0;
+}
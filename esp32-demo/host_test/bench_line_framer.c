@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "host_test.h"
+#include "line_framer.h"
+
+/*
+ * line_framer 的吞吐量：按不同的 TCP 分段大小写入推送和应答混合的字节流，统计 frames/s 和 MB/s，
+ * 并与常见的拷贝式切分对比（每段 strstr 找 \r\n，整行拷到行缓冲区，余下的半包 memmove 到开头）
+ */
+
+#define BENCH_BUF_SIZE      512         // 与 BEMFA_TCP_RX_BUFFER_SIZE 相同
+#define BENCH_STREAM_SIZE   (64 * 1024)
+#define BENCH_ROUNDS        200
+#define BENCH_MIN_SPEEDUP   1.0         // 每种分段大小都不能比拷贝式切分慢
+
+static const char *g_lines[] = {
+    "cmd=2&uid=0123456789abcdef0123456789abcdef&topic=esp32switch01006&msg=on\r\n",
+    "cmd=2&res=1\r\n",
+    "cmd=0&res=1\r\n",
+    "cmd=2&uid=0123456789abcdef0123456789abcdef&topic=esp32switch01006"
+    "&msg={\"switch\":true,\"brightness\":80,\"color\":\"ffcc00\",\"scene\":\"reading\"}\r\n",
+};
+
+#define BENCH_LINE_CNT  (sizeof(g_lines) / sizeof(g_lines[0]))
+
+static char g_stream[BENCH_STREAM_SIZE];
+static size_t g_stream_len;
+static int g_stream_frames;
+static int g_frame_num;
+static size_t g_frame_bytes;
+
+static void bench_cb(char *frame, size_t len, void *arg)
+{
+    g_frame_num++;
+    g_frame_bytes += len;
+}
+
+/* ---------- 作为对比的拷贝式切分 ---------- */
+
+typedef struct {
+    char buf[BENCH_BUF_SIZE];
+    char line[BENCH_BUF_SIZE];
+    size_t used;
+} copy_framer_t;
+
+static void copy_framer_feed(copy_framer_t *cf, const char *data, size_t len)
+{
+    while (len > 0) {
+        size_t n = sizeof(cf->buf) - 1 - cf->used;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(cf->buf + cf->used, data, n);
+        cf->used += n;
+        cf->buf[cf->used] = '\0';
+        data += n;
+        len -= n;
+
+        char *start = cf->buf;
+        char *end;
+        while ((end = strstr(start, "\r\n")) != NULL) {
+            size_t line_len = end - start;
+            memcpy(cf->line, start, line_len);
+            cf->line[line_len] = '\0';
+            bench_cb(cf->line, line_len, NULL);
+            start = end + 2;
+        }
+        cf->used -= start - cf->buf;
+        memmove(cf->buf, start, cf->used);
+        CHECK(cf->used < sizeof(cf->buf) - 1);
+    }
+}
+
+/* ---------- 对比 ---------- */
+
+// 按 segment 字节一段写入，与 bemfa_tcp.c 中 recv 到 get_space 返回的空间相同
+static void framer_feed(line_framer_t *framer, const char *data, size_t len, size_t segment)
+{
+    while (len > 0) {
+        size_t space = 0;
+        char *wr = line_framer_get_space(framer, &space);
+        size_t n = len < space ? len : space;
+        if (n > segment) {
+            n = segment;
+        }
+        memcpy(wr, data, n);
+        line_framer_commit(framer, n);
+        data += n;
+        len -= n;
+    }
+}
+
+static double bench_run(size_t segment, bool copy)
+{
+    char buf[BENCH_BUF_SIZE];
+    line_framer_t framer;
+    copy_framer_t cf = { .used = 0 };
+
+    line_framer_init(&framer, buf, sizeof(buf), bench_cb, NULL);
+    g_frame_num = 0;
+    g_frame_bytes = 0;
+
+    int64_t start = host_now_us();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        for (size_t off = 0; off < g_stream_len; off += segment) {
+            size_t n = g_stream_len - off < segment ? g_stream_len - off : segment;
+            if (copy) {
+                copy_framer_feed(&cf, g_stream + off, n);
+            } else {
+                framer_feed(&framer, g_stream + off, n, segment);
+            }
+        }
+    }
+    int64_t elapsed = host_now_us() - start;
+
+    // 两种做法交付的行数和字节数都必须与构造的字节流一致
+    CHECK(g_frame_num == g_stream_frames * BENCH_ROUNDS);
+    CHECK(g_frame_bytes == (g_stream_len - 2 * (size_t)g_stream_frames) * BENCH_ROUNDS);
+    if (!copy) {
+        CHECK(framer.frame_cnt == (uint32_t)g_frame_num);
+        CHECK(framer.oversize_cnt == 0);
+    }
+
+    return elapsed * 1000.0 / g_frame_num;
+}
+
+int main(void)
+{
+    // 依次拼接各种消息，直到填满字节流
+    for (size_t i = 0;; i++) {
+        const char *line = g_lines[i % BENCH_LINE_CNT];
+        size_t len = strlen(line);
+        if (g_stream_len + len > sizeof(g_stream)) {
+            break;
+        }
+        memcpy(g_stream + g_stream_len, line, len);
+        g_stream_len += len;
+        g_stream_frames++;
+    }
+
+    // 一个 MSS、常见的小分段，以及每段只有几个字节的极端拆包
+    const size_t segments[] = { 1460, 128, 7 };
+    for (size_t i = 0; i < sizeof(segments) / sizeof(segments[0]); i++) {
+        double framer_ns = bench_run(segments[i], false);
+        double copy_ns = bench_run(segments[i], true);
+        double mb_s = g_stream_len / (framer_ns * g_stream_frames) * 1000.0;
+        printf("segment %4zu: line_framer %6.1f ns/frame (%.2f Mframes/s, %6.1f MB/s), copy %6.1f ns/frame (%.1fx)\n",
+               segments[i], framer_ns, 1000.0 / framer_ns, mb_s, copy_ns, copy_ns / framer_ns);
+        fflush(stdout);
+        CHECK(copy_ns / framer_ns > BENCH_MIN_SPEEDUP);
+    }
+
+    printf("bench_line_framer ok\n");
+
+    return 0;
+}
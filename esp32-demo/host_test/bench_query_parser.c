@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "host_test.h"
+#include "query_parser.h"
+
+/*
+ * query_parse 与改动前 bemfa.c 中 parse_query_value 的对比
+ * 每条消息按 bemfa_tcp.c 的用法取 cmd、res、msg、topic；旧做法每个 key 都要 snprintf 加一次 strstr，
+ * 新做法解析一遍后查表。新做法的计时包含把消息复制到可写缓冲区。
+ */
+
+#define BENCH_ROUNDS        1000000
+#define BENCH_MIN_SPEEDUP   1.0     // 每种消息都不能比旧做法慢
+
+/* ---------- 改动前的实现（98da5cd bemfa.c），只作对比 ---------- */
+
+static void old_trim_trailing_whitespace(char *str)
+{
+    if (!str) return;
+
+    size_t len = strlen(str);
+    if (len == 0) return;
+
+    while (len > 0) {
+        unsigned char c = str[len - 1];
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            len--;
+        } else {
+            break;
+        }
+    }
+    str[len] = '\0';
+}
+
+static bool parse_query_value(const char *query, const char *key, char *out_val, size_t out_len)
+{
+    if (!query || !key || !out_val || out_len == 0) {
+        return false;
+    }
+
+    char key_with_eq[64];
+    int key_len = strlen(key);
+    if (key_len + 2 >= sizeof(key_with_eq)) {
+        return false;
+    }
+    snprintf(key_with_eq, sizeof(key_with_eq), "%s=", key);
+
+    const char *p = strstr(query, key_with_eq);
+    if (!p) {
+        return false;
+    }
+
+    p += strlen(key_with_eq);
+
+    const char *end = strchr(p, '&');
+    size_t val_len;
+    if (end) {
+        val_len = end - p;
+    } else {
+        val_len = strlen(p);
+    }
+
+    if (val_len >= out_len) {
+        val_len = out_len - 1;
+    }
+
+    memcpy(out_val, p, val_len);
+    out_val[val_len] = '\0';
+
+    old_trim_trailing_whitespace(out_val);
+    return true;
+}
+
+/* ---------- 对比 ---------- */
+
+typedef struct {
+    const char *name;
+    const char *frame;
+} bench_msg_t;
+
+static const bench_msg_t g_msgs[] = {
+    { "push", "cmd=2&uid=0123456789abcdef0123456789abcdef&topic=esp32switch01006&msg=on\r\n" },
+    { "ack", "cmd=2&res=1\r\n" },
+    { "long", "cmd=2&uid=0123456789abcdef0123456789abcdef&topic=esp32switch01006"
+              "&msg={\"switch\":true,\"brightness\":80,\"color\":\"ffcc00\",\"scene\":\"reading\"}\r\n" },
+};
+
+#define BENCH_MSG_CNT   (sizeof(g_msgs) / sizeof(g_msgs[0]))
+
+typedef struct {
+    char cmd[8];
+    char res[8];
+    char topic[64];
+    char msg[128];
+} bench_result_t;
+
+static void copy_value(const query_table_t *table, const char *key, char *out, size_t out_len)
+{
+    size_t val_len = 0;
+    const char *val = query_get(table, key, &val_len);
+
+    snprintf(out, out_len, "%.*s", val ? (int)val_len : 0, val ? val : "");
+}
+
+static void parse_new(const char *frame, size_t len, bench_result_t *r, bool copy_out)
+{
+    char buf[256];
+    query_table_t table;
+
+    memcpy(buf, frame, len + 1);
+    query_parse(buf, len, &table);
+    if (copy_out) {
+        copy_value(&table, "cmd", r->cmd, sizeof(r->cmd));
+        copy_value(&table, "res", r->res, sizeof(r->res));
+        copy_value(&table, "topic", r->topic, sizeof(r->topic));
+        copy_value(&table, "msg", r->msg, sizeof(r->msg));
+    } else {
+        // 与 bemfa_tcp_handle_frame 相同的查找，值直接在缓冲区里使用
+        r->cmd[0] = query_value_equals(&table, "cmd", "2");
+        r->res[0] = query_get(&table, "res", NULL) != NULL;
+        r->topic[0] = query_get(&table, "topic", NULL) != NULL;
+        r->msg[0] = query_get(&table, "msg", NULL) != NULL;
+    }
+}
+
+static void parse_old(const char *frame, size_t len, bench_result_t *r, bool copy_out)
+{
+    if (!parse_query_value(frame, "cmd", r->cmd, sizeof(r->cmd))) {
+        r->cmd[0] = '\0';
+    }
+    if (!parse_query_value(frame, "res", r->res, sizeof(r->res))) {
+        r->res[0] = '\0';
+    }
+    if (!parse_query_value(frame, "topic", r->topic, sizeof(r->topic))) {
+        r->topic[0] = '\0';
+    }
+    if (!parse_query_value(frame, "msg", r->msg, sizeof(r->msg))) {
+        r->msg[0] = '\0';
+    }
+}
+
+typedef void (*parse_fn_t)(const char *frame, size_t len, bench_result_t *r, bool copy_out);
+
+static double bench_run(parse_fn_t parse, const char *frame, size_t len)
+{
+    bench_result_t r;
+
+    int64_t start = host_now_us();
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        parse(frame, len, &r, false);
+        // 防止编译器把循环体当作无副作用去掉
+        __asm__ volatile("" : : "r"(&r) : "memory");
+    }
+    int64_t elapsed = host_now_us() - start;
+
+    return elapsed * 1000.0 / BENCH_ROUNDS;
+}
+
+int main(void)
+{
+    for (size_t i = 0; i < BENCH_MSG_CNT; i++) {
+        const bench_msg_t *msg = &g_msgs[i];
+        size_t len = strlen(msg->frame);
+        bench_result_t new_r, old_r;
+
+        // 不含转义和重名前缀的消息上，两种做法取出的值必须相同
+        parse_new(msg->frame, len, &new_r, true);
+        parse_old(msg->frame, len, &old_r, true);
+        CHECK(strcmp(new_r.cmd, old_r.cmd) == 0);
+        CHECK(strcmp(new_r.res, old_r.res) == 0);
+        CHECK(strcmp(new_r.topic, old_r.topic) == 0);
+        CHECK(strcmp(new_r.msg, old_r.msg) == 0);
+
+        double new_ns = bench_run(parse_new, msg->frame, len);
+        double old_ns = bench_run(parse_old, msg->frame, len);
+        printf("%-5s %3zu bytes: query_parse %6.1f ns, parse_query_value x4 %6.1f ns (%.1fx)\n",
+               msg->name, len, new_ns, old_ns, old_ns / new_ns);
+        fflush(stdout);
+        CHECK(old_ns / new_ns > BENCH_MIN_SPEEDUP);
+    }
+
+    // 旧做法按子串查找，uid 会匹配到 xuid
+    char val[32];
+    query_table_t table;
+    char frame[] = "xuid=attacker&uid=device";
+    CHECK(parse_query_value(frame, "uid", val, sizeof(val)) && strcmp(val, "attacker") == 0);
+    query_parse(frame, strlen(frame), &table);
+    CHECK(query_value_equals(&table, "uid", "device"));
+
+    printf("bench_query_parser ok\n");
+
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "host_test.h"
+#include "topic_table.h"
+
+/*
+ * 1/16/64 个主题时的分发耗时，并与逐个 strcmp 的线性查找对比
+ * 哈希分发的耗时应基本不随主题数增长
+ */
+
+#define BENCH_ROUNDS        2000000
+#define BENCH_MAX_RATIO     4       // 64 个主题相对 1 个主题的最大耗时倍数
+
+static topic_table_t g_table;
+static char g_names[TOPIC_TABLE_MAX][TOPIC_NAME_MAX_LEN];
+static size_t g_name_lens[TOPIC_TABLE_MAX];
+static uint32_t g_hits[TOPIC_TABLE_MAX];
+
+static void bench_handler(const char *topic, const char *msg, size_t msg_len, void *arg)
+{
+    g_hits[(intptr_t)arg]++;
+}
+
+// 作为对比的线性查找
+static int linear_dispatch(int count, const char *topic, const char *msg, size_t msg_len)
+{
+    for (int i = 0; i < count; i++) {
+        if (strcmp(g_names[i], topic) == 0) {
+            bench_handler(topic, msg, msg_len, (void *)(intptr_t)i);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static double bench_run(int count, bool linear)
+{
+    memset(g_hits, 0, sizeof(g_hits));
+
+    int64_t start = host_now_us();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        int i = r % count;
+        int ret = linear ? linear_dispatch(count, g_names[i], "on", 2)
+                  : topic_table_dispatch(&g_table, g_names[i], g_name_lens[i], "on", 2);
+        CHECK(ret == 0);
+    }
+    int64_t elapsed = host_now_us() - start;
+
+    // 每个主题都只分发到自己的处理函数
+    for (int i = 0; i < count; i++) {
+        CHECK(g_hits[i] == (uint32_t)(BENCH_ROUNDS / count + (i < BENCH_ROUNDS % count)));
+    }
+
+    return elapsed * 1000.0 / BENCH_ROUNDS;
+}
+
+static double bench_topics(int count)
+{
+    topic_table_init(&g_table);
+    for (int i = 0; i < count; i++) {
+        CHECK(topic_table_add(&g_table, g_names[i], bench_handler, (void *)(intptr_t)i) == i);
+    }
+    CHECK(topic_table_count(&g_table) == count);
+
+    // 分发时处理函数和参数不加锁读取，已注册的主题不能换成别的；相同的注册返回原下标
+    for (int i = 0; i < count; i++) {
+        CHECK(topic_table_add(&g_table, g_names[i], bench_handler, (void *)(intptr_t)i) == i);
+        CHECK(topic_table_add(&g_table, g_names[i], bench_handler, (void *)(intptr_t)(i + 1)) == -1);
+        CHECK(topic_table_add(&g_table, g_names[i], NULL, (void *)(intptr_t)i) == -1);
+    }
+    CHECK(topic_table_count(&g_table) == count);
+    if (count == TOPIC_TABLE_MAX) {
+        CHECK(topic_table_add(&g_table, "overflow", bench_handler, NULL) == -1);
+    }
+
+    // 未注册的主题和前缀相同的主题都不能命中
+    CHECK(topic_table_dispatch(&g_table, "unknown", 7, "on", 2) == -1);
+    CHECK(topic_table_dispatch(&g_table, g_names[0], g_name_lens[0] - 1, "on", 2) == -1);
+    CHECK(g_table.miss_cnt == 2);
+
+    double hash_ns = bench_run(count, false);
+    double linear_ns = bench_run(count, true);
+    printf("%2d topics: hash %6.1f ns, linear %6.1f ns per dispatch\n", count, hash_ns, linear_ns);
+
+    return hash_ns;
+}
+
+int main(void)
+{
+    // 与巴法云主题相同的长度和前缀，线性查找要比较到最后几个字符
+    for (int i = 0; i < TOPIC_TABLE_MAX; i++) {
+        g_name_lens[i] = snprintf(g_names[i], TOPIC_NAME_MAX_LEN, "esp32switch%06d", i);
+    }
+
+    double one = bench_topics(1);
+    bench_topics(16);
+    double full = bench_topics(TOPIC_TABLE_MAX);
+    CHECK(full < one * BENCH_MAX_RATIO);
+
+    return 0;
+}
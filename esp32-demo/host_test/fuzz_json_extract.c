@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "host_test.h"
+#include "json_extract.h"
+
+// 供 fuzz_main.c 生成输入，libFuzzer 下不使用
+const char g_fuzz_alphabet[] = "{}[]\":,\\u0d8Ae.-tn ";
+const char *const g_fuzz_seeds[] = {
+    "{\"cmdType\":1,\"ssid\":\"home\",\"password\":\"12345678\",\"token\":\"0123456789abcdef\"}",
+    "{\"code\":0,\"message\":\"ok\",\"data\":{\"code\":40000,\"list\":[1,{\"code\":2}]}}",
+    "{\"switch\":true,\"bemfa_topic\":\"\\u4e2d\\ud83d\\ude00\\n\",\"x\":-1.5e3,\"y\":null}",
+};
+const int g_fuzz_seed_cnt = sizeof(g_fuzz_seeds) / sizeof(g_fuzz_seeds[0]);
+
+#define FIELD_CNT   5
+
+typedef struct {
+    json_field_t fields[FIELD_CNT];
+    char ssid[8];               // 故意很小，走截断分支
+    char token[33];
+    char code_str[16];
+    int feed_ret;
+    int finish_ret;
+} result_t;
+
+static void result_init(result_t *r)
+{
+    memset(r, 0, sizeof(result_t));
+    r->fields[0] = (json_field_t){ .path = "cmdType", .type = JSON_FIELD_INT };
+    r->fields[1] = (json_field_t){ .path = "ssid", .type = JSON_FIELD_STR, .buf = r->ssid, .buf_size = sizeof(r->ssid) };
+    r->fields[2] = (json_field_t){ .path = "token", .type = JSON_FIELD_STR, .buf = r->token, .buf_size = sizeof(r->token) };
+    r->fields[3] = (json_field_t){ .path = "data.code", .type = JSON_FIELD_INT };
+    r->fields[4] = (json_field_t){ .path = "data.code", .type = JSON_FIELD_STR, .buf = r->code_str, .buf_size = sizeof(r->code_str) };
+}
+
+// step 为 0 时一次喂完，否则每次喂 step 字节
+static void run(result_t *r, const char *data, size_t size, size_t step)
+{
+    json_extract_t ctx;
+
+    result_init(r);
+    json_extract_init(&ctx, r->fields, FIELD_CNT);
+
+    if (step == 0) {
+        step = size;
+    }
+    r->feed_ret = 0;
+    for (size_t off = 0; off < size && r->feed_ret == 0; off += step) {
+        size_t n = size - off < step ? size - off : step;
+        r->feed_ret = json_extract_feed(&ctx, data + off, n);
+    }
+    r->finish_ret = json_extract_finish(&ctx);
+
+    CHECK(ctx.depth >= 0 && ctx.depth <= JSON_EXTRACT_DEPTH_MAX);
+    CHECK(r->feed_ret == 0 || r->finish_ret == -1);
+}
+
+static void check_result(const result_t *r)
+{
+    for (int i = 0; i < FIELD_CNT; i++) {
+        const json_field_t *f = &r->fields[i];
+        if (f->type == JSON_FIELD_STR) {
+            CHECK(f->len < f->buf_size);
+            CHECK(f->buf[f->len] == '\0');
+            CHECK(!f->truncated || f->found);
+        }
+    }
+}
+
+static void check_same(const result_t *a, const result_t *b)
+{
+    CHECK(a->feed_ret == b->feed_ret);
+    CHECK(a->finish_ret == b->finish_ret);
+    // 出错后字段内容没有意义，只比较成功解析的结果
+    if (a->finish_ret != 0) {
+        return;
+    }
+    for (int i = 0; i < FIELD_CNT; i++) {
+        const json_field_t *fa = &a->fields[i];
+        const json_field_t *fb = &b->fields[i];
+        CHECK(fa->found == fb->found && fa->truncated == fb->truncated);
+        CHECK(fa->value == fb->value && fa->len == fb->len);
+        if (fa->type == JSON_FIELD_STR) {
+            CHECK(memcmp(fa->buf, fb->buf, fa->len) == 0);
+        }
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static result_t whole, split, bytes;
+
+    // 按实际长度分配，越界读由 ASan 捕获
+    char *buf = malloc(size ? size : 1);
+    if (buf == NULL) {
+        return 0;
+    }
+    memcpy(buf, data, size);
+
+    run(&whole, buf, size, 0);
+    check_result(&whole);
+
+    // 任意切分方式的结果必须和一次喂完相同
+    size_t step = size ? 1 + data[0] % size : 1;
+    run(&split, buf, size, step);
+    check_same(&whole, &split);
+
+    run(&bytes, buf, size, 1);
+    check_same(&whole, &bytes);
+
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/*
+ * 没有 libFuzzer 时的驱动：
+ *   fuzz_xxx <runs>          用固定种子生成 runs 个随机输入，一半纯随机，一半由种子样例变异而来
+ *   fuzz_xxx <file>...       逐个回放语料或崩溃样例
+ */
+
+#define FUZZ_MAX_LEN    256
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+/*
+ * 由各个 fuzz 目标提供：偏向分隔符的字母表和几条合法样例，
+ * 比均匀随机字节更容易走到各个分支
+ */
+extern const char g_fuzz_alphabet[];
+extern const char *const g_fuzz_seeds[];
+extern const int g_fuzz_seed_cnt;
+
+static uint8_t fuzz_byte(void)
+{
+    int r = rand();
+    return (r & 0x100) ? (uint8_t)r : (uint8_t)g_fuzz_alphabet[r % strlen(g_fuzz_alphabet)];
+}
+
+// 对种子样例做几次替换、插入、删除
+static size_t fuzz_mutate(uint8_t *buf)
+{
+    const char *seed = g_fuzz_seeds[rand() % g_fuzz_seed_cnt];
+    size_t len = strlen(seed);
+    memcpy(buf, seed, len);
+
+    int cnt = 1 + rand() % 8;
+    for (int i = 0; i < cnt; i++) {
+        size_t pos = len ? rand() % len : 0;
+        switch (rand() % 3) {
+            case 0:
+                if (len) {
+                    buf[pos] = fuzz_byte();
+                }
+                break;
+            case 1:
+                if (len < FUZZ_MAX_LEN) {
+                    memmove(buf + pos + 1, buf + pos, len - pos);
+                    buf[pos] = fuzz_byte();
+                    len++;
+                }
+                break;
+            default:
+                if (len) {
+                    memmove(buf + pos, buf + pos + 1, len - pos - 1);
+                    len--;
+                }
+                break;
+        }
+    }
+
+    return len;
+}
+
+static int fuzz_file(const char *path)
+{
+    static uint8_t buf[64 * 1024];
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        perror(path);
+        return -1;
+    }
+    size_t len = fread(buf, 1, sizeof(buf), fp);
+    fclose(fp);
+
+    LLVMFuzzerTestOneInput(buf, len);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t buf[FUZZ_MAX_LEN];
+    char *end = NULL;
+    long runs = argc > 1 ? strtol(argv[1], &end, 10) : 100000;
+
+    if (argc > 1 && *end != '\0') {
+        for (int i = 1; i < argc; i++) {
+            if (fuzz_file(argv[i]) != 0) {
+                return 1;
+            }
+        }
+        printf("replayed %d inputs\n", argc - 1);
+        return 0;
+    }
+
+    srand(1);
+    for (long i = 0; i < runs; i++) {
+        size_t len;
+        if (g_fuzz_seed_cnt > 0 && (i & 1)) {
+            len = fuzz_mutate(buf);
+        } else {
+            len = rand() % FUZZ_MAX_LEN;
+            for (size_t j = 0; j < len; j++) {
+                buf[j] = fuzz_byte();
+            }
+        }
+        LLVMFuzzerTestOneInput(buf, len);
+    }
+    printf("%ld runs ok\n", runs);
+
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "host_test.h"
+#include "query_parser.h"
+
+// 指针必须落在 [buf, buf + len] 内，且 ptr[plen] 是 '\0'
+static void check_span(const char *buf, size_t len, const char *ptr, size_t plen)
+{
+    CHECK(ptr >= buf && ptr + plen <= buf + len);
+    CHECK(ptr[plen] == '\0');
+}
+
+// 供 fuzz_main.c 生成输入，libFuzzer 下不使用
+const char g_fuzz_alphabet[] = "=&%0aF z\r\n\t";
+const char *const g_fuzz_seeds[] = {
+    "cmd=2&uid=0123456789abcdef&topic=light002&msg=on",
+    "cmd=1&res=1&topic=a%20b&msg=x+y",
+};
+const int g_fuzz_seed_cnt = sizeof(g_fuzz_seeds) / sizeof(g_fuzz_seeds[0]);
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    query_table_t table;
+
+    // 按接口约定只多分配一个字节给 '\0'，越界写由 ASan 捕获
+    char *buf = malloc(size + 1);
+    if (buf == NULL) {
+        return 0;
+    }
+    memcpy(buf, data, size);
+
+    int count = query_parse(buf, size, &table);
+
+    CHECK(count == table.count);
+    CHECK(count >= 0 && count <= QUERY_MAX_PAIRS);
+    CHECK(!table.truncated || count == QUERY_MAX_PAIRS);
+
+    for (int i = 0; i < count; i++) {
+        const query_pair_t *pair = &table.pairs[i];
+        CHECK(pair->key_len > 0);
+        check_span(buf, size, pair->key, pair->key_len);
+        check_span(buf, size, pair->val, pair->val_len);
+
+        // 不含 '\0' 的 key 必须查回同名的第一项
+        if (strlen(pair->key) == pair->key_len) {
+            int first = 0;
+            while (table.pairs[first].key_len != pair->key_len ||
+                   memcmp(table.pairs[first].key, pair->key, pair->key_len) != 0) {
+                first++;
+            }
+            CHECK(query_get(&table, pair->key, NULL) == table.pairs[first].val);
+        }
+    }
+
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+
+#include "host_test.h"
+#include "protocol.h"
+#include "bemfa.h"
+#include "mock_bemfa_server.h"
+
+#define MOCK_POLL_US        20000       // 检查 stop 标志的间隔
+
+static bool wait_readable(int sock)
+{
+    fd_set rfds;
+    struct timeval tv = { .tv_sec = 0, .tv_usec = MOCK_POLL_US };
+
+    FD_ZERO(&rfds);
+    FD_SET(sock, &rfds);
+    return select(sock + 1, &rfds, NULL, NULL, &tv) > 0;
+}
+
+static bool mock_stopped(mock_server_t *srv)
+{
+    return __atomic_load_n(&srv->stop, __ATOMIC_ACQUIRE);
+}
+
+// 调用前需持有 srv->lock
+static void send_locked(mock_server_t *srv, const char *buf, size_t len)
+{
+    if (srv->sock >= 0) {
+        CHECK(send(srv->sock, buf, len, MSG_NOSIGNAL) == (ssize_t)len || errno == EPIPE || errno == ECONNRESET);
+    }
+}
+
+static void handle_line(mock_server_t *srv, const char *line)
+{
+    char out[2 * MOCK_SERVER_LINE_MAX];
+    int len = 0;
+
+    pthread_mutex_lock(&srv->lock);
+
+    int seen = 0;
+    const char *msg = strstr(line, "&msg=");
+    if (strncmp(line, "cmd=2&", 6) == 0 && msg) {
+        for (int i = 0; i < srv->line_cnt; i++) {
+            const char *prev = strstr(srv->lines[i].line, "&msg=");
+            seen += prev && strcmp(prev, msg) == 0;
+        }
+    }
+
+    CHECK(srv->line_cnt < MOCK_SERVER_LINES);
+    mock_line_t *rec = &srv->lines[srv->line_cnt++];
+    CHECK(strlen(line) < sizeof(rec->line));
+    strcpy(rec->line, line);
+    rec->rx_us = host_now_us();
+
+    if (strncmp(line, "cmd=3&", 6) == 0) {
+        len = snprintf(out, sizeof(out), "cmd=3&res=1\r\n");
+    } else if (strcmp(line, "ping") == 0) {
+        if (!srv->ignore_ping) {
+            len = snprintf(out, sizeof(out), "cmd=0&res=1\r\n");
+        }
+    } else if (strncmp(line, "cmd=2&", 6) == 0 && msg) {
+        // 推送和应答放在同一次 send 中，客户端要从一个数据段中拆出两行
+        if (srv->push_topic) {
+            len = snprintf(out, sizeof(out), "cmd=2&uid=mock&topic=%s&msg=push%d\r\n", srv->push_topic, srv->pushes++);
+        }
+        int res = srv->publish_res ? srv->publish_res(msg + 5, seen) : 1;
+        len += snprintf(out + len, sizeof(out) - len, "cmd=2&res=%d\r\n", res);
+    }
+
+    if (len > 0) {
+        send_locked(srv, out, len);
+    }
+    pthread_mutex_unlock(&srv->lock);
+}
+
+// 按行处理一个连接，直到对端关闭或停止
+static void serve_connection(mock_server_t *srv, int sock)
+{
+    char buf[4 * MOCK_SERVER_LINE_MAX];
+    size_t used = 0;
+
+    while (!mock_stopped(srv)) {
+        if (!wait_readable(sock)) {
+            continue;
+        }
+
+        ssize_t n = recv(sock, buf + used, sizeof(buf) - 1 - used, 0);
+        if (n <= 0) {
+            return;
+        }
+        used += n;
+        buf[used] = '\0';
+
+        char *line = buf;
+        char *end;
+        while ((end = strstr(line, "\r\n")) != NULL) {
+            *end = '\0';
+            handle_line(srv, line);
+            line = end + 2;
+        }
+        used -= line - buf;
+        memmove(buf, line, used);
+        CHECK(used < sizeof(buf) - 1);
+    }
+}
+
+static void *mock_server_thread(void *arg)
+{
+    mock_server_t *srv = arg;
+
+    while (!mock_stopped(srv)) {
+        if (!wait_readable(srv->listen_sock)) {
+            continue;
+        }
+
+        int sock = accept(srv->listen_sock, NULL, NULL);
+        CHECK(sock >= 0);
+        pthread_mutex_lock(&srv->lock);
+        srv->sock = sock;
+        srv->accepts++;
+        pthread_mutex_unlock(&srv->lock);
+
+        serve_connection(srv, sock);
+
+        pthread_mutex_lock(&srv->lock);
+        srv->sock = -1;
+        pthread_mutex_unlock(&srv->lock);
+        close(sock);
+    }
+
+    return NULL;
+}
+
+int mock_server_start(mock_server_t *srv, int port)
+{
+    struct sockaddr_in in = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+    };
+    int one = 1;
+
+    srv->sock = -1;
+    srv->stop = false;
+    srv->accepts = 0;
+    srv->pushes = 0;
+    srv->line_cnt = 0;
+    pthread_mutex_init(&srv->lock, NULL);
+
+    srv->listen_sock = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(srv->listen_sock >= 0);
+    setsockopt(srv->listen_sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    CHECK(inet_pton(AF_INET, MOCK_SERVER_IP, &in.sin_addr) == 1);
+    if (bind(srv->listen_sock, (struct sockaddr *)&in, sizeof(in)) != 0 || listen(srv->listen_sock, 4) != 0) {
+        fprintf(stderr, "mock server listen on %s:%d failed: errno %d\n", MOCK_SERVER_IP, port, errno);
+        close(srv->listen_sock);
+        return -1;
+    }
+
+    CHECK(pthread_create(&srv->thread, NULL, mock_server_thread, srv) == 0);
+    return 0;
+}
+
+void mock_server_stop(mock_server_t *srv)
+{
+    __atomic_store_n(&srv->stop, true, __ATOMIC_RELEASE);
+    pthread_join(srv->thread, NULL);
+    close(srv->listen_sock);
+    pthread_mutex_destroy(&srv->lock);
+}
+
+int64_t mock_server_send(mock_server_t *srv, const char *line)
+{
+    char out[MOCK_SERVER_LINE_MAX + 2];
+    int len = snprintf(out, sizeof(out), "%s\r\n", line);
+    int64_t now = -1;
+
+    pthread_mutex_lock(&srv->lock);
+    if (srv->sock >= 0) {
+        now = host_now_us();
+        send_locked(srv, out, len);
+    }
+    pthread_mutex_unlock(&srv->lock);
+
+    return now;
+}
+
+int mock_server_line_count(mock_server_t *srv)
+{
+    pthread_mutex_lock(&srv->lock);
+    int cnt = srv->line_cnt;
+    pthread_mutex_unlock(&srv->lock);
+
+    return cnt;
+}
+
+void mock_server_get_line(mock_server_t *srv, int index, mock_line_t *out)
+{
+    pthread_mutex_lock(&srv->lock);
+    CHECK(index >= 0 && index < srv->line_cnt);
+    *out = srv->lines[index];
+    pthread_mutex_unlock(&srv->lock);
+}
+
+int mock_server_find(mock_server_t *srv, int from, const char *prefix)
+{
+    int found = -1;
+
+    pthread_mutex_lock(&srv->lock);
+    for (int i = from; i < srv->line_cnt && found < 0; i++) {
+        if (strncmp(srv->lines[i].line, prefix, strlen(prefix)) == 0) {
+            found = i;
+        }
+    }
+    pthread_mutex_unlock(&srv->lock);
+
+    return found;
+}
+
+int mock_server_accepts(mock_server_t *srv)
+{
+    pthread_mutex_lock(&srv->lock);
+    int cnt = srv->accepts;
+    pthread_mutex_unlock(&srv->lock);
+
+    return cnt;
+}
+
+/* ---------- protocol.c 的 DNS 接口，巴法云域名解析到模拟服务器 ---------- */
+
+int dns_resolve(const char *hostname, dns_result_t *result, int timeout_ms)
+{
+    struct sockaddr_in *in = (struct sockaddr_in *)&result->addrs[0];
+
+    CHECK(strcmp(hostname, BEMFA_SERVER_HOSTNAME) == 0);
+    memset(result, 0, sizeof(dns_result_t));
+    result->count = 1;
+    in->sin_family = AF_INET;
+    CHECK(inet_pton(AF_INET, MOCK_SERVER_IP, &in->sin_addr) == 1);
+    return 0;
+}
+
+int dns_resolve_async(const char *hostname, dns_resolve_cb_t cb, void *arg)
+{
+    return 0;
+}
+
+void dns_cache_invalidate(const char *hostname)
+{
+}
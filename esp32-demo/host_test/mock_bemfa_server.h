@@ -0,0 +1,63 @@
+#ifndef __MOCK_BEMFA_SERVER_H__
+#define __MOCK_BEMFA_SERVER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+/*
+ * 回环上的巴法云 TCP 服务器，在独立线程中按行应答：
+ *   cmd=3...  订阅应答 cmd=3&res=1
+ *   ping      心跳应答 cmd=0&res=1
+ *   cmd=2...  发布应答 cmd=2&res=<publish_res 的返回值>，可先推送一条 cmd=2&...&msg= 消息
+ * 收到的每一行都带时间记录下来；连接断开后继续等待下一个连接
+ * 同时提供 protocol.h 中的 dns_resolve 等接口，巴法云域名解析到 MOCK_SERVER_IP
+ */
+
+#define MOCK_SERVER_IP          "127.0.83.44"   // 回环上少用的地址，避免与本机的服务冲突
+#define MOCK_SERVER_LINES       256
+#define MOCK_SERVER_LINE_MAX    256
+
+typedef struct mock_server mock_server_t;
+
+// 返回发布应答的 res 值，seen 为此前收到过同样 msg 的次数；在服务器线程中调用
+typedef int (*mock_publish_res_t)(const char *msg, int seen);
+
+typedef struct {
+    char line[MOCK_SERVER_LINE_MAX];
+    int64_t rx_us;
+} mock_line_t;
+
+struct mock_server {
+    // 行为，启动前设置
+    mock_publish_res_t publish_res;     // NULL 时全部应答 res=1
+    const char *push_topic;             // 非 NULL 时每条发布应答前先推送一条 msg=push<序号> 的消息
+    bool ignore_ping;                   // 不应答心跳，模拟连接已失效
+
+    // 以下由服务器维护，通过接口读取
+    int listen_sock;
+    int sock;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    bool stop;
+    int accepts;
+    int pushes;
+    int line_cnt;
+    mock_line_t lines[MOCK_SERVER_LINES];
+};
+
+// 监听 MOCK_SERVER_IP:port 并启动服务线程
+int mock_server_start(mock_server_t *srv, int port);
+void mock_server_stop(mock_server_t *srv);
+
+// 从测试线程向当前连接发送一行（不含 \r\n），返回发送时间，没有连接返回 -1
+int64_t mock_server_send(mock_server_t *srv, const char *line);
+
+// 已收到的行数，以及第 index 行的快照
+int mock_server_line_count(mock_server_t *srv);
+void mock_server_get_line(mock_server_t *srv, int index, mock_line_t *out);
+// 第 from 行之后第一条以 prefix 开头的行，没有返回 -1
+int mock_server_find(mock_server_t *srv, int from, const char *prefix);
+int mock_server_accepts(mock_server_t *srv);
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef __HOST_ESP_ATTR_H__
+#define __HOST_ESP_ATTR_H__
+
+// 主机测试中没有 RTC 内存，由测试程序自行模拟掉电后的随机内容
+#define RTC_NOINIT_ATTR
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef __HOST_ESP_MAC_H__
+#define __HOST_ESP_MAC_H__
+
+// 主机测试用的 esp_mac.h，只提供打印 MAC 地址的宏
+#define MAC2STR(a)  (a)[0], (a)[1], (a)[2], (a)[3], (a)[4], (a)[5]
+#define MACSTR      "%02x:%02x:%02x:%02x:%02x:%02x"
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef __HOST_ESP_PARTITION_H__
+#define __HOST_ESP_PARTITION_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+/*
+ * 主机测试用的分区接口，分区保存在 RAM 中，行为与 NOR flash 一致：
+ * 写入只能把 1 变成 0，擦除按 erase_size 对齐后全部恢复为 0xFF。
+ * 另外提供模拟掉电的接口：写入指定字节数后停止，之后的写入和擦除全部失败。
+ */
+
+#define ESP_PARTITION_TYPE_DATA         0x01
+#define ESP_PARTITION_SUBTYPE_ANY       0xff
+#define HOST_PARTITION_ERASE_SIZE       4096
+
+typedef int esp_partition_type_t;
+typedef int esp_partition_subtype_t;
+
+typedef enum {
+    ESP_PARTITION_MMAP_DATA = 0,
+    ESP_PARTITION_MMAP_INST,
+} esp_partition_mmap_memory_t;
+
+typedef uint32_t esp_partition_mmap_handle_t;
+
+typedef struct {
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    uint32_t address;
+    uint32_t size;
+    uint32_t erase_size;
+    char label[17];
+    bool encrypted;
+} esp_partition_t;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label);
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t offset, void *dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *part, size_t offset, const void *src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t *part, size_t offset, size_t size);
+// 直接返回 RAM 中的分区数据，映射期间的写入立即可见
+esp_err_t esp_partition_mmap(const esp_partition_t *part, size_t offset, size_t size,
+                             esp_partition_mmap_memory_t memory, const void **out_ptr,
+                             esp_partition_mmap_handle_t *out_handle);
+void esp_partition_munmap(esp_partition_mmap_handle_t handle);
+
+// 创建擦除为 0xFF 的分区，同名分区只能有一个
+const esp_partition_t *host_partition_create(const char *label, esp_partition_subtype_t subtype, uint32_t size);
+void host_partition_remove_all(void);
+uint8_t *host_partition_data(const esp_partition_t *part);
+
+// 再写入 bytes 字节后掉电，bytes 为负数时恢复供电
+void host_partition_power_cut(int32_t bytes);
+bool host_partition_powered(void);
+
+typedef struct {
+    uint32_t writes;
+    uint32_t erases;
+    uint32_t bad_writes;        // 试图把 0 写成 1 的写入次数，正确的用法应为 0
+} host_partition_stats_t;
+
+void host_partition_get_stats(host_partition_stats_t *stats);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef __HOST_ESP_RANDOM_H__
+#define __HOST_ESP_RANDOM_H__
+
+#include <stdint.h>
+
+// 主机测试用的 esp_random.h，由测试程序实现，便于固定随机数
+uint32_t esp_random(void);
+
+#endif
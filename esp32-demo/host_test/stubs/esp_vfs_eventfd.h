@@ -0,0 +1,22 @@
+#ifndef __HOST_ESP_VFS_EVENTFD_H__
+#define __HOST_ESP_VFS_EVENTFD_H__
+
+#include <stddef.h>
+#include <sys/eventfd.h>
+
+#include "esp_err.h"
+
+// 主机测试用的 esp_vfs_eventfd.h，eventfd 由系统提供，不需要注册
+
+typedef struct {
+    size_t max_fds;
+} esp_vfs_eventfd_config_t;
+
+#define ESP_VFS_EVENTD_CONFIG_DEFAULT() (esp_vfs_eventfd_config_t) { .max_fds = 5, }
+
+static inline esp_err_t esp_vfs_eventfd_register(const esp_vfs_eventfd_config_t *config)
+{
+    return ESP_OK;
+}
+
+#endif
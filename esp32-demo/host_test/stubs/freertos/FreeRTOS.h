@@ -0,0 +1,55 @@
+#ifndef __HOST_FREERTOS_H__
+#define __HOST_FREERTOS_H__
+
+#include <stdint.h>
+#include <time.h>
+
+// 主机测试用的 FreeRTOS.h，只提供被测模块用到的类型和常量
+
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE          1
+#define pdFALSE         0
+#define portMAX_DELAY   0xffffffffUL
+#define portTICK_PERIOD_MS  1
+
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms) / portTICK_PERIOD_MS)
+
+// 超时的 tick 数换算成 pthread_cond_timedwait 的绝对时间，tick 即毫秒
+static inline void host_ticks_to_deadline(TickType_t ticks, struct timespec *deadline)
+{
+    clock_gettime(CLOCK_REALTIME, deadline);
+    if (ticks == portMAX_DELAY) {
+        return;
+    }
+    deadline->tv_sec += ticks / 1000;
+    deadline->tv_nsec += (long)(ticks % 1000) * 1000000;
+    if (deadline->tv_nsec >= 1000000000) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+// 临界区用自旋锁实现，多线程测试中同样互斥
+typedef struct {
+    int locked;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED    { 0 }
+
+static inline void host_mux_enter(portMUX_TYPE *mux)
+{
+    while (__atomic_exchange_n(&mux->locked, 1, __ATOMIC_ACQUIRE)) {
+    }
+}
+
+static inline void host_mux_exit(portMUX_TYPE *mux)
+{
+    __atomic_store_n(&mux->locked, 0, __ATOMIC_RELEASE);
+}
+
+#define portENTER_CRITICAL(mux)     host_mux_enter(mux)
+#define portEXIT_CRITICAL(mux)      host_mux_exit(mux)
+
+#endif
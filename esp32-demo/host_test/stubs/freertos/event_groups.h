@@ -0,0 +1,8 @@
+#ifndef __HOST_EVENT_GROUPS_H__
+#define __HOST_EVENT_GROUPS_H__
+
+#include "freertos/FreeRTOS.h"
+
+// 主机测试用的 event_groups.h，被测模块只包含不使用
+
+#endif
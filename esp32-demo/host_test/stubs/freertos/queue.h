@@ -0,0 +1,81 @@
+#ifndef __HOST_QUEUE_H__
+#define __HOST_QUEUE_H__
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "freertos/FreeRTOS.h"
+
+// 主机测试用的队列，固定长度的环形缓冲区，用互斥量和条件变量实现，支持超时
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    uint32_t length;
+    uint32_t item_size;
+    uint32_t head;
+    uint32_t count;
+    uint8_t items[];
+} host_queue_t;
+
+typedef host_queue_t *QueueHandle_t;
+
+static inline QueueHandle_t xQueueCreate(uint32_t length, uint32_t item_size)
+{
+    host_queue_t *q = calloc(1, sizeof(host_queue_t) + (size_t)length * item_size);
+    if (q) {
+        pthread_mutex_init(&q->mutex, NULL);
+        pthread_cond_init(&q->cond, NULL);
+        q->length = length;
+        q->item_size = item_size;
+    }
+    return q;
+}
+
+// 等待条件成立，超时返回 0；调用前需持有 q->mutex
+static inline int host_queue_wait(host_queue_t *q, int want_space, TickType_t ticks)
+{
+    struct timespec deadline;
+    int err = 0;
+
+    host_ticks_to_deadline(ticks, &deadline);
+    while ((want_space ? q->count == q->length : q->count == 0) && err == 0) {
+        err = ticks == portMAX_DELAY ? pthread_cond_wait(&q->cond, &q->mutex)
+                                     : pthread_cond_timedwait(&q->cond, &q->mutex, &deadline);
+    }
+    return want_space ? q->count < q->length : q->count > 0;
+}
+
+static inline BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+    pthread_mutex_lock(&q->mutex);
+    if (!host_queue_wait(q, 1, ticks)) {
+        pthread_mutex_unlock(&q->mutex);
+        return pdFALSE;
+    }
+    memcpy(q->items + (size_t)((q->head + q->count) % q->length) * q->item_size, item, q->item_size);
+    q->count++;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->mutex);
+
+    return pdTRUE;
+}
+
+static inline BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks)
+{
+    pthread_mutex_lock(&q->mutex);
+    if (!host_queue_wait(q, 0, ticks)) {
+        pthread_mutex_unlock(&q->mutex);
+        return pdFALSE;
+    }
+    memcpy(item, q->items + (size_t)q->head * q->item_size, q->item_size);
+    q->head = (q->head + 1) % q->length;
+    q->count--;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->mutex);
+
+    return pdTRUE;
+}
+
+#endif
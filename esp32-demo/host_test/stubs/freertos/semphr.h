@@ -0,0 +1,92 @@
+#ifndef __HOST_SEMPHR_H__
+#define __HOST_SEMPHR_H__
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "freertos/FreeRTOS.h"
+
+// 主机测试用的信号量：互斥量直接用 pthread_mutex 实现，忽略超时；二值信号量用条件变量实现，支持超时
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int binary;
+    int count;
+} host_sem_t;
+
+typedef host_sem_t *SemaphoreHandle_t;
+
+// 静态版本同样从堆上分配，测试进程退出时回收
+typedef struct {
+    host_sem_t sem;
+} StaticSemaphore_t;
+
+static inline SemaphoreHandle_t host_sem_init(host_sem_t *sem, int binary)
+{
+    pthread_mutex_init(&sem->mutex, NULL);
+    pthread_cond_init(&sem->cond, NULL);
+    sem->binary = binary;
+    sem->count = 0;
+    return sem;
+}
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    host_sem_t *sem = malloc(sizeof(host_sem_t));
+    return sem ? host_sem_init(sem, 0) : NULL;
+}
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buf)
+{
+    return host_sem_init(&buf->sem, 0);
+}
+
+static inline SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buf)
+{
+    return host_sem_init(&buf->sem, 1);
+}
+
+static inline void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    pthread_mutex_destroy(&sem->mutex);
+    pthread_cond_destroy(&sem->cond);
+    free(sem);
+}
+
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    if (!sem->binary) {
+        return pthread_mutex_lock(&sem->mutex) == 0 ? pdTRUE : pdFALSE;
+    }
+
+    struct timespec deadline;
+    host_ticks_to_deadline(ticks, &deadline);
+    pthread_mutex_lock(&sem->mutex);
+    int err = 0;
+    while (sem->count == 0 && err == 0) {
+        err = ticks == portMAX_DELAY ? pthread_cond_wait(&sem->cond, &sem->mutex)
+                                     : pthread_cond_timedwait(&sem->cond, &sem->mutex, &deadline);
+    }
+    BaseType_t ret = sem->count ? pdTRUE : pdFALSE;
+    sem->count = 0;
+    pthread_mutex_unlock(&sem->mutex);
+
+    return ret;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    if (!sem->binary) {
+        return pthread_mutex_unlock(&sem->mutex) == 0 ? pdTRUE : pdFALSE;
+    }
+
+    pthread_mutex_lock(&sem->mutex);
+    sem->count = 1;
+    pthread_cond_signal(&sem->cond);
+    pthread_mutex_unlock(&sem->mutex);
+
+    return pdTRUE;
+}
+
+#endif
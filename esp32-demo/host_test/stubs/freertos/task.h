@@ -0,0 +1,25 @@
+#ifndef __HOST_TASK_H__
+#define __HOST_TASK_H__
+
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+
+// 主机测试用的 task.h，任务接口由测试程序实现，通常是单线程的模拟
+
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *arg);
+
+#define pdPASS      pdTRUE
+
+#define taskENTER_CRITICAL(mux)     portENTER_CRITICAL(mux)
+#define taskEXIT_CRITICAL(mux)      portEXIT_CRITICAL(mux)
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks);
+void vTaskDelete(TaskHandle_t task);
+BaseType_t xTaskCreate(TaskFunction_t func, const char *name, uint32_t stack, void *arg,
+                       uint32_t prio, TaskHandle_t *out_task);
+
+#endif
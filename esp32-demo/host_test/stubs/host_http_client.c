@@ -0,0 +1,315 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "esp_http_client.h"
+
+// 主机测试用的 esp_http_client，见 esp_http_client.h
+
+#define HOST_HTTP_URL_MAX       256
+#define HOST_HTTP_HEADERS       4
+#define HOST_HTTP_HEADER_MAX    128
+#define HOST_HTTP_HEADER_SIZE   1024
+#define HOST_HTTP_RX_SIZE       512     // 与 ESP-IDF 默认的 buffer_size 相同，响应体按这个大小分段交给回调
+
+struct esp_http_client {
+    char url[HOST_HTTP_URL_MAX];
+    int timeout_ms;
+    http_event_handle_cb event_handler;
+    void *user_data;
+    esp_http_client_method_t method;
+    char headers[HOST_HTTP_HEADERS][HOST_HTTP_HEADER_MAX];
+    int header_cnt;
+    const char *post_data;
+    int post_len;
+    int sock;
+    struct sockaddr_in peer;            // 当前连接的对端，URL 换了主机时重新连接
+    int status;
+};
+
+static const char *g_method_names[] = { "GET", "POST", "PUT", "PATCH", "DELETE", "HEAD" };
+
+static void host_http_event(esp_http_client_handle_t client, esp_http_client_event_id_t id, void *data, int len)
+{
+    esp_http_client_event_t evt = {
+        .event_id = id,
+        .client = client,
+        .data = data,
+        .data_len = len,
+        .user_data = client->user_data,
+    };
+
+    if (client->event_handler) {
+        client->event_handler(&evt);
+    }
+}
+
+// 只支持 http://a.b.c.d:port/path
+static int host_http_parse_url(const char *url, struct sockaddr_in *addr, const char **path)
+{
+    char ip[16];
+    int port = 80;
+
+    if (strncmp(url, "http://", 7) != 0) {
+        return -1;
+    }
+    url += 7;
+    size_t len = strcspn(url, ":/");
+    if (len == 0 || len >= sizeof(ip)) {
+        return -1;
+    }
+    memcpy(ip, url, len);
+    ip[len] = '\0';
+    url += len;
+    if (*url == ':') {
+        port = atoi(url + 1);
+        url += 1 + strspn(url + 1, "0123456789");
+    }
+
+    memset(addr, 0, sizeof(struct sockaddr_in));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(port);
+    if (inet_pton(AF_INET, ip, &addr->sin_addr) != 1) {
+        return -1;
+    }
+    *path = (*url == '\0') ? "/" : url;
+    return 0;
+}
+
+static int host_http_connect(esp_http_client_handle_t client, const struct sockaddr_in *addr)
+{
+    struct timeval tv = { .tv_sec = client->timeout_ms / 1000, .tv_usec = (client->timeout_ms % 1000) * 1000 };
+
+    client->sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (client->sock < 0) {
+        return -1;
+    }
+    setsockopt(client->sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(client->sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    if (connect(client->sock, (const struct sockaddr *)addr, sizeof(struct sockaddr_in)) != 0) {
+        esp_http_client_close(client);
+        return -1;
+    }
+
+    client->peer = *addr;
+    host_http_event(client, HTTP_EVENT_ON_CONNECTED, NULL, 0);
+    return 0;
+}
+
+static int host_http_send_all(int sock, const char *data, int len)
+{
+    while (len > 0) {
+        ssize_t n = send(sock, data, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return -1;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// 读完响应头，返回头部之后已读到的正文字节数，body 中保存这部分正文
+static int host_http_read_header(esp_http_client_handle_t client, int *content_len, bool *close_conn,
+                                 char *body, int body_size)
+{
+    char buf[HOST_HTTP_HEADER_SIZE];
+    int used = 0;
+    char *end = NULL;
+
+    while (end == NULL) {
+        if (used == sizeof(buf) - 1) {
+            return -1;
+        }
+        ssize_t n = recv(client->sock, buf + used, sizeof(buf) - 1 - used, 0);
+        if (n <= 0) {
+            return -1;
+        }
+        used += n;
+        buf[used] = '\0';
+        end = strstr(buf, "\r\n\r\n");
+    }
+
+    if (sscanf(buf, "HTTP/1.%*d %d", &client->status) != 1) {
+        return -1;
+    }
+
+    *content_len = -1;
+    *close_conn = false;
+    for (char *line = strstr(buf, "\r\n") + 2; line < end; line = strstr(line, "\r\n") + 2) {
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            *content_len = atoi(line + 15);
+        } else if (strncasecmp(line, "Connection: close", 17) == 0) {
+            *close_conn = true;
+        }
+    }
+    if (*content_len < 0) {
+        return -1;
+    }
+
+    int extra = used - (int)(end + 4 - buf);
+    if (extra > body_size) {
+        return -1;
+    }
+    memcpy(body, end + 4, extra);
+    return extra;
+}
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config)
+{
+    esp_http_client_handle_t client = calloc(1, sizeof(struct esp_http_client));
+    if (client == NULL) {
+        return NULL;
+    }
+
+    snprintf(client->url, sizeof(client->url), "%s", config->url);
+    client->timeout_ms = config->timeout_ms > 0 ? config->timeout_ms : 5000;
+    client->event_handler = config->event_handler;
+    client->user_data = config->user_data;
+    client->sock = -1;
+    return client;
+}
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client)
+{
+    struct sockaddr_in addr;
+    const char *path = NULL;
+    char req[1024];
+    char body[HOST_HTTP_HEADER_SIZE];   // 与响应头一起收到的正文可能超过 HOST_HTTP_RX_SIZE
+    int content_len = 0;
+    bool close_conn = false;
+
+    if (host_http_parse_url(client->url, &addr, &path) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (client->sock >= 0 && memcmp(&client->peer, &addr, sizeof(addr)) != 0) {
+        esp_http_client_close(client);
+    }
+    if (client->sock < 0 && host_http_connect(client, &addr) != 0) {
+        return ESP_FAIL;
+    }
+
+    int len = snprintf(req, sizeof(req), "%s %s HTTP/1.1\r\n", g_method_names[client->method], path);
+    for (int i = 0; i < client->header_cnt; i++) {
+        len += snprintf(req + len, sizeof(req) - len, "%s\r\n", client->headers[i]);
+    }
+    len += snprintf(req + len, sizeof(req) - len, "Content-Length: %d\r\n\r\n", client->post_len);
+    if (len >= (int)sizeof(req)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // 服务器关闭了空闲连接时在这里失败，与真实客户端一样返回错误，由调用方决定是否重连
+    if (host_http_send_all(client->sock, req, len) != 0
+        || host_http_send_all(client->sock, client->post_data, client->post_len) != 0) {
+        esp_http_client_close(client);
+        return ESP_FAIL;
+    }
+
+    int got = host_http_read_header(client, &content_len, &close_conn, body, sizeof(body));
+    if (got < 0) {
+        esp_http_client_close(client);
+        return ESP_FAIL;
+    }
+
+    int remaining = content_len;
+    while (remaining > 0) {
+        if (got == 0) {
+            ssize_t n = recv(client->sock, body, remaining < HOST_HTTP_RX_SIZE ? remaining : HOST_HTTP_RX_SIZE, 0);
+            if (n <= 0) {
+                esp_http_client_close(client);
+                return ESP_FAIL;
+            }
+            got = n;
+        }
+        int n = got < remaining ? got : remaining;
+        host_http_event(client, HTTP_EVENT_ON_DATA, body, n);
+        remaining -= n;
+        got = 0;
+    }
+
+    host_http_event(client, HTTP_EVENT_ON_FINISH, NULL, 0);
+    if (close_conn) {
+        esp_http_client_close(client);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client)
+{
+    if (client->sock >= 0) {
+        close(client->sock);
+        client->sock = -1;
+        host_http_event(client, HTTP_EVENT_DISCONNECTED, NULL, 0);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client)
+{
+    if (client) {
+        esp_http_client_close(client);
+        free(client);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client, const char *url)
+{
+    snprintf(client->url, sizeof(client->url), "%s", url);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t client, esp_http_client_method_t method)
+{
+    client->method = method;
+    return ESP_OK;
+}
+
+// 同名的头部覆盖，与真实客户端一致
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value)
+{
+    size_t key_len = strlen(key);
+    int i = 0;
+
+    while (i < client->header_cnt
+           && !(strncasecmp(client->headers[i], key, key_len) == 0 && client->headers[i][key_len] == ':')) {
+        i++;
+    }
+    if (i == HOST_HTTP_HEADERS) {
+        return ESP_ERR_NO_MEM;
+    }
+    snprintf(client->headers[i], HOST_HTTP_HEADER_MAX, "%s: %s", key, value);
+    if (i == client->header_cnt) {
+        client->header_cnt++;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t client, const char *data, int len)
+{
+    client->post_data = data;
+    client->post_len = data ? len : 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_user_data(esp_http_client_handle_t client, void *data)
+{
+    client->user_data = data;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_redirection(esp_http_client_handle_t client)
+{
+    return ESP_OK;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client)
+{
+    return client->status;
+}
@@ -0,0 +1,285 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nvs_flash.h"
+
+#define HOST_NVS_ENTRIES        32
+#define HOST_NVS_NAMESPACES     4
+#define HOST_NVS_VALUE_MAX      512
+
+typedef struct {
+    bool used;
+    int ns;
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    nvs_type_t type;
+    uint8_t value[HOST_NVS_VALUE_MAX];
+    size_t len;
+} host_nvs_entry_t;
+
+static char g_nvs_namespaces[HOST_NVS_NAMESPACES][NVS_KEY_NAME_MAX_SIZE];
+static host_nvs_entry_t g_nvs_entries[HOST_NVS_ENTRIES];
+static int g_nvs_write_budget = -1;         // 掉电前还能成功写入的次数，-1 为不限
+static host_nvs_stats_t g_nvs_stats;
+
+void host_nvs_reset(void)
+{
+    memset(g_nvs_namespaces, 0, sizeof(g_nvs_namespaces));
+    memset(g_nvs_entries, 0, sizeof(g_nvs_entries));
+    memset(&g_nvs_stats, 0, sizeof(g_nvs_stats));
+    g_nvs_write_budget = -1;
+}
+
+void host_nvs_power_cut(int writes)
+{
+    g_nvs_write_budget = writes;
+}
+
+void host_nvs_get_stats(host_nvs_stats_t *stats)
+{
+    *stats = g_nvs_stats;
+}
+
+static int nvs_namespace_find(const char *name)
+{
+    for (int i = 0; i < HOST_NVS_NAMESPACES; i++) {
+        if (g_nvs_namespaces[i][0] && strcmp(g_nvs_namespaces[i], name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static host_nvs_entry_t *nvs_entry_get(int ns, const char *key)
+{
+    for (int i = 0; i < HOST_NVS_ENTRIES; i++) {
+        host_nvs_entry_t *e = &g_nvs_entries[i];
+        if (e->used && e->ns == ns && strcmp(e->key, key) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+bool host_nvs_exists(const char *namespace_name, const char *key)
+{
+    int ns = nvs_namespace_find(namespace_name);
+    return ns >= 0 && nvs_entry_get(ns, key) != NULL;
+}
+
+// 每次写入消耗一次预算，预算用完后失败
+static bool nvs_write_allowed(void)
+{
+    if (g_nvs_write_budget == 0) {
+        g_nvs_stats.failed_writes++;
+        return false;
+    }
+    if (g_nvs_write_budget > 0) {
+        g_nvs_write_budget--;
+    }
+    g_nvs_stats.writes++;
+    return true;
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    host_nvs_reset();
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    int ns = nvs_namespace_find(namespace_name);
+
+    g_nvs_stats.opens++;
+    if (ns < 0) {
+        if (open_mode == NVS_READONLY) {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+        for (ns = 0; ns < HOST_NVS_NAMESPACES && g_nvs_namespaces[ns][0]; ns++) {
+        }
+        if (ns == HOST_NVS_NAMESPACES || strlen(namespace_name) >= NVS_KEY_NAME_MAX_SIZE) {
+            return ESP_FAIL;
+        }
+        strcpy(g_nvs_namespaces[ns], namespace_name);
+    }
+
+    *out_handle = ns + 1;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    g_nvs_stats.commits++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    host_nvs_entry_t *e = nvs_entry_get(handle - 1, key);
+    if (e == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (!nvs_write_allowed()) {
+        return ESP_FAIL;
+    }
+
+    e->used = false;
+    return ESP_OK;
+}
+
+static esp_err_t nvs_set(nvs_handle_t handle, const char *key, nvs_type_t type, const void *value, size_t len)
+{
+    if (strlen(key) >= NVS_KEY_NAME_MAX_SIZE || len > HOST_NVS_VALUE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    host_nvs_entry_t *e = nvs_entry_get(handle - 1, key);
+    for (int i = 0; e == NULL && i < HOST_NVS_ENTRIES; i++) {
+        if (!g_nvs_entries[i].used) {
+            e = &g_nvs_entries[i];
+        }
+    }
+    if (e == NULL) {
+        return ESP_ERR_NVS_NO_FREE_PAGES;
+    }
+    if (!nvs_write_allowed()) {
+        return ESP_FAIL;
+    }
+
+    e->used = true;
+    e->ns = handle - 1;
+    strcpy(e->key, key);
+    e->type = type;
+    memcpy(e->value, value, len);
+    e->len = len;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_i8(nvs_handle_t handle, const char *key, int8_t value)
+{
+    return nvs_set(handle, key, NVS_TYPE_I8, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value)
+{
+    return nvs_set(handle, key, NVS_TYPE_STR, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    return nvs_set(handle, key, NVS_TYPE_BLOB, value, length);
+}
+
+static esp_err_t nvs_get_fixed(nvs_handle_t handle, const char *key, nvs_type_t type, void *out, size_t len)
+{
+    g_nvs_stats.reads++;
+    host_nvs_entry_t *e = nvs_entry_get(handle - 1, key);
+    if (e == NULL || e->type != type) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    memcpy(out, e->value, len);
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *out_value)
+{
+    return nvs_get_fixed(handle, key, NVS_TYPE_U8, out_value, sizeof(*out_value));
+}
+
+esp_err_t nvs_get_i8(nvs_handle_t handle, const char *key, int8_t *out_value)
+{
+    return nvs_get_fixed(handle, key, NVS_TYPE_I8, out_value, sizeof(*out_value));
+}
+
+esp_err_t nvs_get_u16(nvs_handle_t handle, const char *key, uint16_t *out_value)
+{
+    return nvs_get_fixed(handle, key, NVS_TYPE_U16, out_value, sizeof(*out_value));
+}
+
+esp_err_t nvs_get_i16(nvs_handle_t handle, const char *key, int16_t *out_value)
+{
+    return nvs_get_fixed(handle, key, NVS_TYPE_I16, out_value, sizeof(*out_value));
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value)
+{
+    return nvs_get_fixed(handle, key, NVS_TYPE_U32, out_value, sizeof(*out_value));
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char *key, int32_t *out_value)
+{
+    return nvs_get_fixed(handle, key, NVS_TYPE_I32, out_value, sizeof(*out_value));
+}
+
+esp_err_t nvs_get_u64(nvs_handle_t handle, const char *key, uint64_t *out_value)
+{
+    return nvs_get_fixed(handle, key, NVS_TYPE_U64, out_value, sizeof(*out_value));
+}
+
+esp_err_t nvs_get_i64(nvs_handle_t handle, const char *key, int64_t *out_value)
+{
+    return nvs_get_fixed(handle, key, NVS_TYPE_I64, out_value, sizeof(*out_value));
+}
+
+static esp_err_t nvs_get_var(nvs_handle_t handle, const char *key, nvs_type_t type, void *out, size_t *length)
+{
+    g_nvs_stats.reads++;
+    host_nvs_entry_t *e = nvs_entry_get(handle - 1, key);
+    if (e == NULL || e->type != type) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    if (out == NULL) {
+        *length = e->len;
+        return ESP_OK;
+    }
+    if (*length < e->len) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+
+    memcpy(out, e->value, e->len);
+    *length = e->len;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length)
+{
+    return nvs_get_var(handle, key, NVS_TYPE_STR, out_value, length);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    return nvs_get_var(handle, key, NVS_TYPE_BLOB, out_value, length);
+}
+
+// 测试只需要 dump 能运行，不枚举条目
+esp_err_t nvs_entry_find(const char *part_name, const char *namespace_name, nvs_type_t type, nvs_iterator_t *output_iterator)
+{
+    *output_iterator = NULL;
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_entry_next(nvs_iterator_t *iterator)
+{
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_entry_info(const nvs_iterator_t iterator, nvs_entry_info_t *out_info)
+{
+    return ESP_ERR_INVALID_ARG;
+}
+
+void nvs_release_iterator(nvs_iterator_t iterator)
+{
+}
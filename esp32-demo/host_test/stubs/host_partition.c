@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_partition.h"
+
+#define HOST_PARTITION_MAX      4
+
+typedef struct {
+    esp_partition_t part;
+    uint8_t *data;
+} host_partition_t;
+
+static host_partition_t g_parts[HOST_PARTITION_MAX];
+static int g_part_count = 0;
+static int32_t g_power_budget = -1;         // 掉电前还能写入的字节数，-1 为不限
+static bool g_power_off = false;
+static host_partition_stats_t g_part_stats;
+
+static host_partition_t *host_partition_get(const esp_partition_t *part)
+{
+    for (int i = 0; i < g_part_count; i++) {
+        if (&g_parts[i].part == part) {
+            return &g_parts[i];
+        }
+    }
+    return NULL;
+}
+
+const esp_partition_t *host_partition_create(const char *label, esp_partition_subtype_t subtype, uint32_t size)
+{
+    if (g_part_count >= HOST_PARTITION_MAX || size % HOST_PARTITION_ERASE_SIZE != 0) {
+        return NULL;
+    }
+
+    host_partition_t *p = &g_parts[g_part_count];
+    p->data = malloc(size);
+    if (p->data == NULL) {
+        return NULL;
+    }
+    memset(p->data, 0xFF, size);
+
+    memset(&p->part, 0, sizeof(esp_partition_t));
+    p->part.type = ESP_PARTITION_TYPE_DATA;
+    p->part.subtype = subtype;
+    p->part.address = 0x10000 * (g_part_count + 1);
+    p->part.size = size;
+    p->part.erase_size = HOST_PARTITION_ERASE_SIZE;
+    snprintf(p->part.label, sizeof(p->part.label), "%s", label);
+    g_part_count++;
+
+    return &p->part;
+}
+
+void host_partition_remove_all(void)
+{
+    for (int i = 0; i < g_part_count; i++) {
+        free(g_parts[i].data);
+    }
+    memset(g_parts, 0, sizeof(g_parts));
+    memset(&g_part_stats, 0, sizeof(g_part_stats));
+    g_part_count = 0;
+    host_partition_power_cut(-1);
+}
+
+uint8_t *host_partition_data(const esp_partition_t *part)
+{
+    host_partition_t *p = host_partition_get(part);
+    return p ? p->data : NULL;
+}
+
+void host_partition_power_cut(int32_t bytes)
+{
+    g_power_budget = bytes;
+    g_power_off = false;
+}
+
+bool host_partition_powered(void)
+{
+    return !g_power_off;
+}
+
+void host_partition_get_stats(host_partition_stats_t *stats)
+{
+    *stats = g_part_stats;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    for (int i = 0; i < g_part_count; i++) {
+        esp_partition_t *part = &g_parts[i].part;
+        if (part->type != type) {
+            continue;
+        }
+        if (subtype != ESP_PARTITION_SUBTYPE_ANY && part->subtype != subtype) {
+            continue;
+        }
+        if (label && strcmp(part->label, label) != 0) {
+            continue;
+        }
+        return part;
+    }
+    return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t offset, void *dst, size_t size)
+{
+    host_partition_t *p = host_partition_get(part);
+    if (p == NULL || dst == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (offset > part->size || size > part->size - offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memcpy(dst, p->data + offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *part, size_t offset, const void *src, size_t size)
+{
+    host_partition_t *p = host_partition_get(part);
+    if (p == NULL || src == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (offset > part->size || size > part->size - offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (g_power_off) {
+        return ESP_FAIL;
+    }
+
+    const uint8_t *s = src;
+    bool bad = false;
+    for (size_t i = 0; i < size; i++) {
+        if (g_power_budget == 0) {
+            g_power_off = true;
+            return ESP_FAIL;
+        }
+        if (g_power_budget > 0) {
+            g_power_budget--;
+        }
+        if ((p->data[offset + i] & s[i]) != s[i]) {
+            bad = true;
+        }
+        p->data[offset + i] &= s[i];
+    }
+
+    g_part_stats.writes++;
+    if (bad) {
+        g_part_stats.bad_writes++;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *part, size_t offset, size_t size)
+{
+    host_partition_t *p = host_partition_get(part);
+    if (p == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (offset > part->size || size > part->size - offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (offset % part->erase_size != 0 || size % part->erase_size != 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (g_power_off) {
+        return ESP_FAIL;
+    }
+
+    memset(p->data + offset, 0xFF, size);
+    g_part_stats.erases++;
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *part, size_t offset, size_t size,
+                             esp_partition_mmap_memory_t memory, const void **out_ptr,
+                             esp_partition_mmap_handle_t *out_handle)
+{
+    host_partition_t *p = host_partition_get(part);
+    if (p == NULL || out_ptr == NULL || out_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (offset > part->size || size > part->size - offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    *out_ptr = p->data + offset;
+    *out_handle = part->address + offset;
+    return ESP_OK;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t handle)
+{
+}
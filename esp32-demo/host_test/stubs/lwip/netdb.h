@@ -0,0 +1,7 @@
+#ifndef __HOST_LWIP_NETDB_H__
+#define __HOST_LWIP_NETDB_H__
+
+// 主机测试用的 lwip/netdb.h，直接使用系统的解析接口
+#include <netdb.h>
+
+#endif
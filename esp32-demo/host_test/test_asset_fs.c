@@ -0,0 +1,303 @@
+#define _XOPEN_SOURCE 500
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ftw.h>
+
+#include "host_test.h"
+
+// 直接包含源文件，以便在用例之间重置映射状态
+#include "asset_fs.c"
+
+/*
+ * 用 tools/gen_assets.py image 生成的镜像（见 CMakeLists.txt）写入 assets 分区，
+ * 遍历资源目录，每个文件都要通过 asset_fs_find 找到且内容与原文件一致，
+ * 不存在的路径和前后缀都找不到；镜像损坏时 asset_fs_init 拒绝，回落到内置资源表
+ *
+ *   test_asset_fs <镜像> <资源根目录>
+ */
+
+#define ASSET_MAX_FILES     256
+#define ASSET_URI_MAX       128
+
+typedef struct {
+    char uri[ASSET_URI_MAX];
+    uint8_t *raw;
+    size_t raw_len;
+} test_file_t;
+
+static const char *g_root;
+static test_file_t g_files[ASSET_MAX_FILES];
+static int g_file_cnt;
+static uint8_t *g_image;
+static size_t g_image_len;
+
+static uint8_t *read_file(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    CHECK(f != NULL);
+    CHECK(fseek(f, 0, SEEK_END) == 0);
+    long size = ftell(f);
+    CHECK(size >= 0);
+    rewind(f);
+
+    // 空文件也分配一个字节，便于统一释放
+    uint8_t *buf = malloc(size + 1);
+    CHECK(buf != NULL);
+    CHECK(fread(buf, 1, size, f) == (size_t)size);
+    fclose(f);
+
+    *len = size;
+    return buf;
+}
+
+static int collect_file(const char *path, const struct stat *st, int type, struct FTW *ftw)
+{
+    if (type != FTW_F) {
+        return 0;
+    }
+
+    CHECK(g_file_cnt < ASSET_MAX_FILES);
+    test_file_t *file = &g_files[g_file_cnt++];
+    CHECK(strlen(path + strlen(g_root)) < sizeof(file->uri));
+    strcpy(file->uri, path + strlen(g_root));
+    file->raw = read_file(path, &file->raw_len);
+    return 0;
+}
+
+// 去掉 asset_fs_init 的结果，模拟重新启动
+static void asset_fs_reset(void)
+{
+    if (g_asset_header) {
+        esp_partition_munmap(g_asset_mmap);
+    }
+    g_asset_image = NULL;
+    g_asset_header = NULL;
+    g_asset_disp = NULL;
+    g_asset_slots = NULL;
+    g_asset_entries = NULL;
+    host_partition_remove_all();
+}
+
+// 把 image 的前 len 字节写入 part_size 大小的 assets 分区
+static void flash_image(const uint8_t *image, size_t len, uint32_t part_size)
+{
+    asset_fs_reset();
+    const esp_partition_t *part = host_partition_create(ASSET_FS_PART_LABEL, 0x82, part_size);
+    CHECK(part != NULL);
+    CHECK(esp_partition_write(part, 0, image, len) == ESP_OK);
+}
+
+static uint32_t part_size_for(size_t len)
+{
+    return (len + HOST_PARTITION_ERASE_SIZE - 1) / HOST_PARTITION_ERASE_SIZE * HOST_PARTITION_ERASE_SIZE;
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// 资源数据指向映射的分区
+static bool in_image(const void *p)
+{
+    const uint8_t *u = p;
+    return g_asset_image && u >= g_asset_image && u < g_asset_image + g_asset_header->image_len;
+}
+
+/*
+ * 压缩后的数据没法在这里解压，改为检查 gzip 尾部记录的 CRC32 和原文长度，
+ * 两者都与原文件一致说明压缩的是同一份内容
+ */
+static void check_content(const http_asset_t *asset, const test_file_t *file)
+{
+    CHECK(asset->etag[0] == '"' && strlen(asset->etag) == 18 && asset->etag[17] == '"');
+    CHECK(strlen(asset->mime) > 0);
+
+    if (!asset->gzip) {
+        CHECK(asset->len == file->raw_len && memcmp(asset->data, file->raw, file->raw_len) == 0);
+        return;
+    }
+    CHECK(asset->len > 18 && asset->len < file->raw_len);
+    CHECK(asset->data[0] == 0x1f && asset->data[1] == 0x8b);
+    CHECK(get_le32(asset->data + asset->len - 8) == esp_rom_crc32_le(0, file->raw, file->raw_len));
+    CHECK(get_le32(asset->data + asset->len - 4) == (uint32_t)file->raw_len);
+}
+
+static bool find_str(const char *uri, http_asset_t *asset)
+{
+    return asset_fs_find(uri, strlen(uri), asset) == 0;
+}
+
+/* ---------- 测试 ---------- */
+
+// 每个文件都能找到，带查询串时只取路径部分
+static void test_every_route(void)
+{
+    char uri[ASSET_URI_MAX + 16];
+    http_asset_t asset;
+    int gzip_cnt = 0;
+
+    flash_image(g_image, g_image_len, part_size_for(g_image_len));
+    CHECK(asset_fs_init() == 0);
+    CHECK(asset_fs_count() == g_file_cnt);
+
+    for (int i = 0; i < g_file_cnt; i++) {
+        const test_file_t *file = &g_files[i];
+
+        memset(&asset, 0, sizeof(asset));
+        CHECK(find_str(file->uri, &asset));
+        CHECK(strcmp(asset.uri, file->uri) == 0);
+        CHECK(in_image(asset.uri) && in_image(asset.data));
+        check_content(&asset, file);
+        gzip_cnt += asset.gzip;
+
+        snprintf(uri, sizeof(uri), "%s?v=%d", file->uri, i);
+        CHECK(asset_fs_find(uri, strlen(file->uri), &asset) == 0);
+        CHECK(strcmp(asset.uri, file->uri) == 0);
+    }
+
+    // 生成的目录里既有压缩的也有保留原文的资源
+    CHECK(gzip_cnt > 0 && gzip_cnt < g_file_cnt);
+    printf("routes: %d assets (%d gzip), image %zu bytes, %d buckets, %d slots\n",
+           g_file_cnt, gzip_cnt, g_image_len, g_asset_header->buckets, g_asset_header->slots);
+}
+
+// 不存在的路径、已有路径的前缀和加了后缀的路径都找不到
+static void test_misses(void)
+{
+    static const char *misses[] = { "", "/", "/missing", "/index.htm", "/INDEX.HTML", "/index.html/", "index.html" };
+    char uri[ASSET_URI_MAX + 16];
+    http_asset_t asset;
+    int probes = 0;
+
+    for (size_t i = 0; i < sizeof(misses) / sizeof(misses[0]); i++) {
+        CHECK(!find_str(misses[i], &asset));
+        probes++;
+    }
+
+    for (int i = 0; i < g_file_cnt; i++) {
+        const char *file_uri = g_files[i].uri;
+        size_t len = strlen(file_uri);
+
+        CHECK(asset_fs_find(file_uri, len - 1, &asset) == -1);
+        snprintf(uri, sizeof(uri), "%sx", file_uri);
+        CHECK(!find_str(uri, &asset));
+        snprintf(uri, sizeof(uri), "/x%s", file_uri);
+        CHECK(!find_str(uri, &asset));
+        probes += 3;
+    }
+    printf("misses: %d probes\n", probes);
+}
+
+// 内置资源表中的文件与镜像中的是同一份
+static void test_builtin_matches_image(void)
+{
+    http_asset_t asset;
+
+    for (int i = 0; i < g_http_assets_count; i++) {
+        const http_asset_t *builtin = &g_http_assets[i];
+        CHECK(find_str(builtin->uri, &asset));
+        CHECK(in_image(asset.data));
+        CHECK(strcmp(asset.etag, builtin->etag) == 0 && strcmp(asset.mime, builtin->mime) == 0);
+        CHECK(asset.len == builtin->len && memcmp(asset.data, builtin->data, asset.len) == 0);
+        CHECK(asset.gzip == builtin->gzip);
+    }
+}
+
+// 只剩内置资源表：内置的文件仍然能找到，其余的都找不到
+static void check_builtin_only(void)
+{
+    http_asset_t asset;
+
+    CHECK(asset_fs_count() == 0);
+    for (int i = 0; i < g_file_cnt; i++) {
+        bool builtin = false;
+        for (int j = 0; j < g_http_assets_count; j++) {
+            builtin |= strcmp(g_http_assets[j].uri, g_files[i].uri) == 0;
+        }
+        CHECK(find_str(g_files[i].uri, &asset) == builtin);
+        if (builtin) {
+            CHECK(!in_image(asset.data));
+            check_content(&asset, &g_files[i]);
+        }
+    }
+}
+
+// 镜像不完整或被破坏时 asset_fs_check 拒绝整个镜像
+static void test_bad_images(void)
+{
+    uint8_t *bad = malloc(g_image_len);
+    asset_fs_header_t hdr;
+    CHECK(bad != NULL);
+    memcpy(&hdr, g_image, sizeof(hdr));
+
+    // 没有 assets 分区
+    asset_fs_reset();
+    CHECK(asset_fs_init() == -1);
+    check_builtin_only();
+
+    // 分区擦除后没有写入
+    flash_image(g_image, 0, part_size_for(g_image_len));
+    CHECK(asset_fs_init() == -1);
+    check_builtin_only();
+
+    // 分区比镜像小
+    if (part_size_for(g_image_len) > HOST_PARTITION_ERASE_SIZE) {
+        flash_image(g_image, HOST_PARTITION_ERASE_SIZE, HOST_PARTITION_ERASE_SIZE);
+        CHECK(asset_fs_init() == -1);
+        check_builtin_only();
+    }
+
+    // 数据区任意位置的一个比特翻转都由 CRC 发现
+    size_t flips[] = { sizeof(hdr), sizeof(hdr) + hdr.buckets * 2, g_image_len / 2, g_image_len - 1 };
+    for (size_t i = 0; i < sizeof(flips) / sizeof(flips[0]); i++) {
+        memcpy(bad, g_image, g_image_len);
+        bad[flips[i]] ^= 0x10;
+        flash_image(bad, g_image_len, part_size_for(g_image_len));
+        CHECK(asset_fs_init() == -1);
+        check_builtin_only();
+    }
+
+    // 版本不认识
+    memcpy(bad, g_image, g_image_len);
+    ((asset_fs_header_t *)bad)->version = ASSET_FS_VERSION + 1;
+    flash_image(bad, g_image_len, part_size_for(g_image_len));
+    CHECK(asset_fs_init() == -1);
+    check_builtin_only();
+
+    // CRC 正确但条目的偏移越界
+    memcpy(bad, g_image, g_image_len);
+    uint32_t tables_len = (sizeof(hdr) + (hdr.buckets + hdr.slots) * sizeof(uint16_t) + 3) / 4 * 4;
+    asset_fs_entry_t *entry = (asset_fs_entry_t *)(bad + tables_len);
+    entry->data_len = hdr.image_len;
+    ((asset_fs_header_t *)bad)->crc32 = esp_rom_crc32_le(0, bad + sizeof(hdr), hdr.image_len - sizeof(hdr));
+    flash_image(bad, g_image_len, part_size_for(g_image_len));
+    CHECK(asset_fs_init() == -1);
+    check_builtin_only();
+
+    free(bad);
+}
+
+int main(int argc, char **argv)
+{
+    CHECK(argc == 3);
+    g_root = argv[2];
+    g_image = read_file(argv[1], &g_image_len);
+    CHECK(nftw(g_root, collect_file, 16, FTW_PHYS) == 0);
+    CHECK(g_file_cnt > 1);
+
+    test_every_route();
+    test_misses();
+    test_builtin_matches_image();
+    test_bad_images();
+
+    asset_fs_reset();
+    for (int i = 0; i < g_file_cnt; i++) {
+        free(g_files[i].raw);
+    }
+    free(g_image);
+    printf("asset_fs ok\n");
+
+    return 0;
+}
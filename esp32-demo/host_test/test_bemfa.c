@@ -0,0 +1,809 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_test.h"
+#include "mock_bemfa_server.h"
+
+// 直接包含源文件，以便访问会话状态、发布流程的静态函数，以及重置离线存储；各文件的 TAG 改名避免重复定义
+#define TAG BEMFA_TAG
+#include "bemfa.c"
+#undef TAG
+#define TAG STORE_TAG
+#include "pub_store.c"
+#undef TAG
+#define TAG TCP_TAG
+#include "bemfa_tcp.c"
+#undef TAG
+
+/*
+ * bemfa.c 的会话和发布流程，依赖的 Wi-Fi、NVS、HTTP 都替换为模拟实现
+ * 传输层可以是模拟实现：时间由模拟时钟推进，poll 按超时时间推进时钟；
+ * 也可以是真实的 bemfa_tcp.c 连接回环上的模拟服务器，此时使用真实时钟
+ */
+
+#define STORE_PART_SIZE     (64 * 1024)     // 与 partitions.csv 中的 pubstore 一致
+#define SENT_MAX            1024
+
+/* ---------- 模拟时钟和系统接口 ---------- */
+
+static int64_t g_now_us = 1000 * 1000000LL;
+static bool g_real_clock = false;
+static uint32_t g_random = 0;
+
+int64_t esp_timer_get_time(void)
+{
+    return g_real_clock ? host_now_us() : g_now_us;
+}
+
+uint32_t esp_random(void)
+{
+    return g_random;
+}
+
+void esp_restart(void)
+{
+    CHECK(0);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return (TaskHandle_t)1;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    return pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    g_now_us += ticks * portTICK_PERIOD_MS * 1000LL;
+    return 0;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+}
+
+void boot_timeline_mark(const char *phase)
+{
+}
+
+system_status_t g_system_status;
+
+int write_wifi_info(char *ssid, char *password)
+{
+    return 0;
+}
+
+/* ---------- 模拟 NVS 配置 ---------- */
+
+#define FAKE_CONFIG_STR(name, len)                                      \
+    static char g_fake_##name[len];                                     \
+    int user_config_set_##name(const char *value)                       \
+    {                                                                   \
+        snprintf(g_fake_##name, sizeof(g_fake_##name), "%s", value);    \
+        return 0;                                                       \
+    }                                                                   \
+    int user_config_get_##name(char *value, size_t size)                \
+    {                                                                   \
+        snprintf(value, size, "%s", g_fake_##name);                     \
+        return 0;                                                       \
+    }
+
+FAKE_CONFIG_STR(bind_ssid, 33)
+FAKE_CONFIG_STR(bind_pass, 65)
+FAKE_CONFIG_STR(bemfa_token, 64)
+FAKE_CONFIG_STR(bemfa_topic, 32)
+
+int user_nvs_txn_begin(void)
+{
+    return 0;
+}
+
+int user_nvs_txn_commit(void)
+{
+    return 0;
+}
+
+int user_nvs_flush(void)
+{
+    return 0;
+}
+
+/* ---------- 模拟 HTTP ---------- */
+
+void http_resp_sink_init_stream(http_resp_sink_t *sink, http_sink_stream_cb_t cb, void *arg)
+{
+    memset(sink, 0, sizeof(http_resp_sink_t));
+    sink->type = HTTP_SINK_STREAM;
+    sink->cb = cb;
+    sink->arg = arg;
+}
+
+static char g_fake_http_body[256];
+
+int user_http_request_sink(const char *url, esp_http_client_method_t method, const char *content_type,
+                           const char *body, http_resp_sink_t *sink, user_http_timing_t *timing)
+{
+    snprintf(g_fake_http_body, sizeof(g_fake_http_body), "%s", body);
+    const char *resp = "{\"code\":0,\"data\":{\"code\":0}}";
+    sink->len = strlen(resp);
+    return sink->cb(resp, sink->len, sink->arg) == 0 ? 200 : -1;
+}
+
+/* ---------- 模拟传输层 ---------- */
+
+typedef struct {
+    char topic[TOPIC_NAME_MAX_LEN];
+    char msg[PUB_MSG_MAX_LEN];
+    int64_t sent_us;
+} fake_sent_t;
+
+static bemfa_transport_config_t g_fake_config;
+static fake_sent_t g_fake_sent[SENT_MAX];
+static int g_fake_sent_cnt;
+static int g_fake_unacked;                  // 已发送、下次 poll 时应答的消息数
+static int g_fake_connect_fails;            // 接下来这么多次 connect 失败
+static int g_fake_poll_fails;               // 接下来这么多次 poll 返回连接失效
+static int g_fake_subscribe_fails;          // 接下来这么多次 subscribe 失败
+static int g_fake_publish_fails;            // 接下来这么多次 publish 失败
+static int g_fake_rejects;                  // 接下来这么多条消息应答为拒绝
+static char g_fake_log[256];                // 调用顺序，除 wake 外每次调用追加一个名字
+static int g_fake_wakes;
+static int g_fake_connect_timeout;
+static const char *g_fake_sub_topics[TOPIC_TABLE_MAX];
+static int g_fake_sub_cnt;
+static int g_fake_sub_timeout;
+static const char *g_fake_push_topic;       // 非 NULL 时下次 poll 经 rx_cb 投递一条消息
+static const char *g_fake_push_msg;
+
+static void fake_log(const char *name)
+{
+    size_t len = strlen(g_fake_log);
+    snprintf(g_fake_log + len, sizeof(g_fake_log) - len, "%s%s", len ? " " : "", name);
+}
+
+static int fake_init(const bemfa_transport_config_t *config)
+{
+    g_fake_config = *config;
+    return 0;
+}
+
+// 与 bemfa_tcp_prepare 一样每次都计一次域名解析
+static int fake_prepare(void)
+{
+    fake_log("prepare");
+    g_fake_config.stats->dns_resolves++;
+    return 0;
+}
+
+static int fake_connect(int timeout_ms)
+{
+    fake_log("connect");
+    g_fake_connect_timeout = timeout_ms;
+    if (g_fake_connect_fails > 0) {
+        g_fake_connect_fails--;
+        return -1;
+    }
+    return 0;
+}
+
+static void fake_close(void)
+{
+    fake_log("close");
+    g_fake_unacked = 0;
+}
+
+static int fake_subscribe(const char *const *topics, int count, int timeout_ms)
+{
+    fake_log("subscribe");
+    CHECK(count > 0 && count <= TOPIC_TABLE_MAX);
+    memcpy(g_fake_sub_topics, topics, count * sizeof(topics[0]));
+    g_fake_sub_cnt = count;
+    g_fake_sub_timeout = timeout_ms;
+    if (g_fake_subscribe_fails > 0) {
+        g_fake_subscribe_fails--;
+        return -1;
+    }
+    return 0;
+}
+
+static int fake_publish(const pub_msg_t *msgs, int count)
+{
+    fake_log("publish");
+    CHECK(count > 0 && count <= BEMFA_PUB_WINDOW);
+    if (g_fake_publish_fails > 0) {
+        g_fake_publish_fails--;
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        CHECK(g_fake_sent_cnt < SENT_MAX);
+        fake_sent_t *sent = &g_fake_sent[g_fake_sent_cnt++];
+        strcpy(sent->topic, msgs[i].topic);
+        strcpy(sent->msg, msgs[i].msg);
+        sent->sent_us = g_now_us;
+    }
+    g_fake_unacked += count;
+
+    return 0;
+}
+
+// 上次发出的消息在本次 poll 开始时全部应答，然后等满超时
+static int fake_poll(int timeout_ms)
+{
+    fake_log("poll");
+    if (g_fake_poll_fails > 0) {
+        g_fake_poll_fails--;
+        return -1;
+    }
+    while (g_fake_unacked > 0) {
+        g_fake_unacked--;
+        g_fake_config.ack_cb(g_fake_rejects == 0);
+        if (g_fake_rejects > 0) {
+            g_fake_rejects--;
+        }
+    }
+    if (g_fake_push_topic) {
+        g_fake_config.rx_cb(g_fake_push_topic, strlen(g_fake_push_topic), g_fake_push_msg, strlen(g_fake_push_msg));
+        g_fake_push_topic = NULL;
+    }
+    g_now_us += timeout_ms * 1000LL;
+
+    return 0;
+}
+
+static void fake_wake(void)
+{
+    g_fake_wakes++;
+}
+
+static const bemfa_transport_t g_fake_transport = {
+    .name = "fake",
+    .device_type = 3,
+    .init = fake_init,
+    .prepare = fake_prepare,
+    .connect = fake_connect,
+    .close = fake_close,
+    .subscribe = fake_subscribe,
+    .publish = fake_publish,
+    .poll = fake_poll,
+    .wake = fake_wake,
+};
+
+/* ---------- 测试 ---------- */
+
+// 全新的离线存储分区，会话处于断开状态
+static void setup(const bemfa_transport_t *transport)
+{
+    if (g_store_lock) {
+        vSemaphoreDelete(g_store_lock);
+    }
+    free(g_store_ram);
+    g_store_part = NULL;
+    g_store_ram = NULL;
+    g_store_capacity = 0;
+    g_store_per_sector = 1;
+    g_store_head = 0;
+    g_store_tail = 0;
+    g_store_lock = NULL;
+    memset(g_store_topics, 0, sizeof(g_store_topics));
+    memset(&g_store_stats, 0, sizeof(g_store_stats));
+
+    host_partition_remove_all();
+    CHECK(host_partition_create(PUB_STORE_PART_LABEL, 0x41, STORE_PART_SIZE) != NULL);
+    CHECK(pub_store_init(BEMFA_STORE_POLICY) == 0);
+
+    topic_table_init(&g_bemfa_topics);
+    g_bemfa_subscribed = 0;
+    if (g_tcp_wake_fd >= 0) {
+        close(g_tcp_wake_fd);
+        g_tcp_wake_fd = -1;
+    }
+    g_real_clock = transport != &g_fake_transport;
+    g_bemfa_transport = transport;
+    bemfa_transport_config_t config = {
+        .uid = g_bemfa_token,
+        .rx_cb = bemfa_handle_message,
+        .ack_cb = bemfa_pub_ack_received,
+        .stats = &g_bemfa_session_stats,
+    };
+    CHECK(g_bemfa_transport->init(&config) == 0);
+
+    pub_queue_init(&g_bemfa_pub_queue);
+    bemfa_pub_inflight_reset();
+    memset(&g_bemfa_pub_stats, 0, sizeof(g_bemfa_pub_stats));
+    g_bemfa_replay_next_us = 0;
+    g_bemfa_status = 0;
+    g_bemfa_fail_cnt = 0;
+    g_bemfa_topic_added = false;
+    g_bemfa_session_start_us = 0;
+    memset(&g_bemfa_session_stats, 0, sizeof(g_bemfa_session_stats));
+    g_fake_sent_cnt = 0;
+    g_fake_unacked = 0;
+    g_fake_connect_fails = 0;
+    g_fake_poll_fails = 0;
+    g_fake_subscribe_fails = 0;
+    g_fake_publish_fails = 0;
+    g_fake_rejects = 0;
+    g_fake_log[0] = '\0';
+    g_fake_wakes = 0;
+    g_fake_sub_cnt = 0;
+    g_fake_push_topic = NULL;
+    g_random = 0;
+}
+
+// 与 user_bemfa_connect_task 中在线状态的一次循环相同
+static void session_step(void)
+{
+    CHECK(bemfa_device_listen(pub_store_pending() > 0 ? BEMFA_REPLAY_INTERVAL_MS : BEMFA_IDLE_POLL_MS) == 0);
+}
+
+/*
+ * 离线期间积压的消息重连后按 BEMFA_REPLAY_INTERVAL_MS 限速、按原顺序补发：
+ * 开头最多连发 BEMFA_PUB_WINDOW 条，之后每个间隔一条；补发期间新发布的消息排在后面
+ */
+static void test_replay_pacing(void)
+{
+    const int offline = 400;
+    const int live = 10;
+    char msg[16];
+
+    setup(&g_fake_transport);
+    for (int i = 0; i < offline; i++) {
+        snprintf(msg, sizeof(msg), "%d", i);
+        CHECK(bemfa_publish("sensor", msg) == 0);
+    }
+    CHECK(pub_store_pending() == offline);
+    CHECK(g_fake_sent_cnt == 0);
+
+    g_bemfa_status = 5;
+    int64_t start_us = g_now_us;
+    int64_t cpu_start = host_now_us();
+    int steps = 0;
+    bool posted = false;
+
+    while (pub_store_pending() > 0 || g_fake_sent_cnt < offline + live) {
+        // 补发到一半时有新的发布，必须排在离线消息之后
+        if (!posted && g_fake_sent_cnt >= offline / 2) {
+            posted = true;
+            for (int i = 0; i < live; i++) {
+                snprintf(msg, sizeof(msg), "%d", offline + i);
+                CHECK(bemfa_publish("sensor", msg) == 0);
+            }
+        }
+        session_step();
+        CHECK(++steps < 100000);
+    }
+    session_step();
+    int64_t cpu_us = host_now_us() - cpu_start;
+
+    CHECK(g_fake_sent_cnt == offline + live);
+    for (int i = 0; i < g_fake_sent_cnt; i++) {
+        CHECK(atoi(g_fake_sent[i].msg) == i);
+    }
+
+    // 从第一次发送算起，第 i 条在第 i - BEMFA_PUB_WINDOW + 1 个间隔内发出，poll 的粒度就是一个间隔
+    const int64_t interval_us = BEMFA_REPLAY_INTERVAL_MS * 1000LL;
+    start_us = g_fake_sent[0].sent_us;
+    for (int i = 0; i < g_fake_sent_cnt; i++) {
+        int64_t slot = (int64_t)(i - BEMFA_PUB_WINDOW + 1) * interval_us;
+        int64_t offset = g_fake_sent[i].sent_us - start_us;
+        CHECK(offset >= (slot < 0 ? 0 : slot - interval_us));
+        CHECK(offset <= (slot < 0 ? 0 : slot));
+    }
+
+    int64_t duration_us = g_fake_sent[g_fake_sent_cnt - 1].sent_us - start_us;
+    double rate = (g_fake_sent_cnt - BEMFA_PUB_WINDOW) * 1000000.0 / duration_us;
+    CHECK(rate > 1000.0 / BEMFA_REPLAY_INTERVAL_MS * 0.95 && rate < 1000.0 / BEMFA_REPLAY_INTERVAL_MS * 1.05);
+    printf("replayed %d msgs in %.1f s (%.1f msg/s), %.1f us cpu per msg\n",
+           g_fake_sent_cnt, duration_us / 1e6, rate, (double)cpu_us / g_fake_sent_cnt);
+
+    bemfa_pub_stats_t stats;
+    CHECK(bemfa_get_pub_stats(&stats) == 0);
+    CHECK(stats.sent == (uint32_t)(offline + live));
+    CHECK(stats.acked == (uint32_t)(offline + live));
+    CHECK(stats.offline_stored == (uint32_t)(offline + live));
+    CHECK(stats.offline_replayed == (uint32_t)(offline + live));
+    CHECK(stats.offline_pending == 0);
+    CHECK(stats.timeout == 0 && stats.rejected == 0);
+}
+
+// 令牌最多积累 BEMFA_PUB_WINDOW 个：长时间空闲后也只能连发一个窗口
+static void test_replay_burst(void)
+{
+    setup(&g_fake_transport);
+    g_bemfa_status = 5;
+
+    // 空闲很久，令牌桶已满
+    g_now_us += 3600 * 1000000LL;
+    int tokens = 0;
+    while (bemfa_replay_allowed()) {
+        tokens++;
+        CHECK(tokens <= BEMFA_PUB_WINDOW);
+    }
+    CHECK(tokens == BEMFA_PUB_WINDOW);
+
+    // 之后每个间隔恢复一个
+    for (int i = 0; i < 10; i++) {
+        g_now_us += BEMFA_REPLAY_INTERVAL_MS * 1000LL - 1;
+        CHECK(!bemfa_replay_allowed());
+        g_now_us += 1;
+        CHECK(bemfa_replay_allowed());
+        CHECK(!bemfa_replay_allowed());
+    }
+}
+
+// 1s 起步逐次翻倍，第 7 次起封顶 60s；实际等待在 [delay/2, delay] 内随机
+static void test_backoff(void)
+{
+    static const uint32_t expected[] = { 1000, 1000, 2000, 4000, 8000, 16000, 32000, 60000, 60000, 60000 };
+
+    for (int fail_cnt = 0; fail_cnt < (int)(sizeof(expected) / sizeof(expected[0])); fail_cnt++) {
+        uint32_t delay = expected[fail_cnt];
+
+        g_random = 0;
+        CHECK(bemfa_backoff_ms(fail_cnt) == delay / 2);
+        g_random = delay / 2;
+        CHECK(bemfa_backoff_ms(fail_cnt) == delay);
+        g_random = delay / 2 + 1;
+        CHECK(bemfa_backoff_ms(fail_cnt) == delay / 2);
+
+        for (uint32_t r = 0; r < 1000; r++) {
+            g_random = r * 2654435761u;
+            uint32_t ms = bemfa_backoff_ms(fail_cnt);
+            CHECK(ms >= delay / 2 && ms <= delay);
+        }
+    }
+
+    // 很大的失败次数不会移位溢出
+    g_random = 0;
+    CHECK(bemfa_backoff_ms(1000) == BEMFA_BACKOFF_MAX_MS / 2);
+    CHECK(bemfa_backoff_ms(0x7fffffff) == BEMFA_BACKOFF_MAX_MS / 2);
+}
+
+// 与 user_bemfa_connect_task 的循环相同，失败时按退避时间推进时钟，至少走一步；返回失败次数
+static int session_run_until_online(uint32_t *delays, int delays_max)
+{
+    int fails = 0;
+    int steps = 0;
+
+    do {
+        int prev_status = g_bemfa_status;
+        if (bemfa_session_step() == 0) {
+            CHECK(++steps < 1000);
+            continue;
+        }
+
+        uint32_t delay = bemfa_session_fail();
+        CHECK(fails < delays_max);
+        delays[fails++] = delay;
+        CHECK(g_bemfa_fail_cnt == fails);
+        CHECK(g_bemfa_session_stats.backoff_ms == delay);
+
+        // 连接之后的步骤失败回到重新连接，每 BEMFA_REDNS_FAIL_CNT 次从 DNS 开始
+        if (prev_status >= 2) {
+            CHECK(g_bemfa_status == (fails % BEMFA_REDNS_FAIL_CNT == 0 ? 0 : 2));
+        } else {
+            CHECK(g_bemfa_status == prev_status);
+        }
+        g_now_us += delay * 1000LL;
+        CHECK(++steps < 1000);
+    } while (g_bemfa_status != 5);
+
+    return fails;
+}
+
+/*
+ * 服务器连续拒绝连接：退避逐次翻倍，每 BEMFA_REDNS_FAIL_CNT 次失败重新解析一次域名；
+ * 订阅成功后失败计数清零，在线后断开只重连不重新解析
+ */
+static void test_session_redns(void)
+{
+    uint32_t delays[32];
+    const int connect_fails = 10;
+
+    setup(&g_fake_transport);
+    g_fake_connect_fails = connect_fails;
+
+    int fails = session_run_until_online(delays, 32);
+    CHECK(fails == connect_fails);
+    for (int i = 0; i < fails; i++) {
+        CHECK(delays[i] == bemfa_backoff_ms(i + 1));
+    }
+    CHECK(delays[0] == BEMFA_BACKOFF_BASE_MS / 2 && delays[fails - 1] == BEMFA_BACKOFF_MAX_MS / 2);
+
+    bemfa_session_stats_t stats;
+    CHECK(bemfa_get_session_stats(&stats) == 0);
+    CHECK(stats.dns_resolves == 1 + connect_fails / BEMFA_REDNS_FAIL_CNT);
+    CHECK(stats.failures == (uint32_t)connect_fails);
+    CHECK(stats.connects == 1 && stats.backoff_ms == 0);
+    CHECK(g_bemfa_fail_cnt == 0 && g_bemfa_topic_added);
+
+    // 在线后连接失效：从重新连接开始，第一次退避从头计算
+    g_fake_poll_fails = 1;
+    g_fake_connect_fails = 1;
+    fails = session_run_until_online(delays, 32);
+    CHECK(fails == 2);
+    CHECK(delays[0] == bemfa_backoff_ms(1) && delays[1] == bemfa_backoff_ms(2));
+
+    CHECK(bemfa_get_session_stats(&stats) == 0);
+    CHECK(stats.dns_resolves == 1 + connect_fails / BEMFA_REDNS_FAIL_CNT);
+    CHECK(stats.connects == 2 && stats.disconnects == 1 && stats.failures == (uint32_t)connect_fails + 2);
+
+    // 再失败到第 BEMFA_REDNS_FAIL_CNT 次才重新解析
+    g_fake_poll_fails = 1;
+    g_fake_connect_fails = BEMFA_REDNS_FAIL_CNT - 1;
+    fails = session_run_until_online(delays, 32);
+    CHECK(fails == BEMFA_REDNS_FAIL_CNT);
+    CHECK(bemfa_get_session_stats(&stats) == 0);
+    CHECK(stats.dns_resolves == 2 + connect_fails / BEMFA_REDNS_FAIL_CNT);
+    printf("session: %d connect failures, %u dns resolves, backoff %u..%u ms\n",
+           connect_fails, (unsigned int)(1 + connect_fails / BEMFA_REDNS_FAIL_CNT),
+           (unsigned int)bemfa_backoff_ms(1), (unsigned int)bemfa_backoff_ms(connect_fails));
+}
+
+typedef struct {
+    int calls;
+    char topic[TOPIC_NAME_MAX_LEN];
+    char msg[PUB_MSG_MAX_LEN];
+} handler_record_t;
+
+static void record_handler(const char *topic, const char *msg, size_t msg_len, void *arg)
+{
+    handler_record_t *rec = (handler_record_t *)arg;
+
+    rec->calls++;
+    snprintf(rec->topic, sizeof(rec->topic), "%s", topic);
+    snprintf(rec->msg, sizeof(rec->msg), "%.*s", (int)msg_len, msg);
+}
+
+static int g_switch_cb_value = -1;
+
+static void record_switch_cb(int on)
+{
+    g_switch_cb_value = on;
+}
+
+static void check_log(const char *expected)
+{
+    if (strcmp(g_fake_log, expected) != 0) {
+        fprintf(stderr, "calls |%s|, expected |%s|\n", g_fake_log, expected);
+    }
+    CHECK(strcmp(g_fake_log, expected) == 0);
+    g_fake_log[0] = '\0';
+}
+
+static void check_last_sent(const char *topic, const char *msg)
+{
+    CHECK(g_fake_sent_cnt > 0);
+    CHECK(strcmp(g_fake_sent[g_fake_sent_cnt - 1].topic, topic) == 0);
+    CHECK(strcmp(g_fake_sent[g_fake_sent_cnt - 1].msg, msg) == 0);
+}
+
+/*
+ * 会话状态机只经 bemfa_transport_t 收发：
+ * 调用顺序 prepare、connect、subscribe，上线后 poll 在前、publish 在后，任何失败都先 close；
+ * rx_cb 收到的消息按主题分发，ack_cb 的拒绝应答转入补发，其他任务发布时调用 wake
+ */
+static void test_transport_contract(void)
+{
+    uint32_t delays[8];
+    handler_record_t temp = {0};
+    handler_record_t late = {0};
+
+    setup(&g_fake_transport);
+    snprintf(g_bemfa_topic, sizeof(g_bemfa_topic), "light002");
+    snprintf(g_bemfa_token, sizeof(g_bemfa_token), "token");
+    g_bemfa_switch_status = 0;
+    bemfa_set_switch_cb(record_switch_cb);
+    CHECK(bemfa_subscribe_topic(g_bemfa_topic, bemfa_switch_handler, NULL) == 0);
+    CHECK(bemfa_subscribe_topic("temp004", record_handler, &temp) == 0);
+
+    // 建立会话：注册主题时带上传输层的设备类型，连接和订阅使用配置的超时
+    CHECK(session_run_until_online(delays, 8) == 0);
+    CHECK(strstr(g_fake_http_body, "\"topic\":\"light002\"") && strstr(g_fake_http_body, "\"type\":3"));
+    check_log("prepare connect subscribe");
+    CHECK(g_fake_connect_timeout == BEMFA_CONNECT_TIMEOUT_MS);
+    CHECK(g_fake_sub_cnt == 2 && g_fake_sub_timeout == BEMFA_ACK_TIMEOUT_MS);
+    CHECK(strcmp(g_fake_sub_topics[0], "light002") == 0 && strcmp(g_fake_sub_topics[1], "temp004") == 0);
+    CHECK(bemfa_is_online() && g_fake_wakes == 1);
+
+    // 上线后同步一次开关状态
+    CHECK(bemfa_session_step() == 0);
+    check_log("poll publish");
+    check_last_sent("light002", "off");
+
+    // 下发消息按主题分发，没有处理函数的主题忽略
+    g_fake_push_topic = "light002";
+    g_fake_push_msg = "on";
+    CHECK(bemfa_session_step() == 0);
+    CHECK(bemfa_get_switch() == 1 && g_switch_cb_value == 1);
+    CHECK(g_bemfa_pub_stats.acked == 1);
+    g_fake_push_topic = "temp004";
+    g_fake_push_msg = "23.5";
+    CHECK(bemfa_session_step() == 0);
+    CHECK(temp.calls == 1 && strcmp(temp.topic, "temp004") == 0 && strcmp(temp.msg, "23.5") == 0);
+    g_fake_push_topic = "unknown9";
+    g_fake_push_msg = "x";
+    CHECK(bemfa_session_step() == 0);
+    CHECK(temp.calls == 1 && bemfa_get_switch() == 1);
+    check_log("poll poll poll");
+
+    // 本地控制：唤醒 poll，下一次循环发出
+    CHECK(bemfa_set_switch(0) == 0);
+    CHECK(g_switch_cb_value == 0 && g_fake_wakes == 2);
+    CHECK(bemfa_session_step() == 0);
+    check_log("poll publish");
+    check_last_sent("light002", "off");
+
+    // 在线期间注册的主题只补订阅新的
+    CHECK(bemfa_subscribe_topic("new005", record_handler, &late) == 0);
+    CHECK(bemfa_session_step() == 0);
+    check_log("poll subscribe");
+    CHECK(g_fake_sub_cnt == 1 && strcmp(g_fake_sub_topics[0], "new005") == 0);
+
+    // 服务器拒绝：消息转入离线存储，按补发流程重发一次
+    CHECK(bemfa_publish("temp004", "21.5") == 0);
+    CHECK(bemfa_session_step() == 0);
+    g_fake_rejects = 1;
+    CHECK(bemfa_session_step() == 0);
+    CHECK(g_bemfa_pub_stats.rejected == 1);
+    check_last_sent("temp004", "21.5");
+    CHECK(g_fake_sent_cnt == 4 && pub_store_pending() == 0);
+    check_log("poll publish poll publish");
+
+    // publish 失败：关闭连接，消息保留到重连后补发
+    g_fake_publish_fails = 1;
+    CHECK(bemfa_publish("temp004", "22.0") == 0);
+    CHECK(bemfa_session_step() == -1);
+    bemfa_session_fail();
+    check_log("poll publish close");
+    CHECK(pub_store_pending() == 1);
+    CHECK(session_run_until_online(delays, 8) == 0);
+    check_log("connect subscribe");
+    CHECK(g_fake_sub_cnt == 3);
+    CHECK(bemfa_session_step() == 0);
+    CHECK(pub_store_pending() == 0);
+    CHECK(strcmp(g_fake_sent[g_fake_sent_cnt - 2].msg, "22.0") == 0);
+    check_last_sent("light002", "off");
+
+    // poll 和 subscribe 失败同样先 close 再重连
+    g_fake_poll_fails = 1;
+    g_fake_subscribe_fails = 1;
+    g_fake_log[0] = '\0';
+    CHECK(session_run_until_online(delays, 8) == 2);
+    check_log("poll close connect subscribe close connect subscribe");
+
+    bemfa_set_switch_cb(NULL);
+    printf("transport: call order, dispatch, wake and failure paths ok\n");
+}
+
+/* ---------- bemfa_tcp.c 连接模拟服务器 ---------- */
+
+#define PUSH_TOPIC          "light002"
+#define PUSH_MAX            64
+
+static char g_pushes[PUSH_MAX][PUB_MSG_MAX_LEN];
+static int g_push_cnt;
+
+static void push_handler(const char *topic, const char *msg, size_t msg_len, void *arg)
+{
+    CHECK(g_push_cnt < PUSH_MAX);
+    CHECK(strlen(msg) == msg_len);
+    snprintf(g_pushes[g_push_cnt++], PUB_MSG_MAX_LEN, "%s", msg);
+}
+
+// 以 r 开头的消息第一次被拒绝，以 x 开头的每次都被拒绝
+static int reject_res(const char *msg, int seen)
+{
+    if (msg[0] == 'x' || (msg[0] == 'r' && seen == 0)) {
+        return 0;
+    }
+    return 1;
+}
+
+// 与 user_bemfa_connect_task 的状态 2、3 相同：连接并订阅，然后进入在线状态
+static void tcp_session_open(void)
+{
+    CHECK(g_bemfa_transport->connect(BEMFA_CONNECT_TIMEOUT_MS) == 0);
+    bemfa_pub_inflight_reset();
+    int ret = bemfa_device_subscribe(0);
+    CHECK(ret == topic_table_count(&g_bemfa_topics));
+    g_bemfa_subscribed = ret;
+    g_bemfa_status = 5;
+}
+
+static int server_publishes(mock_server_t *srv, const char *msg)
+{
+    char line[PUB_MSG_MAX_LEN + 8];
+    int cnt = 0;
+
+    snprintf(line, sizeof(line), "&msg=%s", msg);
+    for (int i = 0; i < mock_server_line_count(srv); i++) {
+        mock_line_t rec;
+        mock_server_get_line(srv, i, &rec);
+        const char *p = strstr(rec.line, "&msg=");
+        cnt += strncmp(rec.line, "cmd=2&", 6) == 0 && p && strcmp(p, line) == 0;
+    }
+    return cnt;
+}
+
+/*
+ * 每条发布的应答前服务器都推送一条消息，推送和应答在同一个数据段里；
+ * 被拒绝的消息经离线存储重发一次，重发仍被拒绝就丢弃。推送要按顺序全部送达，应答要与发布一一对应
+ */
+static void test_tcp_interleaved_acks(void)
+{
+    static mock_server_t srv = { .publish_res = reject_res, .push_topic = PUSH_TOPIC };
+    const int total = 12;
+    char msg[PUB_MSG_MAX_LEN];
+
+    CHECK(mock_server_start(&srv, BEMFA_SERVER_PORT) == 0);
+    setup(&bemfa_transport_tcp);
+    g_push_cnt = 0;
+    CHECK(bemfa_subscribe_topic(PUSH_TOPIC, push_handler, NULL) == 0);
+    tcp_session_open();
+    CHECK(mock_server_find(&srv, 0, "cmd=3&uid=") == 0);
+
+    // 第 3、7 条第一次被拒绝，第 9 条总被拒绝
+    for (int i = 0; i < total; i++) {
+        snprintf(msg, sizeof(msg), "%c%d", i == 3 || i == 7 ? 'r' : i == 9 ? 'x' : 'm', i);
+        CHECK(bemfa_publish("sensor", msg) == 0);
+    }
+
+    int steps = 0;
+    while (pub_queue_peek(&g_bemfa_pub_queue) || pub_store_pending() > 0 || g_bemfa_pub_inflight.count > 0) {
+        session_step();
+        CHECK(++steps < 1000);
+    }
+    g_bemfa_transport->close();
+
+    // 每条第一次都按顺序发出，被拒绝的各重发一次
+    const int lines = total + 3;
+    CHECK(mock_server_line_count(&srv) == 1 + lines);
+    int prev = 0;
+    for (int i = 0; i < total; i++) {
+        snprintf(msg, sizeof(msg), "%c%d", i == 3 || i == 7 ? 'r' : i == 9 ? 'x' : 'm', i);
+        char prefix[PUB_MSG_MAX_LEN + 64];
+        snprintf(prefix, sizeof(prefix), "cmd=2&uid=%s&topic=sensor&msg=%s", g_bemfa_token, msg);
+        int first = mock_server_find(&srv, 0, prefix);
+        CHECK(first > prev);
+        prev = first;
+        CHECK(server_publishes(&srv, msg) == (msg[0] == 'm' ? 1 : 2));
+    }
+
+    // 推送穿插在应答之间，仍按顺序全部交给处理函数
+    CHECK(g_push_cnt == lines);
+    for (int i = 0; i < g_push_cnt; i++) {
+        snprintf(msg, sizeof(msg), "push%d", i);
+        CHECK(strcmp(g_pushes[i], msg) == 0);
+    }
+
+    bemfa_pub_stats_t stats;
+    CHECK(bemfa_get_pub_stats(&stats) == 0);
+    CHECK(stats.sent == (uint32_t)lines);
+    CHECK(stats.acked == (uint32_t)(total - 1));
+    CHECK(stats.rejected == 4);
+    CHECK(stats.offline_replayed == 3);
+    CHECK(stats.timeout == 0 && stats.inflight == 0);
+    printf("tcp: %d publishes, %d pushes, avg ack latency %lld us\n",
+           lines, g_push_cnt, (long long)(stats.total_latency_us / stats.acked));
+
+    mock_server_stop(&srv);
+}
+
+int main(void)
+{
+    test_backoff();
+    test_session_redns();
+    test_transport_contract();
+    test_replay_burst();
+    test_replay_pacing();
+    test_tcp_interleaved_acks();
+    printf("bemfa ok\n");
+
+    host_partition_remove_all();
+    return 0;
+}
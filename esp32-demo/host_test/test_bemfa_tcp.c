@@ -0,0 +1,289 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "host_test.h"
+#include "mock_bemfa_server.h"
+
+// 直接包含源文件，以便读取心跳状态；心跳间隔由 CMakeLists.txt 缩短
+#include "bemfa_tcp.c"
+
+/*
+ * bemfa_tcp.c 连接回环上的模拟服务器，测量端到端延时：
+ * 连接加订阅、云端推送到回调、其他任务唤醒 poll，心跳的发送间隔，以及服务器不再应答时的失效检测
+ */
+
+#define PUSH_ROUNDS         20
+#define PUSH_DELAY_US       20000       // 推送在 poll 开始阻塞之后发出
+#define POLL_TIMEOUT_MS     1000        // 与 BEMFA_IDLE_POLL_MS 相同
+#define LATENCY_MAX_US      100000      // 远小于改动前 1 秒的轮询间隔
+
+int64_t esp_timer_get_time(void)
+{
+    return host_now_us();
+}
+
+static mock_server_t g_srv;
+static bemfa_session_stats_t g_stats;
+static volatile int g_rx_cnt;
+static int64_t g_rx_us;
+static char g_rx_msg[32];
+
+static void rx_cb(const char *topic, size_t topic_len, const char *msg, size_t msg_len)
+{
+    CHECK(topic_len == 8 && memcmp(topic, "light002", 8) == 0);
+    g_rx_us = host_now_us();
+    snprintf(g_rx_msg, sizeof(g_rx_msg), "%.*s", (int)msg_len, msg);
+    g_rx_cnt++;
+}
+
+static void ack_cb(bool ok)
+{
+}
+
+/* ---------- 延时发送推送或唤醒的线程 ---------- */
+
+typedef struct {
+    const char *line;       // NULL 表示调用 wake
+    int64_t sent_us;
+    int64_t poll_end_us;    // poll 返回的时间
+} delayed_t;
+
+static void *delayed_thread(void *arg)
+{
+    delayed_t *d = arg;
+
+    usleep(PUSH_DELAY_US);
+    if (d->line) {
+        d->sent_us = mock_server_send(&g_srv, d->line);
+    } else {
+        d->sent_us = host_now_us();
+        bemfa_transport_tcp.wake();
+    }
+    return NULL;
+}
+
+// poll 阻塞期间由另一线程触发事件，返回 poll 的耗时
+static int64_t poll_with_event(delayed_t *d)
+{
+    pthread_t thread;
+
+    CHECK(pthread_create(&thread, NULL, delayed_thread, d) == 0);
+    int64_t start = host_now_us();
+    CHECK(bemfa_transport_tcp.poll(POLL_TIMEOUT_MS) == 0);
+    d->poll_end_us = host_now_us();
+    pthread_join(thread, NULL);
+
+    return d->poll_end_us - start;
+}
+
+/* ---------- 测试 ---------- */
+
+// 连接加订阅，一次握手加一次应答
+static void test_session_setup(void)
+{
+    const char *topics[] = { "light002", "esp32switch01006" };
+
+    int64_t start = host_now_us();
+    CHECK(bemfa_transport_tcp.connect(3000) == 0);
+    int64_t connect_us = host_now_us() - start;
+    CHECK(bemfa_transport_tcp.subscribe(topics, 2, 3000) == 0);
+    int64_t setup_us = host_now_us() - start;
+
+    CHECK(mock_server_accepts(&g_srv) == 1);
+    CHECK(mock_server_find(&g_srv, 0, "cmd=3&uid=token&topic=light002,esp32switch01006") == 0);
+    CHECK(g_stats.connect_attempts == 1);
+    CHECK(setup_us < LATENCY_MAX_US);
+    printf("session: connect %lld us, connect + subscribe %lld us\n", (long long)connect_us, (long long)setup_us);
+}
+
+// 推送到达时 poll 立即返回并交给回调，不等到超时
+static void test_push_latency(void)
+{
+    int64_t total = 0;
+    int64_t max = 0;
+    char line[64];
+
+    for (int i = 0; i < PUSH_ROUNDS; i++) {
+        snprintf(line, sizeof(line), "cmd=2&uid=token&topic=light002&msg=on%d", i);
+        delayed_t d = { .line = line };
+        int rx_cnt = g_rx_cnt;
+
+        int64_t elapsed = poll_with_event(&d);
+        CHECK(d.sent_us > 0);
+        CHECK(g_rx_cnt == rx_cnt + 1);
+        CHECK(strcmp(g_rx_msg, line + strlen("cmd=2&uid=token&topic=light002&msg=")) == 0);
+
+        int64_t latency = g_rx_us - d.sent_us;
+        CHECK(latency >= 0 && latency < LATENCY_MAX_US);
+        CHECK(elapsed < PUSH_DELAY_US + LATENCY_MAX_US);
+        total += latency;
+        if (latency > max) {
+            max = latency;
+        }
+    }
+
+    printf("push: avg %lld us, max %lld us over %d rounds\n",
+           (long long)(total / PUSH_ROUNDS), (long long)max, PUSH_ROUNDS);
+}
+
+// 其他任务投递消息后 wake，poll 立即返回
+static void test_wake_latency(void)
+{
+    delayed_t d = { .line = NULL };
+    int rx_cnt = g_rx_cnt;
+
+    int64_t elapsed = poll_with_event(&d);
+    int64_t latency = d.poll_end_us - d.sent_us;
+    CHECK(g_rx_cnt == rx_cnt);
+    CHECK(latency >= 0 && latency < LATENCY_MAX_US);
+    CHECK(elapsed < PUSH_DELAY_US + LATENCY_MAX_US);
+    printf("wake: poll returned after %lld us, %lld us after wake\n", (long long)elapsed, (long long)latency);
+
+    // 计数已经读走，下一次 poll 等满超时
+    int64_t start = host_now_us();
+    CHECK(bemfa_transport_tcp.poll(100) == 0);
+    CHECK(host_now_us() - start >= 100000);
+}
+
+/*
+ * 空闲 BEMFA_HEARTBEAT_INTERVAL_MS 后发送 ping，应答后重新计时；
+ * 收到推送也算有数据，推迟下一次心跳
+ */
+static void test_heartbeat(void)
+{
+    const int64_t interval_us = BEMFA_HEARTBEAT_INTERVAL_MS * 1000LL;
+    const int64_t poll_us = 20000;
+    int first = mock_server_line_count(&g_srv);
+    uint32_t beats = g_stats.heartbeats;
+
+    bemfa_tcp_heartbeat_reset();
+    int64_t start = host_now_us();
+    while (host_now_us() - start < 5 * interval_us) {
+        CHECK(bemfa_transport_tcp.poll(poll_us / 1000) == 0);
+    }
+    // 等最后一次心跳的应答，此时服务器已经记录了 ping
+    while (g_tcp_ping_sent_us != 0) {
+        CHECK(bemfa_transport_tcp.poll(poll_us / 1000) == 0);
+    }
+
+    int pings = 0;
+    int64_t prev_us = start;
+    for (int i = mock_server_find(&g_srv, first, "ping"); i >= 0; i = mock_server_find(&g_srv, i + 1, "ping")) {
+        mock_line_t rec;
+        mock_server_get_line(&g_srv, i, &rec);
+        // 距上次收到数据满一个间隔才发送，发送时机取决于 poll 的粒度
+        CHECK(rec.rx_us - prev_us >= interval_us);
+        CHECK(rec.rx_us - prev_us < interval_us + 2 * poll_us + LATENCY_MAX_US);
+        prev_us = rec.rx_us;
+        pings++;
+    }
+    CHECK(pings >= 4 && pings <= 6);
+    CHECK(g_stats.heartbeats - beats == (uint32_t)pings);
+    CHECK(g_stats.missed_beats == 0 && g_stats.dead_links == 0);
+    printf("heartbeat: %d pings in %lld ms\n", pings, (long long)(host_now_us() - start) / 1000);
+
+    // 持续有推送时不发心跳
+    first = mock_server_line_count(&g_srv);
+    start = host_now_us();
+    while (host_now_us() - start < 2 * interval_us) {
+        mock_server_send(&g_srv, "cmd=2&uid=token&topic=light002&msg=keep");
+        CHECK(bemfa_transport_tcp.poll(poll_us / 1000) == 0);
+    }
+    CHECK(mock_server_find(&g_srv, first, "ping") < 0);
+}
+
+static void set_ignore_ping(bool ignore)
+{
+    pthread_mutex_lock(&g_srv.lock);
+    g_srv.ignore_ping = ignore;
+    pthread_mutex_unlock(&g_srv.lock);
+}
+
+/*
+ * 服务器不应答心跳：丢失一次后恢复应答时连接保持；
+ * 连续丢失 BEMFA_HEARTBEAT_MAX_MISSED 次时 poll 返回 -1，
+ * 从最后收到数据算起约 BEMFA_HEARTBEAT_INTERVAL_MS + MAX_MISSED * BEMFA_HEARTBEAT_TIMEOUT_MS
+ */
+static void test_dead_peer(void)
+{
+    const int64_t poll_us = 20000;
+    const int64_t detect_us = (BEMFA_HEARTBEAT_INTERVAL_MS + BEMFA_HEARTBEAT_MAX_MISSED * BEMFA_HEARTBEAT_TIMEOUT_MS) * 1000LL;
+    const int64_t slack_us = (BEMFA_HEARTBEAT_MAX_MISSED + 1) * 2 * poll_us + LATENCY_MAX_US;
+    uint32_t missed = g_stats.missed_beats;
+    uint32_t dead = g_stats.dead_links;
+
+    // 丢失一次后恢复：服务器丢掉第一个 ping 后恢复应答，超时后重发的 ping 得到应答，丢失计数清零
+    set_ignore_ping(true);
+    int first = mock_server_line_count(&g_srv);
+    bemfa_tcp_heartbeat_reset();
+    int64_t start = host_now_us();
+    while (mock_server_find(&g_srv, first, "ping") < 0) {
+        CHECK(bemfa_transport_tcp.poll(poll_us / 1000) == 0);
+        CHECK(host_now_us() - start < detect_us + slack_us);
+    }
+    set_ignore_ping(false);
+    while (g_stats.missed_beats == missed) {
+        CHECK(bemfa_transport_tcp.poll(poll_us / 1000) == 0);
+        CHECK(host_now_us() - start < detect_us + slack_us);
+    }
+    CHECK(g_tcp_missed_beats == 1);
+    while (g_tcp_missed_beats != 0) {
+        CHECK(bemfa_transport_tcp.poll(poll_us / 1000) == 0);
+        CHECK(host_now_us() - start < 2 * (detect_us + slack_us));
+    }
+    CHECK(g_stats.missed_beats == missed + 1 && g_stats.dead_links == dead);
+
+    // 一直不应答：第一次 ping 之后每次超时立即重发，最后一次超时判定失效
+    set_ignore_ping(true);
+    first = mock_server_line_count(&g_srv);
+    bemfa_tcp_heartbeat_reset();
+    start = host_now_us();
+    int ret;
+    while ((ret = bemfa_transport_tcp.poll(poll_us / 1000)) == 0) {
+        CHECK(host_now_us() - start < detect_us + slack_us);
+    }
+    int64_t elapsed = host_now_us() - start;
+
+    CHECK(ret == -1);
+    CHECK(elapsed >= detect_us);
+    CHECK(g_stats.dead_links == dead + 1);
+    CHECK(g_stats.missed_beats == missed + 1 + BEMFA_HEARTBEAT_MAX_MISSED);
+    CHECK(g_stats.last_detect_ms >= detect_us / 1000 && g_stats.last_detect_ms <= elapsed / 1000);
+    CHECK(g_stats.max_detect_ms >= g_stats.last_detect_ms);
+
+    int pings = 0;
+    for (int i = mock_server_find(&g_srv, first, "ping"); i >= 0; i = mock_server_find(&g_srv, i + 1, "ping")) {
+        pings++;
+    }
+    CHECK(pings == BEMFA_HEARTBEAT_MAX_MISSED);
+    set_ignore_ping(false);
+    printf("dead peer: detected after %lld ms (%d ms idle + %d x %d ms)\n", (long long)elapsed / 1000,
+           BEMFA_HEARTBEAT_INTERVAL_MS, BEMFA_HEARTBEAT_MAX_MISSED, BEMFA_HEARTBEAT_TIMEOUT_MS);
+}
+
+int main(void)
+{
+    bemfa_transport_config_t config = {
+        .uid = "token",
+        .rx_cb = rx_cb,
+        .ack_cb = ack_cb,
+        .stats = &g_stats,
+    };
+
+    CHECK(mock_server_start(&g_srv, BEMFA_SERVER_PORT) == 0);
+    CHECK(bemfa_transport_tcp.init(&config) == 0);
+
+    test_session_setup();
+    test_push_latency();
+    test_wake_latency();
+    test_heartbeat();
+    test_dead_peer();
+
+    bemfa_transport_tcp.close();
+    mock_server_stop(&g_srv);
+    printf("bemfa_tcp ok\n");
+
+    return 0;
+}
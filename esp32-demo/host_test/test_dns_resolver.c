@@ -0,0 +1,377 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "host_test.h"
+
+// 用假的 getaddrinfo 替换系统解析，查询次数、返回的地址和阻塞时机都由测试控制
+#define getaddrinfo     fake_getaddrinfo
+#define freeaddrinfo    fake_freeaddrinfo
+
+// 直接包含源文件，以便读取缓存条目的状态
+#include "dns_resolver.c"
+
+/*
+ * dns_resolver.c 的缓存：同一域名同时发起的请求合并成一次查询，
+ * 结果在 DNS_CACHE_TTL_MS 内命中缓存、过期或失效后重新查询，失败结果缓存 DNS_NEGATIVE_TTL_MS
+ */
+
+#define WAIT_MAX_US         2000000
+
+static pthread_mutex_t g_fake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_fake_cond = PTHREAD_COND_INITIALIZER;
+static bool g_fake_gate_open = true;       // false 时 getaddrinfo 阻塞，查询保持在进行中
+static int g_fake_calls;                    // getaddrinfo 被调用的次数，也是返回地址的最后一段
+static int64_t g_now_us = 1000000;
+
+int64_t esp_timer_get_time(void)
+{
+    return __atomic_load_n(&g_now_us, __ATOMIC_RELAXED);
+}
+
+static void advance_ms(int64_t ms)
+{
+    __atomic_add_fetch(&g_now_us, ms * 1000, __ATOMIC_RELAXED);
+}
+
+typedef struct {
+    TaskFunction_t func;
+    void *arg;
+} task_start_t;
+
+static void *task_thread(void *arg)
+{
+    task_start_t start = *(task_start_t *)arg;
+
+    free(arg);
+    start.func(start.arg);
+    return NULL;
+}
+
+// 解析任务在独立线程中运行
+BaseType_t xTaskCreate(TaskFunction_t func, const char *name, uint32_t stack, void *arg,
+                       uint32_t prio, TaskHandle_t *out_task)
+{
+    pthread_t thread;
+    task_start_t *start = malloc(sizeof(task_start_t));
+
+    CHECK(start);
+    start->func = func;
+    start->arg = arg;
+    if (pthread_create(&thread, NULL, task_thread, start) != 0) {
+        free(start);
+        return pdFALSE;
+    }
+    pthread_detach(thread);
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    pthread_exit(NULL);
+}
+
+// 以 fail. 开头的域名解析失败，其余返回 10.0.0.<调用序号>
+int fake_getaddrinfo(const char *node, const char *service, const struct addrinfo *hints, struct addrinfo **res)
+{
+    pthread_mutex_lock(&g_fake_lock);
+    int n = ++g_fake_calls;
+    pthread_cond_broadcast(&g_fake_cond);
+    while (!g_fake_gate_open) {
+        pthread_cond_wait(&g_fake_cond, &g_fake_lock);
+    }
+    pthread_mutex_unlock(&g_fake_lock);
+
+    if (strncmp(node, "fail.", 5) == 0) {
+        return EAI_NONAME;
+    }
+
+    struct addrinfo *ai = calloc(1, sizeof(struct addrinfo) + sizeof(struct sockaddr_in));
+    struct sockaddr_in *addr = (struct sockaddr_in *)(ai + 1);
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl(0x0a000000 | (n & 0xff));
+    ai->ai_family = AF_INET;
+    ai->ai_socktype = SOCK_STREAM;
+    ai->ai_addrlen = sizeof(struct sockaddr_in);
+    ai->ai_addr = (struct sockaddr *)addr;
+    *res = ai;
+
+    return 0;
+}
+
+void fake_freeaddrinfo(struct addrinfo *res)
+{
+    free(res);
+}
+
+static void set_gate(bool open)
+{
+    pthread_mutex_lock(&g_fake_lock);
+    g_fake_gate_open = open;
+    pthread_cond_broadcast(&g_fake_cond);
+    pthread_mutex_unlock(&g_fake_lock);
+}
+
+static int fake_calls(void)
+{
+    pthread_mutex_lock(&g_fake_lock);
+    int n = g_fake_calls;
+    pthread_mutex_unlock(&g_fake_lock);
+    return n;
+}
+
+static int addr_id(const dns_result_t *result)
+{
+    CHECK(result->count == 1 && result->addrs[0].ss_family == AF_INET);
+    return ntohl(((const struct sockaddr_in *)&result->addrs[0])->sin_addr.s_addr) & 0xff;
+}
+
+static dns_stats_t get_stats(void)
+{
+    dns_stats_t stats;
+    CHECK(dns_get_stats(&stats) == 0);
+    return stats;
+}
+
+// 读取缓存条目，不存在时返回 DNS_ENTRY_EMPTY
+static int entry_state(const char *hostname, int *waiter_cnt, int64_t *expire_us)
+{
+    xSemaphoreTake(g_dns_lock, portMAX_DELAY);
+    dns_cache_entry_t *entry = dns_cache_find(hostname);
+    int state = entry ? entry->state : DNS_ENTRY_EMPTY;
+    if (waiter_cnt) {
+        *waiter_cnt = entry ? entry->waiter_cnt : 0;
+    }
+    if (expire_us) {
+        *expire_us = entry ? entry->expire_us : 0;
+    }
+    xSemaphoreGive(g_dns_lock);
+    return state;
+}
+
+// 回调在解析任务中执行，测试线程等待回调计数
+typedef struct {
+    int calls;
+    int err;
+    dns_result_t result;
+} cb_record_t;
+
+static void record_cb(const char *hostname, int err, const dns_result_t *result, void *arg)
+{
+    cb_record_t *rec = (cb_record_t *)arg;
+
+    pthread_mutex_lock(&g_fake_lock);
+    rec->err = err;
+    if (err == 0) {
+        rec->result = *result;
+    }
+    rec->calls++;
+    pthread_cond_broadcast(&g_fake_cond);
+    pthread_mutex_unlock(&g_fake_lock);
+}
+
+static void wait_cb(cb_record_t *rec, int calls)
+{
+    int64_t start = host_now_us();
+
+    pthread_mutex_lock(&g_fake_lock);
+    while (rec->calls < calls) {
+        pthread_mutex_unlock(&g_fake_lock);
+        CHECK(host_now_us() - start < WAIT_MAX_US);
+        usleep(1000);
+        pthread_mutex_lock(&g_fake_lock);
+    }
+    pthread_mutex_unlock(&g_fake_lock);
+}
+
+// 异步解析并等待结果，返回 dns_resolve_async 的返回值
+static int resolve_wait(const char *hostname, cb_record_t *rec)
+{
+    memset(rec, 0, sizeof(*rec));
+    int ret = dns_resolve_async(hostname, record_cb, rec);
+    CHECK(ret >= 0);
+    wait_cb(rec, 1);
+    return ret;
+}
+
+typedef struct {
+    const char *hostname;
+    int ret;
+    dns_result_t result;
+} resolve_thread_t;
+
+static void *resolve_thread(void *arg)
+{
+    resolve_thread_t *t = (resolve_thread_t *)arg;
+
+    t->ret = dns_resolve(t->hostname, &t->result, 2000);
+    return NULL;
+}
+
+/*
+ * 查询进行中时多个任务同时解析同一域名：只调用一次 getaddrinfo，
+ * 全部挂在等待列表上并拿到同一个结果；等待列表满时新的请求返回 -1
+ */
+static void test_coalesce(void)
+{
+    const char *host = "bemfa.com";
+    resolve_thread_t threads[DNS_MAX_WAITERS];
+    pthread_t tids[DNS_MAX_WAITERS];
+    dns_stats_t before = get_stats();
+    int calls = fake_calls();
+    int waiters = 0;
+
+    set_gate(false);
+    for (int i = 0; i < DNS_MAX_WAITERS; i++) {
+        threads[i].hostname = host;
+        CHECK(pthread_create(&tids[i], NULL, resolve_thread, &threads[i]) == 0);
+    }
+
+    int64_t start = host_now_us();
+    while (entry_state(host, &waiters, NULL) != DNS_ENTRY_PENDING || waiters < DNS_MAX_WAITERS) {
+        CHECK(host_now_us() - start < WAIT_MAX_US);
+        usleep(1000);
+    }
+    CHECK(fake_calls() == calls + 1);
+
+    dns_stats_t stats = get_stats();
+    CHECK(stats.lookups == before.lookups + 1);
+    CHECK(stats.coalesced == before.coalesced + DNS_MAX_WAITERS - 1);
+    CHECK(stats.hits == before.hits);
+
+    // 等待列表已满
+    cb_record_t extra = {0};
+    CHECK(dns_resolve_async(host, record_cb, &extra) == -1);
+    // 只预取时不占等待列表
+    CHECK(dns_resolve_async(host, NULL, NULL) == 0);
+
+    set_gate(true);
+    for (int i = 0; i < DNS_MAX_WAITERS; i++) {
+        pthread_join(tids[i], NULL);
+        CHECK(threads[i].ret == 0);
+        CHECK(addr_id(&threads[i].result) == calls + 1);
+    }
+    CHECK(fake_calls() == calls + 1 && extra.calls == 0);
+    CHECK(get_stats().lookups == before.lookups + 1);
+
+    int64_t expire_us;
+    CHECK(entry_state(host, &waiters, &expire_us) == DNS_ENTRY_VALID && waiters == 0);
+    CHECK(expire_us == esp_timer_get_time() + DNS_CACHE_TTL_MS * 1000LL);
+
+    // 之后的请求直接命中，在调用者上下文中回调
+    cb_record_t rec = {0};
+    CHECK(dns_resolve_async(host, record_cb, &rec) == 1);
+    CHECK(rec.calls == 1 && rec.err == 0 && addr_id(&rec.result) == calls + 1);
+    CHECK(get_stats().hits == before.hits + 1);
+    printf("coalesce: %d concurrent requests, 1 lookup\n", DNS_MAX_WAITERS);
+}
+
+// TTL 内命中，到期后重新查询并拿到新地址；连接失败时可以提前作废
+static void test_ttl(void)
+{
+    const char *host = "ttl.example";
+    cb_record_t rec;
+    int calls = fake_calls();
+
+    CHECK(resolve_wait(host, &rec) == 0);
+    CHECK(rec.err == 0 && addr_id(&rec.result) == calls + 1);
+
+    advance_ms(DNS_CACHE_TTL_MS - 1);
+    CHECK(resolve_wait(host, &rec) == 1);
+    CHECK(addr_id(&rec.result) == calls + 1 && fake_calls() == calls + 1);
+
+    // 到期时刻本身已经过期
+    advance_ms(1);
+    CHECK(resolve_wait(host, &rec) == 0);
+    CHECK(addr_id(&rec.result) == calls + 2 && fake_calls() == calls + 2);
+
+    CHECK(resolve_wait(host, &rec) == 1);
+    CHECK(addr_id(&rec.result) == calls + 2);
+
+    dns_cache_invalidate(host);
+    CHECK(resolve_wait(host, &rec) == 0);
+    CHECK(addr_id(&rec.result) == calls + 3 && fake_calls() == calls + 3);
+
+    // 查询进行中时作废不影响这次查询的结果
+    set_gate(false);
+    dns_cache_invalidate(host);
+    memset(&rec, 0, sizeof(rec));
+    CHECK(dns_resolve_async(host, record_cb, &rec) == 0);
+    dns_cache_invalidate(host);
+    set_gate(true);
+    wait_cb(&rec, 1);
+    CHECK(addr_id(&rec.result) == calls + 4);
+    CHECK(resolve_wait(host, &rec) == 1);
+    CHECK(addr_id(&rec.result) == calls + 4 && fake_calls() == calls + 4);
+}
+
+// 失败结果缓存 DNS_NEGATIVE_TTL_MS，期间直接返回失败，不重复查询
+static void test_negative(void)
+{
+    const char *host = "fail.example";
+    cb_record_t rec;
+    dns_result_t result;
+    dns_stats_t before = get_stats();
+    int calls = fake_calls();
+
+    CHECK(resolve_wait(host, &rec) == 0);
+    CHECK(rec.err != 0);
+    CHECK(entry_state(host, NULL, NULL) == DNS_ENTRY_FAILED);
+    CHECK(get_stats().failures == before.failures + 1);
+
+    advance_ms(DNS_NEGATIVE_TTL_MS - 1);
+    CHECK(resolve_wait(host, &rec) == 1);
+    CHECK(rec.err != 0 && fake_calls() == calls + 1);
+    CHECK(dns_resolve(host, &result, 100) != 0);
+    CHECK(fake_calls() == calls + 1);
+
+    advance_ms(1);
+    CHECK(resolve_wait(host, &rec) == 0);
+    CHECK(rec.err != 0 && fake_calls() == calls + 2);
+    CHECK(get_stats().failures == before.failures + 2);
+}
+
+// 同步解析超时后取消等待，查询完成时不再回调到已经返回的调用者
+static void test_sync_timeout(void)
+{
+    const char *host = "slow.example";
+    dns_result_t result;
+    int waiters = -1;
+    int calls = fake_calls();
+
+    set_gate(false);
+    int64_t start = host_now_us();
+    CHECK(dns_resolve(host, &result, 50) == -1);
+    CHECK(host_now_us() - start >= 50000);
+    CHECK(entry_state(host, &waiters, NULL) == DNS_ENTRY_PENDING && waiters == 0);
+    set_gate(true);
+
+    start = host_now_us();
+    while (entry_state(host, NULL, NULL) != DNS_ENTRY_VALID) {
+        CHECK(host_now_us() - start < WAIT_MAX_US);
+        usleep(1000);
+    }
+    CHECK(dns_resolve(host, &result, 100) == 0);
+    CHECK(addr_id(&result) == calls + 1 && fake_calls() == calls + 1);
+}
+
+int main(void)
+{
+    CHECK(dns_resolve_async("bemfa.com", NULL, NULL) == -1);
+    CHECK(dns_resolver_init() == 0);
+
+    test_coalesce();
+    test_ttl();
+    test_negative();
+    test_sync_timeout();
+
+    dns_stats_t stats = get_stats();
+    printf("dns: %u lookups, %u hits, %u coalesced, %u failures\n",
+           stats.lookups, stats.hits, stats.coalesced, stats.failures);
+    printf("dns_resolver ok\n");
+
+    return 0;
+}
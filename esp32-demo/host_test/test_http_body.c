@@ -0,0 +1,437 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+
+#include "host_test.h"
+
+// 直接包含源文件，以便检查缓冲区池的占用
+#include "http_body.c"
+
+/*
+ * http_body_handler 的负载测试：在模拟的 httpd 上发送 1 字节到 16 MB 的请求体并逐字节核对回显，
+ * 堆分配通过 -Wl,--wrap 统计。流式处理的堆峰值与请求体大小无关（为 0），
+ * 作为对比的整体缓存做法（改动前的 echo_post_handler）峰值随请求体线性增长。
+ * 另外覆盖超限、缓冲区用尽、超时和中止，以及读取前已回显完上一块（背压）。
+ */
+
+#define BODY_SIZE_MAX       (16 * 1024 * 1024)
+#define ECHO_MAX_BODY       (64 * 1024)
+
+/* ---------- 堆统计 ---------- */
+
+typedef struct {
+    uint64_t allocs;
+    size_t live;
+    size_t peak;
+} heap_stats_t;
+
+static heap_stats_t g_heap;
+static bool g_heap_counting;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static void heap_add(void *ptr)
+{
+    if (ptr && g_heap_counting) {
+        g_heap.allocs++;
+        g_heap.live += malloc_usable_size(ptr);
+        if (g_heap.live > g_heap.peak) {
+            g_heap.peak = g_heap.live;
+        }
+    }
+}
+
+static void heap_sub(void *ptr)
+{
+    if (ptr && g_heap_counting) {
+        g_heap.live -= malloc_usable_size(ptr);
+    }
+}
+
+void *__wrap_malloc(size_t size)
+{
+    void *ptr = __real_malloc(size);
+    heap_add(ptr);
+    return ptr;
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    void *ptr = __real_calloc(n, size);
+    heap_add(ptr);
+    return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    heap_sub(ptr);
+    void *out = __real_realloc(ptr, size);
+    heap_add(out ? out : ptr);
+    return out;
+}
+
+void __wrap_free(void *ptr)
+{
+    heap_sub(ptr);
+    __real_free(ptr);
+}
+
+static void heap_begin(void)
+{
+    memset(&g_heap, 0, sizeof(g_heap));
+    g_heap_counting = true;
+}
+
+static void heap_end(void)
+{
+    g_heap_counting = false;
+    CHECK(g_heap.live == 0);
+}
+
+/* ---------- 模拟的 httpd 连接 ---------- */
+
+typedef struct {
+    size_t rx_off;              // 已交给处理函数的请求体字节数
+    size_t resp_len;            // 已回显的字节数
+    uint32_t rnd;               // 决定每次 recv 返回多少字节
+    int timeouts;               // 先返回这么多次超时
+    size_t disconnect_at;       // 读到这里时断开，0 表示不断开
+    bool buffered;              // 整体缓存的处理函数，不检查背压
+    const char *status;
+    bool resp_done;             // 收到结束的空块或整个响应
+    int recv_calls;
+} fake_conn_t;
+
+static char body_byte(size_t off)
+{
+    return 'a' + (off * 7 + off / 251) % 26;
+}
+
+static void fake_req_init(httpd_req_t *req, fake_conn_t *conn, size_t content_len, void *user_ctx)
+{
+    memset(req, 0, sizeof(httpd_req_t));
+    memset(conn, 0, sizeof(fake_conn_t));
+    strcpy((char *)req->uri, "/echo");
+    req->method = HTTP_POST;
+    req->content_len = content_len;
+    req->user_ctx = user_ctx;
+    req->aux = conn;
+    conn->rnd = 12345 + content_len;
+    conn->status = "200 OK";
+}
+
+// TCP 分段大小不固定，每次返回 1 到 len 之间的随机字节数
+int httpd_req_recv(httpd_req_t *req, char *buf, size_t len)
+{
+    fake_conn_t *conn = req->aux;
+
+    conn->recv_calls++;
+    // 背压：上一块回显完之前不会再读
+    CHECK(conn->buffered || conn->resp_len == conn->rx_off);
+    CHECK(len > 0 && len <= HTTP_BODY_CHUNK_SIZE && conn->rx_off + len <= req->content_len);
+
+    if (conn->timeouts > 0) {
+        conn->timeouts--;
+        return HTTPD_SOCK_ERR_TIMEOUT;
+    }
+    if (conn->disconnect_at && conn->rx_off >= conn->disconnect_at) {
+        return 0;
+    }
+
+    conn->rnd = conn->rnd * 1103515245 + 12345;
+    size_t n = 1 + (conn->rnd >> 8) % len;
+    if (conn->rnd & 1) {
+        n = len;
+    }
+    for (size_t i = 0; i < n; i++) {
+        buf[i] = body_byte(conn->rx_off + i);
+    }
+    conn->rx_off += n;
+    return n;
+}
+
+static void fake_check_echo(fake_conn_t *conn, const char *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        CHECK(buf[i] == body_byte(conn->resp_len + i));
+    }
+    conn->resp_len += len;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *req, const char *buf, ssize_t len)
+{
+    fake_conn_t *conn = req->aux;
+
+    CHECK(!conn->resp_done);
+    if (buf == NULL || len == 0) {
+        conn->resp_done = true;
+    } else {
+        fake_check_echo(conn, buf, len);
+    }
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *req, const char *buf, ssize_t len)
+{
+    fake_conn_t *conn = req->aux;
+
+    CHECK(!conn->resp_done);
+    if (strcmp(conn->status, "200 OK") == 0) {
+        fake_check_echo(conn, buf, len);
+    }
+    conn->resp_done = true;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *req, const char *status)
+{
+    ((fake_conn_t *)req->aux)->status = status;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_408(httpd_req_t *req)
+{
+    httpd_resp_set_status(req, "408 Request Timeout");
+    return httpd_resp_send(req, NULL, 0);
+}
+
+esp_err_t httpd_resp_send_500(httpd_req_t *req)
+{
+    httpd_resp_set_status(req, "500 Internal Server Error");
+    return httpd_resp_send(req, NULL, 0);
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *req, const char *type)
+{
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *req, const char *field, const char *value)
+{
+    return ESP_OK;
+}
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t *req, const char *field)
+{
+    return 0;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *req, const char *field, char *val, size_t val_size)
+{
+    return ESP_ERR_NOT_FOUND;
+}
+
+/* ---------- 路由 ---------- */
+
+// 与 user_http_server.c 的 echo_chunk_handler 相同，边收边回
+static int echo_chunk(httpd_req_t *req, size_t off, const char *data, size_t len)
+{
+    if (!data) {
+        return httpd_resp_send_chunk(req, NULL, 0) == ESP_OK ? 0 : -1;
+    }
+    CHECK(off == ((fake_conn_t *)req->aux)->resp_len);
+    return httpd_resp_send_chunk(req, data, len) == ESP_OK ? 0 : -1;
+}
+
+static const http_body_route_t g_echo_unlimited = { .max_len = 0, .on_chunk = echo_chunk };
+static const http_body_route_t g_echo_limited = { .max_len = ECHO_MAX_BODY, .on_chunk = echo_chunk };
+
+// 改动前的 echo_post_handler：整个请求体读进 malloc 的缓冲区后一次发送
+static esp_err_t buffered_echo_handler(httpd_req_t *req)
+{
+    char *buf = malloc(req->content_len + 1);
+    size_t off = 0;
+    int ret;
+
+    if (!buf) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    while (off < req->content_len) {
+        size_t len = req->content_len - off;
+        ret = httpd_req_recv(req, buf + off, len < HTTP_BODY_CHUNK_SIZE ? len : HTTP_BODY_CHUNK_SIZE);
+        if (ret <= 0) {
+            free(buf);
+            return ESP_FAIL;
+        }
+        off += ret;
+    }
+    buf[off] = '\0';
+
+    httpd_resp_send(req, buf, req->content_len);
+    free(buf);
+    return ESP_OK;
+}
+
+/* ---------- 测试 ---------- */
+
+static size_t run_echo(esp_err_t (*handler)(httpd_req_t *), const http_body_route_t *route, size_t len)
+{
+    httpd_req_t req;
+    fake_conn_t conn;
+
+    fake_req_init(&req, &conn, len, (void *)route);
+    conn.buffered = (handler != http_body_handler);
+    heap_begin();
+    CHECK(handler(&req) == ESP_OK);
+    heap_end();
+
+    CHECK(conn.resp_done && conn.resp_len == len && strcmp(conn.status, "200 OK") == 0);
+    CHECK(g_body_pool_used == 0);
+    return g_heap.peak;
+}
+
+// 堆峰值不随请求体增长
+static void test_flat_peak(void)
+{
+    const size_t sizes[] = { 1, 1000, HTTP_BODY_CHUNK_SIZE, 4096 + 3, 64 * 1024, 1024 * 1024, BODY_SIZE_MAX };
+    http_body_stats_t before, after;
+    uint64_t total = 0;
+
+    http_body_get_stats(&before);
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        size_t len = sizes[i];
+        size_t stream_peak = run_echo(http_body_handler, &g_echo_unlimited, len);
+        size_t buffered_peak = run_echo(buffered_echo_handler, NULL, len);
+
+        printf("body %8zu bytes: http_body peak heap %zu bytes, buffered peak heap %zu bytes\n",
+               len, stream_peak, buffered_peak);
+        CHECK(stream_peak == 0);
+        CHECK(buffered_peak > len);
+        total += len;
+    }
+    http_body_get_stats(&after);
+
+    CHECK(after.requests - before.requests == sizeof(sizes) / sizeof(sizes[0]));
+    CHECK(after.bytes - before.bytes == (uint32_t)total);
+    CHECK(after.aborted == before.aborted && after.too_large == before.too_large);
+    CHECK(after.pool_peak == 1);
+}
+
+// 空请求体只收到结束的空块
+static void test_empty_body(void)
+{
+    CHECK(run_echo(http_body_handler, &g_echo_limited, 0) == 0);
+}
+
+// 超过路由上限直接回复 413，不读请求体
+static void test_too_large(void)
+{
+    httpd_req_t req;
+    fake_conn_t conn;
+    http_body_stats_t before, after;
+
+    CHECK(run_echo(http_body_handler, &g_echo_limited, ECHO_MAX_BODY) == 0);
+
+    http_body_get_stats(&before);
+    fake_req_init(&req, &conn, ECHO_MAX_BODY + 1, (void *)&g_echo_limited);
+    CHECK(http_body_handler(&req) == ESP_FAIL);
+    http_body_get_stats(&after);
+
+    CHECK(strcmp(conn.status, "413 Payload Too Large") == 0 && conn.resp_done);
+    CHECK(conn.recv_calls == 0 && conn.resp_len == 0);
+    CHECK(after.too_large - before.too_large == 1);
+    CHECK(g_body_pool_used == 0);
+}
+
+/*
+ * 处理函数还持有缓冲区时又来了请求（异步处理的情况）：
+ * 池中 HTTP_BODY_POOL_CHUNKS 块都被占用后回复 503
+ */
+static fake_conn_t g_nested_conn[HTTP_BODY_POOL_CHUNKS + 1];
+static int g_nested_depth;
+
+static int nested_chunk(httpd_req_t *req, size_t off, const char *data, size_t len)
+{
+    if (data && off == 0 && g_nested_depth < HTTP_BODY_POOL_CHUNKS) {
+        httpd_req_t inner;
+        int depth = ++g_nested_depth;
+        fake_conn_t *conn = &g_nested_conn[depth];
+        fake_req_init(&inner, conn, 100, req->user_ctx);
+        esp_err_t err = http_body_handler(&inner);
+
+        if (depth == HTTP_BODY_POOL_CHUNKS) {
+            CHECK(err == ESP_FAIL && strcmp(conn->status, "503 Service Unavailable") == 0);
+        } else {
+            CHECK(err == ESP_OK && conn->resp_len == 100);
+        }
+    }
+    return echo_chunk(req, off, data, len);
+}
+
+static void test_pool_busy(void)
+{
+    static const http_body_route_t route = { .max_len = 0, .on_chunk = nested_chunk };
+    httpd_req_t req;
+    http_body_stats_t before, after;
+
+    http_body_get_stats(&before);
+    g_nested_depth = 0;
+    fake_req_init(&req, &g_nested_conn[0], 100, (void *)&route);
+    CHECK(http_body_handler(&req) == ESP_OK);
+    http_body_get_stats(&after);
+
+    CHECK(g_nested_depth == HTTP_BODY_POOL_CHUNKS);
+    CHECK(g_nested_conn[0].resp_len == 100 && g_nested_conn[0].resp_done);
+    CHECK(after.busy - before.busy == 1);
+    CHECK(after.pool_peak == HTTP_BODY_POOL_CHUNKS);
+    CHECK(g_body_pool_used == 0);
+}
+
+static int abort_chunk(httpd_req_t *req, size_t off, const char *data, size_t len)
+{
+    return off + len > 3000 ? -1 : echo_chunk(req, off, data, len);
+}
+
+// 超时、断开和处理函数中止都释放缓冲区并计数
+static void test_aborts(void)
+{
+    static const http_body_route_t abort_route = { .max_len = 0, .on_chunk = abort_chunk };
+    httpd_req_t req;
+    fake_conn_t conn;
+    http_body_stats_t before, after;
+
+    http_body_get_stats(&before);
+
+    // 重试次数以内的超时不影响结果
+    fake_req_init(&req, &conn, 5000, (void *)&g_echo_limited);
+    conn.timeouts = HTTP_BODY_RECV_RETRY - 1;
+    CHECK(http_body_handler(&req) == ESP_OK && conn.resp_len == 5000);
+
+    // 一直没有数据，回复 408
+    fake_req_init(&req, &conn, 5000, (void *)&g_echo_limited);
+    conn.timeouts = HTTP_BODY_RECV_RETRY;
+    CHECK(http_body_handler(&req) == ESP_FAIL);
+    CHECK(strcmp(conn.status, "408 Request Timeout") == 0);
+
+    // 发送到一半断开，响应已经开始，不能再回复 408
+    fake_req_init(&req, &conn, 5000, (void *)&g_echo_limited);
+    conn.disconnect_at = 2000;
+    CHECK(http_body_handler(&req) == ESP_FAIL);
+    CHECK(!conn.resp_done && conn.resp_len >= 2000 && conn.resp_len < 5000);
+
+    fake_req_init(&req, &conn, 5000, (void *)&abort_route);
+    CHECK(http_body_handler(&req) == ESP_FAIL);
+    CHECK(!conn.resp_done && conn.resp_len <= 3000);
+
+    http_body_get_stats(&after);
+    CHECK(after.aborted - before.aborted == 3);
+    CHECK(g_body_pool_used == 0);
+}
+
+int main(void)
+{
+    test_flat_peak();
+    test_empty_body();
+    test_too_large();
+    test_pool_busy();
+    test_aborts();
+    printf("http_body ok\n");
+
+    return 0;
+}
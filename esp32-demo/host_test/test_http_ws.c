@@ -0,0 +1,575 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sched.h>
+
+#include "host_test.h"
+
+// 直接包含源文件，以便在 httpd 线程中调用 http_ws_purge
+#include "http_ws.c"
+
+/*
+ * 在回环地址上模拟 httpd：accept 得到的 socket 作为 WebSocket 会话交给 http_ws_handler，
+ * httpd_queue_work 的工作在单独的 "httpd" 线程中依次执行。
+ * N 个客户端线程读取并校验每一帧，记录从 http_ws_broadcast 到收到帧的延迟。
+ *
+ *   test_http_ws [客户端数]
+ */
+
+#define FANOUT_ROUNDS       500
+#define STRESS_SENDERS      4
+#define STRESS_PER_SENDER   2000
+#define SLOW_ROUNDS         2000
+#define WAIT_TIMEOUT_US     5000000
+#define WORK_QUEUE_SIZE     64
+#define MAX_FD              1024
+#define SRC_MAX             (STRESS_SENDERS + 1)
+
+/* ---------- 模拟的 httpd ---------- */
+
+typedef struct {
+    httpd_work_fn_t fn;
+    void *arg;
+} work_t;
+
+static pthread_mutex_t g_work_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_work_cond = PTHREAD_COND_INITIALIZER;
+static work_t g_works[WORK_QUEUE_SIZE];
+static int g_work_head;
+static int g_work_cnt;
+static bool g_httpd_stop;
+
+static int g_listen_fd = -1;
+static struct sockaddr_in g_listen_addr;
+static httpd_uri_t g_ws_uri;
+static httpd_ws_client_info_t g_fd_info[MAX_FD];     // 只在 httpd 线程中访问
+static int g_dummy_server;
+
+int64_t esp_timer_get_time(void)
+{
+    return host_now_us();
+}
+
+int httpd_req_to_sockfd(httpd_req_t *req)
+{
+    return (int)(intptr_t)req->aux;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler)
+{
+    CHECK(uri_handler->is_websocket && strcmp(uri_handler->uri, HTTP_WS_URI) == 0);
+    g_ws_uri = *uri_handler;
+    return ESP_OK;
+}
+
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *arg)
+{
+    esp_err_t err = ESP_FAIL;
+
+    pthread_mutex_lock(&g_work_lock);
+    if (g_work_cnt < WORK_QUEUE_SIZE) {
+        g_works[(g_work_head + g_work_cnt) % WORK_QUEUE_SIZE] = (work_t){ work, arg };
+        g_work_cnt++;
+        pthread_cond_broadcast(&g_work_cond);
+        err = ESP_OK;
+    }
+    pthread_mutex_unlock(&g_work_lock);
+
+    return err;
+}
+
+// 真实的 httpd 在下一轮循环中关闭会话；这里先让客户端读到 EOF，fd 在用例结束时关闭
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd)
+{
+    CHECK(sockfd >= 0 && sockfd < MAX_FD);
+    g_fd_info[sockfd] = HTTPD_WS_CLIENT_INVALID;
+    shutdown(sockfd, SHUT_RDWR);
+    return ESP_OK;
+}
+
+httpd_ws_client_info_t httpd_ws_get_fd_info(httpd_handle_t handle, int fd)
+{
+    return fd >= 0 && fd < MAX_FD ? g_fd_info[fd] : HTTPD_WS_CLIENT_INVALID;
+}
+
+// 客户端不发消息
+esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *frame, size_t max_len)
+{
+    return ESP_FAIL;
+}
+
+static void *httpd_thread(void *arg)
+{
+    pthread_mutex_lock(&g_work_lock);
+    while (!g_httpd_stop || g_work_cnt > 0) {
+        if (g_work_cnt == 0) {
+            pthread_cond_wait(&g_work_cond, &g_work_lock);
+            continue;
+        }
+        work_t work = g_works[g_work_head];
+        g_work_head = (g_work_head + 1) % WORK_QUEUE_SIZE;
+        g_work_cnt--;
+        pthread_mutex_unlock(&g_work_lock);
+        work.fn(work.arg);
+        pthread_mutex_lock(&g_work_lock);
+    }
+    pthread_mutex_unlock(&g_work_lock);
+    return NULL;
+}
+
+typedef struct {
+    httpd_work_fn_t fn;
+    void *arg;
+    bool done;
+} httpd_call_t;
+
+static pthread_mutex_t g_call_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_call_cond = PTHREAD_COND_INITIALIZER;
+
+static void httpd_call_work(void *arg)
+{
+    httpd_call_t *call = arg;
+
+    if (call->fn) {
+        call->fn(call->arg);
+    }
+    pthread_mutex_lock(&g_call_lock);
+    call->done = true;
+    pthread_cond_broadcast(&g_call_cond);
+    pthread_mutex_unlock(&g_call_lock);
+}
+
+// 在 httpd 线程中执行 fn，返回前执行完毕；之前排队的工作也都已执行
+static void httpd_call(httpd_work_fn_t fn, void *arg)
+{
+    httpd_call_t call = { fn, arg, false };
+
+    while (httpd_queue_work(&g_dummy_server, httpd_call_work, &call) != ESP_OK) {
+        usleep(100);
+    }
+    pthread_mutex_lock(&g_call_lock);
+    while (!call.done) {
+        pthread_cond_wait(&g_call_cond, &g_call_lock);
+    }
+    pthread_mutex_unlock(&g_call_lock);
+}
+
+/* ---------- 客户端 ---------- */
+
+typedef struct {
+    int fd;                     // 客户端一侧的 socket
+    int server_fd;              // 服务器一侧的 socket
+    bool reader;                // false：从不读取的慢客户端
+    bool accepted;
+    pthread_t thread;
+    uint32_t frames;            // 原子访问
+    uint32_t last_seq[SRC_MAX];
+    int64_t *lat_us;            // 第 seq 帧的延迟，只记录 src 0
+    size_t lat_cap;
+} ws_client_t;
+
+/*
+ * 帧内容 {"src":S,"seq":N,"t":T,"pad":"ccc..."}，pad 全部是 'a' + seq % 26，
+ * 长度和内容任何一处不对都说明帧被撕裂或拼错
+ */
+static int make_payload(char *buf, size_t size, int src, uint32_t seq, size_t pad)
+{
+    int len = snprintf(buf, size, "{\"src\":%d,\"seq\":%u,\"t\":%lld,\"pad\":\"", src, seq, (long long)host_now_us());
+    CHECK(len > 0 && len + pad + 2 < size);
+    memset(buf + len, 'a' + seq % 26, pad);
+    memcpy(buf + len + pad, "\"}", 2);
+    return len + pad + 2;
+}
+
+static void check_payload(ws_client_t *c, const char *p, size_t len)
+{
+    int src, head = 0;
+    unsigned int seq;
+    long long t;
+    char text[HTTP_WS_PAYLOAD_MAX + 1];
+    int64_t now = host_now_us();
+
+    memcpy(text, p, len);
+    text[len] = '\0';
+    CHECK(sscanf(text, "{\"src\":%d,\"seq\":%u,\"t\":%lld,\"pad\":\"%n", &src, &seq, &t, &head) == 3 && head > 0);
+    CHECK(src >= 0 && src < SRC_MAX);
+    CHECK(len >= (size_t)head + 2 && memcmp(text + len - 2, "\"}", 2) == 0);
+    for (size_t i = head; i < len - 2; i++) {
+        CHECK(text[i] == 'a' + seq % 26);
+    }
+
+    // 同一个发送方的帧按顺序到达，被合并的广播可以跳过
+    CHECK(seq > c->last_seq[src]);
+    c->last_seq[src] = seq;
+    if (src == 0 && c->lat_us && seq < c->lat_cap) {
+        c->lat_us[seq] = now - t;
+    }
+}
+
+// 服务器发出的帧：FIN + 文本，不带掩码，长度 < 126 或 126 + 2 字节
+static void *client_thread(void *arg)
+{
+    ws_client_t *c = arg;
+    uint8_t buf[4096];
+    size_t len = 0;
+
+    for (;;) {
+        ssize_t n = recv(c->fd, buf + len, sizeof(buf) - len, 0);
+        if (n <= 0) {
+            break;
+        }
+        len += n;
+
+        size_t off = 0;
+        while (len - off >= 2) {
+            const uint8_t *f = buf + off;
+            size_t head = 2, plen = f[1];
+
+            CHECK(f[0] == 0x81 && (f[1] & 0x80) == 0);
+            if (plen == 126) {
+                if (len - off < 4) {
+                    break;
+                }
+                plen = f[2] << 8 | f[3];
+                head = 4;
+                CHECK(plen >= 126);
+            }
+            CHECK(plen <= HTTP_WS_PAYLOAD_MAX);
+            if (len - off < head + plen) {
+                break;
+            }
+            check_payload(c, (const char *)f + head, plen);
+            __atomic_add_fetch(&c->frames, 1, __ATOMIC_RELEASE);
+            off += head + plen;
+        }
+        memmove(buf, buf + off, len - off);
+        len -= off;
+    }
+
+    CHECK(len == 0);
+    return NULL;
+}
+
+static void ws_open(void *arg)
+{
+    ws_client_t *c = arg;
+    httpd_req_t req = { .method = HTTP_GET, .aux = (void *)(intptr_t)c->server_fd };
+
+    g_fd_info[c->server_fd] = HTTPD_WS_CLIENT_WEBSOCKET;
+    c->accepted = g_ws_uri.handler(&req) == ESP_OK;
+    if (!c->accepted) {
+        g_fd_info[c->server_fd] = HTTPD_WS_CLIENT_INVALID;
+    }
+}
+
+// 慢客户端把接收缓冲区调小，服务器一侧的发送缓冲区也调小，很快就发不出完整的帧
+static void client_connect(ws_client_t *c, bool reader, int64_t *lat_us, size_t lat_cap)
+{
+    int small = 1024;
+
+    memset(c, 0, sizeof(*c));
+    c->reader = reader;
+    c->lat_us = lat_us;
+    c->lat_cap = lat_cap;
+
+    c->fd = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(c->fd >= 0);
+    if (!reader) {
+        CHECK(setsockopt(c->fd, SOL_SOCKET, SO_RCVBUF, &small, sizeof(small)) == 0);
+    }
+    CHECK(connect(c->fd, (struct sockaddr *)&g_listen_addr, sizeof(g_listen_addr)) == 0);
+    c->server_fd = accept(g_listen_fd, NULL, NULL);
+    CHECK(c->server_fd >= 0 && c->server_fd < MAX_FD);
+    if (!reader) {
+        CHECK(setsockopt(c->server_fd, SOL_SOCKET, SO_SNDBUF, &small, sizeof(small)) == 0);
+    }
+
+    httpd_call(ws_open, c);
+    if (c->accepted && reader) {
+        CHECK(pthread_create(&c->thread, NULL, client_thread, c) == 0);
+    }
+}
+
+static void ws_close(void *arg)
+{
+    ws_client_t *c = arg;
+    g_fd_info[c->server_fd] = HTTPD_WS_CLIENT_INVALID;
+}
+
+static void ws_purge(void *arg)
+{
+    http_ws_purge();
+}
+
+// 会话关闭后由 http_ws_purge 清除，再关闭 fd，避免 fd 被复用时仍登记为 WebSocket
+static void clients_close(ws_client_t *clients, int n)
+{
+    for (int i = 0; i < n; i++) {
+        httpd_call(ws_close, &clients[i]);
+    }
+    httpd_call(ws_purge, NULL);
+    CHECK(g_ws_stats.clients == 0);
+
+    for (int i = 0; i < n; i++) {
+        ws_client_t *c = &clients[i];
+        shutdown(c->server_fd, SHUT_RDWR);
+        if (c->accepted && c->reader) {
+            CHECK(pthread_join(c->thread, NULL) == 0);
+        }
+        close(c->fd);
+        close(c->server_fd);
+    }
+}
+
+static bool wait_frames(ws_client_t *clients, int n, uint32_t frames)
+{
+    int64_t deadline = host_now_us() + WAIT_TIMEOUT_US;
+
+    for (int i = 0; i < n; i++) {
+        if (!clients[i].accepted || !clients[i].reader) {
+            continue;
+        }
+        while (__atomic_load_n(&clients[i].frames, __ATOMIC_ACQUIRE) < frames) {
+            if (host_now_us() > deadline) {
+                return false;
+            }
+            sched_yield();
+        }
+    }
+    return true;
+}
+
+static int cmp_i64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void get_stats(http_ws_stats_t *stats)
+{
+    httpd_call(NULL, NULL);
+    http_ws_get_stats(stats);
+}
+
+/* ---------- 测试 ---------- */
+
+/*
+ * N 个客户端，每轮广播一帧并等所有客户端收到后再发下一轮，
+ * 统计每个客户端的延迟和每轮最后一个客户端收到的延迟（扇出时间）
+ */
+static void test_fanout(int n)
+{
+    ws_client_t *clients = calloc(n + 1, sizeof(ws_client_t));
+    int64_t *lat = calloc((size_t)n * FANOUT_ROUNDS, sizeof(int64_t));
+    int64_t *fanout = calloc(FANOUT_ROUNDS, sizeof(int64_t));
+    http_ws_stats_t before, after;
+    char payload[HTTP_WS_PAYLOAD_MAX];
+    CHECK(clients && lat && fanout);
+
+    get_stats(&before);
+    for (int i = 0; i < n; i++) {
+        client_connect(&clients[i], true, lat + (size_t)i * FANOUT_ROUNDS, FANOUT_ROUNDS);
+        CHECK(clients[i].accepted);
+    }
+
+    // 连接数已满，多出的客户端被拒绝
+    if (n == HTTP_WS_MAX_CLIENTS) {
+        client_connect(&clients[n], true, NULL, 0);
+        CHECK(!clients[n].accepted);
+    }
+
+    for (uint32_t seq = 1; seq < FANOUT_ROUNDS; seq++) {
+        int len = make_payload(payload, sizeof(payload), 0, seq, seq % (HTTP_WS_PAYLOAD_MAX - 64));
+        CHECK(http_ws_broadcast(payload, len) == 0);
+        CHECK(wait_frames(clients, n, seq));
+
+        fanout[seq] = 0;
+        for (int i = 0; i < n; i++) {
+            int64_t us = clients[i].lat_us[seq];
+            fanout[seq] = us > fanout[seq] ? us : fanout[seq];
+        }
+    }
+
+    get_stats(&after);
+    CHECK(after.accepted - before.accepted == (uint32_t)n);
+    CHECK(after.rejected - before.rejected == (n == HTTP_WS_MAX_CLIENTS ? 1 : 0));
+    CHECK(after.broadcasts - before.broadcasts == FANOUT_ROUNDS - 1);
+    CHECK(after.frames_sent - before.frames_sent == (uint32_t)n * (FANOUT_ROUNDS - 1));
+    CHECK(after.coalesced == before.coalesced && after.dropped == before.dropped);
+
+    // 第 0 轮没有发送
+    size_t cnt = 0;
+    for (int i = 0; i < n; i++) {
+        for (int seq = 1; seq < FANOUT_ROUNDS; seq++) {
+            lat[cnt++] = clients[i].lat_us[seq];
+        }
+    }
+    qsort(lat, cnt, sizeof(int64_t), cmp_i64);
+    qsort(fanout + 1, FANOUT_ROUNDS - 1, sizeof(int64_t), cmp_i64);
+    printf("fanout: %d clients, %d rounds, per client p50 %lld us p99 %lld us, "
+           "last client p50 %lld us p99 %lld us max %lld us\n",
+           n, FANOUT_ROUNDS - 1, (long long)lat[cnt / 2], (long long)lat[cnt * 99 / 100],
+           (long long)fanout[1 + (FANOUT_ROUNDS - 1) / 2], (long long)fanout[1 + (FANOUT_ROUNDS - 1) * 99 / 100],
+           (long long)fanout[FANOUT_ROUNDS - 1]);
+
+    clients_close(clients, n == HTTP_WS_MAX_CLIENTS ? n + 1 : n);
+    free(fanout);
+    free(lat);
+    free(clients);
+}
+
+typedef struct {
+    int src;
+    pthread_t thread;
+} sender_t;
+
+static void *sender_thread(void *arg)
+{
+    sender_t *s = arg;
+    char payload[HTTP_WS_PAYLOAD_MAX];
+
+    for (uint32_t seq = 1; seq <= STRESS_PER_SENDER; seq++) {
+        // 覆盖 1 字节和 2 字节长度的帧头
+        int len = make_payload(payload, sizeof(payload), s->src, seq, (seq * 37 + s->src * 11) % (HTTP_WS_PAYLOAD_MAX - 64));
+        while (http_ws_broadcast(payload, len) != 0) {
+            sched_yield();
+        }
+        // 隔几次停一下，让广播与 httpd 线程的发送交错，而不是全部合并掉
+        if (seq % 4 == 0) {
+            usleep(50);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * 多个任务同时广播：帧在锁外组好，httpd 线程同时在发送，
+ * 客户端收到的每一帧都必须完整，每个发送方的帧保持顺序，最后一帧一定送达
+ */
+static void test_concurrent_broadcast(int n)
+{
+    ws_client_t *clients = calloc(n, sizeof(ws_client_t));
+    sender_t senders[STRESS_SENDERS];
+    http_ws_stats_t before, after;
+    char payload[HTTP_WS_PAYLOAD_MAX];
+    CHECK(clients);
+
+    get_stats(&before);
+    for (int i = 0; i < n; i++) {
+        client_connect(&clients[i], true, NULL, 0);
+        CHECK(clients[i].accepted);
+    }
+
+    for (int i = 0; i < STRESS_SENDERS; i++) {
+        senders[i].src = i + 1;
+        CHECK(pthread_create(&senders[i].thread, NULL, sender_thread, &senders[i]) == 0);
+    }
+    for (int i = 0; i < STRESS_SENDERS; i++) {
+        CHECK(pthread_join(senders[i].thread, NULL) == 0);
+    }
+
+    // 所有发送方结束后的一帧不会被合并掉
+    int len = make_payload(payload, sizeof(payload), 0, 1, HTTP_WS_PAYLOAD_MAX - 64);
+    CHECK(http_ws_broadcast(payload, len) == 0);
+    get_stats(&after);
+
+    uint32_t calls = STRESS_SENDERS * STRESS_PER_SENDER + 1;
+    uint32_t broadcasts = after.broadcasts - before.broadcasts;
+    CHECK(broadcasts + (after.coalesced - before.coalesced) == calls);
+    CHECK(after.frames_sent - before.frames_sent == broadcasts * n);
+    CHECK(after.dropped == before.dropped);
+    CHECK(wait_frames(clients, n, broadcasts));
+    for (int i = 0; i < n; i++) {
+        CHECK(clients[i].frames == broadcasts && clients[i].last_seq[0] == 1);
+    }
+    printf("concurrent: %d senders, %u calls, %u broadcasts, %u coalesced\n",
+           STRESS_SENDERS, calls, broadcasts, after.coalesced - before.coalesced);
+
+    clients_close(clients, n);
+    free(clients);
+}
+
+// 不读数据的客户端在发送缓冲区满后被断开，其他客户端照常收到每一帧
+static void test_slow_client(int n)
+{
+    ws_client_t *clients = calloc(n, sizeof(ws_client_t));
+    http_ws_stats_t before, after;
+    char payload[HTTP_WS_PAYLOAD_MAX];
+    uint32_t rounds = 0;
+    CHECK(clients && n >= 2);
+
+    get_stats(&before);
+    client_connect(&clients[0], false, NULL, 0);
+    for (int i = 1; i < n; i++) {
+        client_connect(&clients[i], true, NULL, 0);
+    }
+
+    for (uint32_t seq = 1; seq <= SLOW_ROUNDS; seq++) {
+        int len = make_payload(payload, sizeof(payload), 0, seq, HTTP_WS_PAYLOAD_MAX - 64);
+        CHECK(http_ws_broadcast(payload, len) == 0);
+        CHECK(wait_frames(clients + 1, n - 1, seq));
+        rounds = seq;
+
+        get_stats(&after);
+        if (after.dropped > before.dropped) {
+            break;
+        }
+    }
+
+    CHECK(after.dropped - before.dropped == 1);
+    CHECK(after.clients == (uint32_t)n - 1);
+    CHECK(g_fd_info[clients[0].server_fd] == HTTPD_WS_CLIENT_INVALID);
+
+    // 断开之后只发给剩下的客户端
+    for (uint32_t seq = rounds + 1; seq <= rounds + 10; seq++) {
+        int len = make_payload(payload, sizeof(payload), 0, seq, 10);
+        CHECK(http_ws_broadcast(payload, len) == 0);
+        CHECK(wait_frames(clients + 1, n - 1, seq));
+    }
+    http_ws_stats_t last;
+    get_stats(&last);
+    CHECK(last.frames_sent - after.frames_sent == 10 * (uint32_t)(n - 1));
+    printf("slow client: dropped after %u frames of %d bytes\n", rounds, HTTP_WS_PAYLOAD_MAX);
+
+    clients_close(clients, n);
+    free(clients);
+}
+
+int main(int argc, char **argv)
+{
+    int n = argc > 1 ? atoi(argv[1]) : HTTP_WS_MAX_CLIENTS;
+    pthread_t httpd;
+    socklen_t addr_len = sizeof(g_listen_addr);
+
+    CHECK(n >= 2 && n <= HTTP_WS_MAX_CLIENTS);
+    signal(SIGPIPE, SIG_IGN);
+
+    g_listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(g_listen_fd >= 0);
+    g_listen_addr.sin_family = AF_INET;
+    g_listen_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CHECK(bind(g_listen_fd, (struct sockaddr *)&g_listen_addr, sizeof(g_listen_addr)) == 0);
+    CHECK(getsockname(g_listen_fd, (struct sockaddr *)&g_listen_addr, &addr_len) == 0);
+    CHECK(listen(g_listen_fd, HTTP_WS_MAX_CLIENTS + 1) == 0);
+
+    CHECK(http_ws_broadcast("x", 1) == -1);
+    CHECK(http_ws_register(&g_dummy_server) == 0);
+    CHECK(http_ws_broadcast("x", HTTP_WS_PAYLOAD_MAX + 1) == -1);
+    CHECK(pthread_create(&httpd, NULL, httpd_thread, NULL) == 0);
+
+    test_fanout(n);
+    test_concurrent_broadcast(n);
+    test_slow_client(n);
+
+    pthread_mutex_lock(&g_work_lock);
+    g_httpd_stop = true;
+    pthread_cond_broadcast(&g_work_cond);
+    pthread_mutex_unlock(&g_work_lock);
+    CHECK(pthread_join(httpd, NULL) == 0);
+    close(g_listen_fd);
+    printf("http_ws ok\n");
+
+    return 0;
+}
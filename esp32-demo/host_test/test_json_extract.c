@@ -0,0 +1,426 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_test.h"
+#include "json_extract.h"
+
+#define NO_SPLIT    ((size_t)-1)
+
+// 云端绑定消息的字段，和 parse_bemfa_bind_message 一致
+typedef struct {
+    json_field_t fields[4];
+    char ssid[33];
+    char password[65];
+    char token[33];
+} bind_t;
+
+static void bind_init(bind_t *b)
+{
+    memset(b, 0, sizeof(bind_t));
+    b->fields[0] = (json_field_t){ .path = "cmdType", .type = JSON_FIELD_INT };
+    b->fields[1] = (json_field_t){ .path = "ssid", .type = JSON_FIELD_STR, .buf = b->ssid, .buf_size = sizeof(b->ssid) };
+    b->fields[2] = (json_field_t){ .path = "password", .type = JSON_FIELD_STR, .buf = b->password, .buf_size = sizeof(b->password) };
+    b->fields[3] = (json_field_t){ .path = "token", .type = JSON_FIELD_STR, .buf = b->token, .buf_size = sizeof(b->token) };
+}
+
+// 在 split1、split2 处切成最多三段喂入，返回 0 表示完整解析
+static int extract3(const char *json, json_field_t *fields, int cnt, size_t split1, size_t split2)
+{
+    json_extract_t ctx;
+    size_t len = strlen(json);
+
+    if (split1 > len) {
+        split1 = len;
+    }
+    if (split2 > len || split2 < split1) {
+        split2 = len;
+    }
+
+    json_extract_init(&ctx, fields, cnt);
+    if (json_extract_feed(&ctx, json, split1) != 0 ||
+        json_extract_feed(&ctx, json + split1, split2 - split1) != 0 ||
+        json_extract_feed(&ctx, json + split2, len - split2) != 0) {
+        CHECK(json_extract_finish(&ctx) == -1);
+        return -1;
+    }
+
+    return json_extract_finish(&ctx);
+}
+
+static int extract(const char *json, json_field_t *fields, int cnt)
+{
+    return extract3(json, fields, cnt, NO_SPLIT, NO_SPLIT);
+}
+
+static json_field_t str_field(const char *path, char *buf, size_t size)
+{
+    return (json_field_t){ .path = path, .type = JSON_FIELD_STR, .buf = buf, .buf_size = size };
+}
+
+static json_field_t int_field(const char *path)
+{
+    return (json_field_t){ .path = path, .type = JSON_FIELD_INT };
+}
+
+// 解析 json 中的 "s" 字符串字段，返回解码结果
+static const char *extract_s(const char *json, size_t size, bool *truncated)
+{
+    static char buf[64];
+    json_field_t field = str_field("s", buf, size);
+
+    CHECK(size <= sizeof(buf));
+    CHECK(extract(json, &field, 1) == 0);
+    CHECK(field.found);
+    CHECK(field.len == strlen(buf));
+    if (truncated) {
+        *truncated = field.truncated;
+    } else {
+        CHECK(!field.truncated);
+    }
+
+    return buf;
+}
+
+static void test_bind_message(void)
+{
+    bind_t b;
+    bind_init(&b);
+
+    CHECK(extract(" {\"cmdType\": 1, \"ssid\":\"home\",\r\n\"password\":\"p@ss \\\"w\\\"\",\"token\":\"0123abcd\"} ",
+                  b.fields, 4) == 0);
+    CHECK(b.fields[0].found && b.fields[0].value == 1);
+    CHECK(strcmp(b.ssid, "home") == 0 && b.fields[1].len == 4);
+    CHECK(strcmp(b.password, "p@ss \"w\"") == 0);
+    CHECK(strcmp(b.token, "0123abcd") == 0);
+
+    // 缺失的字段保持 found = false，多余的字段忽略
+    CHECK(extract("{\"cmdType\":2,\"extra\":{\"ssid\":\"x\"},\"list\":[\"a\"]}", b.fields, 4) == 0);
+    CHECK(b.fields[0].value == 2);
+    CHECK(!b.fields[1].found && !b.fields[2].found && !b.fields[3].found);
+    CHECK(b.ssid[0] == '\0');
+}
+
+/*
+ * 在每个字节位置（以及每两个位置）切开，结果必须与一次喂完相同，
+ * 包括切在转义、\u 代理对、多字节字符和数字中间的情况
+ */
+static void test_split_every_offset(void)
+{
+    const char *json = "{\"data\":{\"code\":-40000,\"ssid\":\"a\\\"\\u4e2d\\ud83d\\ude00\xe4\xb8\xad\\n\"},"
+                       "\"list\":[{\"code\":1},true],\"ssid\":\"\\u00e9t\\u00E9\",\"code\":12e2,\"on\":true}";
+    size_t len = strlen(json);
+    char expect_inner[32], expect_outer[32];
+    json_field_t expect[5] = {
+        int_field("data.code"),
+        str_field("data.ssid", expect_inner, sizeof(expect_inner)),
+        str_field("ssid", expect_outer, sizeof(expect_outer)),
+        int_field("code"),
+        int_field("on"),
+    };
+
+    CHECK(extract(json, expect, 5) == 0);
+    CHECK(expect[0].value == -40000);
+    CHECK(strcmp(expect_inner, "a\"\xe4\xb8\xad\xf0\x9f\x98\x80\xe4\xb8\xad\n") == 0);
+    CHECK(strcmp(expect_outer, "\xc3\xa9t\xc3\xa9") == 0);
+    CHECK(expect[3].found && expect[3].value == 1200);
+    CHECK(expect[4].value == 1);
+
+    int runs = 0;
+    for (size_t i = 0; i <= len; i++) {
+        for (size_t j = i; j <= len; j++) {
+            char inner[32], outer[32];
+            json_field_t fields[5] = {
+                int_field("data.code"),
+                str_field("data.ssid", inner, sizeof(inner)),
+                str_field("ssid", outer, sizeof(outer)),
+                int_field("code"),
+                int_field("on"),
+            };
+
+            CHECK(extract3(json, fields, 5, i, j) == 0);
+            for (int k = 0; k < 5; k++) {
+                CHECK(fields[k].found == expect[k].found);
+                CHECK(fields[k].value == expect[k].value);
+                CHECK(fields[k].len == expect[k].len);
+            }
+            CHECK(strcmp(inner, expect_inner) == 0);
+            CHECK(strcmp(outer, expect_outer) == 0);
+            runs++;
+        }
+    }
+    CHECK(runs == (int)((len + 1) * (len + 2) / 2));
+
+    // 逐字节喂入
+    json_extract_t ctx;
+    char inner[32], outer[32];
+    json_field_t fields[2] = {
+        str_field("data.ssid", inner, sizeof(inner)),
+        str_field("ssid", outer, sizeof(outer)),
+    };
+    json_extract_init(&ctx, fields, 2);
+    for (size_t i = 0; i < len; i++) {
+        CHECK(json_extract_feed(&ctx, json + i, 1) == 0);
+    }
+    CHECK(json_extract_finish(&ctx) == 0);
+    CHECK(strcmp(inner, expect_inner) == 0 && strcmp(outer, expect_outer) == 0);
+}
+
+// 嵌套路径只匹配完整路径，同名的 key 在其他层级不算
+static void test_nested(void)
+{
+    char data[16];
+    json_field_t fields[4] = {
+        int_field("code"),
+        int_field("data.code"),
+        int_field("a.b.c.d"),
+        str_field("data", data, sizeof(data)),
+    };
+
+    CHECK(extract("{\"code\":0,\"data\":{\"code\":40000,\"x\":{\"code\":7}},\"a\":{\"b\":{\"c\":{\"d\":5}}}}",
+                  fields, 4) == 0);
+    CHECK(fields[0].found && fields[0].value == 0);
+    CHECK(fields[1].found && fields[1].value == 40000);
+    CHECK(fields[2].found && fields[2].value == 5);
+    // 值是对象时不匹配
+    CHECK(!fields[3].found);
+
+    // 对象结束后路径恢复，后面的同级 key 仍能匹配
+    CHECK(extract("{\"data\":{\"x\":{}},\"code\":3,\"a\":{\"b\":{}},\"data\":{\"code\":4}}", fields, 4) == 0);
+    CHECK(fields[0].value == 3 && fields[1].value == 4 && !fields[2].found);
+
+    // 前缀相同但不是同一个 key
+    CHECK(extract("{\"datax\":{\"code\":1},\"dat\":{\"code\":2},\"codes\":3}", fields, 4) == 0);
+    CHECK(!fields[0].found && !fields[1].found);
+}
+
+// 数组内的元素不参与匹配，数组结束后继续匹配
+static void test_arrays(void)
+{
+    char list[16];
+    json_field_t fields[3] = {
+        int_field("code"),
+        int_field("list.code"),
+        str_field("list", list, sizeof(list)),
+    };
+
+    CHECK(extract("{\"list\":[{\"code\":1},[{\"code\":2}],\"x\",3],\"code\":4}", fields, 3) == 0);
+    CHECK(fields[0].found && fields[0].value == 4);
+    CHECK(!fields[1].found && !fields[2].found);
+
+    CHECK(extract("[{\"code\":1},{\"code\":2}]", fields, 3) == 0);
+    CHECK(!fields[0].found);
+
+    CHECK(extract("{\"list\":[],\"a\":[[]],\"code\":5}", fields, 3) == 0);
+    CHECK(fields[0].value == 5);
+}
+
+static void test_escapes(void)
+{
+    CHECK(strcmp(extract_s("{\"s\":\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"}", 64, NULL), "\"\\/\b\f\n\r\t") == 0);
+    CHECK(strcmp(extract_s("{\"s\":\"\\u0041\\u00e9\\u4E2D\"}", 64, NULL), "A\xc3\xa9\xe4\xb8\xad") == 0);
+
+    // 代理对合并为一个 4 字节的 UTF-8 字符，而不是两个 3 字节的 CESU-8
+    CHECK(strcmp(extract_s("{\"s\":\"\\ud83d\\ude00\"}", 64, NULL), "\xf0\x9f\x98\x80") == 0);
+    CHECK(strcmp(extract_s("{\"s\":\"\\uD800\\uDC00\\uDBFF\\uDFFF\"}", 64, NULL),
+                 "\xf0\x90\x80\x80\xf4\x8f\xbf\xbf") == 0);
+
+    // 不成对的代理替换为 U+FFFD
+    CHECK(strcmp(extract_s("{\"s\":\"\\ud83dx\"}", 64, NULL), "\xef\xbf\xbdx") == 0);
+    CHECK(strcmp(extract_s("{\"s\":\"\\ud83d\"}", 64, NULL), "\xef\xbf\xbd") == 0);
+    CHECK(strcmp(extract_s("{\"s\":\"\\ude00a\"}", 64, NULL), "\xef\xbf\xbd" "a") == 0);
+    CHECK(strcmp(extract_s("{\"s\":\"\\ud83d\\n\"}", 64, NULL), "\xef\xbf\xbd\n") == 0);
+    CHECK(strcmp(extract_s("{\"s\":\"\\ud83d\\u0041\"}", 64, NULL), "\xef\xbf\xbd" "A") == 0);
+    CHECK(strcmp(extract_s("{\"s\":\"\\ud83d\\ud83d\\ude00\"}", 64, NULL), "\xef\xbf\xbd\xf0\x9f\x98\x80") == 0);
+
+    // key 里的转义同样解码
+    char v[8];
+    json_field_t field = str_field("\xc3\xa9", v, sizeof(v));
+    CHECK(extract("{\"\\u00e9\":\"ok\"}", &field, 1) == 0);
+    CHECK(field.found && strcmp(v, "ok") == 0);
+}
+
+// 截断时保留完整字符的前缀，不会留下半个 UTF-8 字符
+static void test_truncation(void)
+{
+    bool truncated;
+
+    CHECK(strcmp(extract_s("{\"s\":\"abcdef\"}", 4, &truncated), "abc") == 0 && truncated);
+    CHECK(strcmp(extract_s("{\"s\":\"abc\"}", 4, &truncated), "abc") == 0 && !truncated);
+    CHECK(strcmp(extract_s("{\"s\":\"ab\\u4e2d\"}", 5, &truncated), "ab") == 0 && truncated);
+    CHECK(strcmp(extract_s("{\"s\":\"ab\\u4e2d\"}", 6, &truncated), "ab\xe4\xb8\xad") == 0 && !truncated);
+    CHECK(strcmp(extract_s("{\"s\":\"\\ud83d\\ude00\"}", 4, &truncated), "") == 0 && truncated);
+    CHECK(strcmp(extract_s("{\"s\":\"\\ud83d\\ude00\"}", 5, &truncated), "\xf0\x9f\x98\x80") == 0 && !truncated);
+    CHECK(strcmp(extract_s("{\"s\":1234567}", 4, &truncated), "123") == 0 && truncated);
+    CHECK(strcmp(extract_s("{\"s\":true}", 8, &truncated), "true") == 0 && !truncated);
+
+    // 重复的 key 以最后一个值为准，截断标记也重新计算
+    CHECK(strcmp(extract_s("{\"s\":\"abcdef\",\"s\":\"ab\"}", 4, &truncated), "ab") == 0 && !truncated);
+    CHECK(strcmp(extract_s("{\"s\":\"ab\",\"s\":\"abcdef\"}", 4, &truncated), "abc") == 0 && truncated);
+}
+
+// 嵌套超过 JSON_EXTRACT_DEPTH_MAX 层是错误
+static void test_depth_overflow(void)
+{
+    char json[64];
+    json_field_t field = int_field("a.a.a.a.a.a.a.a");
+
+    for (int depth = 1; depth <= JSON_EXTRACT_DEPTH_MAX + 1; depth++) {
+        size_t pos = 0;
+        for (int i = 0; i < depth; i++) {
+            pos += sprintf(json + pos, i + 1 < depth ? "{\"a\":" : "{\"a\":1");
+        }
+        for (int i = 0; i < depth; i++) {
+            json[pos++] = '}';
+        }
+        json[pos] = '\0';
+
+        int ret = extract(json, &field, 1);
+        if (depth <= JSON_EXTRACT_DEPTH_MAX) {
+            CHECK(ret == 0);
+            CHECK(field.found == (depth == JSON_EXTRACT_DEPTH_MAX));
+        } else {
+            CHECK(ret == -1);
+        }
+    }
+
+    CHECK(extract("[[[[[[[[1]]]]]]]]", &field, 1) == 0);
+    CHECK(extract("[[[[[[[[[1]]]]]]]]]", &field, 1) == -1);
+}
+
+// key 或拼接后的路径过长时该成员及其下层都不匹配，但不影响后续解析
+static void test_key_overflow(void)
+{
+    char key31[JSON_EXTRACT_KEY_MAX];
+    char key32[JSON_EXTRACT_KEY_MAX + 1];
+    char json[256];
+
+    memset(key31, 'k', sizeof(key31) - 1);
+    key31[sizeof(key31) - 1] = '\0';
+    memset(key32, 'k', sizeof(key32) - 1);
+    key32[sizeof(key32) - 1] = '\0';
+
+    // 最长的 key 正好能放下
+    json_field_t fields[2] = { int_field(key31), int_field("code") };
+    snprintf(json, sizeof(json), "{\"%s\":1,\"code\":2}", key31);
+    CHECK(extract(json, fields, 2) == 0);
+    CHECK(fields[0].found && fields[0].value == 1 && fields[1].value == 2);
+
+    // 超长的 key 不能按前缀匹配到较短的字段
+    snprintf(json, sizeof(json), "{\"%s\":1,\"code\":2}", key32);
+    CHECK(extract(json, fields, 2) == 0);
+    CHECK(!fields[0].found && fields[1].value == 2);
+
+    // 超长 key 下面的对象整体跳过，即使里面有同名的子路径
+    json_field_t inner[2] = { int_field("code"), int_field("x.code") };
+    snprintf(json, sizeof(json), "{\"%s\":{\"code\":1,\"x\":{\"code\":2}},\"x\":{\"code\":3}}", key32);
+    CHECK(extract(json, inner, 2) == 0);
+    CHECK(!inner[0].found && inner[1].value == 3);
+
+    // 路径总长超过 JSON_EXTRACT_PATH_MAX
+    json_field_t deep[2] = { int_field("code"), int_field("b.code") };
+    snprintf(json, sizeof(json), "{\"%s\":{\"%s\":{\"code\":1,\"b\":{\"code\":2}}},\"b\":{\"code\":3}}", key31, key31);
+    CHECK(extract(json, deep, 2) == 0);
+    CHECK(!deep[0].found && deep[1].value == 3);
+}
+
+static void test_scalars(void)
+{
+    static const struct {
+        const char *json;
+        bool found;
+        long value;
+    } ints[] = {
+        { "{\"v\":0}",          true,  0 },
+        { "{\"v\":-17}",        true,  -17 },
+        { "{\"v\":3.9}",        true,  3 },
+        { "{\"v\":1E3}",        true,  1000 },
+        { "{\"v\":-2.5e1}",     true,  -25 },
+        { "{\"v\":true}",       true,  1 },
+        { "{\"v\":false}",      true,  0 },
+        { "{\"v\":null}",       false, 0 },
+        { "{\"v\":\"12\"}",     false, 0 },
+    };
+    static const char *const bad[] = {
+        "{\"v\":01}", "{\"v\":1.}", "{\"v\":.5}", "{\"v\":-}", "{\"v\":1e}", "{\"v\":1e+}",
+        "{\"v\":+1}", "{\"v\":--1}", "{\"v\":0x10}", "{\"v\":1.2.3}", "{\"v\":tru}", "{\"v\":nul}",
+        "{\"v\":True}", "{\"v\":truex}", "{\"v\":NaN}",
+        // 超过 JSON_EXTRACT_SCALAR_MAX 的数字视为错误
+        "{\"v\":123456789012345678901234}",
+    };
+
+    for (size_t i = 0; i < sizeof(ints) / sizeof(ints[0]); i++) {
+        json_field_t field = int_field("v");
+        CHECK(extract(ints[i].json, &field, 1) == 0);
+        CHECK(field.found == ints[i].found);
+        CHECK(field.value == ints[i].value);
+    }
+
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        json_field_t field = int_field("v");
+        CHECK(extract(bad[i], &field, 1) == -1);
+    }
+
+    char num[16];
+    json_field_t field = str_field("v", num, sizeof(num));
+    CHECK(extract("{\"v\":-1.25e-3}", &field, 1) == 0);
+    CHECK(field.found && strcmp(num, "-1.25e-3") == 0);
+}
+
+static void test_syntax_errors(void)
+{
+    static const char *const bad[] = {
+        "", "   ", "{", "}", "[", "{\"a\"}", "{\"a\":}", "{\"a\" 1}", "{\"a\":1,}", "[1,]", "[,1]",
+        "{,}", "{\"a\":1 \"b\":2}", "[1 2]", "{'a':1}", "{a:1}", "\"abc", "{\"a\":\"x\ny\"}",
+        "{\"a\":\"\\x\"}", "{\"a\":\"\\u12g4\"}", "{\"a\":\"\\u12\"}", "{\"a\":1}}", "{\"a\":[1}", "[1]]",
+        "{} {}", "{} x", "1 2", "{\"a\":1}\"", "{\"a\":@}", "{\"a\"::1}", "{:1}",
+    };
+
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        json_field_t field = int_field("a");
+        if (extract(bad[i], &field, 1) != -1) {
+            fprintf(stderr, "accepted: %s\n", bad[i]);
+            CHECK(0);
+        }
+    }
+
+    // 出错后继续喂入的数据被忽略
+    json_extract_t ctx;
+    json_field_t field = int_field("a");
+    json_extract_init(&ctx, &field, 1);
+    CHECK(json_extract_feed(&ctx, "{x", 2) == -1);
+    CHECK(json_extract_feed(&ctx, "{\"a\":1}", 7) == -1);
+    CHECK(json_extract_finish(&ctx) == -1);
+    CHECK(!field.found);
+}
+
+// 顶层可以是任意值，前后允许空白
+static void test_top_level(void)
+{
+    json_field_t field = int_field("a");
+    CHECK(extract(" 42 ", &field, 1) == 0);
+    CHECK(extract("-7", &field, 1) == 0);
+    CHECK(extract("\"x\"", &field, 1) == 0);
+    CHECK(extract("null\r\n", &field, 1) == 0);
+    CHECK(extract("[]", &field, 1) == 0);
+    CHECK(extract(" {\"a\":1} \n", &field, 1) == 0);
+    CHECK(field.value == 1);
+}
+
+int main(void)
+{
+    test_bind_message();
+    test_split_every_offset();
+    test_nested();
+    test_arrays();
+    test_escapes();
+    test_truncation();
+    test_depth_overflow();
+    test_key_overflow();
+    test_scalars();
+    test_syntax_errors();
+    test_top_level();
+    printf("json_extract ok\n");
+
+    return 0;
+}
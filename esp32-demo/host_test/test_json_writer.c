@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "host_test.h"
+#include "json_writer.h"
+#include "json_extract.h"
+
+#define OUT_SIZE        512
+#define GUARD_SIZE      16
+#define GUARD_BYTE      0x5a
+
+static char g_out[OUT_SIZE + GUARD_SIZE];
+
+static void expect(json_writer_t *w, const char *expected)
+{
+    int len = json_writer_finish(w);
+
+    if (len < 0 || strcmp(g_out, expected) != 0) {
+        fprintf(stderr, "got %d |%s|, expected |%s|\n", len, len < 0 ? "" : g_out, expected);
+    }
+    CHECK(len == (int)strlen(expected));
+    CHECK(strcmp(g_out, expected) == 0);
+}
+
+// 用 json_extract 解析写出的文本，取回 key 的字符串值
+static void check_round_trip(const char *json, const char *key, const char *value)
+{
+    char buf[128];
+    json_field_t field = { .path = key, .type = JSON_FIELD_STR, .buf = buf, .buf_size = sizeof(buf) };
+    json_extract_t ctx;
+
+    json_extract_init(&ctx, &field, 1);
+    CHECK(json_extract_feed(&ctx, json, strlen(json)) == 0);
+    CHECK(json_extract_finish(&ctx) == 0);
+    CHECK(field.found && !field.truncated);
+    CHECK(field.len == strlen(value) && strcmp(buf, value) == 0);
+}
+
+// 引号、反斜杠和控制字符转义，其余字节（包括 UTF-8 和 0x7f）原样输出
+static void test_escaping(void)
+{
+    static const struct {
+        const char *in;
+        const char *out;
+    } cases[] = {
+        { "plain", "\"plain\"" },
+        { "", "\"\"" },
+        { "a\"b", "\"a\\\"b\"" },
+        { "back\\slash", "\"back\\\\slash\"" },
+        { "\n\r\t", "\"\\n\\r\\t\"" },
+        { "\x01\x1f", "\"\\u0001\\u001f\"" },
+        { "\b\f", "\"\\u0008\\u000c\"" },
+        { "\x7f", "\"\x7f\"" },
+        { "\xe4\xbd\xa0\xe5\xa5\xbd", "\"\xe4\xbd\xa0\xe5\xa5\xbd\"" },
+        { "</script>", "\"</script>\"" },
+        { "\"\\\"", "\"\\\"\\\\\\\"\"" },
+    };
+    json_writer_t w;
+    char expected[128];
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        json_writer_init(&w, g_out, OUT_SIZE);
+        json_writer_object_begin(&w, NULL);
+        json_writer_str(&w, "v", cases[i].in);
+        json_writer_object_end(&w);
+        snprintf(expected, sizeof(expected), "{\"v\":%s}", cases[i].out);
+        expect(&w, expected);
+        check_round_trip(g_out, "v", cases[i].in);
+    }
+
+    // key 同样转义
+    json_writer_init(&w, g_out, OUT_SIZE);
+    json_writer_object_begin(&w, NULL);
+    json_writer_str(&w, "k\"\n", "v");
+    json_writer_object_end(&w);
+    expect(&w, "{\"k\\\"\\n\":\"v\"}");
+
+    // NULL 当作空字符串
+    json_writer_init(&w, g_out, OUT_SIZE);
+    json_writer_array_begin(&w, NULL);
+    json_writer_str(&w, NULL, NULL);
+    json_writer_array_end(&w);
+    expect(&w, "[\"\"]");
+}
+
+static void test_scalars(void)
+{
+    json_writer_t w;
+
+    json_writer_init(&w, g_out, OUT_SIZE);
+    json_writer_object_begin(&w, NULL);
+    json_writer_int(&w, "zero", 0);
+    json_writer_int(&w, "neg", -42);
+    json_writer_int(&w, "max", LLONG_MAX);
+    json_writer_int(&w, "min", LLONG_MIN);
+    json_writer_bool(&w, "t", true);
+    json_writer_bool(&w, "f", false);
+    json_writer_null(&w, "n");
+    json_writer_object_end(&w);
+    expect(&w, "{\"zero\":0,\"neg\":-42,\"max\":9223372036854775807,\"min\":-9223372036854775808,"
+               "\"t\":true,\"f\":false,\"n\":null}");
+}
+
+// 每层各自记录是否需要逗号，空容器和嵌套的容器都不多写逗号
+static void test_nesting(void)
+{
+    json_writer_t w;
+
+    json_writer_init(&w, g_out, OUT_SIZE);
+    json_writer_object_begin(&w, NULL);
+    json_writer_object_begin(&w, "empty");
+    json_writer_object_end(&w);
+    json_writer_array_begin(&w, "list");
+    json_writer_array_end(&w);
+    json_writer_array_begin(&w, "items");
+    json_writer_object_begin(&w, NULL);
+    json_writer_int(&w, "id", 1);
+    json_writer_array_begin(&w, "tags");
+    json_writer_str(&w, NULL, "a");
+    json_writer_str(&w, NULL, "b");
+    json_writer_array_end(&w);
+    json_writer_object_end(&w);
+    json_writer_object_begin(&w, NULL);
+    json_writer_int(&w, "id", 2);
+    json_writer_object_end(&w);
+    json_writer_array_end(&w);
+    json_writer_bool(&w, "last", true);
+    json_writer_object_end(&w);
+    expect(&w, "{\"empty\":{},\"list\":[],\"items\":[{\"id\":1,\"tags\":[\"a\",\"b\"]},{\"id\":2}],\"last\":true}");
+
+    // 正好 JSON_WRITER_DEPTH_MAX 层
+    char expected[64] = "";
+    json_writer_init(&w, g_out, OUT_SIZE);
+    for (int i = 0; i < JSON_WRITER_DEPTH_MAX; i++) {
+        json_writer_array_begin(&w, NULL);
+        strcat(expected, "[");
+    }
+    json_writer_int(&w, NULL, 7);
+    strcat(expected, "7");
+    for (int i = 0; i < JSON_WRITER_DEPTH_MAX; i++) {
+        json_writer_array_end(&w);
+        strcat(expected, "]");
+    }
+    expect(&w, expected);
+
+    // 超过最大层数
+    json_writer_init(&w, g_out, OUT_SIZE);
+    for (int i = 0; i <= JSON_WRITER_DEPTH_MAX; i++) {
+        json_writer_array_begin(&w, NULL);
+    }
+    for (int i = 0; i <= JSON_WRITER_DEPTH_MAX; i++) {
+        json_writer_array_end(&w);
+    }
+    CHECK(json_writer_finish(&w) == -1);
+
+    // 括号不匹配
+    json_writer_init(&w, g_out, OUT_SIZE);
+    json_writer_object_begin(&w, NULL);
+    CHECK(json_writer_finish(&w) == -1);
+
+    json_writer_init(&w, g_out, OUT_SIZE);
+    json_writer_object_begin(&w, NULL);
+    json_writer_object_end(&w);
+    json_writer_object_end(&w);
+    CHECK(json_writer_finish(&w) == -1);
+}
+
+static void write_state(json_writer_t *w, char *buf, size_t size)
+{
+    json_writer_init(w, buf, size);
+    json_writer_object_begin(w, NULL);
+    json_writer_bool(w, "switch", true);
+    json_writer_int(w, "uptime_ms", 123456789);
+    json_writer_object_begin(w, "wifi");
+    json_writer_str(w, "ssid", "home \"5g\"\t\xe4\xbd\xa0");
+    json_writer_int(w, "rssi", -61);
+    json_writer_object_end(w);
+    json_writer_array_begin(w, "topics");
+    json_writer_str(w, NULL, "light002");
+    json_writer_null(w, NULL);
+    json_writer_array_end(w);
+    json_writer_object_end(w);
+}
+
+/*
+ * 从 0 字节开始逐个尝试缓冲区大小：放不下时返回 -1，缓冲区之外一个字节都不写；
+ * 正好放下（输出长度加 '\0'）时与大缓冲区的结果相同
+ */
+static void test_overflow(void)
+{
+    char full[OUT_SIZE];
+    json_writer_t w;
+
+    write_state(&w, full, sizeof(full));
+    int full_len = json_writer_finish(&w);
+    CHECK(full_len > 0);
+
+    for (int size = 0; size <= full_len + 1; size++) {
+        memset(g_out, GUARD_BYTE, sizeof(g_out));
+        write_state(&w, g_out, size);
+        int len = json_writer_finish(&w);
+
+        if (size <= full_len) {
+            CHECK(len == -1);
+        } else {
+            CHECK(len == full_len && strcmp(g_out, full) == 0);
+        }
+        for (int i = size; i < (int)sizeof(g_out); i++) {
+            CHECK((unsigned char)g_out[i] == GUARD_BYTE);
+        }
+    }
+
+    // 溢出之后的写入全部忽略，不会因为后面的短值又写进去
+    memset(g_out, GUARD_BYTE, sizeof(g_out));
+    json_writer_init(&w, g_out, 8);
+    json_writer_array_begin(&w, NULL);
+    json_writer_str(&w, NULL, "0123456789");
+    json_writer_int(&w, NULL, 1);
+    json_writer_array_end(&w);
+    CHECK(json_writer_finish(&w) == -1);
+    CHECK(w.len == 2 && memcmp(g_out, "[\"", 2) == 0);
+}
+
+int main(void)
+{
+    test_escaping();
+    test_scalars();
+    test_nesting();
+    test_overflow();
+    printf("json_writer ok\n");
+
+    return 0;
+}
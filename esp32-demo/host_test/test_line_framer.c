@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_test.h"
+#include "line_framer.h"
+
+#define FRAMER_BUF_SIZE     32
+#define MAX_FRAMES          4096
+
+static char g_frames[MAX_FRAMES][FRAMER_BUF_SIZE];
+static int g_frame_num;
+
+static void frame_cb(char *frame, size_t len, void *arg)
+{
+    CHECK(strlen(frame) == len);
+    CHECK(len < FRAMER_BUF_SIZE);
+    CHECK(g_frame_num < MAX_FRAMES);
+    memcpy(g_frames[g_frame_num++], frame, len + 1);
+}
+
+// 按 chunk 字节一段写入，chunk 为 0 时每次写满可用空间
+static int feed(line_framer_t *framer, const char *data, size_t len, size_t chunk)
+{
+    int frames = 0;
+
+    while (len > 0) {
+        size_t space = 0;
+        char *wr = line_framer_get_space(framer, &space);
+        CHECK(space > 0);
+        size_t n = len < space ? len : space;
+        if (chunk > 0 && n > chunk) {
+            n = chunk;
+        }
+        memcpy(wr, data, n);
+        frames += line_framer_commit(framer, n);
+        data += n;
+        len -= n;
+    }
+
+    return frames;
+}
+
+static int feed_str(line_framer_t *framer, const char *str)
+{
+    return feed(framer, str, strlen(str), 0);
+}
+
+static void setup(line_framer_t *framer, char *buf)
+{
+    g_frame_num = 0;
+    line_framer_init(framer, buf, FRAMER_BUF_SIZE, frame_cb, NULL);
+}
+
+// 半包：行尾到达前不交付，\r 和 \n 分开到达也能拼上
+static void test_partial(void)
+{
+    char buf[FRAMER_BUF_SIZE];
+    line_framer_t framer;
+    setup(&framer, buf);
+
+    CHECK(feed_str(&framer, "cmd=2&ms") == 0);
+    CHECK(feed_str(&framer, "g=on\r") == 0);
+    CHECK(feed_str(&framer, "\n") == 1);
+    CHECK(strcmp(g_frames[0], "cmd=2&msg=on") == 0);
+
+    CHECK(feed_str(&framer, "cmd=0") == 0);
+    CHECK(feed_str(&framer, "\n") == 1);
+    CHECK(strcmp(g_frames[1], "cmd=0") == 0);
+    CHECK(framer.frame_cnt == 2 && framer.oversize_cnt == 0);
+}
+
+// 一次提交多行，空行不交付，剩下的半包留到下一次
+static void test_multiple(void)
+{
+    char buf[FRAMER_BUF_SIZE];
+    line_framer_t framer;
+    setup(&framer, buf);
+
+    CHECK(feed_str(&framer, "a=1\r\nb=2\n\r\n\nc=3\r\nd") == 3);
+    CHECK(strcmp(g_frames[0], "a=1") == 0);
+    CHECK(strcmp(g_frames[1], "b=2") == 0);
+    CHECK(strcmp(g_frames[2], "c=3") == 0);
+    CHECK(feed_str(&framer, "=4\r\n") == 1);
+    CHECK(strcmp(g_frames[3], "d=4") == 0);
+}
+
+// 超长行整行丢弃并计数，之后的行不受影响
+static void test_oversize(void)
+{
+    char buf[FRAMER_BUF_SIZE];
+    line_framer_t framer;
+    setup(&framer, buf);
+
+    CHECK(feed_str(&framer, "0123456789012345678901234567890123456789\r\nok\r\n") == 1);
+    CHECK(strcmp(g_frames[0], "ok") == 0);
+    CHECK(framer.oversize_cnt == 1);
+
+    // 32 字节内容加 \n，没有位置放 '\0'
+    CHECK(feed_str(&framer, "0123456789012345678901234567890x\nok2\n") == 1);
+    CHECK(strcmp(g_frames[1], "ok2") == 0);
+    CHECK(framer.oversize_cnt == 2);
+
+    // 占满缓冲区的 '\r' 后面不是 '\n'
+    CHECK(feed_str(&framer, "012345678901234567890123456789x\rzz\r\nok3\r\n") == 1);
+    CHECK(strcmp(g_frames[2], "ok3") == 0);
+    CHECK(framer.oversize_cnt == 3);
+}
+
+// 正好用满缓冲区的行：31 字节内容加 \r\n，以及 31 字节内容加 \n
+static void test_exact_fill(void)
+{
+    const char *line = "0123456789012345678901234567890";
+    char buf[FRAMER_BUF_SIZE];
+    char data[64];
+    line_framer_t framer;
+    setup(&framer, buf);
+
+    CHECK(strlen(line) == FRAMER_BUF_SIZE - 1);
+
+    snprintf(data, sizeof(data), "%s\r\n", line);
+    CHECK(feed_str(&framer, data) == 1);
+    CHECK(strcmp(g_frames[0], line) == 0);
+
+    // 前面有半包时，搬移后同样能放下
+    CHECK(feed_str(&framer, "a=1\r\nb") == 1);
+    snprintf(data, sizeof(data), "%s\r\n", line + 1);
+    CHECK(feed_str(&framer, data) == 1);
+    CHECK(g_frames[2][0] == 'b' && strcmp(g_frames[2] + 1, line + 1) == 0);
+
+    snprintf(data, sizeof(data), "%s\n", line);
+    CHECK(feed_str(&framer, data) == 1);
+    CHECK(strcmp(g_frames[3], line) == 0);
+
+    // 内容本身以 '\r' 结尾，只去掉行尾的一个 '\r'
+    snprintf(data, sizeof(data), "%.30s\r\r\n", line);
+    CHECK(feed_str(&framer, data) == 1);
+    CHECK(strlen(g_frames[4]) == FRAMER_BUF_SIZE - 1 && g_frames[4][30] == '\r');
+
+    CHECK(framer.oversize_cnt == 0);
+}
+
+/*
+ * 随机行长和随机分段，与按行切分的参考结果比较
+ * 去掉行尾一个 '\r' 后长度不超过 FRAMER_BUF_SIZE - 1 的非空行才会交付
+ */
+static void test_random(void)
+{
+    static char stream[64 * 1024];
+    static char expect[MAX_FRAMES][FRAMER_BUF_SIZE];
+    char buf[FRAMER_BUF_SIZE];
+    line_framer_t framer;
+
+    srand(2);
+    for (int round = 0; round < 200; round++) {
+        size_t len = 0;
+        int expect_num = 0;
+        uint32_t oversize = 0;
+
+        while (len < sizeof(stream) - 64 && expect_num < MAX_FRAMES) {
+            size_t line_len = rand() % 40;
+            size_t start = len;
+            for (size_t i = 0; i < line_len; i++) {
+                int r = rand() % 8;
+                stream[len++] = r == 0 ? '\r' : 'a' + r;
+            }
+            size_t payload = line_len;
+            if (rand() % 2) {
+                stream[len++] = '\r';
+                payload++;
+            }
+            stream[len++] = '\n';
+
+            if (payload > 0 && stream[start + payload - 1] == '\r') {
+                payload--;
+            }
+            if (payload > FRAMER_BUF_SIZE - 1) {
+                oversize++;
+            } else if (payload > 0) {
+                memcpy(expect[expect_num], stream + start, payload);
+                expect[expect_num++][payload] = '\0';
+            }
+        }
+
+        setup(&framer, buf);
+        CHECK(feed(&framer, stream, len, round % 2 ? 0 : 1 + rand() % 16) == expect_num);
+        CHECK(g_frame_num == expect_num);
+        for (int i = 0; i < expect_num; i++) {
+            CHECK(strcmp(g_frames[i], expect[i]) == 0);
+        }
+        CHECK(framer.oversize_cnt == oversize);
+    }
+}
+
+int main(void)
+{
+    test_partial();
+    test_multiple();
+    test_oversize();
+    test_exact_fill();
+    test_random();
+    printf("line_framer ok\n");
+
+    return 0;
+}
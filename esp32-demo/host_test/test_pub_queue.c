@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "host_test.h"
+#include "pub_queue.h"
+
+#define STRESS_PRODUCERS    4
+#define STRESS_MSGS         20000
+
+static pub_queue_t g_queue;
+
+// 取出队首消息并与期望比较
+static void expect_msg(const char *topic, const char *msg)
+{
+    const pub_msg_t *m = pub_queue_peek(&g_queue);
+    CHECK(m != NULL);
+    CHECK(strcmp(m->topic, topic) == 0);
+    CHECK(strcmp(m->msg, msg) == 0);
+    pub_queue_pop(&g_queue);
+}
+
+static void expect_empty(void)
+{
+    pub_queue_stats_t stats;
+    CHECK(pub_queue_peek(&g_queue) == NULL);
+    pub_queue_get_stats(&g_queue, &stats);
+    CHECK(stats.depth == 0);
+}
+
+// 离线期间开关来回切换 10 次，只发出最后一次
+static void test_flips_coalesce(void)
+{
+    pub_queue_stats_t stats;
+
+    memset(&g_queue, 0, sizeof(g_queue));
+    for (int i = 0; i < 10; i++) {
+        CHECK(pub_queue_post(&g_queue, "switch", i % 2 ? "off" : "on", true) == 0);
+    }
+
+    expect_msg("switch", "off");
+    expect_empty();
+
+    pub_queue_get_stats(&g_queue, &stats);
+    CHECK(stats.posted == 10 && stats.coalesced == 9 && stats.dropped == 0);
+}
+
+// 普通消息不合并且保持顺序，状态消息在最后一次的位置发出，不同状态主题互不影响
+static void test_mixed(void)
+{
+    pub_queue_stats_t stats;
+
+    memset(&g_queue, 0, sizeof(g_queue));
+    CHECK(pub_queue_post(&g_queue, "switch", "on", true) == 0);
+    CHECK(pub_queue_post(&g_queue, "event", "1", false) == 0);
+    CHECK(pub_queue_post(&g_queue, "light", "10", true) == 0);
+    CHECK(pub_queue_post(&g_queue, "event", "2", false) == 0);
+    CHECK(pub_queue_post(&g_queue, "switch", "off", true) == 0);
+    CHECK(pub_queue_post(&g_queue, "event", "2", false) == 0);
+    CHECK(pub_queue_post(&g_queue, "light", "20", true) == 0);
+
+    expect_msg("event", "1");
+    expect_msg("event", "2");
+    expect_msg("switch", "off");
+    expect_msg("event", "2");
+    expect_msg("light", "20");
+    expect_empty();
+
+    pub_queue_get_stats(&g_queue, &stats);
+    CHECK(stats.posted == 7 && stats.coalesced == 2);
+}
+
+// 已经取走的状态消息不参与合并
+static void test_no_coalesce_after_pop(void)
+{
+    memset(&g_queue, 0, sizeof(g_queue));
+    for (int i = 0; i < 10; i++) {
+        const char *msg = i % 2 ? "off" : "on";
+        CHECK(pub_queue_post(&g_queue, "switch", msg, true) == 0);
+        expect_msg("switch", msg);
+    }
+    expect_empty();
+}
+
+// 队列被状态标记占满时新值仍然被接受，消费者拿到的是最新值
+static void test_full_state(void)
+{
+    pub_queue_stats_t stats;
+
+    memset(&g_queue, 0, sizeof(g_queue));
+    for (int i = 0; i < PUB_QUEUE_LEN; i++) {
+        CHECK(pub_queue_post(&g_queue, "switch", i % 2 ? "off" : "on", true) == 0);
+    }
+    CHECK(pub_queue_post(&g_queue, "switch", "on", true) == 0);
+
+    pub_queue_get_stats(&g_queue, &stats);
+    CHECK(stats.depth == PUB_QUEUE_LEN && stats.dropped == 0);
+
+    expect_msg("switch", "on");
+    expect_empty();
+
+    pub_queue_get_stats(&g_queue, &stats);
+    CHECK(stats.posted == PUB_QUEUE_LEN + 1 && stats.coalesced == PUB_QUEUE_LEN);
+}
+
+// 队列被普通消息占满：普通消息丢弃并计数，状态消息在队列取空后发出
+static void test_full_events(void)
+{
+    pub_queue_stats_t stats;
+    char msg[16];
+
+    memset(&g_queue, 0, sizeof(g_queue));
+    for (int i = 0; i < PUB_QUEUE_LEN; i++) {
+        snprintf(msg, sizeof(msg), "%d", i);
+        CHECK(pub_queue_post(&g_queue, "event", msg, false) == 0);
+    }
+    CHECK(pub_queue_post(&g_queue, "event", "lost", false) == -1);
+    CHECK(pub_queue_post(&g_queue, "switch", "on", true) == 0);
+    CHECK(pub_queue_post(&g_queue, "switch", "off", true) == 0);
+
+    pub_queue_get_stats(&g_queue, &stats);
+    CHECK(stats.dropped == 1);
+
+    for (int i = 0; i < PUB_QUEUE_LEN; i++) {
+        snprintf(msg, sizeof(msg), "%d", i);
+        expect_msg("event", msg);
+    }
+    expect_msg("switch", "off");
+    expect_empty();
+
+    // 已发出的值不会因为留在队列中的旧标记再发一次
+    CHECK(pub_queue_post(&g_queue, "switch", "on", true) == 0);
+    expect_msg("switch", "on");
+    expect_empty();
+}
+
+static void *stress_producer(void *arg)
+{
+    long id = (long)arg;
+    char topic[16];
+    char msg[16];
+
+    snprintf(topic, sizeof(topic), "event%ld", id);
+    for (int i = 0; i < STRESS_MSGS; i++) {
+        snprintf(msg, sizeof(msg), "%d", i);
+        // 0 号生产者发状态消息，其余发普通消息
+        while (pub_queue_post(&g_queue, id == 0 ? "state" : topic, msg, id == 0) != 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+// 多个生产者并发：普通消息不丢不乱序，状态消息单调递增且最后一个值一定送达
+static void test_stress(void)
+{
+    pthread_t threads[STRESS_PRODUCERS];
+    long last[STRESS_PRODUCERS];
+    pub_queue_stats_t stats;
+
+    memset(&g_queue, 0, sizeof(g_queue));
+    for (long i = 0; i < STRESS_PRODUCERS; i++) {
+        last[i] = -1;
+        CHECK(pthread_create(&threads[i], NULL, stress_producer, (void *)i) == 0);
+    }
+
+    bool finished = false;
+    while (true) {
+        const pub_msg_t *m = pub_queue_peek(&g_queue);
+        if (m == NULL) {
+            if (finished) {
+                break;
+            }
+            pub_queue_get_stats(&g_queue, &stats);
+            finished = stats.posted == STRESS_PRODUCERS * STRESS_MSGS;
+            sched_yield();
+            continue;
+        }
+
+        long value = atol(m->msg);
+        if (strcmp(m->topic, "state") == 0) {
+            CHECK(value > last[0]);
+            last[0] = value;
+        } else {
+            int id = m->topic[5] - '0';
+            CHECK(value == last[id] + 1);
+            last[id] = value;
+        }
+        pub_queue_pop(&g_queue);
+    }
+
+    for (int i = 0; i < STRESS_PRODUCERS; i++) {
+        pthread_join(threads[i], NULL);
+        CHECK(last[i] == STRESS_MSGS - 1);
+    }
+    pub_queue_get_stats(&g_queue, &stats);
+    printf("stress: posted %u, coalesced %u\n", (unsigned)stats.posted, (unsigned)stats.coalesced);
+}
+
+int main(void)
+{
+    test_flips_coalesce();
+    test_mixed();
+    test_no_coalesce_after_pop();
+    test_full_state();
+    test_full_events();
+    test_stress();
+    printf("pub_queue ok\n");
+
+    return 0;
+}
@@ -0,0 +1,297 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_test.h"
+
+// 直接包含源文件，以便在测试中清空模块的静态变量来模拟重启
+#include "pub_store.c"
+
+#define STORE_PART_SIZE     (64 * 1024)     // 与 partitions.csv 中的 pubstore 一致
+#define OUTAGE_MSGS         6000            // 断网 10 分钟，每秒 10 条消息
+
+typedef struct {
+    char topic[TOPIC_NAME_MAX_LEN];
+    long value;
+} replay_msg_t;
+
+static replay_msg_t g_replayed[STORE_PART_SIZE / PUB_STORE_RECORD_SIZE];
+
+// 模拟重启：丢掉 RAM 中的全部状态，恢复供电后重新初始化
+static void store_reboot(pub_store_policy_t policy)
+{
+    if (g_store_lock) {
+        vSemaphoreDelete(g_store_lock);
+    }
+    free(g_store_ram);
+    g_store_part = NULL;
+    g_store_ram = NULL;
+    g_store_capacity = 0;
+    g_store_per_sector = 1;
+    g_store_head = 0;
+    g_store_tail = 0;
+    g_store_lock = NULL;
+    memset(g_store_topics, 0, sizeof(g_store_topics));
+    memset(&g_store_stats, 0, sizeof(g_store_stats));
+
+    host_partition_power_cut(-1);
+    CHECK(pub_store_init(policy) == 0);
+}
+
+// 全新的分区
+static void store_format(pub_store_policy_t policy)
+{
+    host_partition_remove_all();
+    CHECK(host_partition_create(PUB_STORE_PART_LABEL, 0x41, STORE_PART_SIZE) != NULL);
+    store_reboot(policy);
+    CHECK(g_store_stats.persistent);
+    CHECK(g_store_stats.capacity == STORE_PART_SIZE / PUB_STORE_RECORD_SIZE);
+}
+
+static int store_put_value(const char *topic, long value)
+{
+    char msg[16];
+    snprintf(msg, sizeof(msg), "%ld", value);
+    return pub_store_put(topic, msg);
+}
+
+// 按补发的方式读出最多 max 条并逐条确认
+static int store_replay(int max)
+{
+    pub_msg_t msg;
+    uint32_t seq = 0;
+    uint32_t from = 0;
+    int n = 0;
+
+    while (n < max && pub_store_read(from, &msg, &seq) == 0) {
+        CHECK(msg.state == -1);
+        strcpy(g_replayed[n].topic, msg.topic);
+        g_replayed[n].value = atol(msg.msg);
+        CHECK(pub_store_consume(seq) == 0);
+        from = seq + 1;
+        n++;
+    }
+
+    return n;
+}
+
+// 补发的必须是 first 开始的连续值
+static void check_sequence(int count, long first)
+{
+    for (int i = 0; i < count; i++) {
+        CHECK(g_replayed[i].value == first + i);
+    }
+}
+
+static void check_flash_usage(void)
+{
+    host_partition_stats_t stats;
+    host_partition_get_stats(&stats);
+    CHECK(stats.bad_writes == 0);
+}
+
+// 从空分区开始连续写入 puts 条，每写到扇区开头擦除一次
+static uint32_t expected_erases(uint32_t puts)
+{
+    return (puts + g_store_per_sector - 1) / g_store_per_sector;
+}
+
+// 按 DROP_OLDEST 连续写入 puts 条后保留的记录：最后一次擦除腾出的扇区之后的都在
+static uint32_t expected_pending(uint32_t puts)
+{
+    uint32_t last_erase = (puts - 1) / g_store_per_sector * g_store_per_sector;
+    return puts <= g_store_capacity ? puts : puts - (last_erase - g_store_capacity + g_store_per_sector);
+}
+
+// 断网 10 分钟后重启：保留最新的消息，按原顺序补发，中途重启不重复也不遗漏
+static void test_outage_drop_oldest(void)
+{
+    store_format(PUB_STORE_DROP_OLDEST);
+    for (int i = 0; i < OUTAGE_MSGS; i++) {
+        CHECK(store_put_value("sensor", i) == 0);
+    }
+
+    // 分区回绕了多圈
+    uint32_t pending = expected_pending(OUTAGE_MSGS);
+    CHECK(OUTAGE_MSGS / g_store_capacity >= 10);
+    CHECK(g_store_head == OUTAGE_MSGS);
+    CHECK(g_store_stats.pending == pending);
+    CHECK(pending >= g_store_capacity - g_store_per_sector && pending <= g_store_capacity);
+    CHECK(g_store_stats.stored == OUTAGE_MSGS);
+    CHECK(g_store_stats.dropped == OUTAGE_MSGS - pending);
+    CHECK(g_store_stats.erases == expected_erases(OUTAGE_MSGS));
+
+    host_partition_stats_t flash;
+    host_partition_get_stats(&flash);
+    CHECK(flash.erases == g_store_stats.erases);
+    CHECK(flash.bad_writes == 0);
+
+    store_reboot(PUB_STORE_DROP_OLDEST);
+    CHECK(g_store_stats.pending == pending);
+
+    int half = pending / 2;
+    CHECK(store_replay(half) == half);
+    check_sequence(half, OUTAGE_MSGS - pending);
+
+    store_reboot(PUB_STORE_DROP_OLDEST);
+    CHECK(g_store_stats.pending == pending - half);
+    CHECK(store_replay(pending) == (int)(pending - half));
+    check_sequence(pending - half, OUTAGE_MSGS - pending + half);
+    CHECK(g_store_stats.pending == 0);
+
+    // 补发完后继续使用，跨过分区末尾回绕
+    for (int i = 0; i < OUTAGE_MSGS; i++) {
+        CHECK(store_put_value("sensor", i) == 0);
+        CHECK(store_replay(1) == 1 && g_replayed[0].value == i);
+    }
+    check_flash_usage();
+}
+
+// 存满后拒绝新消息，保留最早的
+static void test_outage_drop_newest(void)
+{
+    store_format(PUB_STORE_DROP_NEWEST);
+    int stored = 0;
+    for (int i = 0; i < OUTAGE_MSGS; i++) {
+        stored += store_put_value("sensor", i) == 0;
+    }
+
+    CHECK(stored == (int)g_store_capacity);
+    CHECK(g_store_stats.stored == g_store_capacity);
+    CHECK(g_store_stats.dropped == OUTAGE_MSGS - g_store_capacity);
+    // 存满后不再擦除，已有的记录不被覆盖
+    CHECK(g_store_stats.erases == g_store_capacity / g_store_per_sector);
+
+    store_reboot(PUB_STORE_DROP_NEWEST);
+    CHECK(store_replay(OUTAGE_MSGS) == stored);
+    check_sequence(stored, 0);
+    check_flash_usage();
+}
+
+// 同一主题只补发最新值，重启后仍然按主题合并
+static void test_outage_coalesce(void)
+{
+    static const char *topics[] = { "switch", "light", "fan", "heater" };
+    const int ntopics = sizeof(topics) / sizeof(topics[0]);
+
+    store_format(PUB_STORE_COALESCE);
+    for (int i = 0; i < OUTAGE_MSGS; i++) {
+        CHECK(store_put_value(topics[i % ntopics], i) == 0);
+    }
+    CHECK(g_store_stats.pending == ntopics);
+    CHECK(g_store_stats.stored == OUTAGE_MSGS);
+    CHECK(g_store_stats.coalesced == OUTAGE_MSGS - ntopics);
+    CHECK(g_store_stats.dropped == 0);
+    CHECK(g_store_stats.erases == expected_erases(OUTAGE_MSGS));
+
+    store_reboot(PUB_STORE_COALESCE);
+    CHECK(g_store_stats.pending == ntopics);
+    CHECK(store_put_value("switch", OUTAGE_MSGS) == 0);
+    CHECK(g_store_stats.pending == ntopics);
+
+    // 按最后一次写入的顺序补发
+    CHECK(store_replay(OUTAGE_MSGS) == ntopics);
+    for (int i = 0; i < ntopics - 1; i++) {
+        int index = OUTAGE_MSGS - ntopics + 1 + i;
+        CHECK(strcmp(g_replayed[i].topic, topics[index % ntopics]) == 0);
+        CHECK(g_replayed[i].value == index);
+    }
+    CHECK(strcmp(g_replayed[ntopics - 1].topic, "switch") == 0);
+    CHECK(g_replayed[ntopics - 1].value == OUTAGE_MSGS);
+    check_flash_usage();
+}
+
+// 记录序号越过 UINT32_MAX：位置、丢弃统计和重启恢复都不受影响
+static void test_seq_wrap(void)
+{
+    const uint32_t start = 0u - 2 * g_store_capacity;
+    const int puts = 4 * g_store_capacity + g_store_per_sector / 2;
+
+    store_format(PUB_STORE_DROP_OLDEST);
+    g_store_head = start;
+    g_store_tail = start;
+    for (int i = 0; i < puts; i++) {
+        CHECK(store_put_value("sensor", i) == 0);
+    }
+    CHECK(g_store_head == start + puts);
+
+    uint32_t pending = expected_pending(puts);
+    CHECK(g_store_stats.pending == pending);
+    CHECK(g_store_stats.dropped == puts - pending);
+
+    store_reboot(PUB_STORE_DROP_OLDEST);
+    CHECK(g_store_head == start + puts);
+    CHECK(g_store_stats.pending == pending);
+    CHECK(store_replay(puts) == (int)pending);
+    check_sequence(pending, puts - pending);
+    check_flash_usage();
+}
+
+/*
+ * 写入第 count 条记录时掉电，断点覆盖记录中的每个字节
+ * 重启后之前的记录完整补发，写了一半的记录被丢弃，之后的写入不受影响
+ */
+static void test_torn_write(int count)
+{
+    for (int cut = 0; cut <= (int)sizeof(store_record_t); cut++) {
+        store_format(PUB_STORE_DROP_OLDEST);
+        for (int i = 0; i < count; i++) {
+            CHECK(store_put_value("sensor", i) == 0);
+        }
+
+        host_partition_power_cut(cut);
+        int ret = store_put_value("sensor", count);
+        CHECK(ret == (cut == (int)sizeof(store_record_t) ? 0 : -1));
+
+        store_reboot(PUB_STORE_DROP_OLDEST);
+        int kept = count + (ret == 0);
+        CHECK(g_store_stats.pending == (uint32_t)kept);
+
+        for (int i = 0; i < 40; i++) {
+            CHECK(store_put_value("sensor", 1000 + i) == 0);
+        }
+        CHECK(store_replay(OUTAGE_MSGS) == kept + 40);
+        check_sequence(kept, 0);
+        for (int i = 0; i < 40; i++) {
+            CHECK(g_replayed[kept + i].value == 1000 + i);
+        }
+        check_flash_usage();
+    }
+}
+
+// 确认时掉电：这条消息重启后再补发一次，不会丢失
+static void test_torn_consume(void)
+{
+    pub_msg_t msg;
+    uint32_t seq = 0;
+
+    store_format(PUB_STORE_DROP_OLDEST);
+    for (int i = 0; i < 3; i++) {
+        CHECK(store_put_value("sensor", i) == 0);
+    }
+
+    CHECK(pub_store_read(0, &msg, &seq) == 0);
+    host_partition_power_cut(0);
+    CHECK(pub_store_consume(seq) == -1);
+
+    store_reboot(PUB_STORE_DROP_OLDEST);
+    CHECK(store_replay(OUTAGE_MSGS) == 3);
+    check_sequence(3, 0);
+}
+
+int main(void)
+{
+    test_outage_drop_oldest();
+    test_outage_drop_newest();
+    test_outage_coalesce();
+    test_seq_wrap();
+    test_torn_write(10);
+    // 掉电的记录是扇区最后一条，以及新扇区的第一条
+    test_torn_write(HOST_PARTITION_ERASE_SIZE / PUB_STORE_RECORD_SIZE - 1);
+    test_torn_write(HOST_PARTITION_ERASE_SIZE / PUB_STORE_RECORD_SIZE);
+    test_torn_consume();
+    printf("pub_store ok\n");
+
+    host_partition_remove_all();
+    return 0;
+}
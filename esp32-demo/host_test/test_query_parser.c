@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_test.h"
+#include "query_parser.h"
+
+#define QUERY_BUF_SIZE      256
+
+static char g_buf[QUERY_BUF_SIZE];
+static query_table_t g_table;
+
+// 复制到可写缓冲区后解析，与 bemfa_tcp.c 中原地解析一致
+static int parse(const char *query)
+{
+    size_t len = strlen(query);
+
+    CHECK(len < sizeof(g_buf));
+    memcpy(g_buf, query, len + 1);
+    return query_parse(g_buf, len, &g_table);
+}
+
+static void check_value(const char *key, const char *expected)
+{
+    size_t val_len = 0;
+    const char *val = query_get(&g_table, key, &val_len);
+
+    CHECK(val != NULL);
+    CHECK(val_len == strlen(expected) && memcmp(val, expected, val_len) == 0);
+    CHECK(val[val_len] == '\0');
+    CHECK(query_value_equals(&g_table, key, expected));
+}
+
+// 服务器推送和发布应答
+static void test_bemfa_frames(void)
+{
+    CHECK(parse("cmd=2&uid=0123456789abcdef&topic=light002&msg=on\r\n") == 4);
+    check_value("cmd", "2");
+    check_value("uid", "0123456789abcdef");
+    check_value("topic", "light002");
+    check_value("msg", "on");
+    CHECK(!g_table.truncated);
+
+    CHECK(parse("cmd=2&res=1") == 2);
+    check_value("res", "1");
+    CHECK(query_get(&g_table, "msg", NULL) == NULL);
+
+    CHECK(parse("cmd=3&res=1\n") == 2);
+    check_value("cmd", "3");
+}
+
+// key 按完整名字匹配：uid 不能匹配到 xuid，前缀和后缀都不算
+static void test_key_boundary(void)
+{
+    CHECK(parse("xuid=attacker&uid=device") == 2);
+    check_value("uid", "device");
+    check_value("xuid", "attacker");
+
+    CHECK(parse("xuid=attacker&uidx=1") == 2);
+    CHECK(query_get(&g_table, "uid", NULL) == NULL);
+    CHECK(query_get(&g_table, "ui", NULL) == NULL);
+
+    // 值里出现的 "uid=" 不是 key
+    CHECK(parse("msg=uid=1&topic=t") == 2);
+    check_value("msg", "uid=1");
+    CHECK(query_get(&g_table, "uid", NULL) == NULL);
+
+    // 同名 key 取第一个
+    CHECK(parse("msg=first&msg=second") == 2);
+    check_value("msg", "first");
+}
+
+// %XX 解码，key 和 value 都解码；不完整或非法的转义原样保留
+static void test_percent_decoding(void)
+{
+    CHECK(parse("topic=a%20b&msg=%7B%22on%22%3Atrue%7D") == 2);
+    check_value("topic", "a b");
+    check_value("msg", "{\"on\":true}");
+
+    CHECK(parse("m%73g=%e4%BD%A0") == 1);
+    check_value("msg", "\xe4\xbd\xa0");
+
+    // 解码出的 & 和 = 不再作为分隔符
+    CHECK(parse("msg=a%26b%3Dc&cmd=2") == 2);
+    check_value("msg", "a&b=c");
+    check_value("cmd", "2");
+
+    CHECK(parse("msg=100%&a=%zz&b=%4") == 3);
+    check_value("msg", "100%");
+    check_value("a", "%zz");
+    check_value("b", "%4");
+
+    // 结尾的 %XX 完整时同样解码
+    CHECK(parse("msg=%41") == 1);
+    check_value("msg", "A");
+}
+
+// '+' 不是空格：巴法云的 msg 原样传递，不是表单编码
+static void test_plus(void)
+{
+    CHECK(parse("msg=x+y&topic=a+b") == 2);
+    check_value("msg", "x+y");
+    check_value("topic", "a+b");
+
+    CHECK(parse("msg=%2B1") == 1);
+    check_value("msg", "+1");
+}
+
+// 空 key 跳过，没有 '=' 的为空值，值末尾的空白去掉
+static void test_edge_cases(void)
+{
+    CHECK(parse("") == 0);
+    CHECK(query_parse(NULL, 0, &g_table) == 0);
+
+    CHECK(parse("&&=x&flag&msg=&cmd=2 \t\r\n") == 3);
+    check_value("flag", "");
+    check_value("msg", "");
+    check_value("cmd", "2");
+
+    // 超过 QUERY_MAX_PAIRS 的部分丢弃并标记
+    CHECK(parse("a=1&b=2&c=3&d=4&e=5&f=6&g=7&h=8&i=9&j=10") == QUERY_MAX_PAIRS);
+    CHECK(g_table.truncated);
+    check_value("h", "8");
+    CHECK(query_get(&g_table, "i", NULL) == NULL);
+}
+
+int main(void)
+{
+    test_bemfa_frames();
+    test_key_boundary();
+    test_percent_decoding();
+    test_plus();
+    test_edge_cases();
+    printf("query_parser ok\n");
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_test.h"
+
+// 直接包含源文件，以便在测试中清空模块的静态变量来模拟重启
+#include "reset_counter.c"
+
+#define RST_PART_SIZE       4096        // 与 partitions.csv 中的 rstcnt 一致
+#define SIM_BOOTS           100000
+
+static esp_reset_reason_t g_sim_reason;
+
+esp_reset_reason_t esp_reset_reason(void)
+{
+    return g_sim_reason;
+}
+
+/*
+ * 模拟一次启动：冷启动时 RTC 内存为随机内容，热复位和掉电以外的复位保留 RTC 内存
+ * 模块中的其余静态变量每次启动都重新初始化
+ */
+static int sim_boot(esp_reset_reason_t reason)
+{
+    g_sim_reason = reason;
+    if (reason == ESP_RST_POWERON) {
+        uint8_t *rtc = (uint8_t *)&g_rst_rtc;
+        for (size_t i = 0; i < sizeof(g_rst_rtc); i++) {
+            rtc[i] = rand();
+        }
+    }
+
+    g_rst_part = NULL;
+    g_rst_cur_slot = -1;
+    g_rst_cur_byte = 0xFF;
+    g_rst_flash_writes = 0;
+
+    return reset_counter_init();
+}
+
+static int next_count(int prev)
+{
+    return prev >= RESET_COUNTER_TRIGGER ? 0 : prev + 1;
+}
+
+// 固定序列：冷启动后经过热复位才稳定，再次上电时计数必须从 1 开始
+static void test_settle_after_warm_reset(void)
+{
+    host_partition_remove_all();
+    CHECK(host_partition_create(RESET_COUNTER_PART_LABEL, 0x40, RST_PART_SIZE) != NULL);
+
+    CHECK(sim_boot(ESP_RST_POWERON) == 1);
+    CHECK(sim_boot(ESP_RST_SW) == 2);
+    CHECK(sim_boot(ESP_RST_TASK_WDT) == 3);
+    CHECK(reset_counter_settle() == 0);
+    CHECK(reset_counter_get_flash_writes() == 1);
+
+    for (int i = 0; i < RESET_COUNTER_TRIGGER * 2; i++) {
+        CHECK(sim_boot(ESP_RST_POWERON) == 2);
+        CHECK(sim_boot(ESP_RST_PANIC) == 3);
+        CHECK(reset_counter_settle() == 0);
+    }
+
+    // 连续快速上电仍能触发
+    for (int i = 2; i <= RESET_COUNTER_TRIGGER; i++) {
+        CHECK(sim_boot(ESP_RST_POWERON) == i);
+    }
+    CHECK(sim_boot(ESP_RST_POWERON) == 0);
+    CHECK(sim_boot(ESP_RST_SW) == 1);
+    CHECK(reset_counter_settle() == 0);
+    CHECK(sim_boot(ESP_RST_POWERON) == 2);
+}
+
+/*
+ * 10 万次随机启动，冷启动、掉电外的复位和热复位混合，随机在稳定前复位
+ * 与参考模型逐次比较计数：flash 中的计数只在冷启动和稳定时更新，RTC 中的计数每次启动都更新
+ */
+static void test_random_boots(void)
+{
+    static const esp_reset_reason_t warm[] = { ESP_RST_SW, ESP_RST_PANIC, ESP_RST_TASK_WDT, ESP_RST_DEEPSLEEP };
+    host_partition_stats_t stats;
+    int flash_count = 0;
+    int rtc_count = 0;
+    int cold_boots = 0;
+    int settles = 0;
+    int triggers = 0;
+
+    host_partition_remove_all();
+    CHECK(host_partition_create(RESET_COUNTER_PART_LABEL, 0x40, RST_PART_SIZE) != NULL);
+    srand(10);
+
+    for (int boot = 0; boot < SIM_BOOTS; boot++) {
+        int r = rand() % 10;
+        esp_reset_reason_t reason = r < 5 ? ESP_RST_POWERON : r < 6 ? ESP_RST_BROWNOUT : warm[rand() % 4];
+        // 第一次启动没有有效的 RTC 内容
+        if (boot == 0) {
+            reason = ESP_RST_POWERON;
+        }
+
+        int expect;
+        if (is_warm_reset(reason)) {
+            expect = next_count(rtc_count);
+        } else {
+            expect = next_count(flash_count);
+            flash_count = expect;
+            cold_boots++;
+        }
+        rtc_count = expect;
+
+        int count = sim_boot(reason);
+        CHECK(count == expect);
+        triggers += count == 0;
+
+        if (rand() % 3 == 0) {
+            CHECK(reset_counter_settle() == 0);
+            flash_count = 1;
+            rtc_count = 1;
+            settles++;
+        }
+    }
+
+    host_partition_get_stats(&stats);
+    printf("%d boots (%d cold, %d settled): %d triggers, %u flash writes, %u erases\n",
+           SIM_BOOTS, cold_boots, settles, triggers, (unsigned)stats.writes, (unsigned)stats.erases);
+
+    // 冷启动和稳定各最多写 1 字节，写满整个位图才擦除一次
+    CHECK(stats.bad_writes == 0);
+    CHECK(triggers > 0);
+    CHECK(stats.writes <= (uint32_t)(cold_boots + settles + stats.erases * RESET_COUNTER_TRIGGER));
+    CHECK(stats.erases > 0 && stats.erases <= (uint32_t)(cold_boots / (RST_PART_SIZE * RST_SLOTS_PER_BYTE - RESET_COUNTER_TRIGGER) + 1));
+}
+
+int main(void)
+{
+    test_settle_after_warm_reset();
+    test_random_boots();
+    printf("reset_counter ok\n");
+
+    host_partition_remove_all();
+    return 0;
+}
@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "host_test.h"
+#include "tcp_connect.h"
+
+/*
+ * 在本机回环上模拟几类地址，同一端口：
+ *   127.0.0.1  正常监听
+ *   127.0.0.2  监听但 accept 队列已满，SYN 被丢弃，相当于黑洞
+ *   127.0.0.3  ::1  无人监听，立即被拒绝
+ */
+
+#define DELAY_US        (TCP_CONNECT_ATTEMPT_DELAY_MS * 1000LL)
+#define FAST_US         100000LL    // 判定“立即”的上限
+
+static int g_port;
+static int g_good_sock;
+static int g_hole_sock;
+static int g_hole_fill;
+
+static void addr_v4(struct sockaddr_storage *ss, const char *ip)
+{
+    struct sockaddr_in *in = (struct sockaddr_in *)ss;
+    memset(ss, 0, sizeof(struct sockaddr_storage));
+    in->sin_family = AF_INET;
+    CHECK(inet_pton(AF_INET, ip, &in->sin_addr) == 1);
+}
+
+static void addr_v6(struct sockaddr_storage *ss, const char *ip)
+{
+    struct sockaddr_in6 *in6 = (struct sockaddr_in6 *)ss;
+    memset(ss, 0, sizeof(struct sockaddr_storage));
+    in6->sin6_family = AF_INET6;
+    CHECK(inet_pton(AF_INET6, ip, &in6->sin6_addr) == 1);
+}
+
+static int listen_on(const char *ip, int port, int backlog)
+{
+    struct sockaddr_in in = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+    };
+    socklen_t len = sizeof(in);
+    int one = 1;
+
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(sock >= 0);
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    CHECK(inet_pton(AF_INET, ip, &in.sin_addr) == 1);
+    CHECK(bind(sock, (struct sockaddr *)&in, sizeof(in)) == 0);
+    CHECK(listen(sock, backlog) == 0);
+
+    CHECK(getsockname(sock, (struct sockaddr *)&in, &len) == 0);
+    g_port = ntohs(in.sin_port);
+    return sock;
+}
+
+static void setup(void)
+{
+    struct sockaddr_storage ss;
+
+    g_good_sock = listen_on("127.0.0.1", 0, 8);
+    g_hole_sock = listen_on("127.0.0.2", g_port, 0);
+
+    // 占满 backlog 为 0 的 accept 队列，之后的 SYN 都会被丢弃
+    addr_v4(&ss, "127.0.0.2");
+    ((struct sockaddr_in *)&ss)->sin_port = htons(g_port);
+    g_hole_fill = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(connect(g_hole_fill, (struct sockaddr *)&ss, sizeof(struct sockaddr_in)) == 0);
+}
+
+// 胜出的 socket 必须真的连上了正常监听的地址
+static void check_connected(int sock)
+{
+    CHECK(sock >= 0);
+    int peer = accept(g_good_sock, NULL, NULL);
+    CHECK(peer >= 0);
+    CHECK(send(sock, "ping", 4, 0) == 4);
+
+    char buf[4];
+    CHECK(recv(peer, buf, sizeof(buf), MSG_WAITALL) == 4 && memcmp(buf, "ping", 4) == 0);
+    close(peer);
+    close(sock);
+}
+
+// 第一个地址无响应：延迟到后启动下一个，下一个胜出，无响应的被取消
+static void test_blackhole_then_good(void)
+{
+    struct sockaddr_storage addrs[2];
+    tcp_connect_stats_t stats;
+
+    addr_v4(&addrs[0], "127.0.0.2");
+    addr_v4(&addrs[1], "127.0.0.1");
+
+    int sock = tcp_connect_parallel(addrs, 2, g_port, 3000, &stats);
+    check_connected(sock);
+
+    CHECK(stats.count == 2 && stats.winner == 1);
+    CHECK(stats.attempts[0].err == ECANCELED);
+    CHECK(stats.attempts[1].err == 0);
+    CHECK(stats.attempts[1].start_us >= DELAY_US - 10000);
+    CHECK(stats.attempts[1].start_us < DELAY_US + FAST_US);
+    CHECK(stats.total_us < DELAY_US + FAST_US);
+}
+
+// 被拒绝的地址不等延迟，立即启动下一个；按协议族交替排序
+static void test_refused_then_good(void)
+{
+    struct sockaddr_storage addrs[4];
+    tcp_connect_stats_t stats;
+
+    addr_v6(&addrs[0], "::1");
+    addr_v4(&addrs[1], "127.0.0.3");
+    addr_v6(&addrs[2], "::1");
+    addr_v4(&addrs[3], "127.0.0.1");
+
+    int sock = tcp_connect_parallel(addrs, 4, g_port, 3000, &stats);
+    check_connected(sock);
+
+    // 顺序为 v6 v4 v6 v4，胜出的是第 4 个
+    CHECK(stats.count == 4 && stats.winner == 3);
+    CHECK(stats.attempts[0].family == AF_INET6 && stats.attempts[1].family == AF_INET);
+    CHECK(stats.attempts[2].family == AF_INET6 && stats.attempts[3].family == AF_INET);
+    for (int i = 0; i < 3; i++) {
+        CHECK(stats.attempts[i].err != 0 && stats.attempts[i].err != ECANCELED);
+    }
+    CHECK(stats.total_us < FAST_US);
+}
+
+// 全部无响应：到达超时后返回 -1，所有尝试都记为超时
+static void test_all_blackhole(void)
+{
+    struct sockaddr_storage addrs[2];
+    tcp_connect_stats_t stats;
+
+    addr_v4(&addrs[0], "127.0.0.2");
+    addr_v4(&addrs[1], "127.0.0.2");
+
+    int64_t start = host_now_us();
+    CHECK(tcp_connect_parallel(addrs, 2, g_port, 500, &stats) == -1);
+    int64_t elapsed = host_now_us() - start;
+
+    CHECK(stats.count == 2 && stats.winner == -1);
+    CHECK(stats.attempts[0].err == ETIMEDOUT && stats.attempts[1].err == ETIMEDOUT);
+    CHECK(elapsed >= 490000 && elapsed < 500000 + FAST_US);
+}
+
+/*
+ * 超时之后不再启动新的尝试：超时等于启动间隔时，下一个地址的启动时间刚好落在超时之后，
+ * 即使它能立即连上也不启动；超时为 0 时一个都不启动
+ */
+static void test_no_start_after_deadline(void)
+{
+    struct sockaddr_storage addrs[2];
+    tcp_connect_stats_t stats;
+
+    addr_v4(&addrs[0], "127.0.0.2");
+    addr_v4(&addrs[1], "127.0.0.1");
+
+    for (int round = 0; round < 5; round++) {
+        CHECK(tcp_connect_parallel(addrs, 2, g_port, TCP_CONNECT_ATTEMPT_DELAY_MS, &stats) == -1);
+        CHECK(stats.count == 1 && stats.winner == -1);
+        CHECK(stats.attempts[0].err == ETIMEDOUT);
+        CHECK(stats.total_us >= DELAY_US - 10000 && stats.total_us < DELAY_US + FAST_US);
+    }
+
+    CHECK(tcp_connect_parallel(&addrs[1], 1, g_port, 0, &stats) == -1);
+    CHECK(stats.count == 0 && stats.winner == -1);
+}
+
+int main(void)
+{
+    setup();
+    test_blackhole_then_good();
+    test_refused_then_good();
+    test_all_blackhole();
+    test_no_start_after_deadline();
+    printf("tcp_connect ok\n");
+
+    close(g_hole_fill);
+    close(g_hole_sock);
+    close(g_good_sock);
+    return 0;
+}
@@ -0,0 +1,423 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "host_test.h"
+#include "protocol.h"
+#include "user_http_client.h"
+
+/*
+ * user_http_client.c 通过 stubs/host_http_client.c 连接回环上的 HTTP 服务器，
+ * 统计服务器接受的连接数，验证连接池的握手次数：同一 host 的请求复用连接，
+ * 服务器关闭空闲连接后重连一次，多个任务并发请求时计数不丢失，各自的接收器互不干扰
+ */
+
+#define SERVER_IP           "127.0.0.1"
+#define SERVER_CONN_MAX     16
+#define SERVER_POLL_US      50000       // 连接线程检查 stop 标志的间隔
+#define SEQ_REQUESTS        10
+#define CONC_TASKS          4
+#define CONC_REQUESTS       25
+#define SINK_REQUESTS       10
+#define SINK_BODY_MAX       4096
+#define SINK_FIXED_SIZE     300         // 小于大部分响应，验证截断
+#define SINK_GROWABLE_MAX   2048
+
+int64_t esp_timer_get_time(void)
+{
+    return host_now_us();
+}
+
+/* ---------- 回环上的 HTTP/1.1 服务器 ---------- */
+
+// /body/<len>/<seed> 的响应体，其余请求的响应体为 path
+static char body_byte(int seed, int i)
+{
+    return 'a' + (seed + i) % 26;
+}
+
+typedef struct {
+    int listen_sock;
+    int port;
+    pthread_t thread;
+    volatile bool stop;
+    int close_after;                // 每个连接处理这么多请求后直接关闭，0 表示一直保持
+    int accepts;
+    int requests;
+    int active;
+} http_server_t;
+
+static http_server_t g_srv;
+
+static bool server_stopped(void)
+{
+    return __atomic_load_n(&g_srv.stop, __ATOMIC_ACQUIRE);
+}
+
+// 读一个完整的请求，返回 0 表示成功，path 为请求行中的路径
+static int server_read_request(int sock, char *path, size_t path_len)
+{
+    char buf[1024];
+    int used = 0;
+    char *end = NULL;
+
+    while (end == NULL) {
+        CHECK(used < (int)sizeof(buf) - 1);
+        ssize_t n = recv(sock, buf + used, sizeof(buf) - 1 - used, 0);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && !server_stopped()) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        used += n;
+        buf[used] = '\0';
+        end = strstr(buf, "\r\n\r\n");
+    }
+
+    char fmt[32];
+    snprintf(fmt, sizeof(fmt), "%%*s %%%zus", path_len - 1);
+    CHECK(sscanf(buf, fmt, path) == 1);
+    CHECK(strstr(buf, "\r\nHost: ") != NULL);
+
+    // 请求体直接丢弃
+    const char *cl = strstr(buf, "Content-Length: ");
+    int body_len = cl ? atoi(cl + 16) : 0;
+    body_len -= used - (int)(end + 4 - buf);
+    while (body_len > 0) {
+        ssize_t n = recv(sock, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            return -1;
+        }
+        body_len -= n;
+    }
+    return 0;
+}
+
+static void *server_conn_thread(void *arg)
+{
+    int sock = (int)(intptr_t)arg;
+    char path[128];
+    char resp[128 + SINK_BODY_MAX];
+    int served = 0;
+
+    while (server_read_request(sock, path, sizeof(path)) == 0) {
+        int body_len, seed;
+        int len = 0;
+        if (sscanf(path, "/body/%d/%d", &body_len, &seed) == 2) {
+            CHECK(body_len <= SINK_BODY_MAX);
+            len = snprintf(resp, sizeof(resp), "HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n", body_len);
+            for (int i = 0; i < body_len; i++) {
+                resp[len++] = body_byte(seed, i);
+            }
+        } else {
+            len = snprintf(resp, sizeof(resp), "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\n\r\n%s", strlen(path), path);
+        }
+        CHECK(send(sock, resp, len, MSG_NOSIGNAL) == len);
+        __atomic_add_fetch(&g_srv.requests, 1, __ATOMIC_RELAXED);
+        if (++served == g_srv.close_after) {
+            break;
+        }
+    }
+
+    close(sock);
+    __atomic_sub_fetch(&g_srv.active, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void *server_thread(void *arg)
+{
+    struct timeval tv = { .tv_sec = 0, .tv_usec = SERVER_POLL_US };
+
+    while (!server_stopped()) {
+        int sock = accept(g_srv.listen_sock, NULL, NULL);
+        if (sock < 0) {
+            continue;
+        }
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        __atomic_add_fetch(&g_srv.accepts, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&g_srv.active, 1, __ATOMIC_RELAXED);
+
+        pthread_t thread;
+        CHECK(pthread_create(&thread, NULL, server_conn_thread, (void *)(intptr_t)sock) == 0);
+        pthread_detach(thread);
+    }
+
+    return NULL;
+}
+
+static void server_start(void)
+{
+    struct sockaddr_in in = { .sin_family = AF_INET };
+    socklen_t in_len = sizeof(in);
+    struct timeval tv = { .tv_sec = 0, .tv_usec = SERVER_POLL_US };
+
+    g_srv.listen_sock = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(g_srv.listen_sock >= 0);
+    CHECK(inet_pton(AF_INET, SERVER_IP, &in.sin_addr) == 1);
+    CHECK(bind(g_srv.listen_sock, (struct sockaddr *)&in, sizeof(in)) == 0);
+    CHECK(listen(g_srv.listen_sock, SERVER_CONN_MAX) == 0);
+    CHECK(getsockname(g_srv.listen_sock, (struct sockaddr *)&in, &in_len) == 0);
+    setsockopt(g_srv.listen_sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    g_srv.port = ntohs(in.sin_port);
+    CHECK(pthread_create(&g_srv.thread, NULL, server_thread, NULL) == 0);
+}
+
+static void server_stop(void)
+{
+    __atomic_store_n(&g_srv.stop, true, __ATOMIC_RELEASE);
+    pthread_join(g_srv.thread, NULL);
+    while (__atomic_load_n(&g_srv.active, __ATOMIC_ACQUIRE) > 0) {
+        usleep(SERVER_POLL_US / 5);
+    }
+    close(g_srv.listen_sock);
+}
+
+static int server_accepts(void)
+{
+    return __atomic_load_n(&g_srv.accepts, __ATOMIC_ACQUIRE);
+}
+
+/* ---------- protocol.c 的 DNS 接口，所有域名都解析到回环地址 ---------- */
+
+int dns_resolve(const char *hostname, dns_result_t *result, int timeout_ms)
+{
+    struct sockaddr_in *in = (struct sockaddr_in *)&result->addrs[0];
+
+    memset(result, 0, sizeof(dns_result_t));
+    result->count = 1;
+    in->sin_family = AF_INET;
+    CHECK(inet_pton(AF_INET, SERVER_IP, &in->sin_addr) == 1);
+    return 0;
+}
+
+int dns_addr_to_str(const struct sockaddr_storage *addr, char *buf, size_t len)
+{
+    const struct sockaddr_in *in = (const struct sockaddr_in *)addr;
+
+    return inet_ntop(AF_INET, &in->sin_addr, buf, len) ? 0 : -1;
+}
+
+void dns_cache_invalidate(const char *hostname)
+{
+}
+
+/* ---------- 测试 ---------- */
+
+static void get_stats(user_http_pool_stats_t *stats)
+{
+    CHECK(user_http_get_pool_stats(stats) == 0);
+}
+
+// 请求 path，响应体应与 path 相同
+static void request_path(const char *host, const char *path, user_http_timing_t *timing)
+{
+    char url[128];
+    char resp[64];
+
+    snprintf(url, sizeof(url), "http://%s:%d%s", host, g_srv.port, path);
+    CHECK(user_http_request(url, HTTP_METHOD_GET, NULL, NULL, resp, sizeof(resp), timing) == 200);
+    CHECK(strcmp(resp, path) == 0);
+}
+
+// 同一 host 的连续请求只握手一次
+static void test_keep_alive(void)
+{
+    user_http_pool_stats_t before, after;
+    user_http_timing_t timing;
+    char path[32];
+    int accepts = server_accepts();
+
+    get_stats(&before);
+    for (int i = 0; i < SEQ_REQUESTS; i++) {
+        snprintf(path, sizeof(path), "/seq/%d", i);
+        request_path("dev-a.local", path, &timing);
+        CHECK(timing.reused == (i > 0));
+        CHECK((timing.connect_us > 0) == (i == 0));
+    }
+    get_stats(&after);
+
+    CHECK(after.requests - before.requests == SEQ_REQUESTS);
+    CHECK(after.handshakes - before.handshakes == 1);
+    CHECK(server_accepts() - accepts == 1);
+
+    // 两个 host 各占一个连接槽，交替请求时都不重新握手
+    get_stats(&before);
+    for (int i = 0; i < SEQ_REQUESTS; i++) {
+        request_path(i % 2 ? "dev-a.local" : "dev-b.local", "/alt", &timing);
+    }
+    get_stats(&after);
+    CHECK(after.handshakes - before.handshakes == 1);
+    CHECK(server_accepts() - accepts == 2);
+    printf("keep-alive: %d requests, %d handshakes\n", 2 * SEQ_REQUESTS, server_accepts() - accepts);
+}
+
+// 服务器每个请求后都关闭连接：复用的连接失败一次，重连后成功，每个请求一次握手
+static void test_server_close(void)
+{
+    user_http_pool_stats_t before, after;
+    user_http_timing_t timing;
+    int accepts = server_accepts();
+
+    g_srv.close_after = 1;
+    get_stats(&before);
+    for (int i = 0; i < SEQ_REQUESTS; i++) {
+        request_path("dev-c.local", "/close", &timing);
+        CHECK(timing.connect_us > 0 && !timing.reused);
+    }
+    get_stats(&after);
+    g_srv.close_after = 0;
+
+    CHECK(after.requests - before.requests == SEQ_REQUESTS);
+    CHECK(after.handshakes - before.handshakes == SEQ_REQUESTS);
+    CHECK(server_accepts() - accepts == SEQ_REQUESTS);
+}
+
+static void *conc_task(void *arg)
+{
+    int id = (int)(intptr_t)arg;
+    char path[32];
+
+    for (int i = 0; i < CONC_REQUESTS; i++) {
+        snprintf(path, sizeof(path), "/task%d/%d", id, i);
+        request_path("dev-a.local", path, NULL);
+    }
+    return NULL;
+}
+
+// 并发请求超过连接池大小，多出的请求使用临时连接；计数与服务器看到的一致
+static void test_concurrent(void)
+{
+    user_http_pool_stats_t before, after;
+    pthread_t threads[CONC_TASKS];
+    int accepts = server_accepts();
+
+    get_stats(&before);
+    for (int i = 0; i < CONC_TASKS; i++) {
+        CHECK(pthread_create(&threads[i], NULL, conc_task, (void *)(intptr_t)i) == 0);
+    }
+    for (int i = 0; i < CONC_TASKS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    get_stats(&after);
+
+    int handshakes = after.handshakes - before.handshakes;
+    CHECK(after.requests - before.requests == CONC_TASKS * CONC_REQUESTS);
+    CHECK(handshakes == server_accepts() - accepts);
+    CHECK(handshakes <= CONC_TASKS * CONC_REQUESTS);
+    printf("concurrent: %d requests from %d tasks, %d handshakes\n", CONC_TASKS * CONC_REQUESTS, CONC_TASKS, handshakes);
+}
+
+/*
+ * 每个任务用一种接收器，响应体按 seed 生成，逐字节检查：
+ * 接收器随请求传递，事件回调中没有共享的缓冲区，并发时不会串到别的请求里
+ */
+typedef struct {
+    http_sink_type_t type;
+    int seed;
+    int cur_seed;                   // 当前请求的 seed，stream 回调按它校验
+    int bytes;                      // stream 回调已校验的字节数
+} sink_task_t;
+
+static int stream_check_cb(const char *data, int len, void *arg)
+{
+    sink_task_t *task = arg;
+
+    for (int i = 0; i < len; i++) {
+        CHECK(data[i] == body_byte(task->cur_seed, task->bytes + i));
+    }
+    task->bytes += len;
+    return 0;
+}
+
+static void check_body(const http_resp_sink_t *sink, int expect_len, int seed)
+{
+    CHECK(sink->len == expect_len);
+    CHECK(sink->buf[expect_len] == '\0');
+    for (int i = 0; i < expect_len; i++) {
+        CHECK(sink->buf[i] == body_byte(seed, i));
+    }
+}
+
+static void *sink_task(void *arg)
+{
+    sink_task_t *task = arg;
+    char fixed[SINK_FIXED_SIZE];
+    char url[128];
+    http_resp_sink_t sink;
+
+    for (int i = 0; i < SINK_REQUESTS; i++) {
+        int seed = task->seed + i;
+        int body_len = 100 + (seed * 397) % (SINK_BODY_MAX - 100);
+        snprintf(url, sizeof(url), "http://dev-a.local:%d/body/%d/%d", g_srv.port, body_len, seed);
+
+        if (task->type == HTTP_SINK_FIXED) {
+            http_resp_sink_init_fixed(&sink, fixed, sizeof(fixed));
+        } else if (task->type == HTTP_SINK_GROWABLE) {
+            http_resp_sink_init_growable(&sink, SINK_GROWABLE_MAX);
+        } else {
+            task->cur_seed = seed;
+            task->bytes = 0;
+            http_resp_sink_init_stream(&sink, stream_check_cb, task);
+        }
+
+        CHECK(user_http_request_sink(url, HTTP_METHOD_GET, NULL, NULL, &sink, NULL) == 200);
+        if (task->type == HTTP_SINK_FIXED) {
+            check_body(&sink, body_len < SINK_FIXED_SIZE ? body_len : SINK_FIXED_SIZE - 1, seed);
+            CHECK(sink.truncated == (body_len >= SINK_FIXED_SIZE));
+        } else if (task->type == HTTP_SINK_GROWABLE) {
+            check_body(&sink, body_len < SINK_GROWABLE_MAX ? body_len : SINK_GROWABLE_MAX, seed);
+            CHECK(sink.truncated == (body_len > SINK_GROWABLE_MAX));
+            http_resp_sink_free(&sink);
+        } else {
+            CHECK(sink.len == body_len && task->bytes == body_len && sink.err == 0);
+        }
+    }
+    return NULL;
+}
+
+static void test_concurrent_sinks(void)
+{
+    sink_task_t tasks[] = {
+        { .type = HTTP_SINK_FIXED, .seed = 0 },
+        { .type = HTTP_SINK_GROWABLE, .seed = 1000 },
+        { .type = HTTP_SINK_STREAM, .seed = 2000 },
+        { .type = HTTP_SINK_GROWABLE, .seed = 3000 },
+        { .type = HTTP_SINK_STREAM, .seed = 4000 },
+    };
+    const int task_cnt = sizeof(tasks) / sizeof(tasks[0]);
+    pthread_t threads[task_cnt];
+
+    for (int i = 0; i < task_cnt; i++) {
+        CHECK(pthread_create(&threads[i], NULL, sink_task, &tasks[i]) == 0);
+    }
+    for (int i = 0; i < task_cnt; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    printf("sinks: %d requests from %d tasks\n", task_cnt * SINK_REQUESTS, task_cnt);
+}
+
+int main(void)
+{
+    user_http_pool_stats_t stats;
+
+    CHECK(user_http_get_pool_stats(&stats) == -1);
+    server_start();
+    CHECK(user_http_client_init() == 0);
+
+    test_keep_alive();
+    test_server_close();
+    test_concurrent();
+    test_concurrent_sinks();
+
+    server_stop();
+    printf("user_http_client ok\n");
+
+    return 0;
+}
@@ -0,0 +1,413 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_test.h"
+
+// 直接包含源文件，以便在测试中清空模块的静态变量来模拟重启
+#include "user_nvs_rw.c"
+
+#define LEGACY_SSID     "home-network"
+#define LEGACY_PASS     "correct horse"
+#define LEGACY_TOKEN    "0123456789abcdef0123456789abcdef"
+#define LEGACY_TOPIC    "light002"
+
+/* ---------- 模拟的任务和定时器 ---------- */
+
+struct esp_timer {
+    esp_timer_create_args_t args;
+    bool armed;
+};
+
+static struct esp_timer g_fake_timer;
+static int g_timer_starts;
+static bool g_commit_notified;
+
+int64_t esp_timer_get_time(void)
+{
+    return host_now_us();
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    memset(&g_fake_timer, 0, sizeof(g_fake_timer));
+    g_fake_timer.args = *create_args;
+    *out_handle = &g_fake_timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    CHECK(timeout_us == NVS_COMMIT_DEBOUNCE_MS * 1000);
+    timer->armed = true;
+    g_timer_starts++;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    timer->armed = false;
+    return ESP_OK;
+}
+
+// commit 任务不真正创建，由 fire_commit_timer 代为执行一次循环
+BaseType_t xTaskCreate(TaskFunction_t func, const char *name, uint32_t stack, void *arg,
+                       uint32_t prio, TaskHandle_t *out_task)
+{
+    *out_task = (TaskHandle_t)1;
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    g_commit_notified = true;
+    return pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    CHECK(0);
+    return 0;
+}
+
+static void fire_commit_timer(void)
+{
+    CHECK(g_fake_timer.armed);
+    g_fake_timer.armed = false;
+    g_fake_timer.args.callback(g_fake_timer.args.arg);
+    CHECK(g_commit_notified);
+    g_commit_notified = false;
+    user_nvs_flush();
+}
+
+/* ---------- 辅助函数 ---------- */
+
+// 模拟一次启动：模块的静态变量重新初始化，NVS 中的数据保留
+static int sim_boot(void)
+{
+    if (g_nvs_lock) {
+        vSemaphoreDelete(g_nvs_lock);
+    }
+    memset(&g_user_config, 0, sizeof(g_user_config));
+    g_user_config_dirty = false;
+    g_nvs_handle = 0;
+    g_nvs_opened = false;
+    g_nvs_lock = NULL;
+    g_nvs_commit_timer = NULL;
+    g_nvs_commit_task = NULL;
+    g_nvs_txn_depth = 0;
+    g_nvs_commit_cnt = 0;
+    g_commit_notified = false;
+
+    return user_nvs_init();
+}
+
+// 旧固件按 key 分散保存的配置
+static void write_legacy(void)
+{
+    nvs_handle_t handle;
+
+    CHECK(nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK);
+    CHECK(nvs_set_i8(handle, NVS_LEGACY_RST_CNT_KEY, 2) == ESP_OK);
+    CHECK(nvs_set_str(handle, NVS_LEGACY_BIND_SSID, LEGACY_SSID) == ESP_OK);
+    CHECK(nvs_set_str(handle, NVS_LEGACY_BIND_PASS, LEGACY_PASS) == ESP_OK);
+    CHECK(nvs_set_str(handle, NVS_LEGACY_BEMFA_TOKEN, LEGACY_TOKEN) == ESP_OK);
+    CHECK(nvs_set_str(handle, NVS_LEGACY_BEMFA_TOPIC, LEGACY_TOPIC) == ESP_OK);
+    CHECK(nvs_commit(handle) == ESP_OK);
+    nvs_close(handle);
+}
+
+static void write_config_blob(const void *blob, size_t size)
+{
+    nvs_handle_t handle;
+
+    CHECK(nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK);
+    CHECK(nvs_set_blob(handle, NVS_CONFIG_KEY, blob, size) == ESP_OK);
+    CHECK(nvs_commit(handle) == ESP_OK);
+    nvs_close(handle);
+}
+
+static int legacy_key_count(void)
+{
+    int cnt = 0;
+    for (int i = 0; i < sizeof(g_legacy_keys) / sizeof(g_legacy_keys[0]); i++) {
+        cnt += host_nvs_exists(NVS_NAMESPACE, g_legacy_keys[i]);
+    }
+    return cnt;
+}
+
+static void check_legacy_migrated(void)
+{
+    user_config_t cfg;
+
+    CHECK(user_config_read(&cfg) == 0);
+    CHECK(cfg.version == USER_CONFIG_VERSION && cfg.size == sizeof(user_config_t));
+    CHECK(strcmp(cfg.bind_ssid, LEGACY_SSID) == 0);
+    CHECK(strcmp(cfg.bind_pass, LEGACY_PASS) == 0);
+    CHECK(strcmp(cfg.bemfa_token, LEGACY_TOKEN) == 0);
+    CHECK(strcmp(cfg.bemfa_topic, LEGACY_TOPIC) == 0);
+    CHECK(cfg.wifi_channel == 0 && cfg.wifi_authmode == 0);
+}
+
+static void check_defaults(void)
+{
+    user_config_t cfg, def;
+
+    user_config_set_defaults(&def);
+    CHECK(user_config_read(&cfg) == 0);
+    CHECK(memcmp(&cfg, &def, sizeof(cfg)) == 0);
+}
+
+static host_nvs_stats_t nvs_stats(void)
+{
+    host_nvs_stats_t stats;
+    host_nvs_get_stats(&stats);
+    return stats;
+}
+
+/* ---------- 测试 ---------- */
+
+// 全新的 NVS：写入默认配置，之后的启动不再写 flash
+static void test_fresh_boot(void)
+{
+    host_nvs_reset();
+    CHECK(sim_boot() == 0);
+    check_defaults();
+    CHECK(host_nvs_exists(NVS_NAMESPACE, NVS_CONFIG_KEY));
+    CHECK(nvs_stats().writes == 1);
+    CHECK(user_nvs_get_commit_count() == 1);
+
+    CHECK(sim_boot() == 0);
+    check_defaults();
+    CHECK(nvs_stats().writes == 1);
+    CHECK(user_nvs_get_commit_count() == 0);
+}
+
+// 旧格式：先写入并 commit 新配置，再删除旧 key 并 commit，共两次 commit
+static void test_legacy_migration(void)
+{
+    host_nvs_reset();
+    write_legacy();
+    host_nvs_stats_t before = nvs_stats();
+
+    CHECK(sim_boot() == 0);
+    check_legacy_migrated();
+    CHECK(legacy_key_count() == 0);
+    CHECK(nvs_stats().writes - before.writes == 1 + sizeof(g_legacy_keys) / sizeof(g_legacy_keys[0]));
+    CHECK(nvs_stats().commits - before.commits == 2);
+    CHECK(user_nvs_get_commit_count() == 2);
+
+    // 迁移完成后重启不再写入
+    before = nvs_stats();
+    CHECK(sim_boot() == 0);
+    check_legacy_migrated();
+    CHECK(nvs_stats().writes == before.writes);
+}
+
+// 新配置写入之前不能删除任何旧 key：第一次写入之后掉电，旧 key 必须全部还在
+static void test_blob_before_erase(void)
+{
+    host_nvs_reset();
+    write_legacy();
+
+    host_nvs_power_cut(1);
+    CHECK(sim_boot() == -1);
+    CHECK(host_nvs_exists(NVS_NAMESPACE, NVS_CONFIG_KEY));
+    CHECK(legacy_key_count() == sizeof(g_legacy_keys) / sizeof(g_legacy_keys[0]));
+
+    // 再次启动直接读到新配置，只补删旧 key
+    host_nvs_power_cut(-1);
+    CHECK(sim_boot() == 0);
+    check_legacy_migrated();
+    CHECK(legacy_key_count() == 0);
+}
+
+// 迁移中任意一次写入之后掉电，重启后配置都不丢失，旧 key 最终全部删除
+static void test_power_cut_during_migration(void)
+{
+    const int total_writes = 1 + sizeof(g_legacy_keys) / sizeof(g_legacy_keys[0]);
+
+    for (int cut = 0; cut <= total_writes; cut++) {
+        host_nvs_reset();
+        write_legacy();
+
+        host_nvs_power_cut(cut);
+        CHECK(sim_boot() == (cut < total_writes ? -1 : 0));
+        // 任何时刻，新配置和完整的旧 key 至少有一份
+        CHECK(host_nvs_exists(NVS_NAMESPACE, NVS_CONFIG_KEY) ||
+              legacy_key_count() == sizeof(g_legacy_keys) / sizeof(g_legacy_keys[0]));
+
+        host_nvs_power_cut(-1);
+        CHECK(sim_boot() == 0);
+        check_legacy_migrated();
+        CHECK(legacy_key_count() == 0);
+    }
+}
+
+// 版本 1、2 没有发布过，遇到时与未知版本一样恢复默认值
+static void test_unknown_version(void)
+{
+    const uint16_t versions[] = { 1, 2, USER_CONFIG_VERSION + 1, 0xffff };
+
+    for (int i = 0; i < sizeof(versions) / sizeof(versions[0]); i++) {
+        uint8_t blob[64];
+        memset(blob, 'x', sizeof(blob));
+        blob[0] = versions[i] & 0xff;
+        blob[1] = versions[i] >> 8;
+        blob[2] = sizeof(blob);
+        blob[3] = 0;
+
+        host_nvs_reset();
+        write_config_blob(blob, sizeof(blob));
+        CHECK(sim_boot() == 0);
+        check_defaults();
+
+        // 默认配置已经写回
+        CHECK(sim_boot() == 0);
+        CHECK(user_nvs_get_commit_count() == 0);
+        check_defaults();
+    }
+}
+
+// 修改只更新 RAM，防抖到期后写入一次；值不变时不重新计时
+static void test_debounce(void)
+{
+    host_nvs_reset();
+    CHECK(sim_boot() == 0);
+    host_nvs_stats_t before = nvs_stats();
+
+    CHECK(user_config_set_bind_ssid("a") == 0);
+    CHECK(user_config_set_bind_pass("b") == 0);
+    CHECK(g_fake_timer.armed);
+    CHECK(nvs_stats().writes == before.writes);
+
+    fire_commit_timer();
+    CHECK(nvs_stats().writes == before.writes + 1);
+
+    CHECK(user_config_set_bind_ssid("a") == 0);
+    CHECK(!g_fake_timer.armed);
+
+    // 重启后读到的是写入的值
+    CHECK(sim_boot() == 0);
+    char value[USER_CONFIG_SIZEOF(bind_pass)];
+    CHECK(user_config_get_bind_ssid(value, sizeof(value)) == 0 && strcmp(value, "a") == 0);
+    CHECK(user_config_get_bind_pass(value, sizeof(value)) == 0 && strcmp(value, "b") == 0);
+}
+
+// 嵌套事务内不启动定时器，最外层结束时写入一次
+static void test_txn(void)
+{
+    const uint8_t bssid[6] = { 1, 2, 3, 4, 5, 6 };
+
+    host_nvs_reset();
+    CHECK(sim_boot() == 0);
+    host_nvs_stats_t before = nvs_stats();
+
+    CHECK(user_nvs_txn_begin() == 0);
+    CHECK(user_config_set_wifi_bssid(bssid) == 0);
+    CHECK(user_nvs_txn_begin() == 0);
+    CHECK(user_config_set_wifi_channel(11) == 0);
+    CHECK(user_config_set_wifi_authmode(3) == 0);
+    CHECK(user_nvs_txn_commit() == 0);
+    CHECK(!g_fake_timer.armed);
+    CHECK(nvs_stats().writes == before.writes);
+    CHECK(user_nvs_txn_commit() == 0);
+    CHECK(nvs_stats().writes == before.writes + 1);
+
+    // 写入失败时保留修改，恢复后 flush 重试
+    CHECK(user_config_set_wifi_channel(6) == 0);
+    host_nvs_power_cut(0);
+    CHECK(user_nvs_flush() == -1);
+    host_nvs_power_cut(-1);
+    CHECK(user_nvs_flush() == 0);
+
+    CHECK(sim_boot() == 0);
+    uint8_t out[6];
+    CHECK(user_config_get_wifi_bssid(out) == 0 && memcmp(out, bssid, sizeof(out)) == 0);
+    CHECK(user_config_get_wifi_channel() == 6);
+    CHECK(user_config_get_wifi_authmode() == 3);
+}
+
+/*
+ * 一个 NVS 句柄在启动时打开后一直使用，之后的读取全部来自 RAM；
+ * 防抖窗口内的多次修改和事务内的修改都合并成一次写入和一次 commit
+ */
+static void test_batched_writes(void)
+{
+    const uint8_t bssid[6] = { 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff };
+    const int rounds = 50;
+    char value[USER_CONFIG_SIZEOF(bemfa_token)];
+
+    host_nvs_reset();
+    CHECK(sim_boot() == 0);
+    host_nvs_stats_t before = nvs_stats();
+    uint32_t commit_cnt = user_nvs_get_commit_count();
+    g_timer_starts = 0;
+
+    // 网页上连续修改：每次修改重新开始防抖计时，读到的是 RAM 中的新值
+    for (int i = 0; i < rounds; i++) {
+        snprintf(value, sizeof(value), "ssid-%d", i);
+        CHECK(user_config_set_bind_ssid(value) == 0);
+        CHECK(user_config_set_wifi_channel(i % 13 + 1) == 0);
+        CHECK(user_config_get_bind_ssid(value, sizeof(value)) == 0);
+        CHECK(atoi(value + 5) == i);
+        CHECK(user_config_get_wifi_channel() == i % 13 + 1);
+    }
+    CHECK(g_fake_timer.armed && g_timer_starts == 2 * rounds);
+    CHECK(nvs_stats().writes == before.writes && nvs_stats().commits == before.commits);
+
+    fire_commit_timer();
+    CHECK(nvs_stats().writes == before.writes + 1);
+    CHECK(nvs_stats().commits == before.commits + 1);
+    CHECK(user_nvs_get_commit_count() == commit_cnt + 1);
+
+    // 配网消息在一个事务中写入四个字段：事务前已挂起的修改一起写入，定时器取消
+    CHECK(user_config_set_wifi_bssid(bssid) == 0);
+    CHECK(g_fake_timer.armed);
+    CHECK(user_nvs_txn_begin() == 0);
+    CHECK(user_config_set_bind_ssid("bind-ssid") == 0);
+    CHECK(user_config_set_bind_pass("bind-pass") == 0);
+    CHECK(user_config_set_bemfa_token(LEGACY_TOKEN) == 0);
+    CHECK(user_config_set_bemfa_topic(LEGACY_TOPIC) == 0);
+    CHECK(nvs_stats().writes == before.writes + 1);
+    CHECK(user_nvs_txn_commit() == 0);
+    CHECK(!g_fake_timer.armed);
+    CHECK(nvs_stats().writes == before.writes + 2);
+    CHECK(nvs_stats().commits == before.commits + 2);
+    CHECK(user_nvs_get_commit_count() == commit_cnt + 2);
+
+    // 没有修改时 flush 不写 flash
+    CHECK(user_nvs_flush() == 0);
+    CHECK(nvs_stats().writes == before.writes + 2);
+
+    // 启动之后没有再打开命名空间，也没有从 flash 读取
+    CHECK(nvs_stats().opens == before.opens);
+    CHECK(nvs_stats().reads == before.reads);
+
+    // 重启后从 flash 读到最后一次写入的值
+    CHECK(sim_boot() == 0);
+    uint8_t out[6];
+    CHECK(user_config_get_bind_ssid(value, sizeof(value)) == 0 && strcmp(value, "bind-ssid") == 0);
+    CHECK(user_config_get_bemfa_token(value, sizeof(value)) == 0 && strcmp(value, LEGACY_TOKEN) == 0);
+    CHECK(user_config_get_wifi_bssid(out) == 0 && memcmp(out, bssid, sizeof(out)) == 0);
+    CHECK(user_config_get_wifi_channel() == (rounds - 1) % 13 + 1);
+    printf("batched: %d edits, 2 flash writes\n", 2 * rounds + 5);
+}
+
+int main(void)
+{
+    test_fresh_boot();
+    test_legacy_migration();
+    test_blob_before_erase();
+    test_power_cut_during_migration();
+    test_unknown_version();
+    test_debounce();
+    test_txn();
+    test_batched_writes();
+    printf("user_nvs ok\n");
+
+    if (g_nvs_lock) {
+        vSemaphoreDelete(g_nvs_lock);
+    }
+    return 0;
+}
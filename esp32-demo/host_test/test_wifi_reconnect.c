@@ -0,0 +1,403 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_test.h"
+
+// 直接包含源文件，以便调用 wifi_backoff_ms 并在用例之间重置状态
+#include "wifi_reconnect.c"
+
+/* ---------- 模拟的时钟、定时器、随机数、配置和 Wi-Fi 驱动 ---------- */
+
+struct esp_timer {
+    esp_timer_create_args_t args;
+    bool armed;
+    uint64_t timeout_us;
+};
+
+static struct esp_timer g_fake_timer;
+static int64_t g_now_us;
+static uint32_t g_random;
+
+static uint8_t g_cfg_bssid[6];
+static int8_t g_cfg_channel;
+static int8_t g_cfg_authmode;
+static int g_txn_depth;
+
+static wifi_config_t g_sta_cfg;
+static int g_set_config_cnt;
+static int g_connect_cnt;
+
+int64_t esp_timer_get_time(void)
+{
+    return g_now_us;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    memset(&g_fake_timer, 0, sizeof(g_fake_timer));
+    g_fake_timer.args = *create_args;
+    *out_handle = &g_fake_timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    timer->armed = true;
+    timer->timeout_us = timeout_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    timer->armed = false;
+    return ESP_OK;
+}
+
+uint32_t esp_random(void)
+{
+    return g_random;
+}
+
+int user_config_set_wifi_bssid(const uint8_t value[6])
+{
+    CHECK(g_txn_depth > 0);
+    memcpy(g_cfg_bssid, value, sizeof(g_cfg_bssid));
+    return 0;
+}
+
+int user_config_get_wifi_bssid(uint8_t value[6])
+{
+    memcpy(value, g_cfg_bssid, sizeof(g_cfg_bssid));
+    return 0;
+}
+
+int user_config_set_wifi_channel(int8_t value)
+{
+    CHECK(g_txn_depth > 0);
+    g_cfg_channel = value;
+    return 0;
+}
+
+int8_t user_config_get_wifi_channel(void)
+{
+    return g_cfg_channel;
+}
+
+int user_config_set_wifi_authmode(int8_t value)
+{
+    CHECK(g_txn_depth > 0);
+    g_cfg_authmode = value;
+    return 0;
+}
+
+int8_t user_config_get_wifi_authmode(void)
+{
+    return g_cfg_authmode;
+}
+
+int user_nvs_txn_begin(void)
+{
+    g_txn_depth++;
+    return 0;
+}
+
+int user_nvs_txn_commit(void)
+{
+    CHECK(g_txn_depth > 0);
+    g_txn_depth--;
+    return 0;
+}
+
+esp_err_t esp_wifi_get_config(wifi_interface_t interface, wifi_config_t *conf)
+{
+    CHECK(interface == WIFI_IF_STA);
+    *conf = g_sta_cfg;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t *conf)
+{
+    CHECK(interface == WIFI_IF_STA);
+    g_sta_cfg = *conf;
+    g_set_config_cnt++;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_connect(void)
+{
+    g_connect_cnt++;
+    return ESP_OK;
+}
+
+/* ---------- 辅助函数 ---------- */
+
+static const uint8_t AP1_BSSID[6] = { 0x24, 0x0a, 0xc4, 0x11, 0x22, 0x33 };
+static const uint8_t AP2_BSSID[6] = { 0x24, 0x0a, 0xc4, 0x44, 0x55, 0x66 };
+
+// 模拟重启：清空模块状态和驱动配置，保留 NVS 中的缓存
+static void reboot(void)
+{
+    memset(&g_wifi_stats, 0, sizeof(g_wifi_stats));
+    memset(g_wifi_latency_ms, 0, sizeof(g_wifi_latency_ms));
+    g_wifi_latency_idx = 0;
+    g_wifi_directed = false;
+    g_wifi_fail_cnt = 0;
+    g_wifi_down_us = 0;
+
+    memset(&g_sta_cfg, 0, sizeof(g_sta_cfg));
+    strcpy((char *)g_sta_cfg.sta.ssid, "home-network");
+    g_set_config_cnt = 0;
+    g_connect_cnt = 0;
+    g_random = 0;
+    g_now_us = 1000000;
+
+    CHECK(wifi_reconnect_init() == 0);
+}
+
+static void connected(const uint8_t bssid[6], int channel)
+{
+    wifi_event_sta_connected_t event = { .channel = channel, .authmode = WIFI_AUTH_WPA2_PSK };
+    memcpy(event.bssid, bssid, sizeof(event.bssid));
+    wifi_reconnect_on_connected(&event);
+}
+
+static int disconnected(void)
+{
+    wifi_event_sta_disconnected_t event = { .reason = 201 };
+    return wifi_reconnect_on_disconnected(&event);
+}
+
+// 重试定时器到期，发起下一次连接
+static void fire_retry_timer(void)
+{
+    CHECK(g_fake_timer.armed);
+    g_now_us += g_fake_timer.timeout_us;
+    g_fake_timer.armed = false;
+    g_fake_timer.args.callback(g_fake_timer.args.arg);
+}
+
+static void check_directed(const uint8_t bssid[6], int channel)
+{
+    CHECK(g_wifi_directed);
+    CHECK(g_sta_cfg.sta.bssid_set && memcmp(g_sta_cfg.sta.bssid, bssid, 6) == 0);
+    CHECK(g_sta_cfg.sta.channel == channel);
+    CHECK(g_sta_cfg.sta.scan_method == WIFI_FAST_SCAN);
+    CHECK(g_sta_cfg.sta.threshold.authmode == WIFI_AUTH_WPA2_PSK);
+    CHECK(strcmp((char *)g_sta_cfg.sta.ssid, "home-network") == 0);
+}
+
+static void check_full_scan(void)
+{
+    static const uint8_t zero[6] = { 0 };
+
+    CHECK(!g_wifi_directed);
+    CHECK(!g_sta_cfg.sta.bssid_set && memcmp(g_sta_cfg.sta.bssid, zero, 6) == 0);
+    CHECK(g_sta_cfg.sta.channel == 0);
+    CHECK(g_sta_cfg.sta.scan_method == WIFI_ALL_CHANNEL_SCAN);
+    CHECK(g_sta_cfg.sta.threshold.authmode == WIFI_AUTH_OPEN);
+    CHECK(strcmp((char *)g_sta_cfg.sta.ssid, "home-network") == 0);
+}
+
+/* ---------- 测试 ---------- */
+
+// 200ms 起步逐次翻倍，第 9 次起封顶 30s；抖动在 0~25% 之间
+static void test_backoff(void)
+{
+    static const uint32_t expected[] = {
+        200, 200, 400, 800, 1600, 3200, 6400, 12800, 25600, 30000, 30000,
+    };
+
+    for (int fail_cnt = 0; fail_cnt < (int)(sizeof(expected) / sizeof(expected[0])); fail_cnt++) {
+        g_random = 0;
+        CHECK(wifi_backoff_ms(fail_cnt) == expected[fail_cnt]);
+
+        g_random = expected[fail_cnt] / 4;
+        CHECK(wifi_backoff_ms(fail_cnt) == expected[fail_cnt] + expected[fail_cnt] / 4);
+        g_random = expected[fail_cnt] / 4 + 1;
+        CHECK(wifi_backoff_ms(fail_cnt) == expected[fail_cnt]);
+
+        for (uint32_t r = 0; r < 1000; r++) {
+            g_random = r * 2654435761u;
+            uint32_t delay = wifi_backoff_ms(fail_cnt);
+            CHECK(delay >= expected[fail_cnt] && delay <= expected[fail_cnt] * 5 / 4);
+        }
+    }
+
+    // 很大的失败次数不会移位溢出
+    g_random = 0;
+    CHECK(wifi_backoff_ms(1000) == WIFI_BACKOFF_MAX_MS);
+    CHECK(wifi_backoff_ms(0x7fffffff) == WIFI_BACKOFF_MAX_MS);
+
+    // 断线后的实际重试间隔与退避一致，定时器到期才发起连接
+    memset(g_cfg_bssid, 0, sizeof(g_cfg_bssid));
+    g_cfg_channel = 0;
+    reboot();
+    for (int i = 1; i <= 12; i++) {
+        CHECK(disconnected() == i);
+        CHECK(g_fake_timer.armed && g_fake_timer.timeout_us == (uint64_t)expected[i < 10 ? i : 10] * 1000);
+        CHECK(g_connect_cnt == i - 1);
+        fire_retry_timer();
+        CHECK(g_connect_cnt == i);
+    }
+    wifi_reconnect_stats_t stats;
+    CHECK(wifi_reconnect_get_stats(&stats) == 0);
+    CHECK(stats.attempts == 13 && stats.connects == 0);
+}
+
+// 从 wifi_reconnect_init（或断线）到获取 IP 记一个样本，单位 ms
+static void reconnect_after(uint32_t ms)
+{
+    if (g_wifi_down_us == 0) {
+        connected(AP1_BSSID, 6);
+        disconnected();
+    }
+    g_now_us += (int64_t)ms * 1000;
+    wifi_reconnect_on_got_ip();
+}
+
+static void check_percentiles(uint32_t p50, uint32_t p90, uint32_t p99, uint32_t max, uint32_t samples)
+{
+    wifi_reconnect_stats_t stats;
+
+    CHECK(wifi_reconnect_get_stats(&stats) == 0);
+    if (stats.p50_ms != p50 || stats.p90_ms != p90 || stats.p99_ms != p99 || stats.max_ms != max) {
+        fprintf(stderr, "p50 %u p90 %u p99 %u max %u\n", stats.p50_ms, stats.p90_ms, stats.p99_ms, stats.max_ms);
+    }
+    CHECK(stats.samples == samples);
+    CHECK(stats.p50_ms == p50 && stats.p90_ms == p90 && stats.p99_ms == p99 && stats.max_ms == max);
+}
+
+/*
+ * 百分位取排序后第 (n-1)*p/100 个样本；环形缓冲区写满后只保留最近 WIFI_LATENCY_SAMPLES 个
+ */
+static void test_percentiles(void)
+{
+    wifi_reconnect_stats_t stats;
+
+    memset(g_cfg_bssid, 0, sizeof(g_cfg_bssid));
+    g_cfg_channel = 0;
+    reboot();
+
+    // 没有样本时百分位都是 0
+    CHECK(wifi_reconnect_get_stats(&stats) == 0);
+    CHECK(stats.samples == 0 && stats.p50_ms == 0 && stats.p99_ms == 0 && stats.max_ms == 0);
+
+    // 已连接时重复的 got_ip 不产生样本
+    reconnect_after(700);
+    wifi_reconnect_on_got_ip();
+    check_percentiles(700, 700, 700, 700, 1);
+
+    // 乱序写入 10 个样本：100..1000 中去掉 700 后加上 700，共 10 个
+    static const uint32_t shuffled[] = { 300, 1000, 100, 900, 500, 200, 800, 400, 600 };
+    for (size_t i = 0; i < sizeof(shuffled) / sizeof(shuffled[0]); i++) {
+        reconnect_after(shuffled[i]);
+    }
+    // n=10：p50 取第 4 个，p90 和 p99 都取第 8 个
+    check_percentiles(500, 900, 900, 1000, 10);
+
+    // 一次特别慢的重连只影响 max 和高百分位
+    reconnect_after(25000);
+    check_percentiles(600, 1000, 1000, 25000, 11);
+
+    // 写满 32 个后旧样本被覆盖：再写 1..40，留下 9..40
+    for (uint32_t ms = 1; ms <= 40; ms++) {
+        reconnect_after(ms);
+    }
+    // n=32：p50 取第 15 个（24），p90 第 27 个（36），p99 第 30 个（39）
+    check_percentiles(24, 36, 39, 40, WIFI_LATENCY_SAMPLES);
+
+    CHECK(wifi_reconnect_get_stats(&stats) == 0);
+    CHECK(stats.connects == 51);
+}
+
+/*
+ * 有缓存时定向连接，连续 WIFI_DIRECTED_MAX_FAIL 次失败后回退全信道扫描；
+ * 获取 IP 后重新缓存，下次断线再定向连接新的 AP
+ */
+static void test_directed_fallback(void)
+{
+    wifi_reconnect_stats_t stats;
+
+    // 没有缓存：一直是全信道扫描，不算回退
+    memset(g_cfg_bssid, 0, sizeof(g_cfg_bssid));
+    g_cfg_channel = 0;
+    reboot();
+    check_full_scan();
+    for (int i = 0; i < 5; i++) {
+        disconnected();
+        check_full_scan();
+    }
+    connected(AP1_BSSID, 6);
+    reconnect_after(1500);
+    CHECK(wifi_reconnect_get_stats(&stats) == 0);
+    CHECK(stats.full_scans == 0 && stats.directed_ok == 0 && stats.connects == 1);
+    CHECK(memcmp(g_cfg_bssid, AP1_BSSID, 6) == 0 && g_cfg_channel == 6 && g_cfg_authmode == WIFI_AUTH_WPA2_PSK);
+
+    // 从已连接断开：改为定向连接刚才的 AP，一次成功
+    disconnected();
+    check_directed(AP1_BSSID, 6);
+    reconnect_after(120);
+    CHECK(wifi_reconnect_get_stats(&stats) == 0);
+    CHECK(stats.directed_ok == 1 && stats.full_scans == 0);
+
+    // 重启后有缓存：启动即定向连接
+    reboot();
+    check_directed(AP1_BSSID, 6);
+    int set_cnt = g_set_config_cnt;
+
+    // AP 换了信道：第一次失败仍定向，第二次回退
+    CHECK(disconnected() == 1);
+    check_directed(AP1_BSSID, 6);
+    CHECK(g_set_config_cnt == set_cnt);
+    CHECK(disconnected() == WIFI_DIRECTED_MAX_FAIL);
+    check_full_scan();
+    CHECK(g_set_config_cnt == set_cnt + 1);
+
+    // 之后继续失败不再修改配置，也不重复计数
+    for (int i = 0; i < 5; i++) {
+        disconnected();
+        check_full_scan();
+    }
+    CHECK(g_set_config_cnt == set_cnt + 1);
+    CHECK(wifi_reconnect_get_stats(&stats) == 0);
+    CHECK(stats.full_scans == 1);
+
+    // 全信道扫描连上新信道，成功不计入定向
+    connected(AP2_BSSID, 11);
+    reconnect_after(3000);
+    CHECK(wifi_reconnect_get_stats(&stats) == 0);
+    CHECK(stats.connects == 1 && stats.directed_ok == 0);
+    CHECK(memcmp(g_cfg_bssid, AP2_BSSID, 6) == 0 && g_cfg_channel == 11);
+
+    // 下次断线定向连接新缓存的 AP，失败一次后成功
+    CHECK(disconnected() == 1);
+    check_directed(AP2_BSSID, 11);
+    fire_retry_timer();
+    reconnect_after(0);
+    CHECK(wifi_reconnect_get_stats(&stats) == 0);
+    CHECK(stats.directed_ok == 1 && stats.full_scans == 1);
+
+    // 修改 SSID 后清除缓存，断线后不再定向
+    wifi_reconnect_forget();
+    CHECK(g_cfg_channel == 0 && g_cfg_authmode == 0);
+    CHECK(g_txn_depth == 0);
+    disconnected();
+    CHECK(!g_wifi_directed);
+
+    // 缓存的信道无效（NVS 数据损坏）时按没有缓存处理
+    g_cfg_channel = 15;
+    reboot();
+    check_full_scan();
+}
+
+int main(void)
+{
+    test_backoff();
+    test_percentiles();
+    test_directed_fallback();
+    CHECK(g_txn_depth == 0);
+    printf("wifi_reconnect ok\n");
+
+    return 0;
+}
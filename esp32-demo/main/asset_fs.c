@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+
+#include "asset_fs.h"
+
+static const char *TAG = "asset_fs.c";
+
+_Static_assert(sizeof(asset_fs_header_t) == 32, "asset_fs_header_t must match gen_assets.py");
+_Static_assert(sizeof(asset_fs_entry_t) == 40, "asset_fs_entry_t must match gen_assets.py");
+
+static const uint8_t *g_asset_image = NULL;
+static const asset_fs_header_t *g_asset_header = NULL;
+static const uint16_t *g_asset_disp = NULL;
+static const uint16_t *g_asset_slots = NULL;
+static const asset_fs_entry_t *g_asset_entries = NULL;
+static esp_partition_mmap_handle_t g_asset_mmap;
+
+// FNV-1a 加 murmur3 的 fmix32，种子不同时低位也互不相关，与 gen_assets.py 的 asset_hash() 相同
+static uint32_t asset_fs_hash(const char *key, size_t len, uint32_t seed)
+{
+    uint32_t h = 2166136261u ^ seed;
+
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)key[i];
+        h *= 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+
+    return h;
+}
+
+static bool asset_fs_str_valid(uint32_t off, uint32_t image_len)
+{
+    return off < image_len && memchr(g_asset_image + off, '\0', image_len - off) != NULL;
+}
+
+// 一次性检查所有偏移，查找时不再做边界判断
+static int asset_fs_check(uint32_t part_size)
+{
+    const asset_fs_header_t *hdr = g_asset_header;
+    uint32_t tables_len;
+
+    if (hdr->magic != ASSET_FS_MAGIC || hdr->version != ASSET_FS_VERSION) {
+        ESP_LOGW(TAG, "No asset image, magic:0x%08x version:%d", (unsigned int)hdr->magic, hdr->version);
+        return -1;
+    }
+    if (hdr->image_len < sizeof(*hdr) || hdr->image_len > part_size || hdr->buckets == 0 || hdr->slots < hdr->count) {
+        ESP_LOGE(TAG, "Bad asset image header, len:%u", (unsigned int)hdr->image_len);
+        return -1;
+    }
+
+    tables_len = (hdr->buckets + hdr->slots) * sizeof(uint16_t);
+    tables_len = (sizeof(*hdr) + tables_len + 3) / 4 * 4;
+    if (tables_len + hdr->count * sizeof(asset_fs_entry_t) > hdr->image_len) {
+        ESP_LOGE(TAG, "Bad asset image tables");
+        return -1;
+    }
+
+    if (esp_rom_crc32_le(0, g_asset_image + sizeof(*hdr), hdr->image_len - sizeof(*hdr)) != hdr->crc32) {
+        ESP_LOGE(TAG, "Asset image crc mismatch");
+        return -1;
+    }
+
+    g_asset_disp = (const uint16_t *)(g_asset_image + sizeof(*hdr));
+    g_asset_slots = g_asset_disp + hdr->buckets;
+    g_asset_entries = (const asset_fs_entry_t *)(g_asset_image + tables_len);
+
+    for (int i = 0; i < hdr->slots; i++) {
+        if (g_asset_slots[i] != ASSET_FS_EMPTY_SLOT && g_asset_slots[i] >= hdr->count) {
+            ESP_LOGE(TAG, "Bad asset slot %d", i);
+            return -1;
+        }
+    }
+
+    for (int i = 0; i < hdr->count; i++) {
+        const asset_fs_entry_t *e = &g_asset_entries[i];
+        if (!asset_fs_str_valid(e->uri_off, hdr->image_len) || !asset_fs_str_valid(e->mime_off, hdr->image_len)
+            || strlen((const char *)g_asset_image + e->uri_off) != e->uri_len
+            || e->data_off > hdr->image_len || e->data_len > hdr->image_len - e->data_off
+            || e->etag[ASSET_FS_ETAG_LEN - 1] != '\0') {
+            ESP_LOGE(TAG, "Bad asset entry %d", i);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int asset_fs_init(void)
+{
+    const esp_partition_t *part;
+    const void *ptr;
+
+    if (g_asset_header) {
+        return 0;
+    }
+
+    part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, ASSET_FS_PART_LABEL);
+    if (!part) {
+        ESP_LOGW(TAG, "Partition '%s' not found, use built-in assets", ASSET_FS_PART_LABEL);
+        return -1;
+    }
+
+    if (esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &ptr, &g_asset_mmap) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to mmap partition '%s'", ASSET_FS_PART_LABEL);
+        return -1;
+    }
+    g_asset_image = ptr;
+    g_asset_header = ptr;
+
+    if (part->size < sizeof(asset_fs_header_t) || asset_fs_check(part->size) != 0) {
+        esp_partition_munmap(g_asset_mmap);
+        g_asset_image = NULL;
+        g_asset_header = NULL;
+        return -1;
+    }
+
+    ESP_LOGI(TAG, "Asset image: %d assets, %u bytes", g_asset_header->count, (unsigned int)g_asset_header->image_len);
+
+    return 0;
+}
+
+static int asset_fs_find_image(const char *uri, size_t len, http_asset_t *asset)
+{
+    const asset_fs_header_t *hdr = g_asset_header;
+    uint16_t disp = g_asset_disp[asset_fs_hash(uri, len, 0) % hdr->buckets];
+    uint16_t index = g_asset_slots[asset_fs_hash(uri, len, disp + 1u) % hdr->slots];
+    const asset_fs_entry_t *e;
+
+    if (index == ASSET_FS_EMPTY_SLOT) {
+        return -1;
+    }
+    e = &g_asset_entries[index];
+    if (e->uri_len != len || memcmp(g_asset_image + e->uri_off, uri, len) != 0) {
+        return -1;
+    }
+
+    asset->uri = (const char *)g_asset_image + e->uri_off;
+    asset->mime = (const char *)g_asset_image + e->mime_off;
+    asset->etag = e->etag;
+    asset->data = g_asset_image + e->data_off;
+    asset->len = e->data_len;
+    asset->gzip = (e->flags & ASSET_FS_FLAG_GZIP) != 0;
+
+    return 0;
+}
+
+int asset_fs_find(const char *uri, size_t len, http_asset_t *asset)
+{
+    if (g_asset_header && asset_fs_find_image(uri, len, asset) == 0) {
+        return 0;
+    }
+
+    // 内置资源表只有几个文件，顺序查找
+    for (int i = 0; i < g_http_assets_count; i++) {
+        if (strlen(g_http_assets[i].uri) == len && memcmp(g_http_assets[i].uri, uri, len) == 0) {
+            *asset = g_http_assets[i];
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+int asset_fs_count(void)
+{
+    return g_asset_header ? g_asset_header->count : 0;
+}
@@ -0,0 +1,56 @@
+#ifndef __ASSET_FS_H__
+#define __ASSET_FS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "http_assets.h"
+
+/*
+ * 只读的网页资源镜像，由 tools/gen_assets.py image 生成并烧录到 assets 分区
+ * 整个分区映射到地址空间，资源数据和字符串都直接指向 flash，不复制到 RAM。
+ * 路由用完美哈希查找：bucket = hash(uri, 0) % buckets，slot = hash(uri, disp[bucket] + 1) % slots，
+ * 最后比较一次 uri 排除不存在的路径。
+ *
+ * 镜像布局（小端）：header | disp[buckets] | slot[slots] | 对齐 4 | entries[count] | 字符串 | 数据
+ */
+
+#define ASSET_FS_PART_LABEL     "assets"
+#define ASSET_FS_MAGIC          0x31545341      // "AST1"
+#define ASSET_FS_VERSION        1
+#define ASSET_FS_EMPTY_SLOT     0xFFFF
+#define ASSET_FS_FLAG_GZIP      0x01
+#define ASSET_FS_ETAG_LEN       20
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint16_t buckets;
+    uint16_t slots;
+    uint32_t image_len;         // 包括 header 的总长度
+    uint32_t crc32;             // header 之后到 image_len 的 CRC32
+    uint8_t reserved[12];
+} asset_fs_header_t;
+
+typedef struct {
+    uint32_t uri_off;           // 以下偏移都相对镜像开头，字符串以 '\0' 结尾
+    uint32_t mime_off;
+    uint32_t data_off;
+    uint32_t data_len;
+    uint16_t uri_len;
+    uint8_t flags;
+    uint8_t reserved;
+    char etag[ASSET_FS_ETAG_LEN];
+} asset_fs_entry_t;
+
+// 映射并校验 assets 分区，没有分区或镜像无效时只使用固件内置的资源表
+int asset_fs_init(void);
+
+// 查找 uri 的前 len 个字符（不含查询串），先查镜像再查内置资源表，找不到返回 -1
+int asset_fs_find(const char *uri, size_t len, http_asset_t *asset);
+
+// 镜像中的资源数，没有镜像时为 0
+int asset_fs_count(void);
+
+#endif
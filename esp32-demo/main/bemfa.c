@@ -1,354 +1,679 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_system.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
 #include "esp_http_client.h"
 
-#include "cJSON.h"
-
 #include "main.h"
 #include "user_nvs_rw.h"
 #include "bemfa.h"
+#include "bemfa_transport.h"
 
-#include "protocol.h"
+#include "topic_table.h"
+#include "pub_queue.h"
+#include "pub_store.h"
+#include "json_extract.h"
 #include "user_http_client.h"
+#include "boot_timeline.h"
 
 static const char *TAG = "bemfa.c";
-static char g_bemfa_topic[32] = {0};
-static char g_bemfa_token[64] = {0};
-
-static char g_bemfa_ipaddr[16] = {0};
-
-static int g_bemfa_status = 0;
-static int g_tcp_sock = 0;
-
-static int g_bemfa_switch_status = 0;
-
-// 辅助函数：移除字符串尾部的空白和控制字符（\r, \n, 空格, 制表符等）
-static void trim_trailing_whitespace(char *str)
-{
-    if (!str) return;
-
-    size_t len = strlen(str);
-    if (len == 0) return;
-
-    // 从末尾向前找第一个非空白字符
-    while (len > 0) {
-        unsigned char c = str[len - 1];
-        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
-            len--;
-        } else {
-            break;
-        }
-    }
-    str[len] = '\0';
-}
 
-bool parse_query_value(const char *query, const char *key, char *out_val, size_t out_len)
-{
-    if (!query || !key || !out_val || out_len == 0) {
-        return false;
-    }
-
-    // 构造要查找的子串： "key="
-    char key_with_eq[64];
-    int key_len = strlen(key);
-    if (key_len + 2 >= sizeof(key_with_eq)) {
-        return false; // key 太长
-    }
-    snprintf(key_with_eq, sizeof(key_with_eq), "%s=", key);
+#define BEMFA_BACKOFF_BASE_MS       1000    // 失败后首次重试间隔，之后逐次翻倍
+#define BEMFA_BACKOFF_MAX_MS        60000   // 重试间隔上限
+#define BEMFA_REDNS_FAIL_CNT        3       // 连续失败多少次后重新解析域名
+#define BEMFA_ACK_TIMEOUT_MS        3000    // 等待服务器应答的超时
+#define BEMFA_CONNECT_TIMEOUT_MS    5000    // 建立连接的超时
+#define BEMFA_IDLE_POLL_MS          1000    // 空闲时最长等待，用于检查 wifi 状态
+#define BEMFA_REPLAY_INTERVAL_MS    50      // 重连后补发离线消息的间隔，即每秒 20 条
 
-    // 在 query 中查找 "key="
-    const char *p = strstr(query, key_with_eq);
-    if (!p) {
-        return false;
-    }
+#if CONFIG_BEMFA_TRANSPORT_MQTT
+#define BEMFA_TRANSPORT             (&bemfa_transport_mqtt)
+#else
+#define BEMFA_TRANSPORT             (&bemfa_transport_tcp)
+#endif
 
-    // 跳过 "key="
-    p += strlen(key_with_eq);
+static char g_bemfa_topic[USER_CONFIG_SIZEOF(bemfa_topic)] = {0};
+static char g_bemfa_token[USER_CONFIG_SIZEOF(bemfa_token)] = {0};
 
-    // 找到值的结束位置（遇到 & 或 \0）
-    const char *end = strchr(p, '&');
-    size_t val_len;
-    if (end) {
-        val_len = end - p;
-    } else {
-        val_len = strlen(p);
-    }
-
-    // 防止缓冲区溢出
-    if (val_len >= out_len) {
-        val_len = out_len - 1;
-    }
-
-    // 复制值
-    memcpy(out_val, p, val_len);
-    out_val[val_len] = '\0';
+static const bemfa_transport_t *g_bemfa_transport = BEMFA_TRANSPORT;
+static int g_bemfa_status = 0;
 
-    // ✅ 关键：清理尾部的 \r\n、空格等
-    trim_trailing_whitespace(out_val);
-    return true;
-}
+static int g_bemfa_switch_status = 0;
+static bemfa_switch_cb_t g_bemfa_switch_cb = NULL;
+// bemfa 任务和 httpd 任务都会更新开关，比较、更新和回调需串行，否则广播顺序可能与最终状态不一致
+static SemaphoreHandle_t g_bemfa_switch_lock = NULL;
+static StaticSemaphore_t g_bemfa_switch_lock_buf;
+static portMUX_TYPE g_bemfa_switch_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// 已订阅的主题，收到的 topic= 按哈希分发到各自的处理函数
+static topic_table_t g_bemfa_topics;
+static portMUX_TYPE g_bemfa_topics_mux = portMUX_INITIALIZER_UNLOCKED;
+static int g_bemfa_subscribed = 0;          // 本次连接已订阅的条目数，新注册的主题在空闲时补订
+
+// 已发送、等待应答的发布消息，应答按发送顺序返回
+typedef struct {
+    int64_t sent_us[BEMFA_PUB_WINDOW];
+    pub_msg_t msgs[BEMFA_PUB_WINDOW];       // 被服务器拒绝时用于重发
+    bool replayed[BEMFA_PUB_WINDOW];        // 已经是补发的消息，再被拒绝就丢弃
+    int head;
+    int count;
+} bemfa_pub_inflight_t;
+
+static bemfa_pub_inflight_t g_bemfa_pub_inflight;
+static bemfa_pub_stats_t g_bemfa_pub_stats;
+
+// 其他任务投递的待发布消息，由 bemfa 任务批量发送；投递后唤醒传输层的 poll
+static pub_queue_t g_bemfa_pub_queue;
+static int64_t g_bemfa_replay_next_us = 0;  // 下一条离线消息最早可补发的时间
+
+// 会话管理
+static TaskHandle_t g_bemfa_task = NULL;
+static bool g_bemfa_topic_added = false;
+static int g_bemfa_fail_cnt = 0;            // 连续失败次数，订阅成功后清零
+static int64_t g_bemfa_session_start_us = 0;
+static bemfa_session_stats_t g_bemfa_session_stats;
 
 int parse_bemfa_bind_message(char *rx_buf, char *tx_buf)
 {
     int ret = 0;
 
-    int ssid_vaild = 0;
-    int pass_vaild = 0;
-    int token_vaild = 0;
+    char ssid[USER_CONFIG_SIZEOF(bind_ssid)] = {0};
+    char password[USER_CONFIG_SIZEOF(bind_pass)] = {0};
+    char token[USER_CONFIG_SIZEOF(bemfa_token)] = {0};
+
+    enum { FIELD_CMD_TYPE, FIELD_SSID, FIELD_PASSWORD, FIELD_TOKEN, FIELD_NUM };
+    json_field_t fields[FIELD_NUM] = {
+        [FIELD_CMD_TYPE] = { .path = "cmdType",  .type = JSON_FIELD_INT },
+        [FIELD_SSID]     = { .path = "ssid",     .type = JSON_FIELD_STR, .buf = ssid,     .buf_size = sizeof(ssid) },
+        [FIELD_PASSWORD] = { .path = "password", .type = JSON_FIELD_STR, .buf = password, .buf_size = sizeof(password) },
+        [FIELD_TOKEN]    = { .path = "token",    .type = JSON_FIELD_STR, .buf = token,    .buf_size = sizeof(token) },
+    };
+    json_extract_t json;
 
     do {
-        cJSON *root = cJSON_Parse(rx_buf);
-        if (root == NULL) {
-            const char *error_ptr = cJSON_GetErrorPtr();
-            if (error_ptr != NULL) {
-                printf("Error before: %s\n", error_ptr);
-            }
+        json_extract_init(&json, fields, FIELD_NUM);
+        if (json_extract_feed(&json, rx_buf, strlen(rx_buf)) != 0 || json_extract_finish(&json) != 0) {
+            printf("Error parsing bind message\n");
             ret = -1;
             break;
         }
 
-        // 读取数值字段
-        cJSON *cmdType = cJSON_GetObjectItemCaseSensitive(root, "cmdType");
-        if (cJSON_IsNumber(cmdType)) {
-            printf("cmdType: %d\n", cmdType->valueint);
+        if (!fields[FIELD_CMD_TYPE].found) {
+            printf("cmdType not found\n");
+            ret = -1;
+            break;
         }
+        int cmd_type = fields[FIELD_CMD_TYPE].value;
+        printf("cmdType: %d\n", cmd_type);
 
-        // 读取字符串字段
-        cJSON *ssid = cJSON_GetObjectItemCaseSensitive(root, "ssid");
-        if (cJSON_IsString(ssid) && (ssid->valuestring != NULL)) {
-            printf("ssid: %s\n", ssid->valuestring);
-            ssid_vaild = 1;
+        // 超长的值会被截断，写入 NVS 后设备就带着错误的凭据，直接拒绝
+        if (fields[FIELD_SSID].truncated || fields[FIELD_PASSWORD].truncated || fields[FIELD_TOKEN].truncated) {
+            printf("Bind field too long\n");
+            ret = -1;
+            break;
         }
 
-        // 读取字符串字段
-        cJSON *password = cJSON_GetObjectItemCaseSensitive(root, "password");
-        if (cJSON_IsString(password) && (password->valuestring != NULL)) {
-            printf("password: %s\n", password->valuestring);
-            pass_vaild = 1;
+        if (fields[FIELD_SSID].found) {
+            printf("ssid: %s\n", ssid);
         }
-
-        // 读取字符串字段
-        cJSON *token = cJSON_GetObjectItemCaseSensitive(root, "token");
-        if (cJSON_IsString(token) && (token->valuestring != NULL)) {
-            printf("token: %s\n", token->valuestring);
-            token_vaild = 1;
+        if (fields[FIELD_PASSWORD].found) {
+            printf("password: %s\n", password);
+        }
+        if (fields[FIELD_TOKEN].found) {
+            printf("token: %s\n", token);
         }
 
-        if (cmdType->valueint == 1 && ssid_vaild && pass_vaild && token_vaild) {
-            char topic[40] = {0};
+        if (cmd_type == 1 && fields[FIELD_SSID].found && fields[FIELD_PASSWORD].found && fields[FIELD_TOKEN].found) {
+            char topic[USER_CONFIG_SIZEOF(bemfa_topic)] = {0};
 
             snprintf(topic, sizeof(topic), "esp32switch%x%x006", (unsigned int)(g_system_status.mac_addr_sta[4]), (unsigned int)(g_system_status.mac_addr_sta[5]));
-            user_nvs_write_string(NVS_NAMESPACE, NVS_BEMFA_TOPIC, topic);
-
-            user_nvs_write_bemfa_info(NVS_NAMESPACE, ssid->valuestring, password->valuestring, token->valuestring);
+            // topic 和绑定信息在同一个事务里只 commit 一次
+            user_nvs_txn_begin();
+            user_config_set_bemfa_topic(topic);
+            user_config_set_bind_ssid(ssid);
+            user_config_set_bind_pass(password);
+            user_config_set_bemfa_token(token);
+            user_nvs_txn_commit();
 
             sprintf(tx_buf, "{\"cmdType\":2,\"productId\":\"%s\",\"deviceName\":\"esp32_test\",\"protoVersion\":\"3.1\"}", topic);
             ret = strlen(tx_buf);
 
-        } else if (cmdType->valueint == 3) {
-            char ssid[33] = {0};
-            char pass[33] = {0};
-            char token[40] = {0};
-            user_nvs_read_bemfa_info(NVS_NAMESPACE, ssid, sizeof(ssid), pass, sizeof(pass), token, sizeof(token));
-            write_wifi_info(ssid, pass);
+        } else if (cmd_type == 3) {
+            user_config_get_bind_ssid(ssid, sizeof(ssid));
+            user_config_get_bind_pass(password, sizeof(password));
+            write_wifi_info(ssid, password);
 
             ESP_LOGW(TAG, "esp restart");
+            user_nvs_flush();
             esp_restart();
             ret = 0;
         }
-
-        cJSON_Delete(root); // 必须释放内存！
     } while (0);
 
     return ret;
 }
 
+static int bemfa_json_stream_cb(const char *data, int len, void *arg)
+{
+    return json_extract_feed((json_extract_t *)arg, data, len);
+}
+
 int bemfa_device_addTopic(void)
 {
     int ret = -1;
-    char local_response_buffer[MAX_HTTP_OUTPUT_BUFFER + 1] = {0};
-
-    esp_http_client_config_t config = {
-        .url = BEMFA_DEVICE_ADDTOPIC_API,
-        .event_handler = _http_event_handler,
-        .user_data = local_response_buffer,        // Pass address of local buffer to get response
-        .disable_auto_redirect = true,
-    };
+    char post_data[256] = {0};
+    user_http_timing_t timing = {0};
 
-    esp_http_client_handle_t client = esp_http_client_init(&config);
+    // 响应边收边解析，只取 data.code，不缓存整个 body
+    json_field_t code = { .path = "data.code", .type = JSON_FIELD_INT };
+    json_extract_t json;
+    http_resp_sink_t sink;
 
-    char post_data[256] = {0};
+    json_extract_init(&json, &code, 1);
+    http_resp_sink_init_stream(&sink, bemfa_json_stream_cb, &json);
 
-    snprintf(post_data, sizeof(post_data), "{\"uid\":\"%s\",\"topic\":\"%s\",\"type\":3,\"wifiConfig\":1}", g_bemfa_token, g_bemfa_topic);
+    snprintf(post_data, sizeof(post_data), "{\"uid\":\"%s\",\"topic\":\"%s\",\"type\":%d,\"wifiConfig\":1}",
+             g_bemfa_token, g_bemfa_topic, g_bemfa_transport->device_type);
 
-    esp_http_client_set_method(client, HTTP_METHOD_POST);
-    esp_http_client_set_header(client, "Content-Type", "application/json; charset=utf-8");
-    esp_http_client_set_post_field(client, post_data, strlen(post_data));
-    ret = esp_http_client_perform(client);
-    if (ret == ESP_OK) {
-        ESP_LOGI(TAG, "HTTP POST Status = %d, content_length = %"PRId64,
-                esp_http_client_get_status_code(client),
-                esp_http_client_get_content_length(client));
-        ESP_LOGI(TAG, "HTTP POST body = %s", local_response_buffer);
+    // 走长连接池，失败重试时不再重复 DNS 和 TCP 握手
+    int status = user_http_request_sink(BEMFA_DEVICE_ADDTOPIC_API, HTTP_METHOD_POST, "application/json; charset=utf-8",
+                                        post_data, &sink, &timing);
+    if (status > 0) {
+        ESP_LOGI(TAG, "HTTP POST Status = %d, dns:%lld connect:%lld first byte:%lld total:%lld us%s",
+                status, timing.dns_us, timing.connect_us, timing.first_byte_us, timing.total_us,
+                timing.reused ? " (reused)" : "");
 
         ret = -2;
-        cJSON *root = cJSON_Parse(local_response_buffer);
-        if (root == NULL) {
-            const char *error_ptr = cJSON_GetErrorPtr();
-            if (error_ptr != NULL) {
-                printf("Error before: %s\n", error_ptr);
-            }
+        if (json_extract_finish(&json) != 0) {
+            printf("Error parsing response, %d bytes\n", sink.len);
         } else {
             ret = -3;
-            cJSON *data = cJSON_GetObjectItemCaseSensitive(root, "data");
-            if (cJSON_IsObject(data)) {
-                cJSON *code = cJSON_GetObjectItemCaseSensitive(data, "code");
-                if (cJSON_IsNumber(code)) {
-                    if (code->valueint == 0 || code->valueint == 40006) {
-                        ret = 0;
-                    }
+            if (code.found) {
+                ESP_LOGI(TAG, "HTTP POST data.code = %ld", code.value);
+                if (code.value == 0 || code.value == 40006) {
+                    ret = 0;
                 }
             }
-            cJSON_Delete(root);
         }
     } else {
-        ESP_LOGE(TAG, "HTTP POST request failed: %s", esp_err_to_name(ret));
+        ESP_LOGE(TAG, "HTTP POST request failed");
     }
 
-    esp_http_client_cleanup(client);
-
     return ret;
 }
 
-int bemfa_device_subscribe(void)
+static void bemfa_pub_inflight_reset(void)
 {
-    int ret = 0;
-    // cmd=3&uid=6cf90baf69f846f08b5a8383d6256a49&topic=esp32switchea28006\r\n
-    char subscribe_str[128] = {0};
-    char rx_buffer[128] = {0};
+    g_bemfa_pub_inflight.head = 0;
+    g_bemfa_pub_inflight.count = 0;
+    g_bemfa_pub_stats.inflight = 0;
+}
 
-    ret = -1;
-    do {
-        snprintf(subscribe_str, sizeof(subscribe_str), "cmd=3&uid=%s&topic=%s\r\n", g_bemfa_token, g_bemfa_topic);
-        int err = send(g_tcp_sock, subscribe_str, strlen(subscribe_str), 0);
-        if (err < 0) {
-            ESP_LOGE(TAG, "Error occurred during sending: errno %d", errno);
-            break;
-        }
+static int64_t bemfa_pub_inflight_pop(void)
+{
+    int64_t sent_us = g_bemfa_pub_inflight.sent_us[g_bemfa_pub_inflight.head];
 
-        // cmd=3&uid=xxxxxxxxxxxxxxxxxxxxxxx&topic=light002&msg=on
-        int len = recv(g_tcp_sock, rx_buffer, sizeof(rx_buffer) - 1, 0);
-        if (len < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                printf("[%d] Timeout, no data received.\n", __LINE__);
-                vTaskDelay(1000 / portTICK_PERIOD_MS);
-                continue;
-            } else {
-                perror("recv error");
-                break;
-            }
-        } else if (len == 0) {
-            printf("Server closed connection.\n");
-            break;
+    g_bemfa_pub_inflight.head = (g_bemfa_pub_inflight.head + 1) % BEMFA_PUB_WINDOW;
+    g_bemfa_pub_inflight.count--;
+    g_bemfa_pub_stats.inflight = g_bemfa_pub_inflight.count;
+
+    return sent_us;
+}
+
+static void bemfa_pub_ack_received(bool ok)
+{
+    if (g_bemfa_pub_inflight.count == 0) {
+        ESP_LOGW(TAG, "Unexpected publish ack");
+        return;
+    }
+
+    int head = g_bemfa_pub_inflight.head;
+    int64_t latency = esp_timer_get_time() - bemfa_pub_inflight_pop();
+
+    if (!ok) {
+        // 被拒绝的消息写入离线存储，按补发流程重发一次；补发后仍被拒绝则丢弃
+        const pub_msg_t *msg = &g_bemfa_pub_inflight.msgs[head];
+        g_bemfa_pub_stats.rejected++;
+        if (g_bemfa_pub_inflight.replayed[head] || pub_store_put(msg->topic, msg->msg) != 0) {
+            ESP_LOGW(TAG, "Publish rejected, drop topic=%s msg=%s", msg->topic, msg->msg);
         } else {
-            printf("[%d] sub Received: %.*s\n", __LINE__, (int)len, rx_buffer);
-            parse_query_value(rx_buffer, "cmd", subscribe_str, sizeof(subscribe_str));
-            if (strcmp(subscribe_str, "3") == 0) {
-                ret = 0;
-                parse_query_value(rx_buffer, "msg", subscribe_str, sizeof(subscribe_str));
-                printf("parse msg: |%s|\n", subscribe_str);
-                if (strcmp(subscribe_str, "on") == 0) {
-                    g_bemfa_switch_status = 1;
-                } else {
-                    g_bemfa_switch_status = 0;
-                }
-            } else {
-                ESP_LOGE(TAG, "Not found cmd 3, retry");
-                vTaskDelay(1000 / portTICK_PERIOD_MS);
-                continue;
-            }
+            ESP_LOGW(TAG, "Publish rejected, retry topic=%s msg=%s", msg->topic, msg->msg);
         }
-    } while (0);
+        return;
+    }
 
-    return ret;
+    g_bemfa_pub_stats.acked++;
+    g_bemfa_pub_stats.last_latency_us = latency;
+    g_bemfa_pub_stats.total_latency_us += latency;
+    if (latency > g_bemfa_pub_stats.max_latency_us) {
+        g_bemfa_pub_stats.max_latency_us = latency;
+    }
 }
 
-int bemfa_device_public(char *msg)
+// 丢弃超时未应答的发布消息
+static void bemfa_pub_expire(void)
 {
-    ESP_LOGI(TAG, "bemfa_device_public msg=%s", msg);
-    // cmd=2&uid=xxxxxxxxxxxxxxxxxxxxxxx&topic=light002&msg=off\r\n
-    char public_str[128] = {0};
-    char rx_buffer[128] = {0};
-    int ret = -1;
-    do {
-        snprintf(public_str, sizeof(public_str), "cmd=2&uid=%s&topic=%s&msg=%s\r\n", g_bemfa_token, g_bemfa_topic, msg);
-        int err = send(g_tcp_sock, public_str, strlen(public_str), 0);
-        if (err < 0) {
-            ESP_LOGE(TAG, "Error occurred during sending: errno %d", errno);
+    int64_t now = esp_timer_get_time();
+
+    while (g_bemfa_pub_inflight.count > 0) {
+        int64_t sent_us = g_bemfa_pub_inflight.sent_us[g_bemfa_pub_inflight.head];
+        if (now - sent_us < BEMFA_ACK_TIMEOUT_MS * 1000LL) {
             break;
         }
+        bemfa_pub_inflight_pop();
+        g_bemfa_pub_stats.timeout++;
+        ESP_LOGW(TAG, "Publish ack timeout, total:%"PRIu32, g_bemfa_pub_stats.timeout);
+    }
+}
 
-        // cmd=2&res=1
-        int len = recv(g_tcp_sock, rx_buffer, sizeof(rx_buffer) - 1, 0);
-        if (len < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                printf("[%d] Timeout, no data received.\n", __LINE__);
-                vTaskDelay(1000 / portTICK_PERIOD_MS);
-                continue;
-            } else {
-                perror("recv error");
-                break;
-            }
-        } else if (len == 0) {
-            printf("Server closed connection.\n");
+int bemfa_get_pub_stats(bemfa_pub_stats_t *stats)
+{
+    if (!stats) {
+        return -1;
+    }
+
+    pub_queue_stats_t queue_stats;
+    pub_queue_get_stats(&g_bemfa_pub_queue, &queue_stats);
+
+    memcpy(stats, &g_bemfa_pub_stats, sizeof(bemfa_pub_stats_t));
+    stats->queue_depth = queue_stats.depth;
+    stats->queue_dropped = queue_stats.dropped;
+    stats->coalesced = queue_stats.coalesced;
+
+    pub_store_stats_t store_stats;
+    pub_store_get_stats(&store_stats);
+    stats->offline_stored = store_stats.stored;
+    stats->offline_replayed = store_stats.replayed;
+    stats->offline_dropped = store_stats.dropped + store_stats.coalesced;
+    stats->offline_pending = store_stats.pending;
+    return 0;
+}
+
+/*
+ * 注册主题及其处理函数，同一主题只能有一个处理函数，重复相同的注册返回 0
+ * 可在任意任务中调用，连接已建立时由 bemfa 任务在空闲时补发订阅
+ */
+int bemfa_subscribe_topic(const char *topic, topic_handler_t handler, void *arg)
+{
+    taskENTER_CRITICAL(&g_bemfa_topics_mux);
+    int index = topic_table_add(&g_bemfa_topics, topic, handler, arg);
+    taskEXIT_CRITICAL(&g_bemfa_topics_mux);
+
+    if (index < 0) {
+        ESP_LOGE(TAG, "Subscribe topic %s fail, %d topics", topic, topic_table_count(&g_bemfa_topics));
+        return -1;
+    }
+
+    return 0;
+}
+
+// 首次使用时创建开关锁，静态内存，不会失败
+static SemaphoreHandle_t bemfa_switch_lock(void)
+{
+    taskENTER_CRITICAL(&g_bemfa_switch_mux);
+    if (g_bemfa_switch_lock == NULL) {
+        g_bemfa_switch_lock = xSemaphoreCreateMutexStatic(&g_bemfa_switch_lock_buf);
+    }
+    taskEXIT_CRITICAL(&g_bemfa_switch_mux);
+
+    return g_bemfa_switch_lock;
+}
+
+// 开关状态变化时通知本地订阅者，回调在锁内执行，保证通知顺序与状态变化顺序一致
+static void bemfa_switch_update(int on)
+{
+    SemaphoreHandle_t lock = bemfa_switch_lock();
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (g_bemfa_switch_status != on) {
+        g_bemfa_switch_status = on;
+        if (g_bemfa_switch_cb) {
+            g_bemfa_switch_cb(on);
+        }
+    }
+    xSemaphoreGive(lock);
+}
+
+// 默认主题：开关状态
+static void bemfa_switch_handler(const char *topic, const char *msg, size_t msg_len, void *arg)
+{
+    printf("parse msg: |%s|\n", msg);
+    bemfa_switch_update(strcmp(msg, "on") == 0 ? 1 : 0);
+}
+
+int bemfa_get_switch(void)
+{
+    return g_bemfa_switch_status;
+}
+
+// 本地控制开关，并把新状态同步到云端；离线时进入离线存储，重连后补发
+int bemfa_set_switch(int on)
+{
+    bemfa_switch_update(on ? 1 : 0);
+    if (g_bemfa_topic[0] == '\0') {
+        return 0;
+    }
+
+    return bemfa_publish_state(g_bemfa_topic, on ? "on" : "off");
+}
+
+void bemfa_set_switch_cb(bemfa_switch_cb_t cb)
+{
+    SemaphoreHandle_t lock = bemfa_switch_lock();
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    g_bemfa_switch_cb = cb;
+    xSemaphoreGive(lock);
+}
+
+bool bemfa_is_online(void)
+{
+    return g_bemfa_status == 5;
+}
+
+static void bemfa_handle_message(const char *topic, size_t topic_len, const char *msg, size_t msg_len)
+{
+    if (topic_table_dispatch(&g_bemfa_topics, topic, topic_len, msg, msg_len) != 0) {
+        ESP_LOGW(TAG, "No handler for topic %.*s", (int)topic_len, topic);
+    }
+}
+
+/*
+ * 订阅从 first 开始的所有已注册主题，返回已订阅的条目数，失败返回 -1
+ */
+static int bemfa_device_subscribe(int first)
+{
+    const char *topics[TOPIC_TABLE_MAX];
+    int count = topic_table_count(&g_bemfa_topics);
+
+    for (int i = first; i < count; i++) {
+        topics[i - first] = topic_table_get(&g_bemfa_topics, i)->name;
+    }
+    if (count > first && g_bemfa_transport->subscribe(topics, count - first, BEMFA_ACK_TIMEOUT_MS) != 0) {
+        return -1;
+    }
+
+    return count;
+}
+
+static int bemfa_pub_post(const char *topic, const char *msg, bool state)
+{
+    // 会话未建立或离线消息还没补发完时写入离线存储，保证按顺序发送
+    if (g_bemfa_status != 5 || pub_store_pending() > 0) {
+        if (pub_store_put(topic, msg) != 0) {
+            ESP_LOGW(TAG, "Offline store full, drop topic=%s msg=%s", topic, msg);
+            return -1;
+        }
+        return 0;
+    }
+
+    if (pub_queue_post(&g_bemfa_pub_queue, topic, msg, state) != 0) {
+        ESP_LOGW(TAG, "Publish queue full, drop topic=%s msg=%s", topic, msg);
+        return -1;
+    }
+
+    g_bemfa_transport->wake();
+
+    return 0;
+}
+
+// 事件类消息，每条都会发送
+int bemfa_publish(const char *topic, const char *msg)
+{
+    return bemfa_pub_post(topic, msg, false);
+}
+
+// 状态类消息，发送前同一主题的旧值被新值覆盖
+int bemfa_publish_state(const char *topic, const char *msg)
+{
+    return bemfa_pub_post(topic, msg, true);
+}
+
+// 令牌桶限制补发速率，空闲时最多积累 BEMFA_PUB_WINDOW 个令牌（next 等于 now 时还有一个）
+static bool bemfa_replay_allowed(void)
+{
+    int64_t now = esp_timer_get_time();
+    int64_t burst = BEMFA_REPLAY_INTERVAL_MS * 1000LL * (BEMFA_PUB_WINDOW - 1);
+
+    if (g_bemfa_replay_next_us < now - burst) {
+        g_bemfa_replay_next_us = now - burst;
+    }
+    if (g_bemfa_replay_next_us > now) {
+        return false;
+    }
+
+    g_bemfa_replay_next_us += BEMFA_REPLAY_INTERVAL_MS * 1000LL;
+    return true;
+}
+
+/*
+ * 取出一批待发消息交给传输层一次发出
+ * 先按 BEMFA_REPLAY_INTERVAL_MS 补发离线存储中的消息，补发完才发送队列中的消息
+ * 每次最多发到在途窗口 BEMFA_PUB_WINDOW 用满，剩余的等应答后下次再发
+ */
+static int bemfa_pub_flush(void)
+{
+    pub_msg_t batch[BEMFA_PUB_WINDOW];
+    uint32_t replay_seq[BEMFA_PUB_WINDOW];
+    int room = BEMFA_PUB_WINDOW - g_bemfa_pub_inflight.count;
+    int replay = 0;
+    int count = 0;
+
+    // 离线消息发送成功后才标记为已发送，失败的下次连接重发
+    uint32_t from = 0;
+    while (count < room && pub_store_pending() > replay && bemfa_replay_allowed()) {
+        if (pub_store_read(from, &batch[count], &replay_seq[replay]) != 0) {
             break;
-        } else {
-            printf("[%d] pub Received: %.*s\n", __LINE__, (int)len, rx_buffer);
-            parse_query_value(rx_buffer, "cmd", public_str, sizeof(public_str));
-            printf("parse cmd: |%s|\n", public_str);
-            if (strcmp(public_str, "2") == 0) {
-                ret = 0;
-            }
         }
-    } while (0);
+        from = replay_seq[replay] + 1;
+        replay++;
+        count++;
+    }
 
-    return ret;
+    const pub_msg_t *msg;
+    while (count < room && pub_store_pending() == replay && (msg = pub_queue_peek(&g_bemfa_pub_queue)) != NULL) {
+        batch[count++] = *msg;
+        pub_queue_pop(&g_bemfa_pub_queue);
+    }
+
+    if (count == 0) {
+        return 0;
+    }
+
+    if (g_bemfa_transport->publish(batch, count) != 0) {
+        // 已从队列取出的消息放回离线存储，排在队列剩余消息之前
+        for (int i = replay; i < count; i++) {
+            pub_store_put(batch[i].topic, batch[i].msg);
+        }
+        return -1;
+    }
+
+    for (int i = 0; i < replay; i++) {
+        pub_store_consume(replay_seq[i]);
+    }
+
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < count; i++) {
+        int tail = (g_bemfa_pub_inflight.head + g_bemfa_pub_inflight.count) % BEMFA_PUB_WINDOW;
+        g_bemfa_pub_inflight.sent_us[tail] = now;
+        g_bemfa_pub_inflight.msgs[tail] = batch[i];
+        g_bemfa_pub_inflight.replayed[tail] = i < replay;
+        g_bemfa_pub_inflight.count++;
+    }
+
+    g_bemfa_pub_stats.sent += count;
+    g_bemfa_pub_stats.flushes++;
+    g_bemfa_pub_stats.inflight = g_bemfa_pub_inflight.count;
+
+    return 0;
 }
 
-int bemfa_device_listen(void)
+/*
+ * 等待云端下发消息，收到即处理；连接是否有效由传输层的心跳判断
+ */
+static int bemfa_device_listen(int timeout_ms)
+{
+    int ret = g_bemfa_transport->poll(timeout_ms);
+    if (ret < 0) {
+        return -1;
+    }
+
+    bemfa_pub_expire();
+
+    if (bemfa_pub_flush() != 0) {
+        return -1;
+    }
+
+    // 连接期间新注册的主题
+    if (topic_table_count(&g_bemfa_topics) > g_bemfa_subscribed) {
+        ret = bemfa_device_subscribe(g_bemfa_subscribed);
+        if (ret < 0) {
+            return -1;
+        }
+        g_bemfa_subscribed = ret;
+    }
+
+    return 0;
+}
+
+int bemfa_get_session_stats(bemfa_session_stats_t *stats)
+{
+    *stats = g_bemfa_session_stats;
+    return 0;
+}
+
+// Wi-Fi 恢复时调用，立即结束退避等待
+void bemfa_notify_network_up(void)
+{
+    if (g_bemfa_task) {
+        xTaskNotifyGive(g_bemfa_task);
+    }
+}
+
+static void bemfa_session_close(void)
+{
+    g_bemfa_transport->close();
+    g_bemfa_subscribed = 0;
+
+    // 还没发出的消息转入离线存储，重连后按顺序补发
+    const pub_msg_t *msg;
+    while ((msg = pub_queue_peek(&g_bemfa_pub_queue)) != NULL) {
+        pub_store_put(msg->topic, msg->msg);
+        pub_queue_pop(&g_bemfa_pub_queue);
+    }
+
+    if (g_bemfa_session_start_us) {
+        int64_t duration = esp_timer_get_time() - g_bemfa_session_start_us;
+        g_bemfa_session_stats.disconnects++;
+        g_bemfa_session_stats.last_session_us = duration;
+        if (duration > g_bemfa_session_stats.longest_session_us) {
+            g_bemfa_session_stats.longest_session_us = duration;
+        }
+        g_bemfa_session_start_us = 0;
+    }
+}
+
+static uint32_t bemfa_backoff_ms(int fail_cnt)
+{
+    int shift = fail_cnt > 7 ? 6 : fail_cnt - 1;
+    uint32_t delay = BEMFA_BACKOFF_BASE_MS << (shift < 0 ? 0 : shift);
+
+    if (delay > BEMFA_BACKOFF_MAX_MS) {
+        delay = BEMFA_BACKOFF_MAX_MS;
+    }
+
+    // 在 [delay/2, delay] 内随机，避免大量设备同时重连
+    return delay / 2 + esp_random() % (delay / 2 + 1);
+}
+
+/*
+ * 某一步失败：关闭连接，计算退避时间并决定下一步
+ * 建立连接之后的失败回到重新连接；连续失败 BEMFA_REDNS_FAIL_CNT 次时重新解析域名
+ */
+static uint32_t bemfa_session_fail(void)
+{
+    bemfa_session_close();
+
+    g_bemfa_fail_cnt++;
+    g_bemfa_session_stats.failures++;
+
+    if (g_bemfa_status >= 2) {
+        g_bemfa_status = (g_bemfa_fail_cnt % BEMFA_REDNS_FAIL_CNT == 0) ? 0 : 2;
+    }
+
+    uint32_t delay = bemfa_backoff_ms(g_bemfa_fail_cnt);
+    g_bemfa_session_stats.backoff_ms = delay;
+    ESP_LOGW(TAG, "bemfa session fail %d, next state:%d, retry in %"PRIu32" ms", g_bemfa_fail_cnt, g_bemfa_status, delay);
+
+    return delay;
+}
+
+/*
+ * 会话状态机推进一步：0 预取 DNS，1 注册主题，2 连接，3 订阅，4 同步开关状态，5 在线收发
+ * 返回 0 表示成功，非 0 时由调用方 bemfa_session_fail 退避
+ */
+static int bemfa_session_step(void)
 {
-    char rx_buffer[128] = {0};
-    char parse[32] = {0};
     int ret = -1;
-    do {
-        int len = recv(g_tcp_sock, rx_buffer, sizeof(rx_buffer) - 1, 0);
-        if (len < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                printf("[%d] Timeout, no data received.\n", __LINE__);
-            } else {
-                perror("recv error");
+
+    switch (g_bemfa_status)
+    {
+        case 0: {
+            ret = g_bemfa_transport->prepare ? g_bemfa_transport->prepare() : 0;
+            if (ret == 0) {
+                g_bemfa_status = g_bemfa_topic_added ? 2 : 1;
+            }
+        } break;
+        case 1: {
+            ret = bemfa_device_addTopic();
+            if (ret == 0) {
+                g_bemfa_topic_added = true;
+                g_bemfa_status = 2;
+            }
+        } break;
+        case 2: {
+            ret = g_bemfa_transport->connect(BEMFA_CONNECT_TIMEOUT_MS);
+            if (ret == 0) {
+                bemfa_pub_inflight_reset();
+                g_bemfa_status = 3;
             }
+        } break;
+        case 3: {
+            ret = bemfa_device_subscribe(0);
+            if (ret >= 0) {
+                g_bemfa_subscribed = ret;
+                ret = 0;
+                boot_timeline_mark("bemfa_online");
+                g_bemfa_session_start_us = esp_timer_get_time();
+                g_bemfa_session_stats.connects++;
+                g_bemfa_session_stats.backoff_ms = 0;
+                g_bemfa_fail_cnt = 0;
+                g_bemfa_status = 4;
+            }
+        } break;
+        case 4: {
+            // 上线后同步一次开关状态，由 bemfa_device_listen 发送
+            // 先切换到在线状态，否则这条消息会被当作离线消息写入 flash 并限速补发
+            g_bemfa_status = 5;
+            bemfa_publish_state(g_bemfa_topic, g_bemfa_switch_status == 1 ? "on" : "off");
             ret = 0;
-        } else if (len == 0) {
-            printf("Server closed connection.\n");
+        } break;
+        case 5: {
+            // 阻塞在 select() 中，有数据立即返回处理；补发离线消息期间按补发间隔唤醒
+            ret = bemfa_device_listen(pub_store_pending() > 0 ? BEMFA_REPLAY_INTERVAL_MS : BEMFA_IDLE_POLL_MS);
+        } break;
+        default:
             break;
-        } else {
-            ret = 0;
-            printf("[%d] listen Received: %.*s\n", __LINE__, (int)len, rx_buffer);
-
-            parse_query_value(rx_buffer, "msg", parse, sizeof(parse));
-            printf("parse msg: |%s|\n", parse);
-            if (strcmp(parse, "on") == 0) {
-                g_bemfa_switch_status = 1;
-            } else {
-                g_bemfa_switch_status = 0;
-            }
-        }
-    } while (0);
+    }
 
     return ret;
 }
@@ -356,77 +681,48 @@ int bemfa_device_listen(void)
 void user_bemfa_connect_task(void *pvParameters)
 {
     int ret = 0;
+    bool wait_wifi = false;
+
+    g_bemfa_task = xTaskGetCurrentTaskHandle();
 
-    user_nvs_read_string(NVS_NAMESPACE, NVS_BEMFA_TOPIC, g_bemfa_topic, sizeof(g_bemfa_topic));
-    user_nvs_read_string(NVS_NAMESPACE, NVS_BEMFA_TOKEN, g_bemfa_token, sizeof(g_bemfa_token));
+    user_config_get_bemfa_topic(g_bemfa_topic, sizeof(g_bemfa_topic));
+    user_config_get_bemfa_token(g_bemfa_token, sizeof(g_bemfa_token));
+    bemfa_subscribe_topic(g_bemfa_topic, bemfa_switch_handler, NULL);
+
+    bemfa_transport_config_t transport_config = {
+        .uid = g_bemfa_token,
+        .rx_cb = bemfa_handle_message,
+        .ack_cb = bemfa_pub_ack_received,
+        .stats = &g_bemfa_session_stats,
+    };
+    ESP_LOGI(TAG, "bemfa transport: %s", g_bemfa_transport->name);
+    g_bemfa_transport->init(&transport_config);
+    pub_store_init(BEMFA_STORE_POLICY);
 
     while (1)
     {
+        // 等待 Wi-Fi 连接，断线后从头开始
         if (g_system_status.wifi_connect_status == 0) {
-            g_bemfa_status = 0;
-            tcp_client_deinit(g_tcp_sock);
-            g_tcp_sock = -1;
-            break;
+            if (!wait_wifi) {
+                bemfa_session_close();
+                g_bemfa_status = 0;
+                wait_wifi = true;
+            }
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(BEMFA_IDLE_POLL_MS));
+            continue;
         }
-
-        switch (g_bemfa_status)
-        {
-            case 0: {
-                ret = dns_lookup(BEMFA_SERVER_HOSTNAME, g_bemfa_ipaddr);
-                if (ret == 0) {
-                    ESP_LOGI(TAG, "bemfa server ip:%s", g_bemfa_ipaddr);
-                    g_bemfa_status = 1;
-                }
-            } break;
-            case 1: {
-                ret = bemfa_device_addTopic();
-                if (ret == 0) {
-                    g_bemfa_status = 2;
-                }
-            } break;
-            case 2: {
-                g_tcp_sock = tcp_client_init(g_bemfa_ipaddr, BEMFA_SERVER_PORT);
-                if (g_tcp_sock > 0) {
-                    g_bemfa_status = 3;
-                } else {
-                    ESP_LOGE(TAG, "bemfa server connect fail, sock:%d", g_tcp_sock);
-                }
-            } break;
-            case 3: {
-                ret = bemfa_device_subscribe();
-                if (ret == 0) {
-                    g_bemfa_status = 4;
-                } else {
-                    tcp_client_deinit(g_tcp_sock);
-                    g_tcp_sock = -1;
-                    g_bemfa_status = 2;
-                }
-            } break;
-            case 4: {
-                ret = bemfa_device_public(g_bemfa_switch_status == 1 ? "on" : "off");
-                if (ret == 0) {
-                    g_bemfa_status = 5;
-                } else {
-                    tcp_client_deinit(g_tcp_sock);
-                    g_tcp_sock = -1;
-                    g_bemfa_status = 2;
-                }
-            } break;
-            case 5: {
-                ret = bemfa_device_listen();
-                if (ret == 0) {
-                    g_bemfa_status = 5;
-                } else {
-                    tcp_client_deinit(g_tcp_sock);
-                    g_tcp_sock = -1;
-                    g_bemfa_status = 2;
-                }
-            } break;
-            default:
-                break;
+        if (wait_wifi) {
+            wait_wifi = false;
+            g_bemfa_fail_cnt = 0;
+            g_bemfa_session_stats.wifi_restarts++;
         }
 
-        vTaskDelay(1000 / portTICK_PERIOD_MS);
+        // 状态推进成功时立即进入下一步，只有失败才退避等待
+        ret = bemfa_session_step();
+        if (ret != 0) {
+            // Wi-Fi 恢复的通知会提前结束等待
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(bemfa_session_fail()));
+        }
     }
 
     vTaskDelete(NULL);
@@ -1,13 +1,97 @@
 #ifndef __BEMFA_H__
 #define __BEMFA_H__
 
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "topic_table.h"
+#include "pub_store.h"
+
 #define BEMFA_SERVER_HOSTNAME       "bemfa.com"
 #define BEMFA_SERVER_PORT           8344
+#define BEMFA_MQTT_PORT             9501
 
 #define BEMFA_DEVICE_ADDTOPIC_API    "http://pro.bemfa.com/vs/web/v1/deviceAddTopic"
 
+#ifndef BEMFA_PUB_WINDOW
+#define BEMFA_PUB_WINDOW            4       // 同时等待应答的发布消息数上限
+#endif
+
+#ifndef BEMFA_STORE_POLICY
+#define BEMFA_STORE_POLICY          PUB_STORE_DROP_OLDEST   // 离线存储写满时的处理方式
+#endif
+
+#ifndef BEMFA_HEARTBEAT_INTERVAL_MS
+#define BEMFA_HEARTBEAT_INTERVAL_MS 30000   // 无数据收发多久后发送心跳，服务器 65 秒无数据会断开
+#endif
+#ifndef BEMFA_HEARTBEAT_TIMEOUT_MS
+#define BEMFA_HEARTBEAT_TIMEOUT_MS  5000    // 等待心跳应答的时间
+#endif
+#ifndef BEMFA_HEARTBEAT_MAX_MISSED
+#define BEMFA_HEARTBEAT_MAX_MISSED  2       // 连续丢失多少次心跳判定连接失效
+#endif
+
+typedef struct {
+    uint32_t sent;              // 已发送
+    uint32_t acked;             // 已收到应答
+    uint32_t timeout;           // 应答超时
+    uint32_t rejected;          // 服务器应答失败（res 不为 1）
+    uint32_t inflight;          // 当前等待应答数
+    int64_t last_latency_us;    // 最近一次发送到应答的延时
+    int64_t max_latency_us;
+    int64_t total_latency_us;   // 累计延时，除以 acked 得平均值
+    uint32_t flushes;           // 批量发送次数，每次一个 send()
+    uint32_t queue_depth;       // 发布队列中等待发送的消息数
+    uint32_t queue_dropped;     // 队列满丢弃的消息数
+    uint32_t coalesced;         // 被同主题新值覆盖的状态消息数
+    uint32_t offline_stored;    // 离线期间保存的消息数
+    uint32_t offline_replayed;  // 重连后补发的消息数
+    uint32_t offline_dropped;   // 离线存储按策略丢弃或合并的消息数
+    uint32_t offline_pending;   // 离线存储中等待补发的消息数
+} bemfa_pub_stats_t;
+
+typedef struct {
+    uint32_t connects;          // 会话建立（订阅成功）次数
+    uint32_t disconnects;       // 已建立的会话断开次数
+    uint32_t failures;          // 各步骤失败次数
+    uint32_t dns_resolves;      // 域名解析次数
+    uint32_t connect_attempts;  // TCP 连接尝试次数（每个地址算一次）
+    int64_t last_connect_us;    // 最近一次建立 TCP 连接的耗时
+    uint32_t wifi_restarts;     // Wi-Fi 恢复后重启会话的次数
+    uint32_t backoff_ms;        // 当前退避时间，会话正常时为 0
+    int64_t last_session_us;    // 上一次会话持续时间
+    int64_t longest_session_us;
+    uint32_t heartbeats;        // 已发送心跳数
+    uint32_t missed_beats;      // 未收到应答的心跳数
+    uint32_t dead_links;        // 由心跳检测出的失效连接数
+    uint32_t last_detect_ms;    // 最近一次从最后收到数据到判定失效的时间
+    uint32_t max_detect_ms;
+} bemfa_session_stats_t;
+
 void user_bemfa_connect_task(void *pvParameters);
+void bemfa_notify_network_up(void);
 
 int parse_bemfa_bind_message(char *rx_buf, char *tx_buf);
 
+// 订阅主题，云端下发到该主题的消息交给 handler；最多 TOPIC_TABLE_MAX 个
+int bemfa_subscribe_topic(const char *topic, topic_handler_t handler, void *arg);
+
+// 任意任务可调用，消息入队后立即返回，由 bemfa 任务批量发送；队列满返回 -1
+// 连接断开期间写入离线存储，重连后按顺序限速补发
+int bemfa_publish(const char *topic, const char *msg);
+// 状态类主题，队列中同一主题只保留最新值
+int bemfa_publish_state(const char *topic, const char *msg);
+
+// 默认主题的开关状态，设置后同步发布到云端
+int bemfa_get_switch(void);
+int bemfa_set_switch(int on);
+// 开关状态变化（云端下发或本地设置）时调用，在 bemfa 任务或调用 bemfa_set_switch 的任务中执行，不能阻塞
+typedef void (*bemfa_switch_cb_t)(int on);
+void bemfa_set_switch_cb(bemfa_switch_cb_t cb);
+// 会话已建立（订阅成功）
+bool bemfa_is_online(void);
+
+int bemfa_get_pub_stats(bemfa_pub_stats_t *stats);
+int bemfa_get_session_stats(bemfa_session_stats_t *stats);
+
 #endif
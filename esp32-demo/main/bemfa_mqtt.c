@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "mqtt_client.h"
+
+#include "bemfa.h"
+#include "bemfa_transport.h"
+
+static const char *TAG = "bemfa_mqtt.c";
+
+#define BEMFA_MQTT_KEEPALIVE_S      60      // 由服务器和 esp-mqtt 负责保活，不再需要应用层 ping
+#define BEMFA_MQTT_QOS              1       // 发布和订阅都使用 QoS 1，PUBACK 作为发布应答
+#define BEMFA_MQTT_SUB_BATCH        8       // 一个 SUBSCRIBE 报文中的主题数
+#define BEMFA_MQTT_RX_QUEUE_LEN     8       // 从 mqtt 任务转交给 bemfa 任务的消息数
+
+#define MQTT_CONNECTED_BIT          BIT0
+#define MQTT_DISCONNECTED_BIT       BIT1
+#define MQTT_SUBSCRIBED_BIT         BIT2
+#define MQTT_EVENT_BIT              BIT3    // 收到消息、应答或有待发消息，poll 需要返回
+
+static bemfa_transport_config_t g_mqtt_config;
+
+static esp_mqtt_client_handle_t g_mqtt_client = NULL;
+static EventGroupHandle_t g_mqtt_event_group = NULL;
+static QueueHandle_t g_mqtt_rx_queue = NULL;
+static uint32_t g_mqtt_acks = 0;            // mqtt 任务收到、还未交给 ack_cb 的 PUBACK 数
+static uint32_t g_mqtt_rx_dropped = 0;
+
+/*
+ * 运行在 esp-mqtt 任务中，只记录事件，回调留到 bemfa 任务的 poll 中执行
+ */
+static void bemfa_mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    esp_mqtt_event_handle_t event = event_data;
+
+    switch ((esp_mqtt_event_id_t)event_id) {
+        case MQTT_EVENT_CONNECTED:
+            xEventGroupSetBits(g_mqtt_event_group, MQTT_CONNECTED_BIT);
+            break;
+        case MQTT_EVENT_DISCONNECTED:
+            xEventGroupSetBits(g_mqtt_event_group, MQTT_DISCONNECTED_BIT | MQTT_EVENT_BIT);
+            break;
+        case MQTT_EVENT_SUBSCRIBED:
+            xEventGroupSetBits(g_mqtt_event_group, MQTT_SUBSCRIBED_BIT);
+            break;
+        case MQTT_EVENT_PUBLISHED:
+            __atomic_fetch_add(&g_mqtt_acks, 1, __ATOMIC_RELAXED);
+            xEventGroupSetBits(g_mqtt_event_group, MQTT_EVENT_BIT);
+            break;
+        case MQTT_EVENT_DATA: {
+            pub_msg_t msg;
+
+            // 巴法云的消息都很短，分片或超长的消息直接丢弃
+            if (event->data_len != event->total_data_len || event->topic_len >= sizeof(msg.topic) || event->data_len >= sizeof(msg.msg)) {
+                ESP_LOGW(TAG, "Drop message, topic len:%d data len:%d", event->topic_len, event->total_data_len);
+                g_mqtt_rx_dropped++;
+                break;
+            }
+            msg.state = -1;
+            memcpy(msg.topic, event->topic, event->topic_len);
+            msg.topic[event->topic_len] = '\0';
+            memcpy(msg.msg, event->data, event->data_len);
+            msg.msg[event->data_len] = '\0';
+
+            if (xQueueSend(g_mqtt_rx_queue, &msg, 0) != pdTRUE) {
+                g_mqtt_rx_dropped++;
+            }
+            xEventGroupSetBits(g_mqtt_event_group, MQTT_EVENT_BIT);
+        } break;
+        case MQTT_EVENT_ERROR:
+            ESP_LOGW(TAG, "MQTT error");
+            break;
+        default:
+            break;
+    }
+}
+
+// 把 mqtt 任务记录的应答和消息交给 bemfa.c
+static void bemfa_mqtt_dispatch(void)
+{
+    pub_msg_t msg;
+
+    for (uint32_t acks = __atomic_exchange_n(&g_mqtt_acks, 0, __ATOMIC_RELAXED); acks > 0; acks--) {
+        g_mqtt_config.ack_cb(true);
+    }
+
+    while (xQueueReceive(g_mqtt_rx_queue, &msg, 0) == pdTRUE) {
+        printf("[%d] Received: %s=%s\n", __LINE__, msg.topic, msg.msg);
+        g_mqtt_config.rx_cb(msg.topic, strlen(msg.topic), msg.msg, strlen(msg.msg));
+    }
+}
+
+static int bemfa_mqtt_init(const bemfa_transport_config_t *config)
+{
+    g_mqtt_config = *config;
+
+    g_mqtt_event_group = xEventGroupCreate();
+    g_mqtt_rx_queue = xQueueCreate(BEMFA_MQTT_RX_QUEUE_LEN, sizeof(pub_msg_t));
+    if (!g_mqtt_event_group || !g_mqtt_rx_queue) {
+        ESP_LOGE(TAG, "Failed to create event group or queue");
+        return -1;
+    }
+
+    return 0;
+}
+
+static void bemfa_mqtt_close(void)
+{
+    if (g_mqtt_client) {
+        esp_mqtt_client_stop(g_mqtt_client);
+        esp_mqtt_client_destroy(g_mqtt_client);
+        g_mqtt_client = NULL;
+    }
+}
+
+/*
+ * 巴法云 MQTT 以私钥作为 client id，不需要用户名和密码
+ * 重连由 bemfa.c 的退避逻辑负责，关闭 esp-mqtt 自己的自动重连
+ */
+static int bemfa_mqtt_connect(int timeout_ms)
+{
+    esp_mqtt_client_config_t mqtt_cfg = {
+        .broker.address.hostname = BEMFA_SERVER_HOSTNAME,
+        .broker.address.port = BEMFA_MQTT_PORT,
+        .broker.address.transport = MQTT_TRANSPORT_OVER_TCP,
+        .credentials.client_id = g_mqtt_config.uid,
+        .session.keepalive = BEMFA_MQTT_KEEPALIVE_S,
+        .network.timeout_ms = timeout_ms,
+        .network.disable_auto_reconnect = true,
+    };
+    int64_t start = esp_timer_get_time();
+
+    g_mqtt_config.stats->connect_attempts++;
+    xEventGroupClearBits(g_mqtt_event_group, MQTT_CONNECTED_BIT | MQTT_DISCONNECTED_BIT | MQTT_SUBSCRIBED_BIT | MQTT_EVENT_BIT);
+
+    g_mqtt_client = esp_mqtt_client_init(&mqtt_cfg);
+    if (!g_mqtt_client) {
+        return -1;
+    }
+    esp_mqtt_client_register_event(g_mqtt_client, MQTT_EVENT_ANY, bemfa_mqtt_event_handler, NULL);
+    if (esp_mqtt_client_start(g_mqtt_client) != ESP_OK) {
+        bemfa_mqtt_close();
+        return -1;
+    }
+
+    EventBits_t bits = xEventGroupWaitBits(g_mqtt_event_group, MQTT_CONNECTED_BIT | MQTT_DISCONNECTED_BIT,
+                                           pdFALSE, pdFALSE, pdMS_TO_TICKS(timeout_ms));
+    if (!(bits & MQTT_CONNECTED_BIT) || (bits & MQTT_DISCONNECTED_BIT)) {
+        ESP_LOGE(TAG, "bemfa mqtt connect fail, bits:0x%x", (unsigned int)bits);
+        bemfa_mqtt_close();
+        return -1;
+    }
+
+    g_mqtt_config.stats->last_connect_us = esp_timer_get_time() - start;
+
+    return 0;
+}
+
+static int bemfa_mqtt_subscribe(const char *const *topics, int count, int timeout_ms)
+{
+    esp_mqtt_topic_t list[BEMFA_MQTT_SUB_BATCH];
+
+    for (int index = 0; index < count; ) {
+        int batch = 0;
+        for (; index < count && batch < BEMFA_MQTT_SUB_BATCH; index++, batch++) {
+            list[batch].filter = topics[index];
+            list[batch].qos = BEMFA_MQTT_QOS;
+        }
+
+        xEventGroupClearBits(g_mqtt_event_group, MQTT_SUBSCRIBED_BIT);
+        if (esp_mqtt_client_subscribe_multiple(g_mqtt_client, list, batch) < 0) {
+            return -1;
+        }
+
+        EventBits_t bits = xEventGroupWaitBits(g_mqtt_event_group, MQTT_SUBSCRIBED_BIT | MQTT_DISCONNECTED_BIT,
+                                               pdFALSE, pdFALSE, pdMS_TO_TICKS(timeout_ms));
+        if (!(bits & MQTT_SUBSCRIBED_BIT) || (bits & MQTT_DISCONNECTED_BIT)) {
+            printf("[%d] Timeout, no ack received.\n", __LINE__);
+            return -1;
+        }
+        ESP_LOGI(TAG, "Subscribed %d topics", batch);
+    }
+
+    // 订阅后服务器会推送各主题的最新消息
+    bemfa_mqtt_dispatch();
+
+    return 0;
+}
+
+static int bemfa_mqtt_publish(const pub_msg_t *msgs, int count)
+{
+    for (int i = 0; i < count; i++) {
+        if (esp_mqtt_client_publish(g_mqtt_client, msgs[i].topic, msgs[i].msg, 0, BEMFA_MQTT_QOS, 0) < 0) {
+            ESP_LOGE(TAG, "Publish fail, topic=%s", msgs[i].topic);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// 保活由 esp-mqtt 完成，断开时 MQTT_DISCONNECTED_BIT 置位
+static int bemfa_mqtt_poll(int timeout_ms)
+{
+    EventBits_t bits = xEventGroupWaitBits(g_mqtt_event_group, MQTT_EVENT_BIT | MQTT_DISCONNECTED_BIT,
+                                           pdFALSE, pdFALSE, pdMS_TO_TICKS(timeout_ms));
+    xEventGroupClearBits(g_mqtt_event_group, MQTT_EVENT_BIT);
+
+    bemfa_mqtt_dispatch();
+
+    if (bits & MQTT_DISCONNECTED_BIT) {
+        ESP_LOGW(TAG, "bemfa mqtt disconnected");
+        return -1;
+    }
+
+    return 0;
+}
+
+static void bemfa_mqtt_wake(void)
+{
+    if (g_mqtt_event_group) {
+        xEventGroupSetBits(g_mqtt_event_group, MQTT_EVENT_BIT);
+    }
+}
+
+const bemfa_transport_t bemfa_transport_mqtt = {
+    .name = "mqtt",
+    .device_type = 1,
+    .init = bemfa_mqtt_init,
+    .prepare = NULL,
+    .connect = bemfa_mqtt_connect,
+    .close = bemfa_mqtt_close,
+    .subscribe = bemfa_mqtt_subscribe,
+    .publish = bemfa_mqtt_publish,
+    .poll = bemfa_mqtt_poll,
+    .wake = bemfa_mqtt_wake,
+};
@@ -0,0 +1,359 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_vfs_eventfd.h"
+#include "lwip/sockets.h"
+
+#include "bemfa.h"
+#include "bemfa_transport.h"
+#include "protocol.h"
+#include "line_framer.h"
+#include "query_parser.h"
+
+static const char *TAG = "bemfa_tcp.c";
+
+#define BEMFA_TCP_ACK_TIMEOUT_MS    3000    // 发送和等待心跳的超时
+#define BEMFA_TCP_DNS_TIMEOUT_MS    10000   // 等待域名解析的超时
+#define BEMFA_TCP_RX_BUFFER_SIZE    512     // 接收缓冲区，需大于单行消息长度
+#define BEMFA_TCP_LINE_MAX          192     // 单条发布命令的最大长度
+#define BEMFA_TCP_TX_BUFFER_SIZE    (BEMFA_TCP_LINE_MAX * BEMFA_PUB_WINDOW)
+#define BEMFA_TCP_SUB_LINE_MAX      256     // 单条订阅命令的最大长度，主题多时拆成多条
+
+static bemfa_transport_config_t g_tcp_config;
+
+static dns_result_t g_tcp_addrs;
+static int g_tcp_sock = -1;
+
+static char g_tcp_rx_buffer[BEMFA_TCP_RX_BUFFER_SIZE];
+static line_framer_t g_tcp_framer;
+static volatile int g_tcp_sub_ack = 0;
+
+// 投递待发消息后通过 eventfd 唤醒 select()
+static int g_tcp_wake_fd = -1;
+static char g_tcp_tx_buffer[BEMFA_TCP_TX_BUFFER_SIZE];
+
+// 心跳，收到任何数据都视为连接正常
+static int64_t g_tcp_last_rx_us = 0;
+static int64_t g_tcp_ping_sent_us = 0;      // 0 表示没有等待应答的心跳
+static int g_tcp_missed_beats = 0;
+
+/*
+ * 处理一行完整的服务器消息，frame 已以 '\0' 结尾
+ */
+static void bemfa_tcp_handle_frame(char *frame, size_t len, void *arg)
+{
+    query_table_t query;
+
+    printf("[%d] Received: %.*s\n", __LINE__, (int)len, frame);
+
+    query_parse(frame, len, &query);
+
+    if (query_value_equals(&query, "cmd", "3")) {
+        g_tcp_sub_ack = 1;
+    } else if (query_value_equals(&query, "cmd", "2") && query_get(&query, "res", NULL) && !query_get(&query, "msg", NULL)) {
+        // 不带 msg 的 cmd=2&res=... 是发布应答，res=1 成功，其他值为失败；带 msg 的是云端推送
+        g_tcp_config.ack_cb(query_value_equals(&query, "res", "1"));
+    }
+
+    // cmd=2&uid=xxxxxxxxxxxxxxxxxxxxxxx&topic=light002&msg=on
+    size_t msg_len = 0;
+    const char *msg = query_get(&query, "msg", &msg_len);
+    if (msg) {
+        size_t topic_len = 0;
+        const char *topic = query_get(&query, "topic", &topic_len);
+        if (topic) {
+            g_tcp_config.rx_cb(topic, topic_len, msg, msg_len);
+        }
+    }
+}
+
+/*
+ * 等待数据到达，读空 socket 并按行交给 bemfa_tcp_handle_frame
+ * 返回 >=0: 处理的行数（0 表示超时、被唤醒或只收到半包）, -1: 出错或连接关闭
+ */
+static int bemfa_tcp_read(int timeout_ms)
+{
+    int frames = 0;
+
+    int ret = tcp_client_wait_event(g_tcp_sock, g_tcp_wake_fd, timeout_ms);
+    if (ret < 0) {
+        return -1;
+    }
+    if (ret & TCP_WAIT_WAKEUP) {
+        // 只需清除计数，待发消息由 bemfa.c 处理
+        uint64_t cnt;
+        read(g_tcp_wake_fd, &cnt, sizeof(cnt));
+    }
+    if (!(ret & TCP_WAIT_READABLE)) {
+        return 0;
+    }
+
+    while (1) {
+        size_t space = 0;
+        char *p = line_framer_get_space(&g_tcp_framer, &space);
+
+        int len = recv(g_tcp_sock, p, space, 0);
+        if (len < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            perror("recv error");
+            return -1;
+        } else if (len == 0) {
+            printf("Server closed connection.\n");
+            return -1;
+        }
+
+        g_tcp_last_rx_us = esp_timer_get_time();
+        frames += line_framer_commit(&g_tcp_framer, len);
+    }
+
+    return frames;
+}
+
+/*
+ * 在超时时间内等待 *flag 被 bemfa_tcp_handle_frame 置位
+ */
+static int bemfa_tcp_wait_ack(volatile int *flag, int timeout_ms)
+{
+    int64_t deadline = esp_timer_get_time() + timeout_ms * 1000LL;
+
+    while (*flag == 0) {
+        int64_t remain = (deadline - esp_timer_get_time()) / 1000;
+        if (remain <= 0) {
+            printf("[%d] Timeout, no ack received.\n", __LINE__);
+            return -1;
+        }
+
+        if (bemfa_tcp_read(remain) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void bemfa_tcp_heartbeat_reset(void)
+{
+    g_tcp_last_rx_us = esp_timer_get_time();
+    g_tcp_ping_sent_us = 0;
+    g_tcp_missed_beats = 0;
+}
+
+/*
+ * 空闲 BEMFA_HEARTBEAT_INTERVAL_MS 后发送 ping，服务器应答 cmd=0&res=1
+ * 超时未收到数据记一次丢失并立即重发，连续丢失 BEMFA_HEARTBEAT_MAX_MISSED 次返回 -1
+ */
+static int bemfa_tcp_heartbeat(void)
+{
+    bemfa_session_stats_t *stats = g_tcp_config.stats;
+    int64_t now = esp_timer_get_time();
+
+    if (g_tcp_ping_sent_us) {
+        if (g_tcp_last_rx_us >= g_tcp_ping_sent_us) {
+            g_tcp_ping_sent_us = 0;
+            g_tcp_missed_beats = 0;
+        } else if (now - g_tcp_ping_sent_us >= BEMFA_HEARTBEAT_TIMEOUT_MS * 1000LL) {
+            g_tcp_ping_sent_us = 0;
+            g_tcp_missed_beats++;
+            stats->missed_beats++;
+            ESP_LOGW(TAG, "Heartbeat missed %d", g_tcp_missed_beats);
+
+            if (g_tcp_missed_beats >= BEMFA_HEARTBEAT_MAX_MISSED) {
+                uint32_t detect_ms = (now - g_tcp_last_rx_us) / 1000;
+                stats->dead_links++;
+                stats->last_detect_ms = detect_ms;
+                if (detect_ms > stats->max_detect_ms) {
+                    stats->max_detect_ms = detect_ms;
+                }
+                ESP_LOGE(TAG, "Connection dead, no data for %"PRIu32" ms", detect_ms);
+                return -1;
+            }
+        } else {
+            return 0;
+        }
+    }
+
+    if (g_tcp_missed_beats == 0 && now - g_tcp_last_rx_us < BEMFA_HEARTBEAT_INTERVAL_MS * 1000LL) {
+        return 0;
+    }
+
+    if (tcp_client_send(g_tcp_sock, "ping\r\n", 6, BEMFA_TCP_ACK_TIMEOUT_MS) < 0) {
+        return -1;
+    }
+    g_tcp_ping_sent_us = esp_timer_get_time();
+    stats->heartbeats++;
+
+    return 0;
+}
+
+static int bemfa_tcp_init(const bemfa_transport_config_t *config)
+{
+    g_tcp_config = *config;
+
+    line_framer_init(&g_tcp_framer, g_tcp_rx_buffer, sizeof(g_tcp_rx_buffer), bemfa_tcp_handle_frame, NULL);
+
+    esp_vfs_eventfd_config_t eventfd_config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+    esp_err_t err = esp_vfs_eventfd_register(&eventfd_config);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "eventfd register fail: %s", esp_err_to_name(err));
+        return 0;
+    }
+
+    g_tcp_wake_fd = eventfd(0, 0);
+    if (g_tcp_wake_fd < 0) {
+        // 没有 eventfd 时退化为每次 poll 超时检查一次待发消息
+        ESP_LOGE(TAG, "eventfd create fail: errno %d", errno);
+    }
+
+    return 0;
+}
+
+// 丢弃旧结果并在后台预取，与 addTopic 的 HTTP 请求并行
+static int bemfa_tcp_prepare(void)
+{
+    g_tcp_config.stats->dns_resolves++;
+    dns_cache_invalidate(BEMFA_SERVER_HOSTNAME);
+
+    return dns_resolve_async(BEMFA_SERVER_HOSTNAME, NULL, NULL) < 0 ? -1 : 0;
+}
+
+static int bemfa_tcp_connect(int timeout_ms)
+{
+    if (dns_resolve(BEMFA_SERVER_HOSTNAME, &g_tcp_addrs, BEMFA_TCP_DNS_TIMEOUT_MS) != 0) {
+        return -1;
+    }
+
+    // 并行尝试解析到的每个地址
+    tcp_connect_stats_t connect_stats;
+    g_tcp_sock = tcp_client_connect(&g_tcp_addrs, BEMFA_SERVER_PORT, timeout_ms, &connect_stats);
+    g_tcp_config.stats->connect_attempts += connect_stats.count;
+    g_tcp_config.stats->last_connect_us = connect_stats.total_us;
+    if (g_tcp_sock < 0) {
+        ESP_LOGE(TAG, "bemfa server connect fail, sock:%d", g_tcp_sock);
+        g_tcp_sock = -1;
+        return -1;
+    }
+
+    line_framer_reset(&g_tcp_framer);
+    bemfa_tcp_heartbeat_reset();
+
+    return 0;
+}
+
+static void bemfa_tcp_close(void)
+{
+    if (g_tcp_sock >= 0) {
+        tcp_client_deinit(g_tcp_sock);
+        g_tcp_sock = -1;
+    }
+}
+
+/*
+ * 多个主题用逗号拼在一条命令里，超过 BEMFA_TCP_SUB_LINE_MAX 时拆成多条，每条等待一次应答
+ */
+static int bemfa_tcp_subscribe(const char *const *topics, int count, int timeout_ms)
+{
+    // cmd=3&uid=6cf90baf69f846f08b5a8383d6256a49&topic=esp32switchea28006,esp32light\r\n
+    char subscribe_str[BEMFA_TCP_SUB_LINE_MAX];
+    int index = 0;
+
+    while (index < count) {
+        int len = snprintf(subscribe_str, sizeof(subscribe_str), "cmd=3&uid=%s&topic=", g_tcp_config.uid);
+        int batch = 0;
+
+        for (; index < count; index++) {
+            size_t name_len = strlen(topics[index]);
+            // 留出 ',' 和 "\r\n"
+            if (len + 1 + name_len + 2 > sizeof(subscribe_str)) {
+                break;
+            }
+            if (batch > 0) {
+                subscribe_str[len++] = ',';
+            }
+            memcpy(subscribe_str + len, topics[index], name_len);
+            len += name_len;
+            batch++;
+        }
+        memcpy(subscribe_str + len, "\r\n", 2);
+        len += 2;
+
+        g_tcp_sub_ack = 0;
+        int err = tcp_client_send(g_tcp_sock, subscribe_str, len, timeout_ms);
+        if (err < 0) {
+            return -1;
+        }
+
+        // cmd=3&uid=xxxxxxxxxxxxxxxxxxxxxxx&topic=light002&msg=on
+        if (bemfa_tcp_wait_ack(&g_tcp_sub_ack, timeout_ms) != 0) {
+            return -1;
+        }
+        ESP_LOGI(TAG, "Subscribed %d topics", batch);
+    }
+
+    return 0;
+}
+
+// 所有消息拼成一个缓冲区，一次 send() 发出
+static int bemfa_tcp_publish(const pub_msg_t *msgs, int count)
+{
+    int len = 0;
+
+    for (int i = 0; i < count; i++) {
+        // cmd=2&uid=xxxxxxxxxxxxxxxxxxxxxxx&topic=light002&msg=off\r\n
+        int n = snprintf(g_tcp_tx_buffer + len, sizeof(g_tcp_tx_buffer) - len,
+                         "cmd=2&uid=%s&topic=%s&msg=%s\r\n", g_tcp_config.uid, msgs[i].topic, msgs[i].msg);
+        if (n >= sizeof(g_tcp_tx_buffer) - len) {
+            return -1;
+        }
+        len += n;
+    }
+
+    if (tcp_client_send(g_tcp_sock, g_tcp_tx_buffer, len, BEMFA_TCP_ACK_TIMEOUT_MS) < 0) {
+        return -1;
+    }
+    ESP_LOGD(TAG, "Published %d messages, %d bytes", count, len);
+
+    return 0;
+}
+
+/*
+ * 等待云端下发消息，收到即处理；timeout_ms 内无数据视为空闲，由心跳判断连接是否还有效
+ */
+static int bemfa_tcp_poll(int timeout_ms)
+{
+    if (bemfa_tcp_read(timeout_ms) < 0) {
+        return -1;
+    }
+
+    return bemfa_tcp_heartbeat();
+}
+
+static void bemfa_tcp_wake(void)
+{
+    if (g_tcp_wake_fd >= 0) {
+        uint64_t one = 1;
+        write(g_tcp_wake_fd, &one, sizeof(one));
+    }
+}
+
+const bemfa_transport_t bemfa_transport_tcp = {
+    .name = "tcp",
+    .device_type = 3,
+    .init = bemfa_tcp_init,
+    .prepare = bemfa_tcp_prepare,
+    .connect = bemfa_tcp_connect,
+    .close = bemfa_tcp_close,
+    .subscribe = bemfa_tcp_subscribe,
+    .publish = bemfa_tcp_publish,
+    .poll = bemfa_tcp_poll,
+    .wake = bemfa_tcp_wake,
+};
@@ -0,0 +1,51 @@
+#ifndef __BEMFA_TRANSPORT_H__
+#define __BEMFA_TRANSPORT_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "bemfa.h"
+#include "pub_queue.h"
+
+/*
+ * 巴法云的连接方式：TCP 文本协议（cmd=...）或 MQTT，由 menuconfig 选择
+ * bemfa.c 的会话状态机只通过这组接口收发，除 wake 外所有函数都在 bemfa 任务中调用，
+ * 回调也只在 bemfa 任务中（connect/subscribe/poll 内部）触发。
+ */
+
+// 收到订阅主题的消息，msg 以 '\0' 结尾
+typedef void (*bemfa_transport_rx_cb_t)(const char *topic, size_t topic_len, const char *msg, size_t msg_len);
+// 收到一条发布应答，应答按发送顺序返回；ok 为 false 表示服务器拒绝了这条消息
+typedef void (*bemfa_transport_ack_cb_t)(bool ok);
+
+typedef struct {
+    const char *uid;                    // 巴法云私钥
+    bemfa_transport_rx_cb_t rx_cb;
+    bemfa_transport_ack_cb_t ack_cb;
+    bemfa_session_stats_t *stats;       // 连接和心跳相关的统计由传输层更新
+} bemfa_transport_config_t;
+
+typedef struct {
+    const char *name;
+    int device_type;                    // deviceAddTopic 的 type：1 MQTT 设备云，3 TCP 设备云
+
+    int (*init)(const bemfa_transport_config_t *config);
+    // 新会话开始前调用，可为空；在 addTopic 的 HTTP 请求期间预取 DNS 等
+    int (*prepare)(void);
+    int (*connect)(int timeout_ms);
+    void (*close)(void);
+    // 订阅一批主题并等待应答
+    int (*subscribe)(const char *const *topics, int count, int timeout_ms);
+    // 发送 count 条消息（不超过 BEMFA_PUB_WINDOW），要么全部交给网络，要么返回 -1
+    int (*publish)(const pub_msg_t *msgs, int count);
+    // 最多等待 timeout_ms 处理收到的数据和心跳，连接失效返回 -1
+    int (*poll)(int timeout_ms);
+    // 其他任务投递了待发消息，让 poll 提前返回
+    void (*wake)(void);
+} bemfa_transport_t;
+
+extern const bemfa_transport_t bemfa_transport_tcp;
+extern const bemfa_transport_t bemfa_transport_mqtt;
+
+#endif
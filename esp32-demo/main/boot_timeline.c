@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "boot_timeline.h"
+
+static const char *TAG = "boot_timeline.c";
+
+static boot_phase_t g_boot_phases[BOOT_TIMELINE_MAX];
+static int g_boot_phase_cnt = 0;
+static portMUX_TYPE g_boot_timeline_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void boot_timeline_mark(const char *phase)
+{
+    int64_t now = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&g_boot_timeline_lock);
+    for (int i = 0; i < g_boot_phase_cnt; i++) {
+        if (strcmp(g_boot_phases[i].phase, phase) == 0) {
+            taskEXIT_CRITICAL(&g_boot_timeline_lock);
+            return;
+        }
+    }
+    if (g_boot_phase_cnt < BOOT_TIMELINE_MAX) {
+        g_boot_phases[g_boot_phase_cnt].phase = phase;
+        g_boot_phases[g_boot_phase_cnt].time_us = now;
+        g_boot_phase_cnt++;
+    }
+    taskEXIT_CRITICAL(&g_boot_timeline_lock);
+}
+
+int boot_timeline_get(boot_phase_t *phases, int max)
+{
+    int cnt = 0;
+
+    taskENTER_CRITICAL(&g_boot_timeline_lock);
+    cnt = g_boot_phase_cnt < max ? g_boot_phase_cnt : max;
+    memcpy(phases, g_boot_phases, cnt * sizeof(boot_phase_t));
+    taskEXIT_CRITICAL(&g_boot_timeline_lock);
+
+    return cnt;
+}
+
+int boot_timeline_format(char *buf, size_t size)
+{
+    boot_phase_t phases[BOOT_TIMELINE_MAX];
+    int cnt = boot_timeline_get(phases, BOOT_TIMELINE_MAX);
+    int64_t prev = 0;
+    int len = 0;
+
+    buf[0] = '\0';
+    for (int i = 0; i < cnt && len < size; i++) {
+        len += snprintf(buf + len, size - len, "%8lld.%03lld ms  +%6lld.%03lld ms  %s\n",
+                phases[i].time_us / 1000, phases[i].time_us % 1000,
+                (phases[i].time_us - prev) / 1000, (phases[i].time_us - prev) % 1000,
+                phases[i].phase);
+        prev = phases[i].time_us;
+    }
+
+    return len < size ? len : size - 1;
+}
+
+void boot_timeline_dump(void)
+{
+    boot_phase_t phases[BOOT_TIMELINE_MAX];
+    int cnt = boot_timeline_get(phases, BOOT_TIMELINE_MAX);
+    int64_t prev = 0;
+
+    ESP_LOGI(TAG, "Boot timeline:");
+    for (int i = 0; i < cnt; i++) {
+        ESP_LOGI(TAG, "%8lld us  +%8lld us  %s", phases[i].time_us, phases[i].time_us - prev, phases[i].phase);
+        prev = phases[i].time_us;
+    }
+}
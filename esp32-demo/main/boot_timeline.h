@@ -0,0 +1,27 @@
+#ifndef __BOOT_TIMELINE_H__
+#define __BOOT_TIMELINE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * 启动阶段时间线
+ * 各模块在关键节点调用 boot_timeline_mark()，记录自上电以来的时间，
+ * 同名阶段只记录第一次，用于对比不同版本的启动耗时。
+ */
+
+#define BOOT_TIMELINE_MAX   24
+
+typedef struct {
+    const char *phase;      // 必须是常量字符串
+    int64_t time_us;
+} boot_phase_t;
+
+void boot_timeline_mark(const char *phase);
+// 返回已记录的阶段数
+int boot_timeline_get(boot_phase_t *phases, int max);
+// 格式化为文本，返回写入的长度
+int boot_timeline_format(char *buf, size_t size);
+void boot_timeline_dump(void);
+
+#endif
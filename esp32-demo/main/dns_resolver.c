@@ -0,0 +1,336 @@
+#include <stdio.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <lwip/netdb.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "lwip/sockets.h"
+
+#include "protocol.h"
+
+static const char *TAG = "dns_resolver.c";
+
+/*
+ * 异步 DNS 解析
+ * 查询在独立的 dns_resolver 任务中执行，结果按域名缓存 DNS_CACHE_TTL_MS，失败结果缓存 DNS_NEGATIVE_TTL_MS；
+ * 同一域名正在查询时新的请求只挂到等待列表上，不重复查询。
+ * getaddrinfo 不返回记录的 TTL，这里的 TTL 是上限，lwIP 自身的 DNS 表仍按记录的 TTL 过期。
+ */
+#define DNS_ENTRY_EMPTY     0
+#define DNS_ENTRY_PENDING   1
+#define DNS_ENTRY_VALID     2
+#define DNS_ENTRY_FAILED    3
+
+typedef struct {
+    dns_resolve_cb_t cb;
+    void *arg;
+} dns_waiter_t;
+
+typedef struct {
+    char host[DNS_HOST_MAX_LEN];
+    int state;
+    int err;
+    int64_t expire_us;
+    int64_t last_used_us;
+    dns_result_t result;
+    dns_waiter_t waiters[DNS_MAX_WAITERS];
+    int waiter_cnt;
+} dns_cache_entry_t;
+
+typedef struct {
+    SemaphoreHandle_t sem;
+    int err;
+    dns_result_t *result;
+} dns_sync_t;
+
+static dns_cache_entry_t g_dns_cache[DNS_CACHE_SIZE];
+static dns_stats_t g_dns_stats;
+static SemaphoreHandle_t g_dns_lock = NULL;
+static QueueHandle_t g_dns_queue = NULL;
+
+static int dns_getaddrinfo(const char *hostname, dns_result_t *result)
+{
+    struct addrinfo hints = {0};
+    struct addrinfo *res = NULL;
+
+    // lwIP 每次只返回一个地址（优先 IPv4），Linux 下会返回全部地址
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    int err = getaddrinfo(hostname, NULL, &hints, &res);
+    if (err != 0 || res == NULL) {
+        ESP_LOGE(TAG, "DNS lookup failed: %s, err:%d", hostname, err);
+        return -1;
+    }
+
+    memset(result, 0, sizeof(dns_result_t));
+    for (struct addrinfo *ai = res; ai && result->count < DNS_MAX_ADDRS; ai = ai->ai_next) {
+        if (ai->ai_family != AF_INET && ai->ai_family != AF_INET6) {
+            continue;
+        }
+        if (ai->ai_addrlen > sizeof(struct sockaddr_storage)) {
+            continue;
+        }
+        memcpy(&result->addrs[result->count++], ai->ai_addr, ai->ai_addrlen);
+    }
+    freeaddrinfo(res);
+
+    return result->count > 0 ? 0 : -1;
+}
+
+static void dns_resolver_task(void *pvParameters)
+{
+    int idx = 0;
+    dns_result_t result;
+    dns_waiter_t waiters[DNS_MAX_WAITERS];
+    char host[DNS_HOST_MAX_LEN];
+
+    while (1) {
+        if (xQueueReceive(g_dns_queue, &idx, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        xSemaphoreTake(g_dns_lock, portMAX_DELAY);
+        snprintf(host, sizeof(host), "%s", g_dns_cache[idx].host);
+        xSemaphoreGive(g_dns_lock);
+
+        int64_t start = esp_timer_get_time();
+        int err = dns_getaddrinfo(host, &result);
+        ESP_LOGI(TAG, "DNS %s: %d address(es) in %lld us", host, err ? 0 : result.count, esp_timer_get_time() - start);
+
+        xSemaphoreTake(g_dns_lock, portMAX_DELAY);
+        dns_cache_entry_t *entry = &g_dns_cache[idx];
+        int64_t now = esp_timer_get_time();
+        entry->err = err;
+        entry->state = err ? DNS_ENTRY_FAILED : DNS_ENTRY_VALID;
+        entry->expire_us = now + (err ? DNS_NEGATIVE_TTL_MS : DNS_CACHE_TTL_MS) * 1000LL;
+        entry->last_used_us = now;
+        if (err == 0) {
+            entry->result = result;
+        } else {
+            g_dns_stats.failures++;
+        }
+        int waiter_cnt = entry->waiter_cnt;
+        memcpy(waiters, entry->waiters, sizeof(waiters));
+        entry->waiter_cnt = 0;
+        xSemaphoreGive(g_dns_lock);
+
+        // 回调不持锁，回调中可以再次发起解析
+        for (int i = 0; i < waiter_cnt; i++) {
+            waiters[i].cb(host, err, err ? NULL : &result, waiters[i].arg);
+        }
+    }
+
+    vTaskDelete(NULL);
+}
+
+int dns_resolver_init(void)
+{
+    if (g_dns_lock) {
+        return 0;
+    }
+
+    g_dns_lock = xSemaphoreCreateMutex();
+    g_dns_queue = xQueueCreate(DNS_CACHE_SIZE, sizeof(int));
+    if (g_dns_lock == NULL || g_dns_queue == NULL) {
+        return -1;
+    }
+
+    if (xTaskCreate(dns_resolver_task, "dns_resolver", 4096, NULL, 5, NULL) != pdPASS) {
+        return -1;
+    }
+
+    return 0;
+}
+
+// 调用前需持有 g_dns_lock
+static dns_cache_entry_t *dns_cache_find(const char *hostname)
+{
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        if (g_dns_cache[i].state != DNS_ENTRY_EMPTY && strcmp(g_dns_cache[i].host, hostname) == 0) {
+            return &g_dns_cache[i];
+        }
+    }
+
+    return NULL;
+}
+
+// 调用前需持有 g_dns_lock，正在查询的条目不会被替换
+static dns_cache_entry_t *dns_cache_victim(void)
+{
+    dns_cache_entry_t *victim = NULL;
+
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        dns_cache_entry_t *entry = &g_dns_cache[i];
+        if (entry->state == DNS_ENTRY_EMPTY) {
+            return entry;
+        }
+        if (entry->state != DNS_ENTRY_PENDING && (victim == NULL || entry->last_used_us < victim->last_used_us)) {
+            victim = entry;
+        }
+    }
+
+    return victim;
+}
+
+int dns_resolve_async(const char *hostname, dns_resolve_cb_t cb, void *arg)
+{
+    dns_result_t result;
+
+    if (g_dns_lock == NULL || strlen(hostname) >= DNS_HOST_MAX_LEN) {
+        return -1;
+    }
+
+    xSemaphoreTake(g_dns_lock, portMAX_DELAY);
+    int64_t now = esp_timer_get_time();
+    dns_cache_entry_t *entry = dns_cache_find(hostname);
+
+    if (entry && entry->state != DNS_ENTRY_PENDING && entry->expire_us > now) {
+        int err = entry->err;
+        result = entry->result;
+        entry->last_used_us = now;
+        g_dns_stats.hits++;
+        xSemaphoreGive(g_dns_lock);
+
+        if (cb) {
+            cb(hostname, err, err ? NULL : &result, arg);
+        }
+        return 1;
+    }
+
+    if (entry && entry->state == DNS_ENTRY_PENDING) {
+        g_dns_stats.coalesced++;
+    } else {
+        if (entry == NULL) {
+            entry = dns_cache_victim();
+            if (entry == NULL) {
+                xSemaphoreGive(g_dns_lock);
+                return -1;
+            }
+            snprintf(entry->host, sizeof(entry->host), "%s", hostname);
+        }
+        entry->state = DNS_ENTRY_PENDING;
+        entry->waiter_cnt = 0;
+        g_dns_stats.lookups++;
+
+        int idx = entry - g_dns_cache;
+        xQueueSend(g_dns_queue, &idx, 0);
+    }
+
+    if (cb) {
+        if (entry->waiter_cnt >= DNS_MAX_WAITERS) {
+            xSemaphoreGive(g_dns_lock);
+            return -1;
+        }
+        entry->waiters[entry->waiter_cnt].cb = cb;
+        entry->waiters[entry->waiter_cnt].arg = arg;
+        entry->waiter_cnt++;
+    }
+    xSemaphoreGive(g_dns_lock);
+
+    return 0;
+}
+
+// 取消尚未回调的请求，返回 0 表示已取消，-1 表示回调已经开始
+static int dns_resolve_cancel(const char *hostname, dns_resolve_cb_t cb, void *arg)
+{
+    int ret = -1;
+
+    xSemaphoreTake(g_dns_lock, portMAX_DELAY);
+    dns_cache_entry_t *entry = dns_cache_find(hostname);
+    if (entry) {
+        for (int i = 0; i < entry->waiter_cnt; i++) {
+            if (entry->waiters[i].cb == cb && entry->waiters[i].arg == arg) {
+                entry->waiters[i] = entry->waiters[--entry->waiter_cnt];
+                ret = 0;
+                break;
+            }
+        }
+    }
+    xSemaphoreGive(g_dns_lock);
+
+    return ret;
+}
+
+static void dns_sync_cb(const char *hostname, int err, const dns_result_t *result, void *arg)
+{
+    dns_sync_t *sync = (dns_sync_t *)arg;
+
+    sync->err = err;
+    if (err == 0) {
+        *sync->result = *result;
+    }
+    xSemaphoreGive(sync->sem);
+}
+
+int dns_resolve(const char *hostname, dns_result_t *result, int timeout_ms)
+{
+    StaticSemaphore_t sem_buf;
+    dns_sync_t sync = {
+        .sem = xSemaphoreCreateBinaryStatic(&sem_buf),
+        .err = -1,
+        .result = result,
+    };
+
+    if (dns_resolve_async(hostname, dns_sync_cb, &sync) < 0) {
+        return -1;
+    }
+
+    if (xSemaphoreTake(sync.sem, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        if (dns_resolve_cancel(hostname, dns_sync_cb, &sync) == 0) {
+            ESP_LOGE(TAG, "DNS lookup timeout: %s", hostname);
+            return -1;
+        }
+        // 回调已经开始，等它完成后才能返回，sync 在栈上
+        xSemaphoreTake(sync.sem, portMAX_DELAY);
+    }
+
+    return sync.err;
+}
+
+void dns_cache_invalidate(const char *hostname)
+{
+    if (g_dns_lock == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(g_dns_lock, portMAX_DELAY);
+    dns_cache_entry_t *entry = dns_cache_find(hostname);
+    if (entry && entry->state != DNS_ENTRY_PENDING) {
+        entry->expire_us = 0;
+    }
+    xSemaphoreGive(g_dns_lock);
+}
+
+int dns_get_stats(dns_stats_t *stats)
+{
+    if (g_dns_lock == NULL) {
+        return -1;
+    }
+
+    xSemaphoreTake(g_dns_lock, portMAX_DELAY);
+    *stats = g_dns_stats;
+    xSemaphoreGive(g_dns_lock);
+
+    return 0;
+}
+
+int dns_addr_to_str(const struct sockaddr_storage *addr, char *buf, size_t len)
+{
+    const void *src = NULL;
+
+    if (addr->ss_family == AF_INET) {
+        src = &((const struct sockaddr_in *)addr)->sin_addr;
+    } else if (addr->ss_family == AF_INET6) {
+        src = &((const struct sockaddr_in6 *)addr)->sin6_addr;
+    } else {
+        return -1;
+    }
+
+    return inet_ntop(addr->ss_family, src, buf, len) ? 0 : -1;
+}
@@ -0,0 +1,25 @@
+#ifndef __HTTP_ASSETS_H__
+#define __HTTP_ASSETS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * 网页资源表，由 tools/gen_assets.py 在构建时从 main/www 生成
+ * 固件内置的 g_http_assets[] 只是没有 assets 分区时的后备，asset_fs_find() 查到的资源也用这个结构
+ * 资源已预先 gzip 压缩，etag 是发送内容的哈希，固件不变则 etag 不变
+ */
+
+typedef struct {
+    const char *uri;            // 如 "/index.html"
+    const char *mime;
+    const char *etag;           // 带双引号的强 ETag
+    const uint8_t *data;
+    uint32_t len;
+    bool gzip;                  // data 是否为 gzip 压缩后的内容
+} http_asset_t;
+
+extern const http_asset_t g_http_assets[];
+extern const int g_http_assets_count;
+
+#endif
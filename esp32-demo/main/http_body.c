@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <sys/param.h>
+
+#include "esp_log.h"
+#include <esp_http_server.h>
+
+#include "http_body.h"
+
+static const char *TAG = "http_body.c";
+
+#define HTTP_BODY_RECV_RETRY    3       // 读超时的重试次数，每次等待 recv_wait_timeout
+
+_Static_assert(HTTP_BODY_POOL_CHUNKS <= 32, "pool bitmap is 32 bits");
+
+static char g_body_pool[HTTP_BODY_POOL_CHUNKS][HTTP_BODY_CHUNK_SIZE];
+static uint32_t g_body_pool_used = 0;       // 每位对应一块缓冲区
+static http_body_stats_t g_body_stats;
+
+static char *http_body_chunk_get(void)
+{
+    uint32_t used = __atomic_load_n(&g_body_pool_used, __ATOMIC_RELAXED);
+
+    for (;;) {
+        int index = __builtin_ffs(~used) - 1;
+        if (index < 0 || index >= HTTP_BODY_POOL_CHUNKS) {
+            return NULL;
+        }
+        if (__atomic_compare_exchange_n(&g_body_pool_used, &used, used | (1u << index),
+                                        false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            uint32_t in_use = __builtin_popcount(used) + 1;
+            if (in_use > g_body_stats.pool_peak) {
+                g_body_stats.pool_peak = in_use;
+            }
+            return g_body_pool[index];
+        }
+    }
+}
+
+static void http_body_chunk_put(char *chunk)
+{
+    int index = (chunk - g_body_pool[0]) / HTTP_BODY_CHUNK_SIZE;
+
+    __atomic_fetch_and(&g_body_pool_used, ~(1u << index), __ATOMIC_RELEASE);
+}
+
+// 客户端可能还在发送请求体，回复后关闭连接，不再读完剩余数据
+static esp_err_t http_body_reject(httpd_req_t *req, const char *status, const char *msg)
+{
+    httpd_resp_set_status(req, status);
+    httpd_resp_set_type(req, "text/plain");
+    httpd_resp_set_hdr(req, "Connection", "close");
+    httpd_resp_send(req, msg, HTTPD_RESP_USE_STRLEN);
+
+    return ESP_FAIL;
+}
+
+static int http_body_recv(httpd_req_t *req, char *buf, size_t len)
+{
+    int ret;
+
+    for (int retry = 0; retry < HTTP_BODY_RECV_RETRY; retry++) {
+        ret = httpd_req_recv(req, buf, len);
+        if (ret != HTTPD_SOCK_ERR_TIMEOUT) {
+            return ret;
+        }
+    }
+
+    return HTTPD_SOCK_ERR_TIMEOUT;
+}
+
+esp_err_t http_body_handler(httpd_req_t *req)
+{
+    const http_body_route_t *route = req->user_ctx;
+    size_t off = 0;
+    char *chunk;
+    int ret;
+
+    g_body_stats.requests++;
+
+    if (route->max_len && req->content_len > route->max_len) {
+        ESP_LOGW(TAG, "%s body too large: %u > %u", req->uri,
+                 (unsigned int)req->content_len, (unsigned int)route->max_len);
+        g_body_stats.too_large++;
+        return http_body_reject(req, "413 Payload Too Large", "Payload Too Large");
+    }
+
+    chunk = http_body_chunk_get();
+    if (!chunk) {
+        g_body_stats.busy++;
+        return http_body_reject(req, "503 Service Unavailable", "Busy");
+    }
+
+    while (off < req->content_len) {
+        ret = http_body_recv(req, chunk, MIN(req->content_len - off, HTTP_BODY_CHUNK_SIZE));
+        if (ret <= 0) {
+            // 响应还没开始发送时才能回复 408
+            if (ret == HTTPD_SOCK_ERR_TIMEOUT && off == 0) {
+                httpd_resp_send_408(req);
+            }
+            ESP_LOGW(TAG, "%s recv fail at %u/%u, ret:%d", req->uri,
+                     (unsigned int)off, (unsigned int)req->content_len, ret);
+            goto abort;
+        }
+
+        if (route->on_chunk(req, off, chunk, ret) != 0) {
+            goto abort;
+        }
+        off += ret;
+        g_body_stats.bytes += ret;
+    }
+
+    http_body_chunk_put(chunk);
+
+    return route->on_chunk(req, off, NULL, 0) == 0 ? ESP_OK : ESP_FAIL;
+
+abort:
+    g_body_stats.aborted++;
+    http_body_chunk_put(chunk);
+    return ESP_FAIL;
+}
+
+void http_body_get_stats(http_body_stats_t *stats)
+{
+    *stats = g_body_stats;
+}
@@ -0,0 +1,40 @@
+#ifndef __HTTP_BODY_H__
+#define __HTTP_BODY_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_http_server.h>
+
+/*
+ * 流式读取 POST 请求体
+ * 请求体按 HTTP_BODY_CHUNK_SIZE 分块读入池中的缓冲区，每块交给路由的 on_chunk 处理后再读下一块，
+ * on_chunk 同步发送响应（httpd_resp_send_chunk）时发送阻塞就不再读 socket，由 TCP 窗口向客户端施加背压。
+ * 每个请求只占用一块缓冲区，与请求体大小无关。
+ *
+ * 路由注册为 { .method = HTTP_POST, .handler = http_body_handler, .user_ctx = &route }
+ */
+
+#define HTTP_BODY_CHUNK_SIZE    1024
+#define HTTP_BODY_POOL_CHUNKS   2       // httpd 单任务处理请求，1 块够用，多留 1 块给异步处理
+
+typedef struct {
+    size_t max_len;             // 请求体上限，超过直接回复 413 并关闭连接，0 表示不限制
+    // 每块调用一次，off 为该块在请求体中的偏移；最后以 data = NULL、len = 0 调用一次表示结束
+    // 返回 -1 中止请求并关闭连接
+    int (*on_chunk)(httpd_req_t *req, size_t off, const char *data, size_t len);
+} http_body_route_t;
+
+typedef struct {
+    uint32_t requests;
+    uint32_t bytes;
+    uint32_t too_large;         // 回复 413 的请求数
+    uint32_t busy;              // 缓冲区用尽回复 503 的请求数
+    uint32_t aborted;           // 超时、断开或 on_chunk 中止的请求数
+    uint32_t pool_peak;         // 同时使用的缓冲区数的峰值
+} http_body_stats_t;
+
+esp_err_t http_body_handler(httpd_req_t *req);
+
+void http_body_get_stats(http_body_stats_t *stats);
+
+#endif
@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <esp_http_server.h>
+#include "lwip/sockets.h"
+
+#include "http_ws.h"
+
+#if !CONFIG_HTTPD_WS_SUPPORT
+#error "http_ws.c requires CONFIG_HTTPD_WS_SUPPORT"
+#endif
+
+static const char *TAG = "http_ws.c";
+
+#define HTTP_WS_FRAME_MAX       (HTTP_WS_PAYLOAD_MAX + 4)
+
+static httpd_handle_t g_ws_server = NULL;
+static int g_ws_fds[HTTP_WS_MAX_CLIENTS];   // 客户端 socket，-1 为空闲；只在 httpd 任务中访问
+static http_ws_stats_t g_ws_stats;
+
+/*
+ * 三个帧缓冲区轮换：httpd 任务发送其中一个，一个等待发送，第三个留给广播方组帧。
+ * 广播方之间用互斥量串行，帧在临界区外组好，临界区内只交换缓冲区下标
+ */
+#define HTTP_WS_FRAME_BUFS      3
+#define HTTP_WS_BUF_NONE        -1
+
+static SemaphoreHandle_t g_ws_build_lock = NULL;
+static StaticSemaphore_t g_ws_build_lock_buf;
+static portMUX_TYPE g_ws_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t g_ws_frames[HTTP_WS_FRAME_BUFS][HTTP_WS_FRAME_MAX];
+static size_t g_ws_frame_len[HTTP_WS_FRAME_BUFS];
+static int64_t g_ws_frame_us[HTTP_WS_FRAME_BUFS];
+static int g_ws_pending = HTTP_WS_BUF_NONE;     // 等待发送的缓冲区
+static int g_ws_sending = HTTP_WS_BUF_NONE;     // httpd 任务正在发送的缓冲区
+static bool g_ws_work_queued = false;
+
+static void http_ws_remove(int fd)
+{
+    for (int i = 0; i < HTTP_WS_MAX_CLIENTS; i++) {
+        if (g_ws_fds[i] == fd) {
+            g_ws_fds[i] = -1;
+            g_ws_stats.clients--;
+        }
+    }
+}
+
+// socket 关闭后 fd 可能被普通 HTTP 连接复用，发送前确认仍是 WebSocket 连接
+static void http_ws_purge(void)
+{
+    for (int i = 0; i < HTTP_WS_MAX_CLIENTS; i++) {
+        if (g_ws_fds[i] >= 0 && httpd_ws_get_fd_info(g_ws_server, g_ws_fds[i]) != HTTPD_WS_CLIENT_WEBSOCKET) {
+            g_ws_fds[i] = -1;
+            g_ws_stats.clients--;
+        }
+    }
+}
+
+static int http_ws_add(int fd)
+{
+    http_ws_purge();
+    for (int i = 0; i < HTTP_WS_MAX_CLIENTS; i++) {
+        if (g_ws_fds[i] < 0) {
+            g_ws_fds[i] = fd;
+            g_ws_stats.clients++;
+            g_ws_stats.accepted++;
+            return 0;
+        }
+    }
+
+    g_ws_stats.rejected++;
+    return -1;
+}
+
+static void http_ws_send_work(void *arg)
+{
+    int idx;
+
+    taskENTER_CRITICAL(&g_ws_lock);
+    idx = g_ws_pending;
+    g_ws_pending = HTTP_WS_BUF_NONE;
+    g_ws_sending = idx;
+    g_ws_work_queued = false;
+    taskEXIT_CRITICAL(&g_ws_lock);
+
+    if (idx == HTTP_WS_BUF_NONE) {
+        return;
+    }
+    const uint8_t *frame = g_ws_frames[idx];
+    size_t len = g_ws_frame_len[idx];
+
+    http_ws_purge();
+    for (int i = 0; i < HTTP_WS_MAX_CLIENTS; i++) {
+        int fd = g_ws_fds[i];
+        if (fd < 0) {
+            continue;
+        }
+
+        // 只发出一部分的帧无法补发，连接必须断开
+        if (send(fd, frame, len, MSG_DONTWAIT) != (int)len) {
+            ESP_LOGW(TAG, "Drop slow client fd:%d, errno:%d", fd, errno);
+            g_ws_fds[i] = -1;
+            g_ws_stats.clients--;
+            g_ws_stats.dropped++;
+            httpd_sess_trigger_close(g_ws_server, fd);
+            continue;
+        }
+        g_ws_stats.frames_sent++;
+    }
+
+    g_ws_stats.broadcasts++;
+    g_ws_stats.last_fanout_us = esp_timer_get_time() - g_ws_frame_us[idx];
+
+    taskENTER_CRITICAL(&g_ws_lock);
+    g_ws_sending = HTTP_WS_BUF_NONE;
+    taskEXIT_CRITICAL(&g_ws_lock);
+}
+
+int http_ws_broadcast(const char *payload, size_t len)
+{
+    bool queue_work;
+    int idx = 0;
+
+    if (!g_ws_server || len > HTTP_WS_PAYLOAD_MAX) {
+        return -1;
+    }
+
+    xSemaphoreTake(g_ws_build_lock, portMAX_DELAY);
+
+    // 另外两个缓冲区可能在等待或发送中，只有这里会把缓冲区变为等待
+    taskENTER_CRITICAL(&g_ws_lock);
+    while (idx == g_ws_pending || idx == g_ws_sending) {
+        idx++;
+    }
+    taskEXIT_CRITICAL(&g_ws_lock);
+
+    // 服务器发出的帧不加掩码：FIN + 文本帧，长度 < 126 用 1 字节，否则 126 + 2 字节
+    uint8_t *frame = g_ws_frames[idx];
+    size_t head = 2;
+    frame[0] = 0x81;
+    if (len < 126) {
+        frame[1] = len;
+    } else {
+        frame[1] = 126;
+        frame[2] = len >> 8;
+        frame[3] = len & 0xFF;
+        head = 4;
+    }
+    memcpy(frame + head, payload, len);
+    g_ws_frame_len[idx] = head + len;
+    g_ws_frame_us[idx] = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&g_ws_lock);
+    g_ws_pending = idx;
+    queue_work = !g_ws_work_queued;
+    g_ws_work_queued = true;
+    if (!queue_work) {
+        g_ws_stats.coalesced++;
+    }
+    taskEXIT_CRITICAL(&g_ws_lock);
+
+    xSemaphoreGive(g_ws_build_lock);
+
+    if (queue_work && httpd_queue_work(g_ws_server, http_ws_send_work, NULL) != ESP_OK) {
+        taskENTER_CRITICAL(&g_ws_lock);
+        g_ws_work_queued = false;
+        taskEXIT_CRITICAL(&g_ws_lock);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * 握手请求时登记客户端；之后收到的数据帧只读出丢弃，ping/close 由 httpd 处理
+ */
+static esp_err_t http_ws_handler(httpd_req_t *req)
+{
+    int fd = httpd_req_to_sockfd(req);
+    httpd_ws_frame_t frame;
+    uint8_t buf[HTTP_WS_RX_MAX];
+
+    if (req->method == HTTP_GET) {
+        if (http_ws_add(fd) != 0) {
+            ESP_LOGW(TAG, "Too many clients, reject fd:%d", fd);
+            return ESP_FAIL;
+        }
+        ESP_LOGI(TAG, "Client connected fd:%d, %d clients", fd, (int)g_ws_stats.clients);
+        return ESP_OK;
+    }
+
+    memset(&frame, 0, sizeof(frame));
+    if (httpd_ws_recv_frame(req, &frame, 0) != ESP_OK || frame.len > sizeof(buf)) {
+        http_ws_remove(fd);
+        return ESP_FAIL;
+    }
+    frame.payload = buf;
+    if (frame.len > 0 && httpd_ws_recv_frame(req, &frame, sizeof(buf)) != ESP_OK) {
+        http_ws_remove(fd);
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
+int http_ws_register(httpd_handle_t server)
+{
+    const httpd_uri_t ws = {
+        .uri          = HTTP_WS_URI,
+        .method       = HTTP_GET,
+        .handler      = http_ws_handler,
+        .user_ctx     = NULL,
+        .is_websocket = true,
+    };
+
+    for (int i = 0; i < HTTP_WS_MAX_CLIENTS; i++) {
+        g_ws_fds[i] = -1;
+    }
+    if (g_ws_build_lock == NULL) {
+        g_ws_build_lock = xSemaphoreCreateMutexStatic(&g_ws_build_lock_buf);
+    }
+    g_ws_server = server;
+
+    if (httpd_register_uri_handler(server, &ws) != ESP_OK) {
+        ESP_LOGW(TAG, "register uri failed for %s", HTTP_WS_URI);
+        g_ws_server = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+void http_ws_get_stats(http_ws_stats_t *stats)
+{
+    *stats = g_ws_stats;
+}
@@ -0,0 +1,41 @@
+#ifndef __HTTP_WS_H__
+#define __HTTP_WS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_http_server.h>
+
+/*
+ * WebSocket 推送通道 /ws
+ * 客户端连接后先 GET /api/state 取完整状态，之后只收到变化的字段。
+ * 每次广播只序列化一次完整的 WebSocket 帧，在 httpd 任务中用非阻塞 send 逐个发给客户端；
+ * 发送缓冲区满（发不完整个帧）的客户端直接断开，不让慢客户端拖住其他客户端和 httpd 任务。
+ * 排队期间的多次广播只发送最新的一次。
+ */
+
+#define HTTP_WS_URI             "/ws"
+#ifndef HTTP_WS_MAX_CLIENTS
+#define HTTP_WS_MAX_CLIENTS     4
+#endif
+#define HTTP_WS_PAYLOAD_MAX     240     // 广播内容上限，帧头最多 4 字节
+#define HTTP_WS_RX_MAX          128     // 客户端消息上限，超过断开
+
+typedef struct {
+    uint32_t clients;           // 当前连接数
+    uint32_t accepted;
+    uint32_t rejected;          // 连接数已满被拒绝的次数
+    uint32_t broadcasts;        // 实际发出的广播次数
+    uint32_t coalesced;         // 排队期间被新内容覆盖的广播次数
+    uint32_t frames_sent;
+    uint32_t dropped;           // 发送失败或太慢被断开的客户端数
+    int64_t last_fanout_us;     // 最近一次从调用 http_ws_broadcast 到发完所有客户端的时间
+} http_ws_stats_t;
+
+int http_ws_register(httpd_handle_t server);
+
+// 任意任务可调用（不能在中断中调用），内容复制后立即返回；payload 为文本
+int http_ws_broadcast(const char *payload, size_t len);
+
+void http_ws_get_stats(http_ws_stats_t *stats);
+
+#endif
@@ -0,0 +1,517 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "json_extract.h"
+
+enum {
+    JS_VALUE = 0,       // 等待一个值
+    JS_ARRAY_FIRST,     // '[' 之后，等待值或 ']'
+    JS_OBJECT_FIRST,    // '{' 之后，等待 key 或 '}'
+    JS_OBJECT_KEY,      // ',' 之后，等待 key
+    JS_COLON,
+    JS_AFTER_VALUE,
+    JS_STRING,
+    JS_STRING_ESCAPE,
+    JS_STRING_UNICODE,
+    JS_SCALAR,          // 数字或 true/false/null
+    JS_DONE,
+};
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+void json_extract_init(json_extract_t *ctx, json_field_t *fields, int field_cnt)
+{
+    memset(ctx, 0, sizeof(json_extract_t));
+    ctx->fields = fields;
+    ctx->field_cnt = field_cnt;
+    ctx->state = JS_VALUE;
+
+    for (int i = 0; i < field_cnt; i++) {
+        fields[i].found = false;
+        fields[i].truncated = false;
+        fields[i].value = 0;
+        fields[i].len = 0;
+        if (fields[i].buf && fields[i].buf_size > 0) {
+            fields[i].buf[0] = '\0';
+        }
+    }
+}
+
+static json_field_t *match_field(json_extract_t *ctx)
+{
+    if (ctx->skip_depth || ctx->array_depth) {
+        return NULL;
+    }
+
+    for (int i = 0; i < ctx->field_cnt; i++) {
+        if (strcmp(ctx->fields[i].path, ctx->path) == 0) {
+            return &ctx->fields[i];
+        }
+    }
+
+    return NULL;
+}
+
+// 把 key 临时拼接到当前路径后面，值是对象时由 push 保留
+static void path_append_key(json_extract_t *ctx)
+{
+    size_t base = ctx->path_len[ctx->depth];
+    size_t need = base + (base ? 1 : 0) + ctx->key_len;
+
+    ctx->path[base] = '\0';
+    ctx->key_appended = false;
+    if (ctx->key_overflow || need >= sizeof(ctx->path)) {
+        ctx->target = NULL;
+        return;
+    }
+
+    if (base) {
+        ctx->path[base++] = '.';
+    }
+    memcpy(ctx->path + base, ctx->key, ctx->key_len);
+    ctx->path[need] = '\0';
+    ctx->key_appended = true;
+
+    ctx->target = match_field(ctx);
+}
+
+static int push(json_extract_t *ctx, bool array)
+{
+    if (ctx->depth >= JSON_EXTRACT_DEPTH_MAX) {
+        return -1;
+    }
+
+    // 对象成员的 key 过长未能拼进路径时，其下全部跳过；数组元素没有 key，沿用数组的路径
+    if (ctx->depth > 0 && !ctx->is_array[ctx->depth] && !ctx->key_appended && ctx->skip_depth == 0) {
+        ctx->skip_depth = ctx->depth + 1;
+    }
+
+    size_t len = strlen(ctx->path);
+
+    ctx->depth++;
+    ctx->is_array[ctx->depth] = array;
+    if (array) {
+        ctx->array_depth++;
+    }
+    ctx->path_len[ctx->depth] = len;
+    ctx->target = NULL;
+
+    return 0;
+}
+
+static void pop(json_extract_t *ctx)
+{
+    if (ctx->is_array[ctx->depth]) {
+        ctx->array_depth--;
+    }
+    ctx->depth--;
+    if (ctx->skip_depth > ctx->depth) {
+        ctx->skip_depth = 0;
+    }
+    ctx->path[ctx->path_len[ctx->depth]] = '\0';
+    ctx->target = NULL;
+    ctx->state = ctx->depth == 0 ? JS_DONE : JS_AFTER_VALUE;
+}
+
+static void value_done(json_extract_t *ctx)
+{
+    ctx->path[ctx->path_len[ctx->depth]] = '\0';
+    ctx->target = NULL;
+    ctx->state = ctx->depth == 0 ? JS_DONE : JS_AFTER_VALUE;
+}
+
+// 写入一个完整的字符（1 到 4 字节），放不下时整个丢弃
+static void string_put_bytes(json_extract_t *ctx, const char *bytes, size_t n)
+{
+    if (ctx->value_is_key) {
+        if (ctx->key_len + n < sizeof(ctx->key)) {
+            memcpy(ctx->key + ctx->key_len, bytes, n);
+            ctx->key_len += n;
+        } else {
+            ctx->key_overflow = true;
+        }
+        return;
+    }
+
+    json_field_t *field = ctx->target;
+    if (field == NULL || field->type != JSON_FIELD_STR || field->buf == NULL) {
+        return;
+    }
+
+    if (field->len + n < field->buf_size) {
+        memcpy(field->buf + field->len, bytes, n);
+        field->len += n;
+        field->buf[field->len] = '\0';
+    } else {
+        field->truncated = true;
+    }
+}
+
+static void string_put(json_extract_t *ctx, char c)
+{
+    string_put_bytes(ctx, &c, 1);
+}
+
+static void string_put_utf8(json_extract_t *ctx, uint32_t cp)
+{
+    char out[4];
+    size_t n;
+
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        n = 1;
+    } else if (cp < 0x800) {
+        out[0] = (char)(0xc0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3f));
+        n = 2;
+    } else if (cp < 0x10000) {
+        out[0] = (char)(0xe0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3f));
+        out[2] = (char)(0x80 | (cp & 0x3f));
+        n = 3;
+    } else {
+        out[0] = (char)(0xf0 | (cp >> 18));
+        out[1] = (char)(0x80 | ((cp >> 12) & 0x3f));
+        out[2] = (char)(0x80 | ((cp >> 6) & 0x3f));
+        out[3] = (char)(0x80 | (cp & 0x3f));
+        n = 4;
+    }
+
+    string_put_bytes(ctx, out, n);
+}
+
+#define UNICODE_REPLACEMENT     0xFFFD
+
+// 高位代理后面没有跟着低位代理
+static void unicode_flush_high(json_extract_t *ctx)
+{
+    if (ctx->unicode_high) {
+        ctx->unicode_high = 0;
+        string_put_utf8(ctx, UNICODE_REPLACEMENT);
+    }
+}
+
+// 处理一个 \uXXXX，代理对合并成一个码点
+static void unicode_put(json_extract_t *ctx, uint32_t cp)
+{
+    if (cp >= 0xDC00 && cp <= 0xDFFF) {
+        if (ctx->unicode_high) {
+            cp = 0x10000 + ((ctx->unicode_high - 0xD800) << 10) + (cp - 0xDC00);
+            ctx->unicode_high = 0;
+        } else {
+            cp = UNICODE_REPLACEMENT;
+        }
+        string_put_utf8(ctx, cp);
+        return;
+    }
+
+    unicode_flush_high(ctx);
+    if (cp >= 0xD800 && cp <= 0xDBFF) {
+        ctx->unicode_high = cp;
+        return;
+    }
+    string_put_utf8(ctx, cp);
+}
+
+static bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+static bool is_number(const char *s)
+{
+    if (*s == '-') {
+        s++;
+    }
+    if (*s == '0') {
+        s++;
+    } else if (is_digit(*s)) {
+        while (is_digit(*s)) {
+            s++;
+        }
+    } else {
+        return false;
+    }
+
+    if (*s == '.') {
+        s++;
+        if (!is_digit(*s)) {
+            return false;
+        }
+        while (is_digit(*s)) {
+            s++;
+        }
+    }
+
+    if (*s == 'e' || *s == 'E') {
+        s++;
+        if (*s == '+' || *s == '-') {
+            s++;
+        }
+        if (!is_digit(*s)) {
+            return false;
+        }
+        while (is_digit(*s)) {
+            s++;
+        }
+    }
+
+    return *s == '\0';
+}
+
+static int scalar_done(json_extract_t *ctx)
+{
+    json_field_t *field = ctx->target;
+    const char *s = ctx->scalar;
+
+    ctx->scalar[ctx->scalar_len] = '\0';
+
+    bool number = is_number(s);
+    if (!number && strcmp(s, "true") != 0 && strcmp(s, "false") != 0 && strcmp(s, "null") != 0) {
+        return -1;
+    }
+
+    if (field) {
+        if (field->type == JSON_FIELD_INT) {
+            if (number) {
+                char *end;
+                field->value = strtol(s, &end, 10);
+                // 小数和指数形式取整数部分
+                if (*end != '\0') {
+                    double d = strtod(s, NULL);
+                    field->value = d >= LONG_MAX ? LONG_MAX : (d <= LONG_MIN ? LONG_MIN : (long)d);
+                }
+                field->found = true;
+            } else if (strcmp(s, "null") != 0) {
+                field->value = (s[0] == 't');
+                field->found = true;
+            }
+        } else if (field->buf && field->buf_size > 0) {
+            snprintf(field->buf, field->buf_size, "%s", s);
+            field->len = strlen(field->buf);
+            field->truncated = field->len < ctx->scalar_len;
+            field->found = true;
+        }
+    }
+
+    value_done(ctx);
+    return 0;
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// 处理一个字符，返回 1 表示该字符需要在新状态下重新处理
+static int feed_char(json_extract_t *ctx, char c)
+{
+    switch (ctx->state) {
+        case JS_VALUE:
+        case JS_ARRAY_FIRST:
+            if (is_space(c)) {
+                return 0;
+            }
+            if (c == ']' && ctx->state == JS_ARRAY_FIRST) {
+                pop(ctx);
+                return 0;
+            }
+            if (c == '{' || c == '[') {
+                if (push(ctx, c == '[') != 0) {
+                    return -1;
+                }
+                ctx->state = (c == '{') ? JS_OBJECT_FIRST : JS_ARRAY_FIRST;
+            } else if (c == '"') {
+                ctx->value_is_key = false;
+                if (ctx->target && ctx->target->type == JSON_FIELD_STR) {
+                    // 重复的 key 以最后一个值为准，不能接在上一个值后面
+                    json_field_t *field = ctx->target;
+                    field->found = true;
+                    field->truncated = false;
+                    field->len = 0;
+                    if (field->buf && field->buf_size > 0) {
+                        field->buf[0] = '\0';
+                    }
+                }
+                ctx->state = JS_STRING;
+            } else if (c == '-' || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z')) {
+                ctx->scalar_len = 0;
+                ctx->state = JS_SCALAR;
+                return 1;
+            } else {
+                return -1;
+            }
+            return 0;
+
+        case JS_OBJECT_FIRST:
+        case JS_OBJECT_KEY:
+            if (is_space(c)) {
+                return 0;
+            }
+            if (c == '}' && ctx->state == JS_OBJECT_FIRST) {
+                pop(ctx);
+                return 0;
+            }
+            if (c != '"') {
+                return -1;
+            }
+            ctx->key_len = 0;
+            ctx->key_overflow = false;
+            ctx->value_is_key = true;
+            ctx->state = JS_STRING;
+            return 0;
+
+        case JS_COLON:
+            if (is_space(c)) {
+                return 0;
+            }
+            if (c != ':') {
+                return -1;
+            }
+            path_append_key(ctx);
+            ctx->state = JS_VALUE;
+            return 0;
+
+        case JS_AFTER_VALUE:
+            if (is_space(c)) {
+                return 0;
+            }
+            if (c == ',') {
+                ctx->state = ctx->is_array[ctx->depth] ? JS_VALUE : JS_OBJECT_KEY;
+                return 0;
+            }
+            if ((c == '}' && !ctx->is_array[ctx->depth]) || (c == ']' && ctx->is_array[ctx->depth])) {
+                pop(ctx);
+                return 0;
+            }
+            return -1;
+
+        case JS_STRING:
+            if (c != '\\') {
+                unicode_flush_high(ctx);
+            }
+            if (c == '"') {
+                if (ctx->value_is_key) {
+                    ctx->state = JS_COLON;
+                } else {
+                    value_done(ctx);
+                }
+            } else if (c == '\\') {
+                ctx->state = JS_STRING_ESCAPE;
+            } else if ((unsigned char)c < 0x20) {
+                return -1;
+            } else {
+                string_put(ctx, c);
+            }
+            return 0;
+
+        case JS_STRING_ESCAPE: {
+            char out = 0;
+            switch (c) {
+                case '"':  out = '"';  break;
+                case '\\': out = '\\'; break;
+                case '/':  out = '/';  break;
+                case 'b':  out = '\b'; break;
+                case 'f':  out = '\f'; break;
+                case 'n':  out = '\n'; break;
+                case 'r':  out = '\r'; break;
+                case 't':  out = '\t'; break;
+                case 'u':
+                    ctx->unicode = 0;
+                    ctx->unicode_digits = 0;
+                    ctx->state = JS_STRING_UNICODE;
+                    return 0;
+                default:
+                    return -1;
+            }
+            unicode_flush_high(ctx);
+            string_put(ctx, out);
+            ctx->state = JS_STRING;
+            return 0;
+        }
+
+        case JS_STRING_UNICODE: {
+            int v = hex_value(c);
+            if (v < 0) {
+                return -1;
+            }
+            ctx->unicode = (ctx->unicode << 4) | v;
+            if (++ctx->unicode_digits == 4) {
+                unicode_put(ctx, ctx->unicode);
+                ctx->state = JS_STRING;
+            }
+            return 0;
+        }
+
+        case JS_SCALAR:
+            if (c == '-' || c == '+' || c == '.' || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == 'E') {
+                if (ctx->scalar_len + 1 >= sizeof(ctx->scalar)) {
+                    return -1;
+                }
+                ctx->scalar[ctx->scalar_len++] = c;
+                return 0;
+            }
+            if (scalar_done(ctx) != 0) {
+                return -1;
+            }
+            return 1;
+
+        case JS_DONE:
+            return is_space(c) ? 0 : -1;
+
+        default:
+            return -1;
+    }
+}
+
+int json_extract_feed(json_extract_t *ctx, const char *data, size_t len)
+{
+    if (ctx->error) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        int ret;
+        do {
+            ret = feed_char(ctx, data[i]);
+        } while (ret == 1);
+
+        if (ret < 0) {
+            ctx->error = true;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int json_extract_finish(json_extract_t *ctx)
+{
+    if (ctx->error) {
+        return -1;
+    }
+
+    // 顶层是裸数字时没有结束符，在这里收尾
+    if (ctx->state == JS_SCALAR && ctx->depth == 0) {
+        if (scalar_done(ctx) != 0) {
+            return -1;
+        }
+    }
+
+    return ctx->state == JS_DONE ? 0 : -1;
+}
@@ -0,0 +1,71 @@
+#ifndef __JSON_EXTRACT_H__
+#define __JSON_EXTRACT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * 流式 JSON 字段提取
+ * 按字节推入数据（可分多次），只取出预先登记的路径，例如 "data.code"、"ssid"。
+ * 不建树、不使用堆内存，字符串直接解码到调用方提供的缓冲区。
+ * 数组内的元素不参与匹配。\u 代理对合并为一个 UTF-8 字符，不成对的代理替换为 U+FFFD，
+ * 放不下的多字节字符整个丢弃并标记截断，不会留下半个字符。
+ */
+
+#define JSON_EXTRACT_DEPTH_MAX      8
+#define JSON_EXTRACT_PATH_MAX       64
+#define JSON_EXTRACT_KEY_MAX        32
+#define JSON_EXTRACT_SCALAR_MAX     24
+
+typedef enum {
+    JSON_FIELD_INT = 0,         // 数字，true/false 记为 1/0
+    JSON_FIELD_STR,             // 字符串，数字和字面量按原文保存
+} json_field_type_t;
+
+typedef struct {
+    const char *path;
+    json_field_type_t type;
+    char *buf;                  // JSON_FIELD_STR 的输出缓冲区
+    size_t buf_size;
+    long value;                 // JSON_FIELD_INT 的结果
+    size_t len;                 // JSON_FIELD_STR 已写入长度
+    bool found;
+    bool truncated;
+} json_field_t;
+
+typedef struct {
+    json_field_t *fields;
+    int field_cnt;
+
+    int state;
+    int depth;
+    int skip_depth;             // 路径过长的层级，其下不再匹配
+    int array_depth;            // 栈中数组的层数
+    bool is_array[JSON_EXTRACT_DEPTH_MAX + 1];
+    uint8_t path_len[JSON_EXTRACT_DEPTH_MAX + 1];
+    char path[JSON_EXTRACT_PATH_MAX];
+
+    char key[JSON_EXTRACT_KEY_MAX];
+    size_t key_len;
+    bool key_overflow;
+    bool key_appended;          // key 已拼接到 path 中
+
+    char scalar[JSON_EXTRACT_SCALAR_MAX];
+    size_t scalar_len;
+
+    json_field_t *target;       // 当前值对应的字段
+    uint32_t unicode;
+    int unicode_digits;
+    uint32_t unicode_high;      // 等待低位代理的高位代理，0 表示没有
+    bool value_is_key;          // 当前字符串是 key 还是 value
+    bool error;
+} json_extract_t;
+
+void json_extract_init(json_extract_t *ctx, json_field_t *fields, int field_cnt);
+// 返回 0 成功，-1 语法错误（之后的数据被忽略）
+int json_extract_feed(json_extract_t *ctx, const char *data, size_t len);
+// 数据结束，返回 0 表示收到一个完整的 JSON 值
+int json_extract_finish(json_extract_t *ctx);
+
+#endif
@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "json_writer.h"
+
+static const char g_hex_digits[] = "0123456789abcdef";
+
+void json_writer_init(json_writer_t *w, char *buf, size_t size)
+{
+    memset(w, 0, sizeof(json_writer_t));
+    w->buf = buf;
+    w->size = size;
+    if (size > 0) {
+        buf[0] = '\0';
+    }
+}
+
+// 留一个字节给结尾的 '\0'
+static void json_put(json_writer_t *w, const char *data, size_t len)
+{
+    if (w->overflow || w->len + len >= w->size) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+}
+
+static void json_put_char(json_writer_t *w, char c)
+{
+    json_put(w, &c, 1);
+}
+
+static void json_put_string(json_writer_t *w, const char *s)
+{
+    const char *start = s;
+
+    json_put_char(w, '"');
+    for (; *s; s++) {
+        unsigned char c = *s;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+
+        // 不需要转义的部分整段复制
+        json_put(w, start, s - start);
+        start = s + 1;
+        switch (c) {
+            case '"':  json_put(w, "\\\"", 2); break;
+            case '\\': json_put(w, "\\\\", 2); break;
+            case '\n': json_put(w, "\\n", 2); break;
+            case '\r': json_put(w, "\\r", 2); break;
+            case '\t': json_put(w, "\\t", 2); break;
+            default: {
+                char esc[6] = { '\\', 'u', '0', '0', g_hex_digits[c >> 4], g_hex_digits[c & 0xF] };
+                json_put(w, esc, sizeof(esc));
+            } break;
+        }
+    }
+    json_put(w, start, s - start);
+    json_put_char(w, '"');
+}
+
+// 写出元素前的逗号和 key
+static void json_item_begin(json_writer_t *w, const char *key)
+{
+    uint32_t bit = 1u << w->depth;
+
+    if (w->has_items & bit) {
+        json_put_char(w, ',');
+    }
+    w->has_items |= bit;
+
+    if (key) {
+        json_put_string(w, key);
+        json_put_char(w, ':');
+    }
+}
+
+static void json_container_begin(json_writer_t *w, const char *key, char open)
+{
+    json_item_begin(w, key);
+    json_put_char(w, open);
+
+    if (w->depth >= JSON_WRITER_DEPTH_MAX) {
+        w->overflow = true;
+        return;
+    }
+    w->depth++;
+    w->has_items &= ~(1u << w->depth);
+}
+
+static void json_container_end(json_writer_t *w, char close)
+{
+    if (w->depth == 0) {
+        w->overflow = true;
+        return;
+    }
+    w->depth--;
+    json_put_char(w, close);
+}
+
+void json_writer_object_begin(json_writer_t *w, const char *key)
+{
+    json_container_begin(w, key, '{');
+}
+
+void json_writer_object_end(json_writer_t *w)
+{
+    json_container_end(w, '}');
+}
+
+void json_writer_array_begin(json_writer_t *w, const char *key)
+{
+    json_container_begin(w, key, '[');
+}
+
+void json_writer_array_end(json_writer_t *w)
+{
+    json_container_end(w, ']');
+}
+
+void json_writer_str(json_writer_t *w, const char *key, const char *value)
+{
+    json_item_begin(w, key);
+    json_put_string(w, value ? value : "");
+}
+
+void json_writer_int(json_writer_t *w, const char *key, long long value)
+{
+    char num[24];
+    int len = snprintf(num, sizeof(num), "%lld", value);
+
+    json_item_begin(w, key);
+    json_put(w, num, len);
+}
+
+void json_writer_bool(json_writer_t *w, const char *key, bool value)
+{
+    json_item_begin(w, key);
+    if (value) {
+        json_put(w, "true", 4);
+    } else {
+        json_put(w, "false", 5);
+    }
+}
+
+void json_writer_null(json_writer_t *w, const char *key)
+{
+    json_item_begin(w, key);
+    json_put(w, "null", 4);
+}
+
+int json_writer_finish(json_writer_t *w)
+{
+    if (w->overflow || w->depth != 0 || w->size == 0) {
+        return -1;
+    }
+    w->buf[w->len] = '\0';
+
+    return w->len;
+}
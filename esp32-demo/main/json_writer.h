@@ -0,0 +1,41 @@
+#ifndef __JSON_WRITER_H__
+#define __JSON_WRITER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * 定长缓冲区上的 JSON 输出
+ * 按调用顺序直接写出文本，不建树、不使用堆内存；逗号由写入器自动补上。
+ * 对象内的值必须带 key，数组内的值 key 传 NULL。
+ * 缓冲区不够时后续写入全部忽略，json_writer_finish() 返回 -1。
+ */
+
+#define JSON_WRITER_DEPTH_MAX   8
+
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+    int depth;
+    uint32_t has_items;         // 每位对应一层，该层已写过元素，下一个元素前需要逗号
+    bool overflow;
+} json_writer_t;
+
+void json_writer_init(json_writer_t *w, char *buf, size_t size);
+
+void json_writer_object_begin(json_writer_t *w, const char *key);
+void json_writer_object_end(json_writer_t *w);
+void json_writer_array_begin(json_writer_t *w, const char *key);
+void json_writer_array_end(json_writer_t *w);
+
+void json_writer_str(json_writer_t *w, const char *key, const char *value);
+void json_writer_int(json_writer_t *w, const char *key, long long value);
+void json_writer_bool(json_writer_t *w, const char *key, bool value);
+void json_writer_null(json_writer_t *w, const char *key);
+
+// 返回输出长度（buf 以 '\0' 结尾），溢出或括号不匹配返回 -1
+int json_writer_finish(json_writer_t *w);
+
+#endif
@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "line_framer.h"
+
+void line_framer_init(line_framer_t *framer, char *buf, size_t size, line_framer_cb_t cb, void *arg)
+{
+    memset(framer, 0, sizeof(line_framer_t));
+    framer->buf = buf;
+    framer->size = size;
+    framer->cb = cb;
+    framer->arg = arg;
+}
+
+void line_framer_reset(line_framer_t *framer)
+{
+    framer->head = 0;
+    framer->tail = 0;
+    framer->scan = 0;
+    framer->discarding = false;
+    framer->cr_pending = false;
+}
+
+char *line_framer_get_space(line_framer_t *framer, size_t *len)
+{
+    if (framer->tail == framer->size) {
+        if (framer->head > 0) {
+            // 只有残留的半包需要搬到缓冲区开头
+            size_t pending = framer->tail - framer->head;
+            memmove(framer->buf, framer->buf + framer->head, pending);
+            framer->scan -= framer->head;
+            framer->tail = pending;
+            framer->head = 0;
+        } else if (framer->buf[framer->size - 1] == '\r') {
+            // 整行正好占满缓冲区，只差 '\n'：去掉行尾 '\r'，腾出一个字节接收换行符
+            framer->tail--;
+            framer->scan = framer->tail;
+            framer->cr_pending = true;
+        } else {
+            // 整个缓冲区都放不下一行，丢弃到下一个换行符为止
+            framer->oversize_cnt++;
+            line_framer_reset(framer);
+            framer->discarding = true;
+        }
+    }
+
+    *len = framer->size - framer->tail;
+    return framer->buf + framer->tail;
+}
+
+// 以 '\0' 结尾后交给回调，空行不交付
+static int line_framer_emit(line_framer_t *framer, char *frame, size_t frame_len)
+{
+    frame[frame_len] = '\0';
+    if (frame_len == 0) {
+        return 0;
+    }
+
+    framer->frame_cnt++;
+    if (framer->cb) {
+        framer->cb(frame, frame_len, framer->arg);
+    }
+    return 1;
+}
+
+int line_framer_commit(line_framer_t *framer, size_t len)
+{
+    int frames = 0;
+
+    if (framer->cr_pending && len > 0) {
+        framer->cr_pending = false;
+        if (framer->buf[framer->tail] == '\n') {
+            // 行尾的 '\r' 已经去掉，不再检查
+            frames += line_framer_emit(framer, framer->buf + framer->head, framer->tail - framer->head);
+            framer->head = framer->tail + 1;
+        } else {
+            // '\r' 之后不是换行符，这一行超长
+            framer->oversize_cnt++;
+            framer->discarding = true;
+            framer->head = framer->tail;
+        }
+        framer->scan = framer->head;
+    }
+
+    framer->tail += len;
+
+    while (framer->scan < framer->tail) {
+        char *nl = memchr(framer->buf + framer->scan, '\n', framer->tail - framer->scan);
+        if (nl == NULL) {
+            framer->scan = framer->tail;
+            if (framer->discarding) {
+                framer->head = framer->tail;
+            }
+            break;
+        }
+
+        size_t end = nl - framer->buf;
+        if (framer->discarding) {
+            framer->discarding = false;
+        } else {
+            char *frame = framer->buf + framer->head;
+            size_t frame_len = end - framer->head;
+            if (frame_len > 0 && frame[frame_len - 1] == '\r') {
+                frame_len--;
+            }
+            frames += line_framer_emit(framer, frame, frame_len);
+        }
+
+        framer->head = end + 1;
+        framer->scan = framer->head;
+    }
+
+    if (framer->head == framer->tail) {
+        framer->head = 0;
+        framer->tail = 0;
+        framer->scan = 0;
+    }
+
+    return frames;
+}
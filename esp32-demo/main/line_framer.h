@@ -0,0 +1,40 @@
+#ifndef __LINE_FRAMER_H__
+#define __LINE_FRAMER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * 按行切分 TCP 字节流
+ * 数据直接 recv 到 framer 的缓冲区中，完整的一行（以 \r\n 或 \n 结尾）
+ * 原地去掉行尾并以 '\0' 结尾后交给回调，不做任何拷贝。
+ * 半包保留到下次 commit，一次 commit 中的多行依次回调，
+ * 一行去掉行尾后最长 size - 1 字节（留一个字节给 '\0'），更长的行被整行丢弃并计数。
+ */
+
+typedef void (*line_framer_cb_t)(char *frame, size_t len, void *arg);
+
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t head;            // 未处理数据起始位置
+    size_t tail;            // 已接收数据结束位置
+    size_t scan;            // 已查找过换行符的位置
+    bool discarding;        // 正在丢弃超长行
+    bool cr_pending;        // 缓冲区已满且以 '\r' 结尾，等待 '\n'
+    uint32_t frame_cnt;     // 已交付的行数
+    uint32_t oversize_cnt;  // 丢弃的超长行数
+    line_framer_cb_t cb;
+    void *arg;
+} line_framer_t;
+
+void line_framer_init(line_framer_t *framer, char *buf, size_t size, line_framer_cb_t cb, void *arg);
+void line_framer_reset(line_framer_t *framer);
+
+// 获取可写入的空间，返回写指针，*len 为可写长度（始终大于 0）
+char *line_framer_get_space(line_framer_t *framer, size_t *len);
+// 提交写入的 len 字节，返回本次交付的行数
+int line_framer_commit(line_framer_t *framer, size_t len);
+
+#endif
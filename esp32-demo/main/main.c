@@ -25,6 +25,9 @@
 #include "main.h"
 #include "protocol.h"
 #include "user_nvs_rw.h"
+#include "reset_counter.h"
+#include "boot_timeline.h"
+#include "wifi_reconnect.h"
 #include "user_http_client.h"
 #include "bemfa.h"
 
@@ -32,6 +35,9 @@
 
 static const char *TAG = "main.c";
 
+// 启动时打印 NVS 中的全部数据，仅调试时打开
+#define ENABLE_NVS_DUMP    0
+
 #define ENABLE_SMARTCONFIG 0
 #if ENABLE_SMARTCONFIG
 #include "esp_smartconfig.h"
@@ -57,7 +63,7 @@ static void smartconfig_task(void * parm);
 #define ESP_STA_WIFI_SSID      "ZTE-xNH5kA"
 #define ESP_STA_WIFI_PASS      "rwYwsWh1P3"
 #endif
-#define ESP_STA_MAXIMUM_RETRY  10
+#define ESP_STA_MAXIMUM_RETRY  10      // 连续失败达到该次数时上报，之后继续按退避间隔重试
 
 /* FreeRTOS event group to signal when we are connected & ready to make a request */
 static EventGroupHandle_t s_wifi_event_group;
@@ -66,10 +72,10 @@ static EventGroupHandle_t s_wifi_event_group;
 #define WIFI_FAIL_BIT                BIT1
 #define WIFI_SMARTCONFIG_DONE_BIT    BIT2
 #define SYS_RESTORE_TIMEOUT_BIT      BIT3
+#define BOOT_NET_READY_BIT           BIT4
 
 static esp_timer_handle_t system_restore_time_handle;
 
-static int s_retry_num = 0;
 static wifi_config_t g_wifi_sta_config;
 
 int g_clean_wifi_info_flag = 0;
@@ -134,6 +140,7 @@ static void event_handler(void* arg, esp_event_base_t event_base,
                  MAC2STR(event->mac), event->aid, event->reason);
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
         ESP_LOGI(TAG, "STA Start");
+        boot_timeline_mark("wifi_sta_start");
 #if ENABLE_SMARTCONFIG
         if (g_smartconfig_enable) {
             ESP_LOGI(TAG, "SmartConfig start");
@@ -146,21 +153,20 @@ static void event_handler(void* arg, esp_event_base_t event_base,
 #endif // ENABLE_SMARTCONFIG
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_STOP) {
         ESP_LOGI(TAG, "STA Stop");
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+        wifi_reconnect_on_connected((wifi_event_sta_connected_t*) event_data);
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
         g_system_status.wifi_connect_status = 0;
 
-        if (s_retry_num < ESP_STA_MAXIMUM_RETRY) {
-            esp_wifi_connect();
-            s_retry_num++;
-            ESP_LOGI(TAG, "retry to connect to the AP");
-        } else {
+        if (wifi_reconnect_on_disconnected((wifi_event_sta_disconnected_t*) event_data) == ESP_STA_MAXIMUM_RETRY) {
             xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
         }
         ESP_LOGI(TAG,"connect to the AP fail");
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
         ESP_LOGI(TAG, "got ip:" IPSTR, IP2STR(&event->ip_info.ip));
-        s_retry_num = 0;
+        boot_timeline_mark("wifi_got_ip");
+        wifi_reconnect_on_got_ip();
         xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
     }
 #if ENABLE_SMARTCONFIG
@@ -191,6 +197,7 @@ static void event_handler(void* arg, esp_event_base_t event_base,
         }
 
         ESP_ERROR_CHECK( esp_wifi_disconnect() );
+        wifi_reconnect_forget();
         ESP_ERROR_CHECK( esp_wifi_set_config(WIFI_IF_STA, &g_wifi_sta_config) );
         esp_wifi_connect();
     } else if (event_base == SC_EVENT && event_id == SC_EVENT_SEND_ACK_DONE) {
@@ -209,6 +216,7 @@ int write_wifi_info(char *ssid, char *password)
     memccpy(wifi_sta_config.sta.password, password, 0, strlen(password));
 
     ESP_ERROR_CHECK(esp_wifi_stop());
+    wifi_reconnect_forget();
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_sta_config) );
 
@@ -228,8 +236,6 @@ static int check_wifi_sta_or_ap(void)
     ESP_LOGI(TAG, "STA SSID:%s", g_wifi_sta_config.sta.ssid);
     ESP_LOGI(TAG, "STA PASSWORD:%s", g_wifi_sta_config.sta.password);
 
-    ESP_ERROR_CHECK(esp_wifi_stop());
-
 #if ESP_PREWRITE_WIFI
     ESP_LOGW(TAG, "Pre Write wifi ssid:%s pass:%s", wifi_sta_config.sta.ssid, wifi_sta_config.sta.password);
     write_wifi_info(ESP_STA_WIFI_SSID, ESP_STA_WIFI_PASS);
@@ -251,6 +257,7 @@ static int check_wifi_sta_or_ap(void)
         ESP_LOGW(TAG, "Clean wifi info, restarting...");
         ESP_ERROR_CHECK( esp_wifi_set_mode(WIFI_MODE_STA));
         ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config) );
+        user_nvs_flush();
         esp_restart();
     }
 
@@ -260,8 +267,6 @@ static int check_wifi_sta_or_ap(void)
 static void initialise_wifi(void)
 {
     int ret = 0;
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
 
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK( esp_wifi_init(&cfg) );
@@ -326,9 +331,11 @@ static void initialise_wifi(void)
         assert(esp_netif_handle);
 
         ESP_ERROR_CHECK( esp_wifi_set_mode(WIFI_MODE_STA));
+        wifi_reconnect_init();
         ESP_ERROR_CHECK( esp_wifi_start() );
         ESP_LOGI(TAG, "wifi_init_sta finished.");
     }
+    boot_timeline_mark("wifi_start");
 }
 
 #if ENABLE_SMARTCONFIG
@@ -356,7 +363,7 @@ static void system_restore_timer_callback(void* arg)
     int64_t time_since_boot = esp_timer_get_time();
     ESP_LOGI(TAG, "system_restore_timer, time since boot: %lld us", time_since_boot);
 
-    user_nvs_write_int8(NVS_NAMESPACE, NVS_RST_CNT_KEY, 1);
+    reset_counter_settle();
 
     xEventGroupSetBits(s_wifi_event_group, SYS_RESTORE_TIMEOUT_BIT);
 }
@@ -409,18 +416,57 @@ static int user_mdns_init(void)
     return 0;
 }
 
-void app_main(void)
+/*
+ * 与 NVS 无关的初始化放到单独的任务中，和 app_main 中的 NVS 初始化并行执行：
+ * 网络协议栈、事件循环、mDNS 以及 HTTP 服务器都不依赖 IP，可以在连上 AP 之前启动。
+ */
+static void boot_net_task(void *pvParameters)
 {
-    print_system_info();
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    boot_timeline_mark("netif_init");
+
+    user_mdns_init();
+    boot_timeline_mark("mdns_init");
+
+    xEventGroupSetBits(s_wifi_event_group, BOOT_NET_READY_BIT);
+
+    user_http_server_init();
+    boot_timeline_mark("httpd_start");
 
+    vTaskDelete(NULL);
+}
+
+void app_main(void)
+{
+    boot_timeline_mark("app_main");
     s_wifi_event_group = xEventGroupCreate();
 
+    xTaskCreate(boot_net_task, "boot_net_task", 4096, NULL, 5, NULL);
+
+    print_system_info();
+
     user_nvs_init();
+    boot_timeline_mark("nvs_init");
+    if (reset_counter_init() == 0) {
+        g_clean_wifi_info_flag = 1;
+    }
+    boot_timeline_mark("reset_counter");
     user_timer_init();
+    dns_resolver_init();
+    user_http_client_init();
 
+#if ENABLE_NVS_DUMP
     dump_nvs_key_value(NVS_NAMESPACE);
+#endif
+
+    // Wi-Fi 需要 NVS 和事件循环都已就绪
+    xEventGroupWaitBits(s_wifi_event_group, BOOT_NET_READY_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
     initialise_wifi();
 
+    // 任务内部等待 Wi-Fi 连接，断线后自动重连
+    xTaskCreate(&user_bemfa_connect_task, "bemfa_connect_task", 8192, NULL, 5, NULL);
+
     // xTaskCreate(udp_server_task, "udp_server", 4096, (void*)AF_INET, 5, NULL);
     while (1)
     {
@@ -434,10 +480,8 @@ void app_main(void)
             ESP_LOGI(TAG, "connected to ap SSID:%s password:%s",
                     g_wifi_sta_config.sta.ssid, g_wifi_sta_config.sta.password);
             g_system_status.wifi_connect_status = 1;
-            user_mdns_init();
-
-            // xTaskCreate(&user_bemfa_connect_task, "bemfa_connect_task", 8192, NULL, 5, NULL);
-            xTaskCreate(&user_http_server_task, "bemfa_connect_task", 8192, NULL, 5, NULL);
+            bemfa_notify_network_up();
+            boot_timeline_dump();
         } else if (bits & WIFI_FAIL_BIT) {
             ESP_LOGI(TAG, "Failed to connect to SSID:%s, password:%s",
                     g_wifi_sta_config.sta.ssid, g_wifi_sta_config.sta.password);
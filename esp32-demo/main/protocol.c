@@ -1,11 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <netdb.h>
+#include <string.h>
+#include <fcntl.h>
 #include <arpa/inet.h>
-#include <lwip/netdb.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_system.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
@@ -24,29 +25,6 @@ static const char *TAG = "protocol.c";
 
 #define UDP_LISTEN_PORT 8266
 
-int dns_lookup(const char *hostname, char *ip_address)
-{
-    struct addrinfo hints = {0};
-    struct addrinfo *res = NULL;
-
-    hints.ai_family = AF_INET;      // 仅 IPv4（设为 AF_UNSPEC 可同时查 IPv4/IPv6）
-    hints.ai_socktype = SOCK_STREAM;
-
-    int err = getaddrinfo(hostname, NULL, &hints, &res);
-    if (err != 0) {
-        printf("DNS lookup failed\n");
-        return -1;
-    }
-
-    // 遍历结果（通常第一个即可）
-    struct sockaddr_in *addr = (struct sockaddr_in *)res->ai_addr;
-    sprintf(ip_address, "%s", inet_ntoa(addr->sin_addr));
-
-    freeaddrinfo(res); // 必须释放！
-    return 0;
-}
-
-
 void udp_server_task(void *pvParameters)
 {
     char rx_buffer[256];
@@ -164,44 +142,3 @@ void udp_server_task(void *pvParameters)
     }
     vTaskDelete(NULL);
 }
-
-int tcp_client_init(char *ip_addr, int port)
-{
-    int sock = -1;
-    struct sockaddr_in dest_addr;
-    inet_pton(AF_INET, ip_addr, &dest_addr.sin_addr);
-    dest_addr.sin_family = AF_INET;
-    dest_addr.sin_port = htons(port);
-
-    sock =  socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
-    if (sock < 0) {
-        ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
-        return -1;
-    }
-    ESP_LOGI(TAG, "Socket created, connecting to %s:%d", ip_addr, port);
-
-    int err = connect(sock, (struct sockaddr *)&dest_addr, sizeof(dest_addr));
-    if (err != 0) {
-        ESP_LOGE(TAG, "Socket unable to connect: errno %d", errno);
-        shutdown(sock, 0);
-        close(sock);
-        return -1;
-    }
-
-    // 设置 3 秒接收超时
-    struct timeval timeout = {.tv_sec = 3, .tv_usec = 0};
-    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
-
-    ESP_LOGI(TAG, "Successfully connected");
-
-    return sock;
-}
-
-int tcp_client_deinit(int sock)
-{
-    if (sock > 0) {
-        shutdown(sock, 0);
-        close(sock);
-    }
-    return 0;
-}
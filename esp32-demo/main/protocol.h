@@ -1,11 +1,56 @@
 #ifndef __PROTOCOL_H__
 #define __PROTOCOL_H__
 
+#include <stdint.h>
+#include <stddef.h>
+#include "lwip/sockets.h"
+#include "tcp_connect.h"
+
+// TCP keepalive，作为应用层心跳之外的兜底；空闲 IDLE 秒后每 INTVL 秒探测一次，CNT 次无响应断开
+#define TCP_KEEPALIVE_IDLE_S    60
+#define TCP_KEEPALIVE_INTVL_S   10
+#define TCP_KEEPALIVE_CNT       3
+
+#define TCP_WAIT_READABLE       0x01    // tcp_client_wait_event: socket 可读
+#define TCP_WAIT_WAKEUP         0x02    // tcp_client_wait_event: 被 wake_fd 唤醒
+
+#define DNS_HOST_MAX_LEN        64
+#define DNS_MAX_ADDRS           4       // 每个域名保存的地址数
+#define DNS_CACHE_SIZE          4       // 缓存的域名数，也是同时进行的查询数上限
+#define DNS_MAX_WAITERS         4       // 每个域名同时等待结果的回调数
+#define DNS_CACHE_TTL_MS        (5 * 60 * 1000)
+#define DNS_NEGATIVE_TTL_MS     (5 * 1000)  // 查询失败的结果也缓存一小段时间
+
+typedef struct {
+    int count;
+    struct sockaddr_storage addrs[DNS_MAX_ADDRS];   // 端口为 0
+} dns_result_t;
+
+typedef struct {
+    uint32_t lookups;           // 实际发起的查询
+    uint32_t hits;              // 缓存命中，即节省的查询
+    uint32_t coalesced;         // 合并到正在进行的查询上的请求
+    uint32_t failures;
+} dns_stats_t;
+
+// err 为 0 时 result 有效；回调在 dns_resolver 任务或调用者上下文中执行，不能阻塞
+typedef void (*dns_resolve_cb_t)(const char *hostname, int err, const dns_result_t *result, void *arg);
+
 void udp_server_task(void *pvParameters);
 
-int dns_lookup(const char *hostname, char *ip_address);
+int dns_resolver_init(void);
+// 缓存命中时直接回调并返回 1，已发起查询返回 0，失败返回 -1；cb 为 NULL 时只做预取
+int dns_resolve_async(const char *hostname, dns_resolve_cb_t cb, void *arg);
+// 同步等待解析结果，返回 0 成功
+int dns_resolve(const char *hostname, dns_result_t *result, int timeout_ms);
+// 连接失败时调用，下次解析重新查询
+void dns_cache_invalidate(const char *hostname);
+int dns_get_stats(dns_stats_t *stats);
+int dns_addr_to_str(const struct sockaddr_storage *addr, char *buf, size_t len);
 
-int tcp_client_init(char *ip_addr, int port);
+int tcp_client_connect(const dns_result_t *result, int port, int timeout_ms, tcp_connect_stats_t *stats);
 int tcp_client_deinit(int sock);
+int tcp_client_wait_event(int sock, int wake_fd, int timeout_ms);
+int tcp_client_send(int sock, const char *buf, int len, int timeout_ms);
 
 #endif
@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "pub_queue.h"
+
+#define PUB_QUEUE_MASK      (PUB_QUEUE_LEN - 1)
+
+_Static_assert((PUB_QUEUE_LEN & PUB_QUEUE_MASK) == 0, "PUB_QUEUE_LEN must be a power of 2");
+
+/*
+ * 格子的绝对序号 = 保存值 + 下标：等于 pos 时可写入，等于 pos + 1 时可读取，
+ * 读取后置为 pos + PUB_QUEUE_LEN 留给下一圈
+ */
+static uint32_t cell_seq_load(pub_msg_t *cell, uint32_t index)
+{
+    return __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) + index;
+}
+
+static void cell_seq_store(pub_msg_t *cell, uint32_t index, uint32_t seq)
+{
+    __atomic_store_n(&cell->seq, seq - index, __ATOMIC_RELEASE);
+}
+
+void pub_queue_init(pub_queue_t *queue)
+{
+    memset(queue, 0, sizeof(pub_queue_t));
+}
+
+/*
+ * 查找状态主题，不存在时占用一个空闲项
+ * 两个任务同时首次发布同一主题可能各占一项，只是少合并几次，不影响正确性
+ */
+static int pub_state_index(pub_queue_t *queue, const char *topic)
+{
+    for (int i = 0; i < PUB_STATE_MAX; i++) {
+        pub_state_t *state = &queue->states[i];
+        if (__atomic_load_n(&state->ready, __ATOMIC_ACQUIRE) == 2 && strcmp(state->topic, topic) == 0) {
+            return i;
+        }
+    }
+
+    for (int i = 0; i < PUB_STATE_MAX; i++) {
+        pub_state_t *state = &queue->states[i];
+        uint32_t expected = 0;
+        if (__atomic_compare_exchange_n(&state->ready, &expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            strcpy(state->topic, topic);
+            __atomic_store_n(&state->ready, 2, __ATOMIC_RELEASE);
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * 写入状态值：版本号改为奇数后写值，写完改为偶数
+ * 已有其他任务正在写时不等待，两次写入重叠，视为本次先发生并被覆盖
+ */
+static int pub_state_write(pub_queue_t *queue, pub_state_t *state, const char *msg, size_t msg_len)
+{
+    uint32_t version = __atomic_load_n(&state->version, __ATOMIC_RELAXED);
+
+    if ((version & 1) ||
+        !__atomic_compare_exchange_n(&state->version, &version, version + 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        __atomic_fetch_add(&queue->coalesced, 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+
+    memcpy(state->msg, msg, msg_len + 1);
+    __atomic_store_n(&state->version, version + 2, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+// 读取状态的当前值，没有未发送的新值或正在写入时返回 false
+static bool pub_state_read(pub_queue_t *queue, int index)
+{
+    pub_state_t *state = &queue->states[index];
+    uint32_t version = __atomic_load_n(&state->version, __ATOMIC_ACQUIRE);
+
+    if ((version & 1) || version == state->sent) {
+        return false;
+    }
+
+    pub_msg_t *out = &queue->out;
+    out->state = index;
+    memcpy(out->topic, state->topic, sizeof(out->topic));
+    memcpy(out->msg, state->msg, sizeof(out->msg));
+    out->msg[PUB_MSG_MAX_LEN - 1] = '\0';
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    // 复制期间被改写，写入方完成后会再入队一个标记
+    if (__atomic_load_n(&state->version, __ATOMIC_RELAXED) != version) {
+        return false;
+    }
+
+    queue->out_version = version;
+    return true;
+}
+
+int pub_queue_post(pub_queue_t *queue, const char *topic, const char *msg, bool state)
+{
+    size_t topic_len = strlen(topic);
+    size_t msg_len = strlen(msg);
+    if (topic_len == 0 || topic_len >= TOPIC_NAME_MAX_LEN || msg_len >= PUB_MSG_MAX_LEN) {
+        return -1;
+    }
+
+    // 状态项用完时退化为普通消息
+    int state_index = state ? pub_state_index(queue, topic) : -1;
+
+    if (state_index >= 0 && pub_state_write(queue, &queue->states[state_index], msg, msg_len) != 0) {
+        __atomic_fetch_add(&queue->posted, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    pub_msg_t *cell;
+    uint32_t pos = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+    while (1) {
+        uint32_t index = pos & PUB_QUEUE_MASK;
+        cell = &queue->cells[index];
+        int32_t diff = (int32_t)(cell_seq_load(cell, index) - pos);
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&queue->head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // 状态值已经更新，由已有的标记或队列取空后的扫描发出
+            if (state_index >= 0) {
+                __atomic_fetch_add(&queue->posted, 1, __ATOMIC_RELAXED);
+                return 0;
+            }
+            __atomic_fetch_add(&queue->dropped, 1, __ATOMIC_RELAXED);
+            return -1;
+        } else {
+            pos = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->state = state_index;
+    memcpy(cell->topic, topic, topic_len + 1);
+    if (state_index < 0) {
+        memcpy(cell->msg, msg, msg_len + 1);
+    }
+    cell_seq_store(cell, pos & PUB_QUEUE_MASK, pos + 1);
+
+    // 标记发布之后再更新 latest，消费者据此跳过的旧标记一定有更新的标记排在后面
+    if (state_index >= 0) {
+        uint32_t *latest = &queue->states[state_index].latest;
+        uint32_t cur = __atomic_load_n(latest, __ATOMIC_RELAXED);
+        while ((int32_t)(pos + 1 - cur) > 0 &&
+               !__atomic_compare_exchange_n(latest, &cur, pos + 1, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+
+    __atomic_fetch_add(&queue->posted, 1, __ATOMIC_RELAXED);
+
+    return 0;
+}
+
+// 释放队首格子
+static void pub_queue_release(pub_queue_t *queue)
+{
+    uint32_t pos = queue->tail;
+    uint32_t index = pos & PUB_QUEUE_MASK;
+
+    cell_seq_store(&queue->cells[index], index, pos + PUB_QUEUE_LEN);
+    __atomic_store_n(&queue->tail, pos + 1, __ATOMIC_RELEASE);
+}
+
+const pub_msg_t *pub_queue_peek(pub_queue_t *queue)
+{
+    while (1) {
+        uint32_t pos = queue->tail;
+        uint32_t index = pos & PUB_QUEUE_MASK;
+        pub_msg_t *cell = &queue->cells[index];
+
+        if (cell_seq_load(cell, index) != pos + 1) {
+            break;
+        }
+
+        if (cell->state < 0) {
+            queue->out_state = -1;
+            queue->out_cell = true;
+            return cell;
+        }
+
+        // 后面还有同主题的标记，或者值已经发出、正在改写，丢弃这个标记
+        uint32_t latest = __atomic_load_n(&queue->states[cell->state].latest, __ATOMIC_ACQUIRE);
+        if ((int32_t)(latest - (pos + 1)) > 0 || !pub_state_read(queue, cell->state)) {
+            pub_queue_release(queue);
+            continue;
+        }
+
+        queue->out_state = cell->state;
+        queue->out_cell = true;
+        return &queue->out;
+    }
+
+    // 队列已空，发出队列满时没能入队标记的状态
+    for (int i = 0; i < PUB_STATE_MAX; i++) {
+        if (__atomic_load_n(&queue->states[i].ready, __ATOMIC_ACQUIRE) == 2 && pub_state_read(queue, i)) {
+            queue->out_state = i;
+            queue->out_cell = false;
+            return &queue->out;
+        }
+    }
+
+    return NULL;
+}
+
+void pub_queue_pop(pub_queue_t *queue)
+{
+    if (queue->out_state >= 0) {
+        pub_state_t *state = &queue->states[queue->out_state];
+        // 两次发出之间被覆盖的版本数
+        __atomic_fetch_add(&queue->coalesced, (queue->out_version - state->sent) / 2 - 1, __ATOMIC_RELAXED);
+        state->sent = queue->out_version;
+    }
+    if (queue->out_cell) {
+        pub_queue_release(queue);
+    }
+
+    queue->out_state = -1;
+    queue->out_cell = false;
+}
+
+void pub_queue_get_stats(pub_queue_t *queue, pub_queue_stats_t *stats)
+{
+    // 先读 tail，保证 head - tail 不会为负
+    uint32_t tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+    uint32_t head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+
+    stats->depth = head - tail;
+    stats->posted = __atomic_load_n(&queue->posted, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&queue->dropped, __ATOMIC_RELAXED);
+    stats->coalesced = __atomic_load_n(&queue->coalesced, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,81 @@
+#ifndef __PUB_QUEUE_H__
+#define __PUB_QUEUE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "topic_table.h"
+
+#ifndef PUB_QUEUE_LEN
+#define PUB_QUEUE_LEN           16      // 队列长度，需为 2 的幂
+#endif
+#ifndef PUB_STATE_MAX
+#define PUB_STATE_MAX           8       // 可合并的状态主题数
+#endif
+#define PUB_MSG_MAX_LEN         64      // 含结尾 '\0'
+
+/*
+ * 多生产者单消费者的发布队列，不加锁
+ * 有界环形队列，每个格子带序号：生产者 CAS 抢占写入位置，写完后更新序号发布，
+ * 只有一个消费者按顺序取出。队列满时直接丢弃并计数。
+ *
+ * 状态类主题只关心最新值：值保存在状态项中，队列里只放一个“已更新”标记，
+ * 标记记录入队位置，消费者取到更早的同主题标记时跳过，在最新标记的位置发出当前值，
+ * 连续多次变化只发出最后一次。队列满时只更新值不入队标记，已有的标记或队列
+ * 取空后的扫描会把它发出，所以最新状态不会因为队列满被丢弃。
+ * 同一主题同时有两次写入时后到的一次视为先发生并被覆盖。
+ * 格子序号以相对下标保存，全零即为空队列，静态变量无需初始化。
+ */
+
+typedef struct {
+    uint32_t seq;
+    int8_t state;                       // 状态主题下标，-1 为普通消息
+    char topic[TOPIC_NAME_MAX_LEN];
+    char msg[PUB_MSG_MAX_LEN];
+} pub_msg_t;
+
+typedef struct {
+    uint32_t ready;                     // 0: 空闲 1: 写入中 2: 可用
+    uint32_t latest;                    // 最新一个标记的入队位置 + 1
+    uint32_t version;                   // 值的版本号 * 2，奇数表示正在写入
+    uint32_t sent;                      // 已交给消费者的版本，仅消费者访问
+    char topic[TOPIC_NAME_MAX_LEN];
+    char msg[PUB_MSG_MAX_LEN];
+} pub_state_t;
+
+typedef struct {
+    pub_msg_t cells[PUB_QUEUE_LEN];
+    pub_state_t states[PUB_STATE_MAX];
+    uint32_t head;                      // 生产者写入位置
+    uint32_t tail;                      // 消费者读取位置
+    uint32_t posted;
+    uint32_t dropped;                   // 队列满丢弃的消息数
+    uint32_t coalesced;                 // 被更新值覆盖而跳过的状态消息数
+    pub_msg_t out;                      // 交给消费者的状态消息副本
+    int8_t out_state;                   // 当前消息所属的状态项，-1 为普通消息
+    bool out_cell;                      // 当前消息是否占用队首格子
+    uint32_t out_version;
+} pub_queue_t;
+
+typedef struct {
+    uint32_t depth;
+    uint32_t posted;
+    uint32_t dropped;
+    uint32_t coalesced;
+} pub_queue_stats_t;
+
+void pub_queue_init(pub_queue_t *queue);
+
+// 任意任务可调用；state 为 true 时同一主题只保留最新值，队列满也不会丢弃
+// 普通消息队列满或参数过长返回 -1
+int pub_queue_post(pub_queue_t *queue, const char *topic, const char *msg, bool state);
+
+// 仅消费者调用：返回队首消息，已被覆盖的状态消息自动跳过；队列为空返回 NULL
+const pub_msg_t *pub_queue_peek(pub_queue_t *queue);
+// 仅消费者调用：释放 pub_queue_peek 返回的消息
+void pub_queue_pop(pub_queue_t *queue);
+
+void pub_queue_get_stats(pub_queue_t *queue, pub_queue_stats_t *stats);
+
+#endif
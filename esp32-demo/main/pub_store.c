@@ -0,0 +1,442 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_partition.h"
+#include "esp_log.h"
+
+#include "pub_store.h"
+
+static const char *TAG = "pub_store.c";
+
+/*
+ * 记录状态只能由 1 写成 0：
+ *   FF 空闲 -> 7F 待发送 -> 3F 已发送
+ *                        -> 1F 被同主题新消息覆盖
+ * 记录序号单调递增，位置为 seq % capacity，重启后按序号恢复读写位置。
+ */
+#define STORE_STATE_FREE        0xFF
+#define STORE_STATE_PENDING     0x7F
+#define STORE_STATE_SENT        0x3F
+#define STORE_STATE_COALESCED   0x1F
+
+typedef struct {
+    uint8_t state;
+    uint8_t reserved[3];
+    uint32_t seq;
+    char topic[TOPIC_NAME_MAX_LEN];
+    char msg[PUB_MSG_MAX_LEN];
+    uint32_t check;             // seq 到 msg 的哈希，识别写了一半的记录
+} store_record_t;
+
+_Static_assert(sizeof(store_record_t) <= PUB_STORE_RECORD_SIZE, "store_record_t too large");
+
+typedef struct {
+    char topic[TOPIC_NAME_MAX_LEN];
+    uint32_t seq;               // 该主题最新一条待发送记录
+    bool used;
+} store_topic_t;
+
+static const esp_partition_t *g_store_part = NULL;
+static uint8_t *g_store_ram = NULL;
+static uint32_t g_store_capacity = 0;
+static uint32_t g_store_per_sector = 1;     // 每次擦除的记录数
+static uint32_t g_store_head = 0;           // 下一条记录的序号
+static uint32_t g_store_tail = 0;           // 最早一条可能待发送的记录序号
+static pub_store_policy_t g_store_policy = PUB_STORE_DROP_OLDEST;
+static SemaphoreHandle_t g_store_lock = NULL;
+static store_topic_t g_store_topics[PUB_STORE_TOPICS];
+static pub_store_stats_t g_store_stats;
+
+static uint32_t record_check(const store_record_t *rec)
+{
+    return topic_hash((const char *)&rec->seq, offsetof(store_record_t, check) - offsetof(store_record_t, seq));
+}
+
+static int store_read(uint32_t seq, size_t offset, void *buf, size_t len)
+{
+    size_t addr = (seq % g_store_capacity) * PUB_STORE_RECORD_SIZE + offset;
+
+    if (g_store_part) {
+        return esp_partition_read(g_store_part, addr, buf, len) == ESP_OK ? 0 : -1;
+    }
+
+    memcpy(buf, g_store_ram + addr, len);
+    return 0;
+}
+
+static int store_write(uint32_t seq, size_t offset, const void *buf, size_t len)
+{
+    size_t addr = (seq % g_store_capacity) * PUB_STORE_RECORD_SIZE + offset;
+
+    if (g_store_part) {
+        esp_err_t err = esp_partition_write(g_store_part, addr, buf, len);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to write record %"PRIu32" (%s)", seq, esp_err_to_name(err));
+            return -1;
+        }
+        return 0;
+    }
+
+    // 与 flash 一样只能把 1 写成 0
+    const uint8_t *src = buf;
+    for (size_t i = 0; i < len; i++) {
+        g_store_ram[addr + i] &= src[i];
+    }
+    return 0;
+}
+
+// 擦除 seq 所在的扇区
+static int store_erase(uint32_t seq)
+{
+    uint32_t first = (seq % g_store_capacity) / g_store_per_sector * g_store_per_sector;
+    size_t addr = first * PUB_STORE_RECORD_SIZE;
+    size_t len = g_store_per_sector * PUB_STORE_RECORD_SIZE;
+
+    g_store_stats.erases++;
+
+    if (g_store_part) {
+        esp_err_t err = esp_partition_erase_range(g_store_part, addr, len);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to erase sector at 0x%x (%s)", (unsigned int)addr, esp_err_to_name(err));
+            return -1;
+        }
+        return 0;
+    }
+
+    memset(g_store_ram + addr, 0xFF, len);
+    return 0;
+}
+
+static int store_read_state(uint32_t seq)
+{
+    uint8_t state = 0;
+
+    if (store_read(seq, 0, &state, 1) != 0) {
+        return -1;
+    }
+
+    return state;
+}
+
+static int store_mark(uint32_t seq, uint8_t state)
+{
+    return store_write(seq, 0, &state, 1);
+}
+
+// tail 跳过已发送和被覆盖的记录
+static void store_advance_tail(void)
+{
+    while (g_store_tail != g_store_head && store_read_state(g_store_tail) != STORE_STATE_PENDING) {
+        g_store_tail++;
+    }
+}
+
+static bool store_in_ring(uint32_t seq)
+{
+    return (int32_t)(seq - g_store_tail) >= 0 && (int32_t)(g_store_head - seq) > 0;
+}
+
+// 丢弃 [tail, end) 范围内的记录，为擦除扇区腾出空间
+static void store_drop_until(uint32_t end)
+{
+    for (; (int32_t)(end - g_store_tail) > 0; g_store_tail++) {
+        if (store_read_state(g_store_tail) == STORE_STATE_PENDING) {
+            g_store_stats.dropped++;
+            g_store_stats.pending--;
+        }
+    }
+    store_advance_tail();
+}
+
+static store_topic_t *store_topic_find(const char *topic)
+{
+    for (int i = 0; i < PUB_STORE_TOPICS; i++) {
+        if (g_store_topics[i].used && strcmp(g_store_topics[i].topic, topic) == 0) {
+            return &g_store_topics[i];
+        }
+    }
+
+    return NULL;
+}
+
+// 记录主题最新的序号，表满时替换最早的一项
+static void store_topic_update(const char *topic, uint32_t seq)
+{
+    store_topic_t *entry = store_topic_find(topic);
+
+    if (!entry) {
+        entry = &g_store_topics[0];
+        for (int i = 0; i < PUB_STORE_TOPICS; i++) {
+            if (!g_store_topics[i].used) {
+                entry = &g_store_topics[i];
+                break;
+            }
+            if ((int32_t)(g_store_topics[i].seq - entry->seq) < 0) {
+                entry = &g_store_topics[i];
+            }
+        }
+        strcpy(entry->topic, topic);
+        entry->used = true;
+    }
+
+    entry->seq = seq;
+}
+
+// 同主题还未发送的旧记录标记为被覆盖
+static void store_coalesce(const char *topic)
+{
+    store_topic_t *entry = store_topic_find(topic);
+
+    if (!entry || !store_in_ring(entry->seq) || store_read_state(entry->seq) != STORE_STATE_PENDING) {
+        return;
+    }
+
+    if (store_mark(entry->seq, STORE_STATE_COALESCED) == 0) {
+        g_store_stats.coalesced++;
+        g_store_stats.pending--;
+        if (entry->seq == g_store_tail) {
+            store_advance_tail();
+        }
+    }
+}
+
+static bool store_record_blank(uint32_t seq)
+{
+    uint8_t buf[sizeof(store_record_t)];
+
+    if (store_read(seq, 0, buf, sizeof(buf)) != 0) {
+        return false;
+    }
+    for (int i = 0; i < sizeof(buf); i++) {
+        if (buf[i] != 0xFF) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// 扫描所有记录，恢复读写位置和待发送数
+static void store_recover(void)
+{
+    store_record_t rec;
+    bool found = false;
+    uint32_t max_seq = 0;
+    uint32_t min_pending = 0;
+
+    for (uint32_t i = 0; i < g_store_capacity; i++) {
+        if (store_read(i, 0, &rec, sizeof(rec)) != 0) {
+            continue;
+        }
+        if (rec.state == STORE_STATE_FREE || rec.check != record_check(&rec) || rec.seq % g_store_capacity != i) {
+            continue;
+        }
+
+        if (!found || (int32_t)(rec.seq - max_seq) > 0) {
+            max_seq = rec.seq;
+        }
+        if (rec.state == STORE_STATE_PENDING) {
+            if (g_store_stats.pending == 0 || (int32_t)(rec.seq - min_pending) < 0) {
+                min_pending = rec.seq;
+            }
+            g_store_stats.pending++;
+            rec.topic[TOPIC_NAME_MAX_LEN - 1] = '\0';
+            store_topic_t *entry = store_topic_find(rec.topic);
+            if (!entry || (int32_t)(rec.seq - entry->seq) > 0) {
+                store_topic_update(rec.topic, rec.seq);
+            }
+        }
+        found = true;
+    }
+
+    g_store_head = found ? max_seq + 1 : 0;
+    // 断电时写了一半的记录所在位置不能直接再写，跳到下一个扇区重新擦除
+    while (g_store_head % g_store_per_sector != 0 && !store_record_blank(g_store_head)) {
+        g_store_head++;
+    }
+    g_store_tail = g_store_stats.pending ? min_pending : g_store_head;
+}
+
+int pub_store_init(pub_store_policy_t policy)
+{
+    if (g_store_lock) {
+        return 0;
+    }
+
+    g_store_policy = policy;
+    g_store_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, PUB_STORE_PART_LABEL);
+    if (g_store_part) {
+        g_store_per_sector = g_store_part->erase_size / PUB_STORE_RECORD_SIZE;
+        g_store_capacity = g_store_part->size / g_store_part->erase_size * g_store_per_sector;
+    }
+
+    if (g_store_capacity < g_store_per_sector * 2) {
+        ESP_LOGW(TAG, "Partition '%s' not found, keep %d messages in RAM", PUB_STORE_PART_LABEL, PUB_STORE_RAM_RECORDS);
+        g_store_part = NULL;
+        g_store_ram = malloc(PUB_STORE_RAM_RECORDS * PUB_STORE_RECORD_SIZE);
+        if (!g_store_ram) {
+            return -1;
+        }
+        memset(g_store_ram, 0xFF, PUB_STORE_RAM_RECORDS * PUB_STORE_RECORD_SIZE);
+        g_store_per_sector = 1;
+        g_store_capacity = PUB_STORE_RAM_RECORDS;
+    }
+
+    g_store_stats.capacity = g_store_capacity;
+    g_store_stats.persistent = g_store_part != NULL;
+
+    if (g_store_part) {
+        store_recover();
+    }
+
+    g_store_lock = xSemaphoreCreateMutex();
+    if (!g_store_lock) {
+        return -1;
+    }
+
+    ESP_LOGI(TAG, "Store ready, capacity:%"PRIu32" pending:%"PRIu32" head:%"PRIu32" policy:%d",
+             g_store_capacity, g_store_stats.pending, g_store_head, policy);
+
+    return 0;
+}
+
+int pub_store_put(const char *topic, const char *msg)
+{
+    size_t topic_len = strlen(topic);
+    size_t msg_len = strlen(msg);
+    if (!g_store_lock || topic_len == 0 || topic_len >= TOPIC_NAME_MAX_LEN || msg_len >= PUB_MSG_MAX_LEN) {
+        return -1;
+    }
+
+    int ret = -1;
+    xSemaphoreTake(g_store_lock, portMAX_DELAY);
+
+    do {
+        if (g_store_policy == PUB_STORE_COALESCE) {
+            store_coalesce(topic);
+        }
+
+        // 写到扇区开头时擦除整个扇区，其中还有未发送的记录时按策略处理
+        if (g_store_head % g_store_per_sector == 0) {
+            uint32_t sector_end = g_store_head - g_store_capacity + g_store_per_sector;
+            if ((int32_t)(g_store_head - g_store_capacity) >= 0 && (int32_t)(g_store_tail - sector_end) < 0) {
+                if (g_store_policy == PUB_STORE_DROP_NEWEST) {
+                    g_store_stats.dropped++;
+                    break;
+                }
+                store_drop_until(sector_end);
+            }
+            if (store_erase(g_store_head) != 0) {
+                break;
+            }
+        }
+
+        store_record_t rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.state = STORE_STATE_PENDING;
+        memset(rec.reserved, 0xFF, sizeof(rec.reserved));
+        rec.seq = g_store_head;
+        memcpy(rec.topic, topic, topic_len + 1);
+        memcpy(rec.msg, msg, msg_len + 1);
+        rec.check = record_check(&rec);
+
+        // 写失败的位置也不能再用
+        uint32_t seq = g_store_head++;
+        if (store_write(seq, 0, &rec, sizeof(rec)) != 0) {
+            break;
+        }
+
+        if (g_store_stats.pending == 0) {
+            g_store_tail = seq;
+        }
+        g_store_stats.pending++;
+        g_store_stats.stored++;
+        if (g_store_policy == PUB_STORE_COALESCE) {
+            store_topic_update(topic, seq);
+        }
+        ret = 0;
+    } while (0);
+
+    xSemaphoreGive(g_store_lock);
+
+    return ret;
+}
+
+int pub_store_read(uint32_t from, pub_msg_t *msg, uint32_t *seq)
+{
+    if (!g_store_lock) {
+        return -1;
+    }
+
+    int ret = -1;
+    store_record_t rec;
+
+    xSemaphoreTake(g_store_lock, portMAX_DELAY);
+
+    uint32_t s = store_in_ring(from) ? from : g_store_tail;
+    for (; s != g_store_head; s++) {
+        if (store_read(s, 0, &rec, sizeof(rec)) != 0) {
+            break;
+        }
+        if (rec.state == STORE_STATE_PENDING && rec.check == record_check(&rec)) {
+            msg->state = -1;
+            memcpy(msg->topic, rec.topic, sizeof(msg->topic));
+            memcpy(msg->msg, rec.msg, sizeof(msg->msg));
+            msg->topic[TOPIC_NAME_MAX_LEN - 1] = '\0';
+            msg->msg[PUB_MSG_MAX_LEN - 1] = '\0';
+            *seq = s;
+            ret = 0;
+            break;
+        }
+    }
+
+    xSemaphoreGive(g_store_lock);
+
+    return ret;
+}
+
+int pub_store_consume(uint32_t seq)
+{
+    if (!g_store_lock) {
+        return -1;
+    }
+
+    int ret = 0;
+    xSemaphoreTake(g_store_lock, portMAX_DELAY);
+
+    // 已被丢弃或覆盖的记录不再处理
+    if (store_in_ring(seq) && store_read_state(seq) == STORE_STATE_PENDING) {
+        ret = store_mark(seq, STORE_STATE_SENT);
+        if (ret == 0) {
+            g_store_stats.pending--;
+            g_store_stats.replayed++;
+        }
+        if (seq == g_store_tail) {
+            store_advance_tail();
+        }
+    }
+
+    xSemaphoreGive(g_store_lock);
+
+    return ret;
+}
+
+uint32_t pub_store_pending(void)
+{
+    return g_store_stats.pending;
+}
+
+void pub_store_get_stats(pub_store_stats_t *stats)
+{
+    if (g_store_lock) {
+        xSemaphoreTake(g_store_lock, portMAX_DELAY);
+    }
+    *stats = g_store_stats;
+    if (g_store_lock) {
+        xSemaphoreGive(g_store_lock);
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef __PUB_STORE_H__
+#define __PUB_STORE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "pub_queue.h"
+
+/*
+ * 离线发布消息的环形存储
+ * 优先使用 pubstore 分区，按定长记录顺序追加，写到扇区开头时才擦除该扇区；
+ * 记录发送后只改写状态字节（1 变 0），不需要擦除。重启后扫描分区恢复未发送的消息。
+ * 找不到分区时退化为 RAM 中的小缓冲区，行为相同但断电丢失。
+ */
+
+#define PUB_STORE_PART_LABEL    "pubstore"
+#define PUB_STORE_RECORD_SIZE   128     // 每条记录占用的空间，需整除扇区大小
+#define PUB_STORE_RAM_RECORDS   32      // 没有分区时 RAM 中保存的记录数
+#define PUB_STORE_TOPICS        8       // 按主题合并时跟踪的主题数
+
+typedef enum {
+    PUB_STORE_DROP_OLDEST = 0,  // 存满时丢弃最早的一个扇区
+    PUB_STORE_DROP_NEWEST,      // 存满时拒绝新消息
+    PUB_STORE_COALESCE,         // 同一主题只保留最新一条，仍存满时丢弃最早的
+} pub_store_policy_t;
+
+typedef struct {
+    uint32_t capacity;          // 可保存的记录数
+    uint32_t pending;           // 未发送的记录数
+    uint32_t stored;
+    uint32_t replayed;
+    uint32_t dropped;           // 按丢弃策略丢掉的记录数
+    uint32_t coalesced;         // 被同主题新消息覆盖的记录数
+    uint32_t erases;            // 扇区擦除次数
+    bool persistent;            // 是否保存在 flash 中
+} pub_store_stats_t;
+
+int pub_store_init(pub_store_policy_t policy);
+
+// 可多个任务调用，失败返回 -1
+int pub_store_put(const char *topic, const char *msg);
+// 读取序号不小于 from 的最早一条未发送记录，*seq 为其序号；没有返回 -1
+int pub_store_read(uint32_t from, pub_msg_t *msg, uint32_t *seq);
+// 发送成功后标记为已发送
+int pub_store_consume(uint32_t seq);
+
+uint32_t pub_store_pending(void);
+void pub_store_get_stats(pub_store_stats_t *stats);
+
+#endif
@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "query_parser.h"
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/*
+ * 从 *rd 开始解码到 '&'（stop_at_eq 时还有 '='）为止，写入 *wr
+ * 返回遇到的分隔符（'\0' 表示到达结尾）
+ */
+static char decode_token(char *query, size_t len, size_t *rd, size_t *wr, bool stop_at_eq)
+{
+    size_t r = *rd;
+    size_t w = *wr;
+    char stop = '\0';
+
+    while (r < len) {
+        char c = query[r];
+        if (c == '&' || (c == '=' && stop_at_eq)) {
+            stop = c;
+            break;
+        }
+
+        if (c == '%' && r + 2 < len) {
+            int hi = hex_value(query[r + 1]);
+            int lo = hex_value(query[r + 2]);
+            if (hi >= 0 && lo >= 0) {
+                query[w++] = (char)((hi << 4) | lo);
+                r += 3;
+                continue;
+            }
+        }
+
+        // 还没有解码过 %XX 时读写位置相同，不需要搬移
+        if (w != r) {
+            query[w] = c;
+        }
+        w++;
+        r++;
+    }
+
+    *rd = r;
+    *wr = w;
+    return stop;
+}
+
+static size_t trim_trailing_whitespace(const char *str, size_t len)
+{
+    while (len > 0) {
+        char c = str[len - 1];
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            len--;
+        } else {
+            break;
+        }
+    }
+    return len;
+}
+
+int query_parse(char *query, size_t len, query_table_t *table)
+{
+    size_t rd = 0;
+    size_t wr = 0;
+
+    table->count = 0;
+    table->truncated = false;
+
+    if (query == NULL) {
+        return 0;
+    }
+
+    while (rd < len) {
+        // 解码后的长度不会超过原文，所以 '\0' 总是写在已读过的分隔符位置上
+        size_t key_start = wr;
+        char stop = decode_token(query, len, &rd, &wr, true);
+        size_t key_len = wr - key_start;
+        query[wr++] = '\0';
+        rd++;
+
+        size_t val_start = wr;
+        size_t val_len = 0;
+        if (stop == '=') {
+            decode_token(query, len, &rd, &wr, false);
+            val_len = trim_trailing_whitespace(query + val_start, wr - val_start);
+            query[val_start + val_len] = '\0';
+            wr++;
+            rd++;
+        } else {
+            // 没有 '=' 的片段视为空值，并与 key 共用结尾的 '\0'
+            val_start = key_start + key_len;
+        }
+
+        if (key_len == 0) {
+            continue;
+        }
+
+        if (table->count >= QUERY_MAX_PAIRS) {
+            table->truncated = true;
+            continue;
+        }
+
+        query_pair_t *pair = &table->pairs[table->count++];
+        pair->key = query + key_start;
+        pair->key_len = key_len;
+        pair->val = query + val_start;
+        pair->val_len = val_len;
+    }
+
+    return table->count;
+}
+
+const char *query_get(const query_table_t *table, const char *key, size_t *val_len)
+{
+    size_t key_len = strlen(key);
+
+    for (int i = 0; i < table->count; i++) {
+        const query_pair_t *pair = &table->pairs[i];
+        if (pair->key_len == key_len && memcmp(pair->key, key, key_len) == 0) {
+            if (val_len) {
+                *val_len = pair->val_len;
+            }
+            return pair->val;
+        }
+    }
+
+    return NULL;
+}
+
+bool query_value_equals(const query_table_t *table, const char *key, const char *expected)
+{
+    size_t val_len = 0;
+    const char *val = query_get(table, key, &val_len);
+
+    return val != NULL && val_len == strlen(expected) && memcmp(val, expected, val_len) == 0;
+}
@@ -0,0 +1,36 @@
+#ifndef __QUERY_PARSER_H__
+#define __QUERY_PARSER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define QUERY_MAX_PAIRS     8
+
+/*
+ * 解析 "k1=v1&k2=v2" 形式的消息
+ * 一次遍历完成切分和 %XX 解码，结果直接写回原缓冲区：
+ * 每个 key 和 value 都以 '\0' 结尾，表中只保存指针和长度，不使用堆内存。
+ */
+
+typedef struct {
+    const char *key;
+    size_t key_len;
+    const char *val;
+    size_t val_len;
+} query_pair_t;
+
+typedef struct {
+    query_pair_t pairs[QUERY_MAX_PAIRS];
+    int count;
+    bool truncated;     // 键值对数量超过 QUERY_MAX_PAIRS
+} query_table_t;
+
+// query 需可写，且 query[len] 可写入 '\0'；返回解析出的键值对数量
+int query_parse(char *query, size_t len, query_table_t *table);
+
+// 按完整 key 查找，未找到返回 NULL
+const char *query_get(const query_table_t *table, const char *key, size_t *val_len);
+bool query_value_equals(const query_table_t *table, const char *key, const char *expected);
+
+#endif
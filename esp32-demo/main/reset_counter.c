@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "esp_system.h"
+#include "esp_attr.h"
+#include "esp_partition.h"
+#include "esp_log.h"
+
+#include "reset_counter.h"
+
+static const char *TAG = "reset_counter.c";
+
+/*
+ * 位图中每次启动占 2 bit，flash 只能由 1 写成 0，所以状态只能按下面的方向变化：
+ *   11 空闲 -> 10 启动中（计数加一）-> 00 已稳定（计数为 1）
+ *   11 空闲 -> 01 触发清除（计数为 0）-> 00 已稳定
+ * 从头回放所有已写的槽位即可得到上一次的计数。
+ */
+#define RST_SLOT_FREE       0x3
+#define RST_SLOT_BOOT       0x2
+#define RST_SLOT_TRIGGER    0x1
+#define RST_SLOT_SETTLED    0x0
+
+#define RST_SLOTS_PER_BYTE  4
+#define RST_READ_CHUNK      64
+
+#define RST_RTC_MAGIC       0x52535444
+
+typedef struct {
+    uint32_t magic;
+    int32_t count;
+    int32_t slot;               // 最近一次冷启动写入、尚未稳定的槽位，-1 表示没有
+    uint32_t byte;              // 该槽位所在字节当前的内容
+    uint32_t check;
+} reset_counter_rtc_t;
+
+// 热复位后保持，上电后内容随机，靠 magic 和校验判断
+static RTC_NOINIT_ATTR reset_counter_rtc_t g_rst_rtc;
+
+static const esp_partition_t *g_rst_part = NULL;
+static int g_rst_cur_slot = -1;         // 本次启动写入的槽位，-1 表示本次没有写 flash
+static uint8_t g_rst_cur_byte = 0xFF;   // 该槽位所在字节当前的内容
+static uint32_t g_rst_flash_writes = 0;
+
+static uint32_t rtc_check(void)
+{
+    return ~(g_rst_rtc.magic ^ (uint32_t)g_rst_rtc.count ^ ((uint32_t)g_rst_rtc.slot << 8) ^ g_rst_rtc.byte);
+}
+
+static bool rtc_is_valid(void)
+{
+    return g_rst_rtc.magic == RST_RTC_MAGIC && g_rst_rtc.check == rtc_check()
+        && g_rst_rtc.count >= 0 && g_rst_rtc.count <= RESET_COUNTER_TRIGGER
+        && g_rst_rtc.slot >= -1 && g_rst_rtc.byte <= 0xFF;
+}
+
+// 同时保存当前未稳定的槽位，热复位后仍能在稳定时把它写成已稳定
+static void rtc_store(int count)
+{
+    g_rst_rtc.magic = RST_RTC_MAGIC;
+    g_rst_rtc.count = count;
+    g_rst_rtc.slot = g_rst_cur_slot;
+    g_rst_rtc.byte = g_rst_cur_byte;
+    g_rst_rtc.check = rtc_check();
+}
+
+static bool is_warm_reset(esp_reset_reason_t reason)
+{
+    switch (reason) {
+        case ESP_RST_SW:
+        case ESP_RST_PANIC:
+        case ESP_RST_INT_WDT:
+        case ESP_RST_TASK_WDT:
+        case ESP_RST_WDT:
+        case ESP_RST_DEEPSLEEP:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static int slot_shift(int slot)
+{
+    return 6 - (slot % RST_SLOTS_PER_BYTE) * 2;
+}
+
+// 在 cur 字节的基础上写入槽位，只会把 1 变成 0
+static int slot_write(int slot, uint8_t cur, int state, uint8_t *out)
+{
+    uint8_t val = cur & ~((~state & 0x3) << slot_shift(slot));
+
+    if (val != cur) {
+        esp_err_t ret = esp_partition_write(g_rst_part, slot / RST_SLOTS_PER_BYTE, &val, 1);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to write slot %d (%s)", slot, esp_err_to_name(ret));
+            return -1;
+        }
+        g_rst_flash_writes++;
+    }
+
+    if (out) {
+        *out = val;
+    }
+
+    return 0;
+}
+
+// 回放位图，返回上次的计数，*next 为第一个空闲槽位，*next_byte 为其所在字节的内容
+static int bitmap_replay(int *next, uint8_t *next_byte)
+{
+    uint8_t buf[RST_READ_CHUNK];
+    int total = g_rst_part->size * RST_SLOTS_PER_BYTE;
+    int count = 0;
+
+    for (size_t offset = 0; offset < g_rst_part->size; offset += sizeof(buf)) {
+        size_t len = g_rst_part->size - offset;
+        if (len > sizeof(buf)) {
+            len = sizeof(buf);
+        }
+        if (esp_partition_read(g_rst_part, offset, buf, len) != ESP_OK) {
+            return -1;
+        }
+
+        for (int i = 0; i < len; i++) {
+            for (int j = 0; j < RST_SLOTS_PER_BYTE; j++) {
+                int slot = (offset + i) * RST_SLOTS_PER_BYTE + j;
+                int state = (buf[i] >> slot_shift(slot)) & 0x3;
+
+                if (state == RST_SLOT_FREE) {
+                    *next = slot;
+                    *next_byte = buf[i];
+                    return count;
+                } else if (state == RST_SLOT_BOOT) {
+                    if (count < RESET_COUNTER_TRIGGER) {
+                        count++;
+                    }
+                } else if (state == RST_SLOT_TRIGGER) {
+                    count = 0;
+                } else {
+                    count = 1;
+                }
+            }
+        }
+    }
+
+    *next = total;
+    *next_byte = 0;
+    return count;
+}
+
+// 分区写满后擦除，并用最少的槽位写回当前计数
+static int bitmap_compact(int count, int *next, uint8_t *next_byte)
+{
+    uint8_t cur = 0xFF;
+    int slot = 0;
+
+    ESP_LOGI(TAG, "Bitmap full, erase and keep count %d", count);
+    if (esp_partition_erase_range(g_rst_part, 0, g_rst_part->size) != ESP_OK) {
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++, slot++) {
+        if (slot % RST_SLOTS_PER_BYTE == 0) {
+            cur = 0xFF;
+        }
+        if (slot_write(slot, cur, i == 0 ? RST_SLOT_SETTLED : RST_SLOT_BOOT, &cur) != 0) {
+            return -1;
+        }
+    }
+
+    *next = slot;
+    *next_byte = (slot % RST_SLOTS_PER_BYTE == 0) ? 0xFF : cur;
+    return 0;
+}
+
+static int flash_boot(int *count)
+{
+    int next = 0;
+    uint8_t next_byte = 0xFF;
+    int prev = bitmap_replay(&next, &next_byte);
+
+    if (prev < 0) {
+        return -1;
+    }
+    if (next >= g_rst_part->size * RST_SLOTS_PER_BYTE) {
+        if (bitmap_compact(prev, &next, &next_byte) != 0) {
+            return -1;
+        }
+    }
+
+    int state = RST_SLOT_BOOT;
+    *count = prev + 1;
+    if (prev >= RESET_COUNTER_TRIGGER) {
+        state = RST_SLOT_TRIGGER;
+        *count = 0;
+    }
+
+    if (slot_write(next, next_byte, state, &g_rst_cur_byte) != 0) {
+        return -1;
+    }
+    g_rst_cur_slot = next;
+
+    ESP_LOGI(TAG, "Read sys reset counter = %d (slot %d)", prev, next);
+    return 0;
+}
+
+int reset_counter_init(void)
+{
+    esp_reset_reason_t reason = esp_reset_reason();
+    int count = 0;
+
+    g_rst_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, RESET_COUNTER_PART_LABEL);
+    if (g_rst_part == NULL) {
+        ESP_LOGW(TAG, "Partition '%s' not found, only count warm resets", RESET_COUNTER_PART_LABEL);
+    }
+
+    if (is_warm_reset(reason) && rtc_is_valid()) {
+        // 热复位不写 flash；若随后断电，冷启动读到的是上次写入 flash 的计数
+        int prev = g_rst_rtc.count;
+        count = (prev >= RESET_COUNTER_TRIGGER) ? 0 : prev + 1;
+        if (g_rst_part && g_rst_rtc.slot < (int)g_rst_part->size * RST_SLOTS_PER_BYTE) {
+            g_rst_cur_slot = g_rst_rtc.slot;
+            g_rst_cur_byte = g_rst_rtc.byte;
+        }
+        ESP_LOGI(TAG, "Read sys reset counter = %d (rtc)", prev);
+    } else if (g_rst_part == NULL || flash_boot(&count) != 0) {
+        count = 1;
+    }
+
+    rtc_store(count);
+    ESP_LOGI(TAG, "Write sys reset counter = %d", count);
+
+    return count;
+}
+
+int reset_counter_settle(void)
+{
+    int ret = 0;
+
+    // 冷启动写入的槽位可能在之后的热复位中才稳定，槽位号从 RTC 中恢复
+    if (g_rst_cur_slot >= 0) {
+        ret = slot_write(g_rst_cur_slot, g_rst_cur_byte, RST_SLOT_SETTLED, &g_rst_cur_byte);
+        g_rst_cur_slot = -1;
+    }
+    rtc_store(1);
+
+    return ret;
+}
+
+uint32_t reset_counter_get_flash_writes(void)
+{
+    return g_rst_flash_writes;
+}
@@ -0,0 +1,22 @@
+#ifndef __RESET_COUNTER_H__
+#define __RESET_COUNTER_H__
+
+#include <stdint.h>
+
+/*
+ * 快速复位计数（连续 RESET_COUNTER_TRIGGER 次在稳定前复位后，下一次启动清除配网信息）
+ * 软件复位、看门狗等热复位只更新 RTC 内存，不写 flash；
+ * 上电等冷启动时使用 rstcnt 分区中只追加的位图，每次启动写 1 字节，分区写满才擦除一次。
+ */
+
+#define RESET_COUNTER_TRIGGER       5
+#define RESET_COUNTER_PART_LABEL    "rstcnt"
+
+// 启动时调用一次，返回本次启动后的计数，返回 0 表示触发了清除配网信息
+int reset_counter_init(void);
+// 启动稳定后调用，计数回到 1
+int reset_counter_settle(void);
+
+uint32_t reset_counter_get_flash_writes(void);
+
+#endif
@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "esp_log.h"
+#include "lwip/sockets.h"
+
+#include "protocol.h"
+
+static const char *TAG = "tcp_client.c";
+
+/*
+ * bemfa_tcp.c 使用的 TCP 客户端接口，只依赖 BSD socket，主机测试中可直接在回环上运行
+ */
+
+/*
+ * 并行连接解析到的所有地址，timeout_ms 内最先成功的胜出；返回非阻塞 socket
+ * 成功后打开 keepalive，由调用方通过 select() 等待数据
+ */
+int tcp_client_connect(const dns_result_t *result, int port, int timeout_ms, tcp_connect_stats_t *stats)
+{
+    int sock = tcp_connect_parallel(result->addrs, result->count, port, timeout_ms, stats);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "Socket unable to connect to port %d", port);
+        return -1;
+    }
+
+    int keepalive = 1;
+    int keepidle = TCP_KEEPALIVE_IDLE_S;
+    int keepintvl = TCP_KEEPALIVE_INTVL_S;
+    int keepcnt = TCP_KEEPALIVE_CNT;
+    if (setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &keepalive, sizeof(int)) != 0
+        || setsockopt(sock, IPPROTO_TCP, TCP_KEEPIDLE, &keepidle, sizeof(int)) != 0
+        || setsockopt(sock, IPPROTO_TCP, TCP_KEEPINTVL, &keepintvl, sizeof(int)) != 0
+        || setsockopt(sock, IPPROTO_TCP, TCP_KEEPCNT, &keepcnt, sizeof(int)) != 0) {
+        ESP_LOGW(TAG, "Unable to set keepalive: errno %d", errno);
+    }
+
+    ESP_LOGI(TAG, "Successfully connected");
+
+    return sock;
+}
+
+/*
+ * 同时等待 socket 可读和 wake_fd（eventfd）被其他任务唤醒，wake_fd < 0 时只等 socket
+ * 返回 TCP_WAIT_READABLE / TCP_WAIT_WAKEUP 的组合，超时返回 0，出错返回 -1
+ * wake_fd 的计数由调用方读走
+ */
+int tcp_client_wait_event(int sock, int wake_fd, int timeout_ms)
+{
+    fd_set rfds;
+    struct timeval tv;
+
+    FD_ZERO(&rfds);
+    FD_SET(sock, &rfds);
+    if (wake_fd >= 0) {
+        FD_SET(wake_fd, &rfds);
+    }
+
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+    int ret = select((sock > wake_fd ? sock : wake_fd) + 1, &rfds, NULL, NULL, timeout_ms < 0 ? NULL : &tv);
+    if (ret < 0) {
+        if (errno == EINTR) {
+            return 0;
+        }
+        ESP_LOGE(TAG, "select failed: errno %d", errno);
+        return -1;
+    }
+
+    ret = 0;
+    if (FD_ISSET(sock, &rfds)) {
+        ret |= TCP_WAIT_READABLE;
+    }
+    if (wake_fd >= 0 && FD_ISSET(wake_fd, &rfds)) {
+        ret |= TCP_WAIT_WAKEUP;
+    }
+
+    return ret;
+}
+
+/*
+ * 在非阻塞 socket 上发送全部数据，发送缓冲区满时等待可写
+ * 返回已发送长度，出错或超时返回 -1
+ */
+int tcp_client_send(int sock, const char *buf, int len, int timeout_ms)
+{
+    int off = 0;
+
+    while (off < len) {
+        int n = send(sock, buf + off, len - off, 0);
+        if (n > 0) {
+            off += n;
+            continue;
+        }
+
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            fd_set wfds;
+            struct timeval tv = {
+                .tv_sec = timeout_ms / 1000,
+                .tv_usec = (timeout_ms % 1000) * 1000,
+            };
+
+            FD_ZERO(&wfds);
+            FD_SET(sock, &wfds);
+            if (select(sock + 1, NULL, &wfds, NULL, &tv) > 0) {
+                continue;
+            }
+            ESP_LOGE(TAG, "send timeout, sent %d/%d", off, len);
+            return -1;
+        }
+
+        ESP_LOGE(TAG, "Error occurred during sending: errno %d", errno);
+        return -1;
+    }
+
+    return off;
+}
+
+int tcp_client_deinit(int sock)
+{
+    if (sock > 0) {
+        shutdown(sock, 0);
+        close(sock);
+    }
+    return 0;
+}
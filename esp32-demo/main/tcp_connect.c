@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_log.h"
+#else
+#define ESP_LOGI(tag, fmt, ...) printf("I %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) printf("W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#endif
+
+#include "tcp_connect.h"
+
+static const char *TAG = "tcp_connect.c";
+
+typedef struct {
+    int sock;
+    int addr_idx;
+    int64_t start_us;
+} tcp_attempt_t;
+
+static int64_t tcp_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+// 发起非阻塞连接，返回 socket；*err 为 0 表示已连接，EINPROGRESS 表示进行中
+static int tcp_attempt_start(const struct sockaddr_storage *addr, int port, int *err)
+{
+    struct sockaddr_storage dest = *addr;
+    socklen_t len = sizeof(struct sockaddr_in);
+
+    if (dest.ss_family == AF_INET6) {
+        ((struct sockaddr_in6 *)&dest)->sin6_port = htons(port);
+        len = sizeof(struct sockaddr_in6);
+    } else {
+        ((struct sockaddr_in *)&dest)->sin_port = htons(port);
+    }
+
+    int sock = socket(dest.ss_family, SOCK_STREAM, 0);
+    if (sock < 0) {
+        *err = errno;
+        return -1;
+    }
+
+    int flags = fcntl(sock, F_GETFL, 0);
+    if (flags < 0 || fcntl(sock, F_SETFL, flags | O_NONBLOCK) < 0) {
+        *err = errno;
+        close(sock);
+        return -1;
+    }
+
+    if (connect(sock, (struct sockaddr *)&dest, len) == 0) {
+        *err = 0;
+        return sock;
+    }
+    if (errno != EINPROGRESS) {
+        *err = errno;
+        close(sock);
+        return -1;
+    }
+
+    *err = EINPROGRESS;
+    return sock;
+}
+
+// 按协议族交替排列地址，第一个地址的协议族优先
+static int tcp_attempt_order(const struct sockaddr_storage *addrs, int count, int *order)
+{
+    int n = 0;
+    int first = 0, second = 0;
+    int family = addrs[0].ss_family;
+
+    while (n < count && n < TCP_CONNECT_MAX_ATTEMPTS) {
+        while (first < count && addrs[first].ss_family != family) {
+            first++;
+        }
+        if (first < count) {
+            order[n++] = first++;
+        }
+        while (second < count && addrs[second].ss_family == family) {
+            second++;
+        }
+        if (second < count && n < TCP_CONNECT_MAX_ATTEMPTS) {
+            order[n++] = second++;
+        }
+        if (first >= count && second >= count) {
+            break;
+        }
+    }
+
+    return n;
+}
+
+int tcp_connect_parallel(const struct sockaddr_storage *addrs, int count, int port, int timeout_ms,
+                         tcp_connect_stats_t *stats)
+{
+    tcp_attempt_t attempts[TCP_CONNECT_MAX_ATTEMPTS];
+    tcp_connect_stats_t local_stats;
+    int order[TCP_CONNECT_MAX_ATTEMPTS];
+    int total = 0, started = 0, pending = 0;
+    int winner = -1;
+
+    if (stats == NULL) {
+        stats = &local_stats;
+    }
+    memset(stats, 0, sizeof(tcp_connect_stats_t));
+    stats->winner = -1;
+
+    if (count <= 0) {
+        return -1;
+    }
+    total = tcp_attempt_order(addrs, count, order);
+
+    int64_t start = tcp_now_us();
+    int64_t deadline = start + timeout_ms * 1000LL;
+    int64_t next_start = start;
+
+    while (winner < 0) {
+        int64_t now = tcp_now_us();
+
+        // 到了启动时间，或者没有进行中的连接时，启动下一个；超时之后不再启动
+        if (started < total && now < deadline && (now >= next_start || pending == 0)) {
+            tcp_attempt_t *a = &attempts[started];
+            tcp_connect_attempt_t *s = &stats->attempts[started];
+            int err = 0;
+
+            a->addr_idx = order[started];
+            a->start_us = now;
+            a->sock = tcp_attempt_start(&addrs[a->addr_idx], port, &err);
+            s->family = addrs[a->addr_idx].ss_family;
+            s->start_us = now - start;
+            s->err = err;
+            started++;
+
+            if (a->sock >= 0 && err == 0) {
+                winner = started - 1;
+                break;
+            } else if (a->sock >= 0) {
+                pending++;
+                next_start = now + TCP_CONNECT_ATTEMPT_DELAY_MS * 1000LL;
+            } else {
+                next_start = now;
+            }
+            continue;
+        }
+
+        if (pending == 0 || now >= deadline) {
+            break;
+        }
+
+        fd_set wfds, efds;
+        int maxfd = -1;
+        FD_ZERO(&wfds);
+        FD_ZERO(&efds);
+        for (int i = 0; i < started; i++) {
+            if (attempts[i].sock >= 0) {
+                FD_SET(attempts[i].sock, &wfds);
+                FD_SET(attempts[i].sock, &efds);
+                if (attempts[i].sock > maxfd) {
+                    maxfd = attempts[i].sock;
+                }
+            }
+        }
+
+        int64_t wait_until = (started < total && next_start < deadline) ? next_start : deadline;
+        int64_t wait_us = wait_until > now ? wait_until - now : 0;
+        struct timeval tv = {
+            .tv_sec = wait_us / 1000000,
+            .tv_usec = wait_us % 1000000,
+        };
+
+        int ret = select(maxfd + 1, NULL, &wfds, &efds, &tv);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        now = tcp_now_us();
+        for (int i = 0; i < started && ret > 0; i++) {
+            tcp_attempt_t *a = &attempts[i];
+            if (a->sock < 0 || !(FD_ISSET(a->sock, &wfds) || FD_ISSET(a->sock, &efds))) {
+                continue;
+            }
+
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (getsockopt(a->sock, SOL_SOCKET, SO_ERROR, &err, &len) != 0) {
+                err = errno;
+            }
+            stats->attempts[i].err = err;
+            stats->attempts[i].elapsed_us = now - a->start_us;
+
+            if (err == 0) {
+                winner = i;
+                break;
+            }
+
+            // 失败的连接立即启动下一个，不必等待
+            close(a->sock);
+            a->sock = -1;
+            pending--;
+            next_start = now;
+        }
+    }
+
+    int64_t end = tcp_now_us();
+    for (int i = 0; i < started; i++) {
+        tcp_attempt_t *a = &attempts[i];
+        if (i == winner) {
+            stats->attempts[i].err = 0;
+            stats->attempts[i].elapsed_us = end - a->start_us;
+            continue;
+        }
+        if (a->sock >= 0) {
+            close(a->sock);
+            a->sock = -1;
+            stats->attempts[i].err = winner >= 0 ? ECANCELED : ETIMEDOUT;
+            stats->attempts[i].elapsed_us = end - a->start_us;
+        }
+    }
+
+    stats->count = started;
+    stats->winner = winner;
+    stats->total_us = end - start;
+
+    for (int i = 0; i < started; i++) {
+        ESP_LOGI(TAG, "attempt %d family:%d start:+%lldus elapsed:%lldus err:%d%s", i,
+                 stats->attempts[i].family, (long long)stats->attempts[i].start_us,
+                 (long long)stats->attempts[i].elapsed_us, stats->attempts[i].err, i == winner ? " (winner)" : "");
+    }
+    if (winner < 0) {
+        ESP_LOGW(TAG, "all %d attempts failed in %lldus", started, (long long)stats->total_us);
+        return -1;
+    }
+
+    return attempts[winner].sock;
+}
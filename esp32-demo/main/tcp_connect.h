@@ -0,0 +1,35 @@
+#ifndef __TCP_CONNECT_H__
+#define __TCP_CONNECT_H__
+
+#include <stdint.h>
+#include <sys/socket.h>
+
+/*
+ * 并行 TCP 连接（Happy Eyeballs, RFC 8305）
+ * 地址按协议族交替排序，先连第一个地址，TCP_CONNECT_ATTEMPT_DELAY_MS 内未成功
+ * 或连接失败时再启动下一个，最先成功的连接胜出，其余全部关闭。
+ * 只依赖 BSD socket 接口，lwIP 和 Linux 下都能编译运行。
+ */
+
+#define TCP_CONNECT_ATTEMPT_DELAY_MS    250
+#define TCP_CONNECT_MAX_ATTEMPTS        4
+
+typedef struct {
+    int family;
+    int err;                    // 0 成功，否则为 errno；被取消为 ECANCELED，超时为 ETIMEDOUT
+    int64_t start_us;           // 相对本次连接开始的时间
+    int64_t elapsed_us;
+} tcp_connect_attempt_t;
+
+typedef struct {
+    int count;                  // 实际发起的尝试数
+    int winner;                 // 成功的尝试序号，-1 表示全部失败
+    int64_t total_us;
+    tcp_connect_attempt_t attempts[TCP_CONNECT_MAX_ATTEMPTS];
+} tcp_connect_stats_t;
+
+// 返回已连接的非阻塞 socket，失败返回 -1；stats 可为 NULL
+int tcp_connect_parallel(const struct sockaddr_storage *addrs, int count, int port, int timeout_ms,
+                         tcp_connect_stats_t *stats);
+
+#endif
@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "topic_table.h"
+
+#define TOPIC_SLOT_MASK     (TOPIC_TABLE_SLOTS - 1)
+
+_Static_assert((TOPIC_TABLE_SLOTS & TOPIC_SLOT_MASK) == 0, "TOPIC_TABLE_SLOTS must be a power of 2");
+
+void topic_table_init(topic_table_t *table)
+{
+    memset(table, 0, sizeof(topic_table_t));
+}
+
+uint32_t topic_hash(const char *name, size_t len)
+{
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/*
+ * 返回 name 所在的槽，不存在时返回探测到的第一个空槽
+ * 装载率不超过 50%，一定能找到空槽
+ */
+static int topic_table_probe(const topic_table_t *table, const char *name, size_t len, uint32_t hash)
+{
+    int slot = hash & TOPIC_SLOT_MASK;
+
+    while (1) {
+        int index = __atomic_load_n(&table->slots[slot], __ATOMIC_ACQUIRE) - 1;
+        if (index < 0) {
+            return slot;
+        }
+
+        const topic_entry_t *entry = &table->entries[index];
+        if (entry->hash == hash && entry->name_len == len && memcmp(entry->name, name, len) == 0) {
+            return slot;
+        }
+
+        slot = (slot + 1) & TOPIC_SLOT_MASK;
+    }
+}
+
+int topic_table_add(topic_table_t *table, const char *name, topic_handler_t handler, void *arg)
+{
+    size_t len = strlen(name);
+    if (len == 0 || len >= TOPIC_NAME_MAX_LEN) {
+        return -1;
+    }
+
+    uint32_t hash = topic_hash(name, len);
+    int slot = topic_table_probe(table, name, len, hash);
+    int index = table->slots[slot] - 1;
+
+    // 分发时不加锁读取处理函数和参数，两者不能原地修改；重复相同的注册视为成功
+    if (index >= 0) {
+        const topic_entry_t *entry = &table->entries[index];
+        return entry->handler == handler && entry->arg == arg ? index : -1;
+    }
+
+    if (table->count >= TOPIC_TABLE_MAX) {
+        return -1;
+    }
+
+    index = table->count;
+    topic_entry_t *entry = &table->entries[index];
+    memcpy(entry->name, name, len + 1);
+    entry->name_len = len;
+    entry->hash = hash;
+    entry->handler = handler;
+    entry->arg = arg;
+    entry->rx_cnt = 0;
+
+    // 条目写完后再发布，查找方看到下标时内容已完整
+    __atomic_store_n(&table->slots[slot], (uint16_t)(index + 1), __ATOMIC_RELEASE);
+    __atomic_store_n(&table->count, index + 1, __ATOMIC_RELEASE);
+
+    return index;
+}
+
+topic_entry_t *topic_table_find(topic_table_t *table, const char *name, size_t len)
+{
+    if (len == 0 || len >= TOPIC_NAME_MAX_LEN) {
+        return NULL;
+    }
+
+    int slot = topic_table_probe(table, name, len, topic_hash(name, len));
+    int index = __atomic_load_n(&table->slots[slot], __ATOMIC_ACQUIRE) - 1;
+
+    return index < 0 ? NULL : &table->entries[index];
+}
+
+int topic_table_dispatch(topic_table_t *table, const char *topic, size_t topic_len, const char *msg, size_t msg_len)
+{
+    topic_entry_t *entry = topic_table_find(table, topic, topic_len);
+    if (!entry || !entry->handler) {
+        table->miss_cnt++;
+        return -1;
+    }
+
+    entry->rx_cnt++;
+    entry->handler(entry->name, msg, msg_len, entry->arg);
+
+    return 0;
+}
+
+int topic_table_count(const topic_table_t *table)
+{
+    return __atomic_load_n(&table->count, __ATOMIC_ACQUIRE);
+}
+
+const topic_entry_t *topic_table_get(const topic_table_t *table, int index)
+{
+    if (index < 0 || index >= topic_table_count(table)) {
+        return NULL;
+    }
+
+    return &table->entries[index];
+}
@@ -0,0 +1,56 @@
+#ifndef __TOPIC_TABLE_H__
+#define __TOPIC_TABLE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifndef TOPIC_TABLE_MAX
+#define TOPIC_TABLE_MAX         64      // 最多可注册的主题数
+#endif
+#define TOPIC_TABLE_SLOTS       (TOPIC_TABLE_MAX * 2)   // 哈希槽数，需为 2 的幂，装载率不超过 50%
+#define TOPIC_NAME_MAX_LEN      32      // 含结尾 '\0'
+
+/*
+ * 主题名到处理函数的固定容量哈希表
+ * FNV-1a 哈希 + 线性探测，槽中只存条目下标，条目按注册顺序保存，
+ * 因此按下标遍历即得到订阅顺序。不支持删除，不使用堆内存。
+ *
+ * 条目先写完整再把下标发布到槽中，发布后不再修改，查找不需要加锁；
+ * 多个任务同时注册时需由调用方互斥。全零即为空表，静态变量无需初始化。
+ */
+
+typedef void (*topic_handler_t)(const char *topic, const char *msg, size_t msg_len, void *arg);
+
+typedef struct {
+    char name[TOPIC_NAME_MAX_LEN];
+    size_t name_len;
+    uint32_t hash;
+    topic_handler_t handler;
+    void *arg;
+    uint32_t rx_cnt;            // 已分发的消息数
+} topic_entry_t;
+
+typedef struct {
+    topic_entry_t entries[TOPIC_TABLE_MAX];
+    uint16_t slots[TOPIC_TABLE_SLOTS];  // 条目下标 + 1，0 表示空槽
+    int count;
+    uint32_t miss_cnt;          // 未注册主题的消息数
+} topic_table_t;
+
+void topic_table_init(topic_table_t *table);
+
+uint32_t topic_hash(const char *name, size_t len);
+
+// 返回条目下标，以相同的处理函数和参数再次注册时返回原下标；
+// 已注册了其他处理函数或参数、表满、名字过长返回 -1
+int topic_table_add(topic_table_t *table, const char *name, topic_handler_t handler, void *arg);
+// 未找到返回 NULL
+topic_entry_t *topic_table_find(topic_table_t *table, const char *name, size_t len);
+// 查找并调用处理函数，未注册的主题返回 -1
+int topic_table_dispatch(topic_table_t *table, const char *topic, size_t topic_len, const char *msg, size_t msg_len);
+
+int topic_table_count(const topic_table_t *table);
+const topic_entry_t *topic_table_get(const topic_table_t *table, int index);
+
+#endif
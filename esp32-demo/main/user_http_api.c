@@ -0,0 +1,304 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_mac.h"
+#include "esp_wifi.h"
+#include "esp_netif.h"
+#include <esp_http_server.h>
+
+#include "main.h"
+#include "bemfa.h"
+#include "user_nvs_rw.h"
+#include "json_writer.h"
+#include "json_extract.h"
+#include "http_body.h"
+#include "http_ws.h"
+#include "user_http_server.h"
+#include "user_http_api.h"
+
+static const char *TAG = "user_http_api.c";
+
+static char g_api_resp[HTTP_API_RESP_MAX];
+static json_extract_t g_api_json;           // 请求体边收边解析，同一时间只处理一个请求
+
+static esp_err_t api_send_json(httpd_req_t *req, json_writer_t *w)
+{
+    int len = json_writer_finish(w);
+
+    if (len < 0) {
+        ESP_LOGE(TAG, "%s response overflow", req->uri);
+        return httpd_resp_send_500(req);
+    }
+
+    httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return httpd_resp_send(req, g_api_resp, len);
+}
+
+static void api_write_wifi(json_writer_t *w)
+{
+    wifi_ap_record_t ap;
+    esp_netif_ip_info_t ip_info;
+    esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    char text[20];
+    bool connected = g_system_status.wifi_connect_status == 1;
+
+    json_writer_object_begin(w, "wifi");
+    json_writer_bool(w, "connected", connected);
+
+    snprintf(text, sizeof(text), MACSTR, MAC2STR(g_system_status.mac_addr_sta));
+    json_writer_str(w, "mac", text);
+
+    if (connected && esp_wifi_sta_get_ap_info(&ap) == ESP_OK) {
+        json_writer_str(w, "ssid", (const char *)ap.ssid);
+        json_writer_int(w, "rssi", ap.rssi);
+        json_writer_int(w, "channel", ap.primary);
+    }
+    if (connected && netif && esp_netif_get_ip_info(netif, &ip_info) == ESP_OK) {
+        snprintf(text, sizeof(text), IPSTR, IP2STR(&ip_info.ip));
+        json_writer_str(w, "ip", text);
+    }
+    json_writer_object_end(w);
+}
+
+static void api_write_switch(json_writer_t *w)
+{
+    json_writer_bool(w, "switch", bemfa_get_switch() == 1);
+}
+
+static esp_err_t api_state_get_handler(httpd_req_t *req)
+{
+    json_writer_t w;
+    bemfa_pub_stats_t pub_stats;
+    user_http_asset_stats_t asset_stats;
+
+    bemfa_get_pub_stats(&pub_stats);
+    user_http_server_get_asset_stats(&asset_stats);
+
+    json_writer_init(&w, g_api_resp, sizeof(g_api_resp));
+    json_writer_object_begin(&w, NULL);
+    api_write_switch(&w);
+    json_writer_int(&w, "uptime_ms", esp_timer_get_time() / 1000);
+    json_writer_int(&w, "heap_free", esp_get_free_heap_size());
+    api_write_wifi(&w);
+
+    // 经云端控制的往返时间可与本接口的响应时间对比
+    json_writer_object_begin(&w, "cloud");
+    json_writer_bool(&w, "online", bemfa_is_online());
+    json_writer_int(&w, "ack_latency_us", pub_stats.last_latency_us);
+    json_writer_int(&w, "pending", pub_stats.offline_pending + pub_stats.queue_depth);
+    json_writer_object_end(&w);
+
+    // 页面加载的开销：静态资源实际发送的字节数和响应时间
+    json_writer_object_begin(&w, "assets");
+    json_writer_int(&w, "requests", asset_stats.requests);
+    json_writer_int(&w, "not_modified", asset_stats.not_modified);
+    json_writer_int(&w, "bytes_sent", asset_stats.bytes_sent);
+    json_writer_int(&w, "avg_us", asset_stats.requests ? asset_stats.total_us / asset_stats.requests : 0);
+    json_writer_int(&w, "max_us", asset_stats.max_us);
+    json_writer_object_end(&w);
+
+    json_writer_object_end(&w);
+
+    return api_send_json(req, &w);
+}
+
+/*
+ * POST 请求体按块交给 json_extract，返回 1 表示还有数据，0 表示收到完整的 JSON，-1 表示格式错误
+ */
+static int api_body_parse(size_t off, const char *data, size_t len, json_field_t *fields, int field_cnt)
+{
+    // 空请求体只有结束调用，off 同样为 0
+    if (off == 0) {
+        json_extract_init(&g_api_json, fields, field_cnt);
+    }
+    if (data) {
+        // 语法错误之后的数据被忽略，结束时统一回复 400
+        json_extract_feed(&g_api_json, data, len);
+        return 1;
+    }
+
+    return json_extract_finish(&g_api_json) == 0 ? 0 : -1;
+}
+
+enum { SWITCH_FIELD_SWITCH, SWITCH_FIELD_NUM };
+static json_field_t g_switch_fields[SWITCH_FIELD_NUM] = {
+    [SWITCH_FIELD_SWITCH] = { .path = "switch", .type = JSON_FIELD_INT },
+};
+
+static int api_switch_chunk_handler(httpd_req_t *req, size_t off, const char *data, size_t len)
+{
+    json_writer_t w;
+    int ret = api_body_parse(off, data, len, g_switch_fields, SWITCH_FIELD_NUM);
+
+    if (ret > 0) {
+        return 0;
+    }
+    if (ret < 0 || !g_switch_fields[SWITCH_FIELD_SWITCH].found) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "expect {\"switch\": true|false}");
+        return 0;
+    }
+
+    bemfa_set_switch(g_switch_fields[SWITCH_FIELD_SWITCH].value != 0);
+
+    json_writer_init(&w, g_api_resp, sizeof(g_api_resp));
+    json_writer_object_begin(&w, NULL);
+    api_write_switch(&w);
+    json_writer_object_end(&w);
+
+    return api_send_json(req, &w) == ESP_OK ? 0 : -1;
+}
+
+static esp_err_t api_write_config(httpd_req_t *req, bool restart_required)
+{
+    json_writer_t w;
+    user_config_t cfg;
+
+    if (user_config_read(&cfg) != 0) {
+        return httpd_resp_send_500(req);
+    }
+
+    json_writer_init(&w, g_api_resp, sizeof(g_api_resp));
+    json_writer_object_begin(&w, NULL);
+    json_writer_int(&w, "version", cfg.version);
+    json_writer_str(&w, "bind_ssid", cfg.bind_ssid);
+    json_writer_str(&w, "bemfa_topic", cfg.bemfa_topic);
+    json_writer_bool(&w, "bemfa_token_set", cfg.bemfa_token[0] != '\0');
+    json_writer_int(&w, "wifi_channel", cfg.wifi_channel);
+    if (restart_required) {
+        json_writer_bool(&w, "restart_required", true);
+    }
+    json_writer_object_end(&w);
+
+    return api_send_json(req, &w);
+}
+
+static esp_err_t api_config_get_handler(httpd_req_t *req)
+{
+    return api_write_config(req, false);
+}
+
+static char g_config_token[USER_CONFIG_SIZEOF(bemfa_token)];
+static char g_config_topic[USER_CONFIG_SIZEOF(bemfa_topic)];
+
+enum { CONFIG_FIELD_TOKEN, CONFIG_FIELD_TOPIC, CONFIG_FIELD_NUM };
+static json_field_t g_config_fields[CONFIG_FIELD_NUM] = {
+    [CONFIG_FIELD_TOKEN] = { .path = "bemfa_token", .type = JSON_FIELD_STR, .buf = g_config_token, .buf_size = sizeof(g_config_token) },
+    [CONFIG_FIELD_TOPIC] = { .path = "bemfa_topic", .type = JSON_FIELD_STR, .buf = g_config_topic, .buf_size = sizeof(g_config_topic) },
+};
+
+// 私钥和主题会拼进 "cmd=1&uid=...&topic=...\r\n"，只允许巴法云支持的字母、数字和下划线
+static bool api_config_value_valid(const json_field_t *field)
+{
+    if (!field->found) {
+        return true;
+    }
+    if (field->truncated || field->len == 0) {
+        return false;
+    }
+    for (size_t i = 0; i < field->len; i++) {
+        char c = field->buf[i];
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_')) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// 巴法云任务启动时读取私钥和主题，修改后重启生效；Wi-Fi 仍通过配网流程设置
+static int api_config_chunk_handler(httpd_req_t *req, size_t off, const char *data, size_t len)
+{
+    json_field_t *token = &g_config_fields[CONFIG_FIELD_TOKEN];
+    json_field_t *topic = &g_config_fields[CONFIG_FIELD_TOPIC];
+    int ret = api_body_parse(off, data, len, g_config_fields, CONFIG_FIELD_NUM);
+
+    if (ret > 0) {
+        return 0;
+    }
+    if (ret < 0 || (!token->found && !topic->found) || !api_config_value_valid(token) || !api_config_value_valid(topic)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "expect {\"bemfa_token\": \"...\", \"bemfa_topic\": \"...\"}, values [0-9A-Za-z_]");
+        return 0;
+    }
+
+    user_nvs_txn_begin();
+    if (token->found) {
+        user_config_set_bemfa_token(g_config_token);
+    }
+    if (topic->found) {
+        user_config_set_bemfa_topic(g_config_topic);
+    }
+    user_nvs_txn_commit();
+    ESP_LOGI(TAG, "Config updated, token:%d topic:%d", token->found, topic->found);
+
+    return api_write_config(req, true) == ESP_OK ? 0 : -1;
+}
+
+// 开关变化时只推送变化的字段，可能在 bemfa 任务中调用，不使用共享的 g_api_resp
+static void api_switch_changed(int on)
+{
+    char buf[32];
+    json_writer_t w;
+    int len;
+
+    json_writer_init(&w, buf, sizeof(buf));
+    json_writer_object_begin(&w, NULL);
+    json_writer_bool(&w, "switch", on == 1);
+    json_writer_object_end(&w);
+
+    len = json_writer_finish(&w);
+    if (len > 0) {
+        http_ws_broadcast(buf, len);
+    }
+}
+
+static const http_body_route_t api_switch_route = {
+    .max_len  = HTTP_API_BODY_MAX,
+    .on_chunk = api_switch_chunk_handler,
+};
+
+static const http_body_route_t api_config_route = {
+    .max_len  = HTTP_API_BODY_MAX,
+    .on_chunk = api_config_chunk_handler,
+};
+
+static const httpd_uri_t api_handlers[] = {
+    { .uri      = "/api/state",
+      .method   = HTTP_GET,
+      .handler  = api_state_get_handler,
+      .user_ctx = NULL,
+    },
+    { .uri      = "/api/switch",
+      .method   = HTTP_POST,
+      .handler  = http_body_handler,
+      .user_ctx = (void *)&api_switch_route,
+    },
+    { .uri      = "/api/config",
+      .method   = HTTP_GET,
+      .handler  = api_config_get_handler,
+      .user_ctx = NULL,
+    },
+    { .uri      = "/api/config",
+      .method   = HTTP_POST,
+      .handler  = http_body_handler,
+      .user_ctx = (void *)&api_config_route,
+    },
+};
+
+int user_http_api_register(httpd_handle_t server)
+{
+    for (int i = 0; i < sizeof(api_handlers) / sizeof(httpd_uri_t); i++) {
+        if (httpd_register_uri_handler(server, &api_handlers[i]) != ESP_OK) {
+            ESP_LOGW(TAG, "register uri failed for %s", api_handlers[i].uri);
+            return -1;
+        }
+    }
+
+    bemfa_set_switch_cb(api_switch_changed);
+
+    return 0;
+}
@@ -0,0 +1,20 @@
+#ifndef __USER_HTTP_API_H__
+#define __USER_HTTP_API_H__
+
+#include <esp_http_server.h>
+
+/*
+ * 局域网控制接口，响应都是 JSON
+ *   GET  /api/state    开关、Wi-Fi 和云端连接状态，以及静态资源的发送字节数和响应时间
+ *   POST /api/switch   {"switch": true|false}，本地切换开关并同步到云端
+ *   GET  /api/config   当前配置，不返回密码和私钥
+ *   POST /api/config   {"bemfa_token": "...", "bemfa_topic": "..."}，值只能是字母、数字和下划线，重启后生效
+ * 开关变化时通过 /ws 推送 {"switch": true|false}，见 http_ws.h
+ */
+
+#define HTTP_API_RESP_MAX       768     // 响应缓冲区，httpd 单任务处理请求，所有接口共用
+#define HTTP_API_BODY_MAX       256     // 请求体上限
+
+int user_http_api_register(httpd_handle_t server);
+
+#endif
@@ -6,204 +6,422 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
-#include "esp_tls.h"
+#include "esp_timer.h"
+#include "lwip/netdb.h"
+#include "lwip/sockets.h"
 
+#include "protocol.h"
 #include "user_http_client.h"
 
 static const char *TAG = "user_http_client.c";
 
-esp_err_t _http_event_handler(esp_http_client_event_t *evt)
+/*
+ * 响应数据接收器，每个请求各自持有一个，事件回调中不保存任何静态状态
+ */
+void http_resp_sink_init_fixed(http_resp_sink_t *sink, char *buf, int size)
 {
-    static char *output_buffer;  // Buffer to store response of http request from event handler
-    static int output_len;       // Stores number of bytes read
-    switch(evt->event_id) {
-        case HTTP_EVENT_ERROR:
-            ESP_LOGD(TAG, "HTTP_EVENT_ERROR");
-            break;
-        case HTTP_EVENT_ON_CONNECTED:
-            ESP_LOGD(TAG, "HTTP_EVENT_ON_CONNECTED");
-            break;
-        case HTTP_EVENT_HEADER_SENT:
-            ESP_LOGD(TAG, "HTTP_EVENT_HEADER_SENT");
-            break;
-        case HTTP_EVENT_ON_HEADER:
-            ESP_LOGD(TAG, "HTTP_EVENT_ON_HEADER, key=%s, value=%s", evt->header_key, evt->header_value);
-            break;
-        case HTTP_EVENT_ON_DATA:
-            ESP_LOGD(TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
-            if (output_len == 0 && evt->user_data) {
-                memset(evt->user_data, 0, MAX_HTTP_OUTPUT_BUFFER);
-            }
+    memset(sink, 0, sizeof(http_resp_sink_t));
+    sink->type = HTTP_SINK_FIXED;
+    sink->buf = buf;
+    sink->cap = size;
+    if (buf && size > 0) {
+        buf[0] = '\0';
+    }
+}
 
-            /*
-             *  Check for chunked encoding is added as the URL for chunked encoding used in this example returns binary data.
-             *  However, event handler can also be used in case chunked encoding is used.
-             */
-            if (!esp_http_client_is_chunked_response(evt->client)) {
-                // If user_data buffer is configured, copy the response into the buffer
-                int copy_len = 0;
-                if (evt->user_data) {
-                    // The last byte in evt->user_data is kept for the NULL character in case of out-of-bound access.
-                    copy_len = MIN(evt->data_len, (MAX_HTTP_OUTPUT_BUFFER - output_len));
-                    if (copy_len) {
-                        memcpy(evt->user_data + output_len, evt->data, copy_len);
-                    }
-                } else {
-                    int content_len = esp_http_client_get_content_length(evt->client);
-                    if (output_buffer == NULL) {
-                        // We initialize output_buffer with 0 because it is used by strlen() and similar functions therefore should be null terminated.
-                        output_buffer = (char *) calloc(content_len + 1, sizeof(char));
-                        output_len = 0;
-                        if (output_buffer == NULL) {
-                            ESP_LOGE(TAG, "Failed to allocate memory for output buffer");
-                            return ESP_FAIL;
-                        }
-                    }
-                    copy_len = MIN(evt->data_len, (content_len - output_len));
-                    if (copy_len) {
-                        memcpy(output_buffer + output_len, evt->data, copy_len);
-                    }
-                }
-                output_len += copy_len;
-            }
-            break;
-        case HTTP_EVENT_ON_FINISH:
-            ESP_LOGD(TAG, "HTTP_EVENT_ON_FINISH");
-            if (output_buffer != NULL) {
-                free(output_buffer);
-                output_buffer = NULL;
-            }
-            output_len = 0;
+void http_resp_sink_init_growable(http_resp_sink_t *sink, int max_len)
+{
+    memset(sink, 0, sizeof(http_resp_sink_t));
+    sink->type = HTTP_SINK_GROWABLE;
+    sink->max_len = max_len;
+}
+
+void http_resp_sink_init_stream(http_resp_sink_t *sink, http_sink_stream_cb_t cb, void *arg)
+{
+    memset(sink, 0, sizeof(http_resp_sink_t));
+    sink->type = HTTP_SINK_STREAM;
+    sink->cb = cb;
+    sink->arg = arg;
+}
+
+void http_resp_sink_reset(http_resp_sink_t *sink)
+{
+    sink->len = 0;
+    sink->truncated = false;
+    sink->err = 0;
+    if (sink->buf && sink->cap > 0) {
+        sink->buf[0] = '\0';
+    }
+}
+
+void http_resp_sink_free(http_resp_sink_t *sink)
+{
+    if (sink->type == HTTP_SINK_GROWABLE && sink->buf) {
+        free(sink->buf);
+        sink->buf = NULL;
+        sink->cap = 0;
+    }
+}
+
+int http_resp_sink_write(http_resp_sink_t *sink, const char *data, int len)
+{
+    if (sink->type == HTTP_SINK_STREAM) {
+        sink->len += len;
+        if (sink->cb && sink->err == 0) {
+            sink->err = sink->cb(data, len, sink->arg);
+        }
+        return sink->err;
+    }
+
+    if (sink->type == HTTP_SINK_GROWABLE && sink->len + len + 1 > sink->cap && sink->cap < sink->max_len + 1) {
+        int cap = sink->cap ? sink->cap : HTTP_SINK_INIT_SIZE;
+        while (cap < sink->len + len + 1 && cap < sink->max_len + 1) {
+            cap *= 2;
+        }
+        cap = MIN(cap, sink->max_len + 1);
+
+        char *buf = realloc(sink->buf, cap);
+        if (buf == NULL) {
+            ESP_LOGE(TAG, "Failed to grow response buffer to %d bytes", cap);
+        } else {
+            sink->buf = buf;
+            sink->cap = cap;
+        }
+    }
+
+    // 保留最后一个字节给 '\0'
+    int copy_len = MIN(len, sink->cap - 1 - sink->len);
+    if (copy_len < 0) {
+        copy_len = 0;
+    }
+    if (copy_len > 0) {
+        memcpy(sink->buf + sink->len, data, copy_len);
+        sink->len += copy_len;
+        sink->buf[sink->len] = '\0';
+    }
+    if (copy_len < len) {
+        sink->truncated = true;
+    }
+
+    return 0;
+}
+
+/*
+ * 长连接客户端池
+ * 每个 host 保留一个 esp_http_client 句柄，HTTP/1.1 连接在请求之间保持，
+ * 重复请求不再重新握手；host 的解析结果带 TTL 缓存，明文 HTTP 直接用 IP 连接。
+ */
+typedef struct {
+    esp_http_client_handle_t client;
+    char host[HTTP_HOST_MAX_LEN];
+    int port;
+    bool https;
+    bool in_use;
+    int64_t last_used_us;
+} http_pool_slot_t;
+
+typedef struct {
+    http_resp_sink_t *sink;
+    int64_t start_us;
+    int64_t connect_us;
+    int64_t first_byte_us;
+} http_request_ctx_t;
+
+static http_pool_slot_t g_http_pool[HTTP_POOL_SIZE];
+static user_http_pool_stats_t g_http_pool_stats;
+static SemaphoreHandle_t g_http_pool_lock;
+
+// 多个任务并发请求，计数在锁内累加
+static void http_pool_stats_inc(uint32_t *counter)
+{
+    xSemaphoreTake(g_http_pool_lock, portMAX_DELAY);
+    (*counter)++;
+    xSemaphoreGive(g_http_pool_lock);
+}
+
+static esp_err_t http_pool_event_handler(esp_http_client_event_t *evt)
+{
+    http_request_ctx_t *ctx = (http_request_ctx_t *)evt->user_data;
+    if (ctx == NULL) {
+        return ESP_OK;
+    }
+
+    switch (evt->event_id) {
+        case HTTP_EVENT_ON_CONNECTED:
+            // 只有新建 TCP 连接才会触发，复用连接时不会进入这里
+            ctx->connect_us = esp_timer_get_time() - ctx->start_us;
+            http_pool_stats_inc(&g_http_pool_stats.handshakes);
             break;
-        case HTTP_EVENT_DISCONNECTED:
-            ESP_LOGI(TAG, "HTTP_EVENT_DISCONNECTED");
-            int mbedtls_err = 0;
-            esp_err_t err = esp_tls_get_and_clear_last_error((esp_tls_error_handle_t)evt->data, &mbedtls_err, NULL);
-            if (err != 0) {
-                ESP_LOGI(TAG, "Last esp error code: 0x%x", err);
-                ESP_LOGI(TAG, "Last mbedtls failure: 0x%x", mbedtls_err);
+        case HTTP_EVENT_ON_DATA: {
+            if (ctx->first_byte_us == 0) {
+                ctx->first_byte_us = esp_timer_get_time() - ctx->start_us;
             }
-            if (output_buffer != NULL) {
-                free(output_buffer);
-                output_buffer = NULL;
+            // chunked 响应在这里已经去掉了分块头，和普通响应一样直接写入
+            if (ctx->sink) {
+                http_resp_sink_write(ctx->sink, evt->data, evt->data_len);
             }
-            output_len = 0;
-            break;
-        case HTTP_EVENT_REDIRECT:
-            ESP_LOGD(TAG, "HTTP_EVENT_REDIRECT");
-            esp_http_client_set_header(evt->client, "From", "user@example.com");
-            esp_http_client_set_header(evt->client, "Accept", "text/html");
-            esp_http_client_set_redirection(evt->client);
-            break;
+        } break;
         default:
             break;
     }
+
     return ESP_OK;
 }
 
-/*
-#define CONFIG_EXAMPLE_HTTP_ENDPOINT    "httpbin.org"
-static void http_rest_with_url(void)
-{
-    // Declare local_response_buffer with size (MAX_HTTP_OUTPUT_BUFFER + 1) to prevent out of bound access when
-    // it is used by functions like strlen(). The buffer should only be used upto size MAX_HTTP_OUTPUT_BUFFER
-    char local_response_buffer[MAX_HTTP_OUTPUT_BUFFER + 1] = {0};
-
-    esp_http_client_config_t config = {
-        .host = CONFIG_EXAMPLE_HTTP_ENDPOINT,
-        .path = "/get",
-        .query = "esp",
-        .event_handler = _http_event_handler,
-        .user_data = local_response_buffer,        // Pass address of local buffer to get response
-        .disable_auto_redirect = true,
-    };
-    ESP_LOGI(TAG, "HTTP request with url =>");
-    esp_http_client_handle_t client = esp_http_client_init(&config);
+// 解析 http[s]://host[:port][/path]，path 指向 url 内部
+static int http_parse_url(const char *url, bool *https, char *host, size_t host_len, int *port, const char **path)
+{
+    const char *p = NULL;
 
-    // GET
-    esp_err_t err = esp_http_client_perform(client);
-    if (err == ESP_OK) {
-        ESP_LOGI(TAG, "HTTP GET Status = %d, content_length = %"PRId64,
-                esp_http_client_get_status_code(client),
-                esp_http_client_get_content_length(client));
+    if (strncmp(url, "http://", 7) == 0) {
+        *https = false;
+        *port = 80;
+        p = url + 7;
+    } else if (strncmp(url, "https://", 8) == 0) {
+        *https = true;
+        *port = 443;
+        p = url + 8;
     } else {
-        ESP_LOGE(TAG, "HTTP GET request failed: %s", esp_err_to_name(err));
+        return -1;
     }
-    ESP_LOG_BUFFER_HEX(TAG, local_response_buffer, strlen(local_response_buffer));
 
-    // POST
-    const char *post_data = "{\"field1\":\"value1\"}";
-    esp_http_client_set_url(client, "http://"CONFIG_EXAMPLE_HTTP_ENDPOINT"/post");
-    esp_http_client_set_method(client, HTTP_METHOD_POST);
-    esp_http_client_set_header(client, "Content-Type", "application/json");
-    esp_http_client_set_post_field(client, post_data, strlen(post_data));
-    err = esp_http_client_perform(client);
-    if (err == ESP_OK) {
-        ESP_LOGI(TAG, "HTTP POST Status = %d, content_length = %"PRId64,
-                esp_http_client_get_status_code(client),
-                esp_http_client_get_content_length(client));
+    size_t len = strcspn(p, ":/?");
+    if (len == 0 || len >= host_len) {
+        return -1;
+    }
+    memcpy(host, p, len);
+    host[len] = '\0';
+    p += len;
+
+    if (*p == ':') {
+        *port = atoi(p + 1);
+        p += strspn(p + 1, "0123456789") + 1;
+    }
+
+    *path = (*p == '\0') ? "/" : p;
+    return 0;
+}
+
+// 通过 protocol.c 中共享的解析器获取地址，IPv6 地址加上方括号用于 URL
+static int http_dns_resolve(const char *host, char *ip, size_t ip_len)
+{
+    dns_result_t result;
+    char addr[INET6_ADDRSTRLEN] = {0};
+
+    if (dns_resolve(host, &result, HTTP_REQUEST_TIMEOUT_MS) != 0) {
+        ESP_LOGE(TAG, "DNS lookup failed: %s", host);
+        return -1;
+    }
+
+    dns_addr_to_str(&result.addrs[0], addr, sizeof(addr));
+    if (result.addrs[0].ss_family == AF_INET6) {
+        snprintf(ip, ip_len, "[%s]", addr);
     } else {
-        ESP_LOGE(TAG, "HTTP POST request failed: %s", esp_err_to_name(err));
+        snprintf(ip, ip_len, "%s", addr);
     }
 
-    //PUT
-    esp_http_client_set_url(client, "http://"CONFIG_EXAMPLE_HTTP_ENDPOINT"/put");
-    esp_http_client_set_method(client, HTTP_METHOD_PUT);
-    err = esp_http_client_perform(client);
-    if (err == ESP_OK) {
-        ESP_LOGI(TAG, "HTTP PUT Status = %d, content_length = %"PRId64,
-                esp_http_client_get_status_code(client),
-                esp_http_client_get_content_length(client));
+    return 0;
+}
+
+// 取一个空闲的连接槽，优先复用同一 host 的连接
+static http_pool_slot_t *http_pool_acquire(const char *host, int port, bool https)
+{
+    http_pool_slot_t *victim = NULL;
+
+    xSemaphoreTake(g_http_pool_lock, portMAX_DELAY);
+    for (int i = 0; i < HTTP_POOL_SIZE; i++) {
+        http_pool_slot_t *slot = &g_http_pool[i];
+        if (slot->in_use) {
+            continue;
+        }
+        if (slot->client && slot->port == port && slot->https == https && strcmp(slot->host, host) == 0) {
+            victim = slot;
+            break;
+        }
+        if (victim == NULL || slot->client == NULL || (victim->client && slot->last_used_us < victim->last_used_us)) {
+            victim = slot;
+        }
+    }
+
+    if (victim) {
+        if (victim->client && (victim->port != port || victim->https != https || strcmp(victim->host, host) != 0)) {
+            esp_http_client_cleanup(victim->client);
+            victim->client = NULL;
+        }
+        snprintf(victim->host, sizeof(victim->host), "%s", host);
+        victim->port = port;
+        victim->https = https;
+        victim->in_use = true;
+    }
+    xSemaphoreGive(g_http_pool_lock);
+
+    return victim;
+}
+
+static void http_pool_release(http_pool_slot_t *slot, bool keep)
+{
+    xSemaphoreTake(g_http_pool_lock, portMAX_DELAY);
+    if (!keep && slot->client) {
+        esp_http_client_cleanup(slot->client);
+        slot->client = NULL;
+    }
+    slot->last_used_us = esp_timer_get_time();
+    slot->in_use = false;
+    xSemaphoreGive(g_http_pool_lock);
+}
+
+int user_http_client_init(void)
+{
+    if (g_http_pool_lock == NULL) {
+        g_http_pool_lock = xSemaphoreCreateMutex();
+    }
+
+    return g_http_pool_lock ? 0 : -1;
+}
+
+int user_http_request_sink(const char *url, esp_http_client_method_t method, const char *content_type,
+                           const char *body, http_resp_sink_t *sink, user_http_timing_t *timing)
+{
+    char host[HTTP_HOST_MAX_LEN] = {0};
+    char ip[48] = {0};
+    char real_url[256] = {0};
+    const char *path = NULL;
+    bool https = false;
+    int port = 0;
+    int ret = -1;
+
+    if (g_http_pool_lock == NULL) {
+        ESP_LOGE(TAG, "HTTP client pool not initialized");
+        return -1;
+    }
+
+    if (http_parse_url(url, &https, host, sizeof(host), &port, &path) != 0) {
+        ESP_LOGE(TAG, "Invalid url: %s", url);
+        return -1;
+    }
+
+    http_request_ctx_t ctx = {
+        .sink = sink,
+        .start_us = esp_timer_get_time(),
+    };
+
+    // HTTPS 需要用域名做证书校验，只对明文 HTTP 使用缓存的 IP
+    int64_t dns_us = 0;
+    if (!https) {
+        if (http_dns_resolve(host, ip, sizeof(ip)) != 0) {
+            return -1;
+        }
+        dns_us = esp_timer_get_time() - ctx.start_us;
+        snprintf(real_url, sizeof(real_url), "http://%s:%d%s", ip, port, path);
     } else {
-        ESP_LOGE(TAG, "HTTP PUT request failed: %s", esp_err_to_name(err));
+        snprintf(real_url, sizeof(real_url), "%s", url);
     }
 
-    //PATCH
-    esp_http_client_set_url(client, "http://"CONFIG_EXAMPLE_HTTP_ENDPOINT"/patch");
-    esp_http_client_set_method(client, HTTP_METHOD_PATCH);
-    esp_http_client_set_post_field(client, NULL, 0);
-    err = esp_http_client_perform(client);
-    if (err == ESP_OK) {
-        ESP_LOGI(TAG, "HTTP PATCH Status = %d, content_length = %"PRId64,
-                esp_http_client_get_status_code(client),
-                esp_http_client_get_content_length(client));
+    http_pool_slot_t *slot = http_pool_acquire(host, port, https);
+    esp_http_client_handle_t client = slot ? slot->client : NULL;
+    bool reused = (client != NULL);
+
+    if (client == NULL) {
+        esp_http_client_config_t config = {
+            .url = real_url,
+            .event_handler = http_pool_event_handler,
+            .disable_auto_redirect = true,
+            .timeout_ms = HTTP_REQUEST_TIMEOUT_MS,
+            .keep_alive_enable = true,
+        };
+        client = esp_http_client_init(&config);
+        if (client == NULL) {
+            if (slot) {
+                http_pool_release(slot, false);
+            }
+            return -1;
+        }
+        if (slot) {
+            slot->client = client;
+        }
     } else {
-        ESP_LOGE(TAG, "HTTP PATCH request failed: %s", esp_err_to_name(err));
+        esp_http_client_set_url(client, real_url);
+    }
+
+    esp_http_client_set_user_data(client, &ctx);
+    esp_http_client_set_method(client, method);
+    esp_http_client_set_header(client, "Host", host);
+    if (content_type) {
+        esp_http_client_set_header(client, "Content-Type", content_type);
+    }
+    esp_http_client_set_post_field(client, body, body ? strlen(body) : 0);
+
+    http_pool_stats_inc(&g_http_pool_stats.requests);
+    esp_err_t err = esp_http_client_perform(client);
+    // 服务器可能已关闭空闲连接，重新建立连接后重试一次
+    // 只在还没收到任何响应数据时重试，stream 回调的解析状态无法回滚
+    if (err != ESP_OK && reused && (sink == NULL || (sink->len == 0 && !sink->truncated))) {
+        ESP_LOGW(TAG, "Pooled connection to %s failed (%s), reconnecting", host, esp_err_to_name(err));
+        esp_http_client_close(client);
+        if (sink) {
+            http_resp_sink_reset(sink);
+        }
+        ctx.first_byte_us = 0;
+        err = esp_http_client_perform(client);
     }
 
-    //DELETE
-    esp_http_client_set_url(client, "http://"CONFIG_EXAMPLE_HTTP_ENDPOINT"/delete");
-    esp_http_client_set_method(client, HTTP_METHOD_DELETE);
-    err = esp_http_client_perform(client);
     if (err == ESP_OK) {
-        ESP_LOGI(TAG, "HTTP DELETE Status = %d, content_length = %"PRId64,
-                esp_http_client_get_status_code(client),
-                esp_http_client_get_content_length(client));
+        ret = esp_http_client_get_status_code(client);
     } else {
-        ESP_LOGE(TAG, "HTTP DELETE request failed: %s", esp_err_to_name(err));
+        ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
+        if (!https) {
+            dns_cache_invalidate(host);
+        }
     }
 
-    //HEAD
-    esp_http_client_set_url(client, "http://"CONFIG_EXAMPLE_HTTP_ENDPOINT"/get");
-    esp_http_client_set_method(client, HTTP_METHOD_HEAD);
-    err = esp_http_client_perform(client);
-    if (err == ESP_OK) {
-        ESP_LOGI(TAG, "HTTP HEAD Status = %d, content_length = %"PRId64,
-                esp_http_client_get_status_code(client),
-                esp_http_client_get_content_length(client));
+    esp_http_client_set_user_data(client, NULL);
+
+    if (timing) {
+        timing->dns_us = dns_us;
+        timing->connect_us = ctx.connect_us;
+        timing->first_byte_us = ctx.first_byte_us;
+        timing->total_us = esp_timer_get_time() - ctx.start_us;
+        timing->reused = (ctx.connect_us == 0 && err == ESP_OK);
+    }
+
+    if (slot) {
+        http_pool_release(slot, err == ESP_OK);
     } else {
-        ESP_LOGE(TAG, "HTTP HEAD request failed: %s", esp_err_to_name(err));
+        esp_http_client_cleanup(client);
     }
 
-    esp_http_client_cleanup(client);
+    return ret;
 }
 
-// void user_http_client_task(void *pvParameters)
-// {
-//     http_rest_with_url();
+int user_http_request(const char *url, esp_http_client_method_t method, const char *content_type,
+                      const char *body, char *response, int buf_len, user_http_timing_t *timing)
+{
+    http_resp_sink_t sink;
+
+    http_resp_sink_init_fixed(&sink, response, buf_len);
+    int ret = user_http_request_sink(url, method, content_type, body, &sink, timing);
+    if (sink.truncated) {
+        ESP_LOGW(TAG, "Response from %s truncated to %d bytes", url, sink.len);
+    }
 
-//     vTaskDelete(NULL);
-// }
+    return ret;
+}
 
-*/
+int user_http_get(char *url, char *response, int buf_len)
+{
+    return user_http_request(url, HTTP_METHOD_GET, NULL, NULL, response, buf_len, NULL);
+}
+
+int user_http_get_pool_stats(user_http_pool_stats_t *stats)
+{
+    if (!stats || g_http_pool_lock == NULL) {
+        return -1;
+    }
+
+    xSemaphoreTake(g_http_pool_lock, portMAX_DELAY);
+    memcpy(stats, &g_http_pool_stats, sizeof(user_http_pool_stats_t));
+    xSemaphoreGive(g_http_pool_lock);
+    return 0;
+}
@@ -1,11 +1,65 @@
 #ifndef __USER_HTTP_CLIENT_H__
 #define __USER_HTTP_CLIENT_H__
 
-#define MAX_HTTP_OUTPUT_BUFFER 512
+#define HTTP_POOL_SIZE          2           // 保持的长连接数
+#define HTTP_HOST_MAX_LEN       64
+#define HTTP_REQUEST_TIMEOUT_MS 5000
+
+#define HTTP_SINK_INIT_SIZE     256         // 可增长接收器的初始容量
 
 #include "esp_http_client.h"
-esp_err_t _http_event_handler(esp_http_client_event_t *evt);
 
+typedef enum {
+    HTTP_SINK_FIXED = 0,        // 调用方提供的固定缓冲区，超出部分截断
+    HTTP_SINK_GROWABLE,         // 按需 realloc，最多 max_len 字节
+    HTTP_SINK_STREAM,           // 不缓存，每段数据直接交给回调
+} http_sink_type_t;
+
+typedef int (*http_sink_stream_cb_t)(const char *data, int len, void *arg);
+
+// 每个请求独立的响应接收器，通过 user_data 传给事件回调
+typedef struct {
+    http_sink_type_t type;
+    char *buf;
+    int cap;
+    int max_len;
+    int len;                    // 已写入（stream 为已收到）的字节数
+    bool truncated;             // 响应超出缓冲区被截断
+    int err;                    // stream 回调返回的第一个错误
+    http_sink_stream_cb_t cb;
+    void *arg;
+} http_resp_sink_t;
+
+// 单次请求各阶段耗时，均从请求开始计时
+typedef struct {
+    int64_t dns_us;
+    int64_t connect_us;         // 复用连接时为 0
+    int64_t first_byte_us;
+    int64_t total_us;
+    bool reused;
+} user_http_timing_t;
+
+typedef struct {
+    uint32_t requests;
+    uint32_t handshakes;        // 新建 TCP 连接次数
+} user_http_pool_stats_t;
+
+void http_resp_sink_init_fixed(http_resp_sink_t *sink, char *buf, int size);
+void http_resp_sink_init_growable(http_resp_sink_t *sink, int max_len);
+void http_resp_sink_init_stream(http_resp_sink_t *sink, http_sink_stream_cb_t cb, void *arg);
+void http_resp_sink_reset(http_resp_sink_t *sink);
+void http_resp_sink_free(http_resp_sink_t *sink);
+int http_resp_sink_write(http_resp_sink_t *sink, const char *data, int len);
+
+int user_http_client_init(void);
+
+// 返回 HTTP 状态码，失败返回 -1；可多个任务并发调用
+int user_http_request_sink(const char *url, esp_http_client_method_t method, const char *content_type,
+                           const char *body, http_resp_sink_t *sink, user_http_timing_t *timing);
+// 同上，response 以 '\0' 结尾，超长部分被截断
+int user_http_request(const char *url, esp_http_client_method_t method, const char *content_type,
+                      const char *body, char *response, int buf_len, user_http_timing_t *timing);
 int user_http_get(char *url, char *response, int buf_len);
+int user_http_get_pool_stats(user_http_pool_stats_t *stats);
 
 #endif
@@ -18,96 +18,200 @@
 #include "esp_check.h"
 #include <time.h>
 #include <sys/time.h>
+#include "esp_timer.h"
+#include "lwip/sockets.h"
 
 #include "main.h"
+#include "boot_timeline.h"
+#include "asset_fs.h"
+#include "http_body.h"
+#include "user_http_api.h"
+#include "http_ws.h"
 #include "user_http_server.h"
 
 static const char *TAG = "user_httpd";
 
 static httpd_handle_t g_httpd_server = NULL;
-static int g_pre_start_mem, g_post_stop_mem;
+static int g_pre_start_mem;
+// httpd 单任务处理请求，统计不加锁
+static user_http_asset_stats_t g_asset_stats;
+static uint32_t g_sock_bytes_sent;
 
-extern const char _binary_index_html_start[] asm("_binary_index_html_start");
-extern const char _binary_index_html_end[]   asm("_binary_index_html_end");
+esp_err_t http_404_error_handler(httpd_req_t *req, httpd_err_code_t err);
 
-static esp_err_t hello_get_handler(httpd_req_t *req)
+#define HTTP_ASSET_INDEX            "/index.html"
+#define HTTP_ASSET_CACHE_CONTROL    "no-cache"      // 可以缓存，但每次使用前用 ETag 验证
+#define HTTP_ETAG_HDR_MAX           128
+
+// 按 If-None-Match 判断客户端缓存是否仍有效，值可能是 "*"、逗号分隔的列表或 W/ 前缀的弱标签
+static bool http_asset_not_modified(httpd_req_t *req, const http_asset_t *asset)
 {
-    ESP_LOGI(TAG, "Free Stack for server task: '%d'", uxTaskGetStackHighWaterMark(NULL));
+    char value[HTTP_ETAG_HDR_MAX];
+    size_t len = httpd_req_get_hdr_value_len(req, "If-None-Match");
 
-    httpd_resp_set_type(req, HTTPD_TYPE_TEXT);
-    size_t len = _binary_index_html_end - _binary_index_html_start;
-    httpd_resp_send(req, _binary_index_html_start, len);
-    return ESP_OK;
+    if (len == 0 || len >= sizeof(value)) {
+        return false;
+    }
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", value, sizeof(value)) != ESP_OK) {
+        return false;
+    }
+
+    return strcmp(value, "*") == 0 || strstr(value, asset->etag) != NULL;
 }
 
-static esp_err_t echo_post_handler(httpd_req_t *req)
+/*
+ * 与 httpd 默认的发送函数相同，另外累计写入的字节数
+ * 资源请求时装到该连接上，之后一直保留，每次资源请求开始时清零
+ */
+static int http_counting_send(httpd_handle_t hd, int sockfd, const char *buf, size_t buf_len, int flags)
 {
-    ESP_LOGI(TAG, "/echo handler read content length %d", req->content_len);
-
-    char*  buf = malloc(req->content_len + 1);
-    size_t off = 0;
-    int    ret;
-
-    if (!buf) {
-        ESP_LOGE(TAG, "Failed to allocate memory of %d bytes!", req->content_len + 1);
-        httpd_resp_send_500(req);
-        return ESP_FAIL;
-    }
-
-    while (off < req->content_len) {
-        /* Read data received in the request */
-        ret = httpd_req_recv(req, buf + off, req->content_len - off);
-        if (ret <= 0) {
-            if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
-                httpd_resp_send_408(req);
-            }
-            free (buf);
-            return ESP_FAIL;
-        }
-        off += ret;
-        ESP_LOGI(TAG, "/echo handler recv length %d", ret);
+    if (buf == NULL) {
+        return HTTPD_SOCK_ERR_INVALID;
+    }
+
+    int ret = send(sockfd, buf, buf_len, flags);
+    if (ret < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? HTTPD_SOCK_ERR_TIMEOUT
+               : HTTPD_SOCK_ERR_FAIL;
+    }
+
+    g_sock_bytes_sent += ret;
+    return ret;
+}
+
+static void asset_stats_update(bool not_modified, esp_err_t err, int64_t elapsed_us)
+{
+    if (err != ESP_OK) {
+        g_asset_stats.send_errors++;
+        return;
     }
-    buf[off] = '\0';
 
-    if (req->content_len < 128) {
-        ESP_LOGI(TAG, "/echo handler read %s", buf);
+    g_asset_stats.requests++;
+    g_asset_stats.not_modified += not_modified;
+    g_asset_stats.bytes_sent += g_sock_bytes_sent;
+    g_asset_stats.last_bytes = g_sock_bytes_sent;
+    g_asset_stats.last_us = elapsed_us;
+    g_asset_stats.total_us += elapsed_us;
+    if (elapsed_us > g_asset_stats.max_us) {
+        g_asset_stats.max_us = elapsed_us;
     }
+}
+
+// 其他 GET 路由都不匹配时查找资源，"/" 指向 index.html，忽略查询串
+static esp_err_t asset_get_handler(httpd_req_t *req)
+{
+    http_asset_t found;
+    const http_asset_t *asset = &found;
+    const char *path = req->uri;
+    size_t len = strcspn(req->uri, "?#");
+    int64_t start = esp_timer_get_time();
+    bool not_modified;
+    esp_err_t err;
+
+    if (len == 1) {
+        path = HTTP_ASSET_INDEX;
+        len = strlen(HTTP_ASSET_INDEX);
+    }
+    if (asset_fs_find(path, len, &found) != 0) {
+        return http_404_error_handler(req, HTTPD_404_NOT_FOUND);
+    }
+
+    g_sock_bytes_sent = 0;
+    httpd_sess_set_send_override(req->handle, httpd_req_to_sockfd(req), http_counting_send);
+
+    httpd_resp_set_hdr(req, "ETag", asset->etag);
+    httpd_resp_set_hdr(req, "Cache-Control", HTTP_ASSET_CACHE_CONTROL);
+
+    not_modified = http_asset_not_modified(req, asset);
+    if (not_modified) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        err = httpd_resp_send(req, NULL, 0);
+    } else {
+        httpd_resp_set_type(req, asset->mime);
+        if (asset->gzip) {
+            // 只保存了压缩后的内容，浏览器都支持 gzip
+            httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+            httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+        }
+        err = httpd_resp_send(req, (const char *)asset->data, asset->len);
+    }
+
+    int64_t elapsed_us = esp_timer_get_time() - start;
+    asset_stats_update(not_modified, err, elapsed_us);
+    ESP_LOGD(TAG, "GET %s -> %s, %u bytes sent, %lld us", req->uri, not_modified ? "304" : "200",
+             (unsigned int)g_sock_bytes_sent, elapsed_us);
 
-    /* Search for Custom header field */
-    char*  req_hdr = 0;
-    size_t hdr_len = httpd_req_get_hdr_value_len(req, "Custom");
-    if (hdr_len) {
-        /* Read Custom header value */
-        req_hdr = malloc(hdr_len + 1);
-        if (!req_hdr) {
-            ESP_LOGE(TAG, "Failed to allocate memory of %d bytes!", hdr_len + 1);
-            httpd_resp_send_500(req);
-            return ESP_FAIL;
+    return err;
+}
+
+#define HTTP_ECHO_MAX_BODY          (64 * 1024)
+#define HTTP_ECHO_CUSTOM_HDR_MAX    64
+
+// 边收边回，响应用 chunked 编码，不需要先知道长度，也不缓存整个请求体
+static int echo_chunk_handler(httpd_req_t *req, size_t off, const char *data, size_t len)
+{
+    // 响应头在第一次发送时才写出，值必须保持到那时
+    static char custom[HTTP_ECHO_CUSTOM_HDR_MAX];
+
+    if (off == 0) {
+        ESP_LOGI(TAG, "/echo handler read content length %d", req->content_len);
+
+        /* Search for Custom header field */
+        size_t hdr_len = httpd_req_get_hdr_value_len(req, "Custom");
+        if (hdr_len > 0 && hdr_len < sizeof(custom)
+            && httpd_req_get_hdr_value_str(req, "Custom", custom, sizeof(custom)) == ESP_OK) {
+            /* Set as additional header for response packet */
+            httpd_resp_set_hdr(req, "Custom", custom);
         }
-        httpd_req_get_hdr_value_str(req, "Custom", req_hdr, hdr_len + 1);
+    }
+
+    if (!data) {
+        return httpd_resp_send_chunk(req, NULL, 0) == ESP_OK ? 0 : -1;
+    }
 
-        /* Set as additional header for response packet */
-        httpd_resp_set_hdr(req, "Custom", req_hdr);
+    if (off == 0 && req->content_len < 128) {
+        ESP_LOGI(TAG, "/echo handler read %.*s", len, data);
     }
-    httpd_resp_send(req, buf, req->content_len);
-    free (req_hdr);
-    free (buf);
+
+    return httpd_resp_send_chunk(req, data, len) == ESP_OK ? 0 : -1;
+}
+
+static const http_body_route_t echo_route = {
+    .max_len  = HTTP_ECHO_MAX_BODY,
+    .on_chunk = echo_chunk_handler,
+};
+
+static esp_err_t boot_get_handler(httpd_req_t *req)
+{
+    char buf[BOOT_TIMELINE_MAX * 48];
+    int len = boot_timeline_format(buf, sizeof(buf));
+
+    httpd_resp_set_type(req, HTTPD_TYPE_TEXT);
+    httpd_resp_send(req, buf, len);
     return ESP_OK;
 }
 
 static const httpd_uri_t basic_handlers[] = {
-    { .uri      = "/",
-      .method   = HTTP_GET,
-      .handler  = hello_get_handler,
-      .user_ctx = NULL,
-    },
     { .uri      = "/echo",
       .method   = HTTP_POST,
-      .handler  = echo_post_handler,
+      .handler  = http_body_handler,
+      .user_ctx = (void *)&echo_route,
+    },
+    { .uri      = "/boot",
+      .method   = HTTP_GET,
+      .handler  = boot_get_handler,
       .user_ctx = NULL,
     }
 };
 
+// 通配路由按注册顺序最后匹配，必须在其他 GET 路由之后注册
+static const httpd_uri_t asset_handler = {
+    .uri      = "/*",
+    .method   = HTTP_GET,
+    .handler  = asset_get_handler,
+    .user_ctx = NULL,
+};
+
 static const int basic_handlers_no = sizeof(basic_handlers)/sizeof(httpd_uri_t);
 static void register_basic_handlers(httpd_handle_t hd)
 {
@@ -126,9 +230,9 @@ static void register_basic_handlers(httpd_handle_t hd)
 esp_err_t http_404_error_handler(httpd_req_t *req, httpd_err_code_t err)
 {
     char response[128];
-    strncpy(response, req->uri, sizeof(response));
 
-    snprintf(response + strlen(req->uri), sizeof(response) - strlen(req->uri), " URI is not available");
+    // uri 最长 CONFIG_HTTPD_MAX_URI_LEN，截断后再拼接
+    snprintf(response, sizeof(response), "%.96s URI is not available", req->uri);
     httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, response);
     return ESP_FAIL;
 }
@@ -140,10 +244,14 @@ static httpd_handle_t start_webserver(void)
     /* Modify this setting to match the number of test URI handlers */
     config.max_uri_handlers  = 9;
     config.server_port = 80;
+    // 资源不再每个文件占用一个路由，由 "/*" 统一查找
+    config.uri_match_fn = httpd_uri_match_wildcard;
 
     /* This check should be a part of http_server */
     config.max_open_sockets = (CONFIG_LWIP_MAX_SOCKETS - 3);
 
+    asset_fs_init();
+
     g_pre_start_mem = esp_get_free_heap_size();
     ESP_LOGI(TAG, "HTTPD Start: Current free memory: %d", g_pre_start_mem);
 
@@ -158,6 +266,9 @@ static httpd_handle_t start_webserver(void)
         ESP_LOGI(TAG, "Max Stack Size: '%d'", config.stack_size);
 
         register_basic_handlers(server);
+        user_http_api_register(server);
+        http_ws_register(server);
+        httpd_register_uri_handler(server, &asset_handler);
         httpd_register_err_handler(server, HTTPD_404_NOT_FOUND, http_404_error_handler);
 
         return server;
@@ -167,34 +278,19 @@ static httpd_handle_t start_webserver(void)
     return NULL;
 }
 
-static esp_err_t stop_webserver(httpd_handle_t server)
+// 服务器监听 INADDR_ANY，不依赖 IP，启动后在断网重连期间保持运行
+int user_http_server_init(void)
 {
-    if (server == NULL) {
-        return ESP_OK;
+    if (g_httpd_server) {
+        return 0;
     }
 
-    esp_err_t err = httpd_stop(server);
-
-    g_post_stop_mem = esp_get_free_heap_size();
-    ESP_LOGI(TAG, "HTTPD Stop: Current free memory: %d", g_post_stop_mem);
+    g_httpd_server = start_webserver();
 
-    // Stop the httpd server
-    return err;
+    return g_httpd_server ? 0 : -1;
 }
 
-void user_http_server_task(void *pvParameters)
+void user_http_server_get_asset_stats(user_http_asset_stats_t *stats)
 {
-    g_httpd_server = start_webserver();
-
-    while (1)
-    {
-        if (g_system_status.wifi_connect_status == 0) {
-            stop_webserver(g_httpd_server);
-            g_httpd_server = NULL;
-        }
-
-        vTaskDelay(pdMS_TO_TICKS(1000));
-    }
-
-    vTaskDelete(NULL);
+    *stats = g_asset_stats;
 }
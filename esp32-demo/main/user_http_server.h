@@ -1,6 +1,22 @@
 #ifndef __USER_HTTP_SERVER_H__
 #define __USER_HTTP_SERVER_H__
 
-void user_http_server_task(void *pvParameters);
+#include <stdint.h>
+
+// 静态资源的响应统计，字节数为实际写入 socket 的长度（含响应头），耗时从查找资源到响应交给协议栈
+typedef struct {
+    uint32_t requests;          // 200 和 304 的请求数，不含 404
+    uint32_t not_modified;      // 304 的请求数
+    uint32_t send_errors;
+    uint64_t bytes_sent;
+    uint32_t last_bytes;
+    int64_t last_us;
+    int64_t max_us;
+    int64_t total_us;
+} user_http_asset_stats_t;
+
+int user_http_server_init(void);
+
+void user_http_server_get_asset_stats(user_http_asset_stats_t *stats);
 
 #endif
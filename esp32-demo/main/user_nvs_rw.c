@@ -3,11 +3,14 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+
+#include <string.h>
 
 #include "nvs_flash.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
-#include "main.h"
 #include "user_nvs_rw.h"
 
 static const char *TAG = "user_nvs_rw.c";
@@ -45,173 +48,380 @@ static const char *type_to_str(nvs_type_t type)
     return "Unknown";
 }
 
-int user_nvs_write_bemfa_info(char *namespace, char *ssid, char *password, char *token)
-{
-    ESP_LOGW(TAG, "NVS write namespace:%s bemfa info ssid:%s pass:%s token:%s", namespace, ssid, password, token);
+/*
+ * 配置存储
+ * 所有配置由 user_nvs_rw.h 中的 USER_CONFIG_SCHEMA 描述，保存为一个 blob。
+ * 启动时一次读入 RAM，之后的读操作不再访问 flash；
+ * 写操作只更新 RAM 并标记 dirty，事务结束或防抖定时器到期时整体写入并 commit 一次。
+ */
+
+// 旧版本按 key 分散保存的配置，仅用于迁移
+#define NVS_LEGACY_RST_CNT_KEY      "rst_cnt"
+#define NVS_LEGACY_BIND_SSID        "bind_ssid"
+#define NVS_LEGACY_BIND_PASS        "bind_pass"
+#define NVS_LEGACY_BEMFA_TOKEN      "bemfa_token"
+#define NVS_LEGACY_BEMFA_TOPIC      "bemfa_topic"
+
+static const char *const g_legacy_keys[] = {
+    NVS_LEGACY_RST_CNT_KEY,
+    NVS_LEGACY_BIND_SSID,
+    NVS_LEGACY_BIND_PASS,
+    NVS_LEGACY_BEMFA_TOKEN,
+    NVS_LEGACY_BEMFA_TOPIC,
+};
 
-    // Open NVS handle
-    nvs_handle_t my_handle;
-    esp_err_t ret = nvs_open(namespace, NVS_READWRITE, &my_handle);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%s) opening NVS handle!", esp_err_to_name(ret));
-        return -1;
-    }
+// 第一个发布的 blob 版本，之前的版本 1、2 没有发布过
+#define USER_CONFIG_FIRST_BLOB_VERSION  3
 
-    ret = nvs_set_str(my_handle, NVS_BIND_SSID, ssid);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to write namespace:%s key:%s value:%s", namespace, NVS_BIND_SSID, ssid);
+static user_config_t g_user_config;
+static bool g_user_config_dirty = false;
+
+static nvs_handle_t g_nvs_handle;
+static bool g_nvs_opened = false;
+static SemaphoreHandle_t g_nvs_lock;
+static esp_timer_handle_t g_nvs_commit_timer;
+static TaskHandle_t g_nvs_commit_task = NULL;
+static int g_nvs_txn_depth = 0;
+static uint32_t g_nvs_commit_cnt = 0;
+
+static void user_config_set_defaults(user_config_t *cfg)
+{
+    memset(cfg, 0, sizeof(user_config_t));
+    cfg->version = USER_CONFIG_VERSION;
+    cfg->size = sizeof(user_config_t);
+}
+
+// 只读取，旧 key 在新配置 commit 之后才由 legacy_erase_keys 删除
+static void legacy_read_str(const char *key, char *value, size_t size)
+{
+    if (nvs_get_str(g_nvs_handle, key, value, &size) != ESP_OK) {
+        value[0] = '\0';
     }
+}
 
-    ret = nvs_set_str(my_handle, NVS_BIND_PASS, password);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to write namespace:%s key:%s value:%s", namespace, NVS_BIND_PASS, password);
+/*
+ * 删除旧格式的 key，必须在新配置写入并 commit 之后调用，中途掉电时旧数据仍在，下次启动重新迁移；
+ * 新配置已保存后才掉电的，下次启动在这里删完。没有旧 key 时不写 flash。
+ */
+static int legacy_erase_keys(void)
+{
+    bool erased = false;
+
+    for (int i = 0; i < sizeof(g_legacy_keys) / sizeof(g_legacy_keys[0]); i++) {
+        esp_err_t ret = nvs_erase_key(g_nvs_handle, g_legacy_keys[i]);
+        if (ret == ESP_OK) {
+            erased = true;
+        } else if (ret != ESP_ERR_NVS_NOT_FOUND) {
+            ESP_LOGE(TAG, "Failed to erase legacy key %s (%s)", g_legacy_keys[i], esp_err_to_name(ret));
+            return -1;
+        }
     }
 
-    ret = nvs_set_str(my_handle, NVS_BEMFA_TOKEN, token);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to write namespace:%s key:%s value:%s", namespace, NVS_BEMFA_TOKEN, token);
+    if (!erased) {
+        return 0;
     }
 
-    ESP_LOGI(TAG, "Committing updates in NVS...");
-    ret = nvs_commit(my_handle);
-    if (ret != ESP_OK) {
+    ESP_LOGI(TAG, "Legacy keys erased");
+    if (nvs_commit(g_nvs_handle) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to commit NVS changes!");
+        return -1;
     }
-
-    // Close
-    nvs_close(my_handle);
-    ESP_LOGI(TAG, "NVS handle closed.");
+    g_nvs_commit_cnt++;
 
     return 0;
 }
 
+#define USER_CONFIG_BLOB_MAX    512
 
-int user_nvs_read_bemfa_info(char *namespace, char *ssid, size_t ssid_size, char *password, size_t password_size, char *token, size_t token_size)
+/*
+ * 迁移钩子：把旧版本的数据升级到 USER_CONFIG_VERSION
+ * old 为 NULL 表示旧的按 key 保存的格式（版本 0）
+ */
+static int user_config_migrate(const uint8_t *old, size_t old_size, user_config_t *cfg)
 {
-    ESP_LOGW(TAG, "NVS Read namespace:%s bemfa info ", namespace);
+    int from_version = 0;
 
-    // Open NVS handle
-    nvs_handle_t my_handle;
-    esp_err_t ret = nvs_open(namespace, NVS_READONLY, &my_handle);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%s) opening NVS handle!", esp_err_to_name(ret));
-        return -1;
+    if (old && old_size >= 2 * sizeof(uint16_t)) {
+        from_version = old[0] | (old[1] << 8);
     }
-    ret = nvs_get_str(my_handle, NVS_BIND_SSID, ssid, &ssid_size);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to read namespace:%s key:%s", namespace, NVS_BIND_SSID);
+    ESP_LOGW(TAG, "Migrate config from version %d to %d", from_version, USER_CONFIG_VERSION);
+
+    user_config_set_defaults(cfg);
+
+    if (old == NULL) {
+        // 复位计数已改由 reset_counter 维护，旧值不再读取
+        legacy_read_str(NVS_LEGACY_BIND_SSID, cfg->bind_ssid, sizeof(cfg->bind_ssid));
+        legacy_read_str(NVS_LEGACY_BIND_PASS, cfg->bind_pass, sizeof(cfg->bind_pass));
+        legacy_read_str(NVS_LEGACY_BEMFA_TOKEN, cfg->bemfa_token, sizeof(cfg->bemfa_token));
+        legacy_read_str(NVS_LEGACY_BEMFA_TOPIC, cfg->bemfa_topic, sizeof(cfg->bemfa_topic));
+        return 0;
     }
 
-    ret = nvs_get_str(my_handle, NVS_BIND_PASS, password, &password_size);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to read namespace:%s key:%s", namespace, NVS_BIND_PASS);
+    // 发布之后的版本只在末尾追加字段
+    if (from_version >= USER_CONFIG_FIRST_BLOB_VERSION && from_version < USER_CONFIG_VERSION &&
+        old_size < sizeof(user_config_t)) {
+        size_t hdr = 2 * sizeof(uint16_t);
+        memcpy((uint8_t *)cfg + hdr, old + hdr, old_size - hdr);
+        return 0;
     }
 
-    ret = nvs_get_str(my_handle, NVS_BEMFA_TOKEN, token, &token_size);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to read namespace:%s key:%s", namespace, NVS_BEMFA_TOKEN);
+    ESP_LOGE(TAG, "Unknown config version %d, reset to defaults", from_version);
+    return -1;
+}
+
+static void user_config_load(void)
+{
+    int64_t start = esp_timer_get_time();
+    uint8_t blob[USER_CONFIG_BLOB_MAX];
+    size_t size = sizeof(blob);
+
+    esp_err_t ret = nvs_get_blob(g_nvs_handle, NVS_CONFIG_KEY, blob, &size);
+    if (ret == ESP_OK && size == sizeof(user_config_t)) {
+        memcpy(&g_user_config, blob, sizeof(user_config_t));
+        if (g_user_config.version == USER_CONFIG_VERSION) {
+            ESP_LOGI(TAG, "Config loaded in %lld us", esp_timer_get_time() - start);
+            return;
+        }
     }
 
-    // Close
-    nvs_close(my_handle);
-    ESP_LOGI(TAG, "NVS handle closed.");
+    if (ret == ESP_OK) {
+        user_config_migrate(blob, size, &g_user_config);
+    } else {
+        if (ret != ESP_ERR_NVS_NOT_FOUND) {
+            ESP_LOGE(TAG, "Error (%s) loading config", esp_err_to_name(ret));
+        }
+        user_config_migrate(NULL, 0, &g_user_config);
+    }
+    g_user_config_dirty = true;
 
-    return 0;
+    ESP_LOGI(TAG, "Config migrated in %lld us", esp_timer_get_time() - start);
 }
 
-int user_nvs_write_int8(char *namespace, char *key, int8_t value)
+// 调用前需持有 g_nvs_lock
+static int nvs_config_flush_locked(void)
 {
-    ESP_LOGI(TAG, "NVS write namespace:%s key:%s i8 value:%d", namespace, key, value);
+    if (!g_user_config_dirty) {
+        return 0;
+    }
+    g_user_config_dirty = false;
 
-    // Open NVS handle
-    nvs_handle_t my_handle;
-    esp_err_t ret = nvs_open(namespace, NVS_READWRITE, &my_handle);
+    // 失败时保持 dirty，下次 flush 重试
+    esp_err_t ret = nvs_set_blob(g_nvs_handle, NVS_CONFIG_KEY, &g_user_config, sizeof(user_config_t));
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%s) opening NVS handle!", esp_err_to_name(ret));
+        ESP_LOGE(TAG, "Failed to write config (%s)", esp_err_to_name(ret));
+        g_user_config_dirty = true;
         return -1;
     }
 
-    ret = nvs_set_i8(my_handle, key, value);
+    ESP_LOGI(TAG, "Committing config in NVS...");
+    ret = nvs_commit(g_nvs_handle);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to write namespace:%s key:%s value:%d", namespace, key, value);
+        ESP_LOGE(TAG, "Failed to commit NVS changes!");
+        g_user_config_dirty = true;
+        return -1;
     }
+    g_nvs_commit_cnt++;
 
-    ESP_LOGI(TAG, "Committing updates in NVS...");
-    ret = nvs_commit(my_handle);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to commit NVS changes!");
+    return 0;
+}
+
+// commit 可能擦除 flash，耗时较长，不能放在所有 esp_timer 回调共用的任务里执行
+static void nvs_commit_task(void *pvParameters)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        user_nvs_flush();
     }
+}
 
-    // Close
-    nvs_close(my_handle);
-    ESP_LOGI(TAG, "NVS handle closed.");
+// 运行在 esp_timer 任务中，只唤醒 commit 任务
+static void nvs_commit_timer_callback(void *arg)
+{
+    xTaskNotifyGive(g_nvs_commit_task);
+}
+
+// 修改配置后调用：事务中等待事务结束，否则重新开始防抖计时
+static void nvs_schedule_commit_locked(void)
+{
+    if (g_nvs_txn_depth > 0 || g_nvs_commit_timer == NULL) {
+        return;
+    }
+
+    esp_timer_stop(g_nvs_commit_timer);
+    esp_timer_start_once(g_nvs_commit_timer, NVS_COMMIT_DEBOUNCE_MS * 1000);
+}
+
+static int user_config_set_field(void *field, const void *value, size_t size)
+{
+    if (!g_nvs_opened) {
+        return -1;
+    }
+
+    xSemaphoreTake(g_nvs_lock, portMAX_DELAY);
+    // 值没有变化时不写 flash
+    if (memcmp(field, value, size) != 0) {
+        memcpy(field, value, size);
+        g_user_config_dirty = true;
+        nvs_schedule_commit_locked();
+    }
+    xSemaphoreGive(g_nvs_lock);
 
     return 0;
 }
 
-int user_nvs_write_string(char *namespace, char *key, char *value)
+static int user_config_set_str_field(char *field, size_t field_size, const char *value)
 {
-    ESP_LOGW(TAG, "NVS write namespace:%s key:%s str value:%s", namespace, key, value);
+    char tmp[field_size];
 
-    // Open NVS handle
-    nvs_handle_t my_handle;
-    esp_err_t ret = nvs_open(namespace, NVS_READWRITE, &my_handle);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%s) opening NVS handle!", esp_err_to_name(ret));
+    memset(tmp, 0, field_size);
+    if (value) {
+        strncpy(tmp, value, field_size - 1);
+    }
+
+    return user_config_set_field(field, tmp, field_size);
+}
+
+static int user_config_get_field(void *out, const void *field, size_t size)
+{
+    if (!g_nvs_opened) {
+        memset(out, 0, size);
         return -1;
     }
 
-    ret = nvs_set_str(my_handle, key, value);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to write namespace:%s key:%s value:%s", namespace, key, value);
+    xSemaphoreTake(g_nvs_lock, portMAX_DELAY);
+    memcpy(out, field, size);
+    xSemaphoreGive(g_nvs_lock);
+
+    return 0;
+}
+
+#define USER_CONFIG_DEFINE_STR(name, len)                                                   \
+    int user_config_set_##name(const char *value)                                           \
+    {                                                                                       \
+        return user_config_set_str_field(g_user_config.name, sizeof(g_user_config.name), value); \
+    }                                                                                       \
+    int user_config_get_##name(char *value, size_t size)                                    \
+    {                                                                                       \
+        char tmp[len];                                                                      \
+        int ret = user_config_get_field(tmp, g_user_config.name, sizeof(tmp));              \
+        snprintf(value, size, "%s", tmp);                                                   \
+        return ret;                                                                         \
+    }
+#define USER_CONFIG_DEFINE_I8(name)                                                         \
+    int user_config_set_##name(int8_t value)                                                \
+    {                                                                                       \
+        return user_config_set_field(&g_user_config.name, &value, sizeof(value));           \
+    }                                                                                       \
+    int8_t user_config_get_##name(void)                                                     \
+    {                                                                                       \
+        int8_t value = 0;                                                                   \
+        user_config_get_field(&value, &g_user_config.name, sizeof(value));                  \
+        return value;                                                                       \
     }
 
-    ESP_LOGI(TAG, "Committing updates in NVS...");
-    ret = nvs_commit(my_handle);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to commit NVS changes!");
+#define USER_CONFIG_DEFINE_BLOB(name, len)                                                  \
+    int user_config_set_##name(const uint8_t value[len])                                    \
+    {                                                                                       \
+        return user_config_set_field(g_user_config.name, value, len);                       \
+    }                                                                                       \
+    int user_config_get_##name(uint8_t value[len])                                          \
+    {                                                                                       \
+        return user_config_get_field(value, g_user_config.name, len);                       \
     }
 
-    // Close
-    nvs_close(my_handle);
-    ESP_LOGI(TAG, "NVS handle closed.");
+USER_CONFIG_SCHEMA(USER_CONFIG_DEFINE_STR, USER_CONFIG_DEFINE_I8, USER_CONFIG_DEFINE_BLOB)
+
+int user_config_read(user_config_t *cfg)
+{
+    return user_config_get_field(cfg, &g_user_config, sizeof(user_config_t));
+}
+
+int user_nvs_txn_begin(void)
+{
+    if (!g_nvs_opened) {
+        return -1;
+    }
+
+    xSemaphoreTake(g_nvs_lock, portMAX_DELAY);
+    g_nvs_txn_depth++;
+    xSemaphoreGive(g_nvs_lock);
 
     return 0;
 }
 
-int user_nvs_read_string(char *namespace, char *key, char *value, size_t size)
+int user_nvs_txn_commit(void)
 {
-    ESP_LOGW(TAG, "NVS Read namespace:%s key:%s str ", namespace, key);
+    int ret = 0;
 
-    // Open NVS handle
-    nvs_handle_t my_handle;
-    esp_err_t ret = nvs_open(namespace, NVS_READONLY, &my_handle);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%s) opening NVS handle!", esp_err_to_name(ret));
+    if (!g_nvs_opened) {
         return -1;
     }
 
-    ret = nvs_get_str(my_handle, key, value, &size);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to Read namespace:%s key:%s", namespace, key);
+    xSemaphoreTake(g_nvs_lock, portMAX_DELAY);
+    if (g_nvs_txn_depth > 0) {
+        g_nvs_txn_depth--;
     }
+    if (g_nvs_txn_depth == 0) {
+        if (g_nvs_commit_timer) {
+            esp_timer_stop(g_nvs_commit_timer);
+        }
+        ret = nvs_config_flush_locked();
+    }
+    xSemaphoreGive(g_nvs_lock);
 
-    // Close
-    nvs_close(my_handle);
-    ESP_LOGI(TAG, "NVS handle closed.");
+    return ret;
+}
 
-    return 0;
+int user_nvs_flush(void)
+{
+    int ret = 0;
+
+    if (!g_nvs_opened) {
+        return -1;
+    }
+
+    xSemaphoreTake(g_nvs_lock, portMAX_DELAY);
+    ret = nvs_config_flush_locked();
+    xSemaphoreGive(g_nvs_lock);
+
+    return ret;
+}
+
+uint32_t user_nvs_get_commit_count(void)
+{
+    return g_nvs_commit_cnt;
+}
+
+static void dump_user_config(void)
+{
+    user_config_t cfg;
+
+    user_config_read(&cfg);
+    ESP_LOGI(TAG, "Config version: %d size: %d", cfg.version, cfg.size);
+#define USER_CONFIG_DUMP_STR(name, len) ESP_LOGI(TAG, "Config: '%s', Type: str[%d] val:%s", #name, len, cfg.name);
+#define USER_CONFIG_DUMP_I8(name)       ESP_LOGI(TAG, "Config: '%s', Type: i8 value: %d", #name, cfg.name);
+#define USER_CONFIG_DUMP_BLOB(name, len)                                        \
+    ESP_LOGI(TAG, "Config: '%s', Type: blob[%d]", #name, len);                  \
+    ESP_LOG_BUFFER_HEX(TAG, cfg.name, len);
+    USER_CONFIG_SCHEMA(USER_CONFIG_DUMP_STR, USER_CONFIG_DUMP_I8, USER_CONFIG_DUMP_BLOB)
+#undef USER_CONFIG_DUMP_STR
+#undef USER_CONFIG_DUMP_I8
+#undef USER_CONFIG_DUMP_BLOB
 }
 
 int dump_nvs_key_value(char *namespace)
 {
     ESP_LOGW(TAG, "[%s] NVS dump namespace:%s", __func__, namespace);
 
-    nvs_handle_t my_handle;
-    esp_err_t ret = nvs_open(namespace, NVS_READONLY, &my_handle);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%s) opening NVS handle!", esp_err_to_name(ret));
-        return -1;
+    nvs_handle_t my_handle = g_nvs_handle;
+    bool temp_handle = !g_nvs_opened || strcmp(namespace, NVS_NAMESPACE) != 0;
+    esp_err_t ret = ESP_OK;
+    if (temp_handle) {
+        ret = nvs_open(namespace, NVS_READONLY, &my_handle);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Error (%s) opening NVS handle!", esp_err_to_name(ret));
+            return -1;
+        }
     }
 
     nvs_iterator_t it = NULL;
@@ -284,15 +494,18 @@ int dump_nvs_key_value(char *namespace)
     }
     nvs_release_iterator(it);
 
-    nvs_close(my_handle);
-    ESP_LOGI(TAG, "NVS handle closed.");
+    if (temp_handle) {
+        nvs_close(my_handle);
+        ESP_LOGI(TAG, "NVS handle closed.");
+    } else {
+        dump_user_config();
+    }
 
     return 0;
 }
 
 int user_nvs_init(void)
 {
-    int8_t system_reset_counter = 0;
     //Initialize NVS
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
@@ -301,56 +514,35 @@ int user_nvs_init(void)
     }
     ESP_ERROR_CHECK(ret);
 
+    g_nvs_lock = xSemaphoreCreateMutex();
+    if (xTaskCreate(nvs_commit_task, "nvs_commit_task", NVS_COMMIT_TASK_STACK, NULL, NVS_COMMIT_TASK_PRIO, &g_nvs_commit_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create nvs commit task");
+        return -1;
+    }
+
+    const esp_timer_create_args_t commit_timer_args = {
+            .callback = &nvs_commit_timer_callback,
+            .name = "nvs_commit_timer",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&commit_timer_args, &g_nvs_commit_timer));
+
     do {
-        // Open NVS handle
-        nvs_handle_t my_handle;
-        ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &my_handle);
+        // 整个运行期间只打开一次
+        ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &g_nvs_handle);
         if (ret != ESP_OK) {
             ESP_LOGE(TAG, "Error (%s) opening NVS handle!", esp_err_to_name(ret));
             ret = -1;
             break;
         }
+        g_nvs_opened = true;
 
-        // Read back the value
-        ret = nvs_get_i8(my_handle, NVS_RST_CNT_KEY, &system_reset_counter);
-        switch (ret) {
-            case ESP_OK:
-                ESP_LOGI(TAG, "Read sys reset counter = %d", system_reset_counter);
-                break;
-            case ESP_ERR_NVS_NOT_FOUND:
-                ESP_LOGW(TAG, "The value is not initialized yet!");
-                break;
-            default:
-                ESP_LOGE(TAG, "Error (%s) reading!", esp_err_to_name(ret));
-        }
+        user_config_load();
 
-        if (system_reset_counter >= 5) {
-            g_clean_wifi_info_flag = 1;
-
-            ESP_LOGI(TAG, "Write sys reset counter = 0");
-            ret = nvs_set_i8(my_handle, NVS_RST_CNT_KEY, 0);
-            if (ret != ESP_OK) {
-                ESP_LOGE(TAG, "Failed to write counter!");
-            }
-        } else {
-            system_reset_counter++;
-            ESP_LOGI(TAG, "Write sys reset counter = %d", system_reset_counter);
-            ret = nvs_set_i8(my_handle, NVS_RST_CNT_KEY, system_reset_counter);
-            if (ret != ESP_OK) {
-                ESP_LOGE(TAG, "Failed to write counter!");
-            }
+        // 迁移产生的修改立即落盘，成功后才删除旧 key，两步分别 commit
+        ret = user_nvs_flush();
+        if (ret == 0) {
+            ret = legacy_erase_keys();
         }
-
-        ESP_LOGI(TAG, "Committing updates in NVS...");
-        ret = nvs_commit(my_handle);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to commit NVS changes!");
-        }
-
-        // Close
-        nvs_close(my_handle);
-        ESP_LOGI(TAG, "NVS handle closed.");
-
     } while (0);
 
     return ret;
@@ -1,22 +1,69 @@
 #ifndef __USER_NVS_RW_H__
 #define __USER_NVS_RW_H__
 
+#include <stdint.h>
+#include <stddef.h>
+
 // NVS
 #define NVS_NAMESPACE          "storage"
-#define NVS_RST_CNT_KEY        "rst_cnt"
-#define NVS_BIND_SSID          "bind_ssid"
-#define NVS_BIND_PASS          "bind_pass"
-#define NVS_BEMFA_TOKEN        "bemfa_token"
-#define NVS_BEMFA_TOPIC        "bemfa_topic"
+#define NVS_CONFIG_KEY         "config"
+
+#define NVS_COMMIT_DEBOUNCE_MS 1000        // 写入后延迟 commit 的时间
+#define NVS_COMMIT_TASK_STACK  3072        // 防抖到期后执行 commit 的任务
+#define NVS_COMMIT_TASK_PRIO   2
+
+/*
+ * 配置表，STR(name, size) 为定长字符串（含结尾 '\0'），I8(name) 为 int8_t，BLOB(name, size) 为定长二进制
+ * 修改字段时增加 USER_CONFIG_VERSION，并在迁移钩子中转换旧版本的数据；
+ * 只在末尾追加字段时，旧数据按前缀复制，新字段为 0
+ */
+#define USER_CONFIG_VERSION    3
+
+#define USER_CONFIG_SCHEMA(STR, I8, BLOB)   \
+    STR(bind_ssid,   33)                    \
+    STR(bind_pass,   65)                    \
+    STR(bemfa_token, 64)                    \
+    STR(bemfa_topic, 32)                    \
+    BLOB(wifi_bssid, 6)                     \
+    I8(wifi_channel)                        \
+    I8(wifi_authmode)
+
+#define USER_CONFIG_STRUCT_STR(name, len)   char name[len];
+#define USER_CONFIG_STRUCT_I8(name)         int8_t name;
+#define USER_CONFIG_STRUCT_BLOB(name, len)  uint8_t name[len];
+
+typedef struct __attribute__((packed)) {
+    uint16_t version;
+    uint16_t size;
+    USER_CONFIG_SCHEMA(USER_CONFIG_STRUCT_STR, USER_CONFIG_STRUCT_I8, USER_CONFIG_STRUCT_BLOB)
+} user_config_t;
+
+// 字段长度，用于调用方定义缓冲区
+#define USER_CONFIG_SIZEOF(name)    sizeof(((user_config_t *)0)->name)
+
+#define USER_CONFIG_DECLARE_STR(name, len)                          \
+    int user_config_set_##name(const char *value);                  \
+    int user_config_get_##name(char *value, size_t size);
+#define USER_CONFIG_DECLARE_I8(name)                                \
+    int user_config_set_##name(int8_t value);                       \
+    int8_t user_config_get_##name(void);
+#define USER_CONFIG_DECLARE_BLOB(name, len)                         \
+    int user_config_set_##name(const uint8_t value[len]);           \
+    int user_config_get_##name(uint8_t value[len]);
+
+USER_CONFIG_SCHEMA(USER_CONFIG_DECLARE_STR, USER_CONFIG_DECLARE_I8, USER_CONFIG_DECLARE_BLOB)
 
 int user_nvs_init(void);
 int dump_nvs_key_value(char *namespace);
 
-int user_nvs_write_bemfa_info(char *namespace, char *ssid, char *password, char *token);
-int user_nvs_read_bemfa_info(char *namespace, char *ssid, size_t ssid_size, char *password, size_t password_size, char *token, size_t token_size);
+// 读取整个配置的快照
+int user_config_read(user_config_t *cfg);
 
-int user_nvs_write_int8(char *namespace, char *key, int8_t value);
-int user_nvs_write_string(char *namespace, char *key, char *value);
-int user_nvs_read_string(char *namespace, char *key, char *value, size_t size);
+// 事务内的写入只更新 RAM，最外层 commit 时一次性写入 flash；可嵌套
+int user_nvs_txn_begin(void);
+int user_nvs_txn_commit(void);
+// 立即写入所有未提交的修改，重启前调用
+int user_nvs_flush(void);
+uint32_t user_nvs_get_commit_count(void);
 
 #endif
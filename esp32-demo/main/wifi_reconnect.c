@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_wifi.h"
+#include "esp_mac.h"
+
+#include "user_nvs_rw.h"
+#include "wifi_reconnect.h"
+
+static const char *TAG = "wifi_reconnect.c";
+
+static esp_timer_handle_t g_wifi_retry_timer;
+static bool g_wifi_directed = false;        // 当前配置是否为定向连接
+static int g_wifi_fail_cnt = 0;             // 获取 IP 前的连续失败次数
+static int64_t g_wifi_down_us = 0;          // 开始重连的时间，0 表示已连接
+
+static wifi_reconnect_stats_t g_wifi_stats;
+static uint32_t g_wifi_latency_ms[WIFI_LATENCY_SAMPLES];
+static int g_wifi_latency_idx = 0;
+static portMUX_TYPE g_wifi_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void wifi_retry_timer_callback(void *arg)
+{
+    taskENTER_CRITICAL(&g_wifi_stats_lock);
+    g_wifi_stats.attempts++;
+    taskEXIT_CRITICAL(&g_wifi_stats_lock);
+
+    esp_wifi_connect();
+}
+
+static bool wifi_cache_valid(void)
+{
+    int8_t channel = user_config_get_wifi_channel();
+    return channel > 0 && channel <= 14;
+}
+
+/*
+ * 切换定向连接 / 全信道扫描
+ * 修改的配置会被 Wi-Fi 驱动写入 NVS，所以只在模式变化时调用
+ */
+static void wifi_apply_directed(bool directed)
+{
+    wifi_config_t cfg;
+
+    if (esp_wifi_get_config(WIFI_IF_STA, &cfg) != ESP_OK) {
+        return;
+    }
+
+    if (directed) {
+        cfg.sta.bssid_set = true;
+        user_config_get_wifi_bssid(cfg.sta.bssid);
+        cfg.sta.channel = user_config_get_wifi_channel();
+        cfg.sta.threshold.authmode = user_config_get_wifi_authmode();
+        cfg.sta.scan_method = WIFI_FAST_SCAN;
+    } else {
+        cfg.sta.bssid_set = false;
+        memset(cfg.sta.bssid, 0, sizeof(cfg.sta.bssid));
+        cfg.sta.channel = 0;
+        cfg.sta.threshold.authmode = WIFI_AUTH_OPEN;
+        cfg.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+    }
+
+    esp_wifi_set_config(WIFI_IF_STA, &cfg);
+    g_wifi_directed = directed;
+}
+
+static uint32_t wifi_backoff_ms(int fail_cnt)
+{
+    int shift = fail_cnt > 8 ? 8 : fail_cnt - 1;
+    uint32_t delay = WIFI_BACKOFF_BASE_MS << (shift < 0 ? 0 : shift);
+
+    if (delay > WIFI_BACKOFF_MAX_MS) {
+        delay = WIFI_BACKOFF_MAX_MS;
+    }
+
+    // 加 0~25% 的随机抖动，避免多台设备同时重连
+    return delay + esp_random() % (delay / 4 + 1);
+}
+
+int wifi_reconnect_init(void)
+{
+    const esp_timer_create_args_t retry_timer_args = {
+            .callback = &wifi_retry_timer_callback,
+            .name = "wifi_retry_timer",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&retry_timer_args, &g_wifi_retry_timer));
+
+    g_wifi_fail_cnt = 0;
+    g_wifi_down_us = esp_timer_get_time();
+    g_wifi_stats.attempts = 1;
+
+    if (wifi_cache_valid()) {
+        ESP_LOGI(TAG, "Directed connect, channel:%d", user_config_get_wifi_channel());
+        wifi_apply_directed(true);
+    } else {
+        wifi_apply_directed(false);
+    }
+
+    return 0;
+}
+
+void wifi_reconnect_forget(void)
+{
+    uint8_t bssid[USER_CONFIG_SIZEOF(wifi_bssid)] = {0};
+
+    user_nvs_txn_begin();
+    user_config_set_wifi_bssid(bssid);
+    user_config_set_wifi_channel(0);
+    user_config_set_wifi_authmode(0);
+    user_nvs_txn_commit();
+    g_wifi_directed = false;
+}
+
+void wifi_reconnect_on_connected(const wifi_event_sta_connected_t *event)
+{
+    ESP_LOGI(TAG, "Connected to "MACSTR" channel:%d authmode:%d",
+            MAC2STR(event->bssid), event->channel, event->authmode);
+
+    // 值不变时不会写 flash
+    user_nvs_txn_begin();
+    user_config_set_wifi_bssid(event->bssid);
+    user_config_set_wifi_channel(event->channel);
+    user_config_set_wifi_authmode(event->authmode);
+    user_nvs_txn_commit();
+}
+
+int wifi_reconnect_on_disconnected(const wifi_event_sta_disconnected_t *event)
+{
+    if (g_wifi_down_us == 0) {
+        // 从已连接状态断开，先尝试定向连接回原来的 AP
+        g_wifi_down_us = esp_timer_get_time();
+        g_wifi_fail_cnt = 0;
+        if (!g_wifi_directed && wifi_cache_valid()) {
+            wifi_apply_directed(true);
+        }
+    }
+
+    g_wifi_fail_cnt++;
+    if (g_wifi_directed && g_wifi_fail_cnt >= WIFI_DIRECTED_MAX_FAIL) {
+        ESP_LOGW(TAG, "Directed connect failed, fall back to full scan");
+        wifi_apply_directed(false);
+        taskENTER_CRITICAL(&g_wifi_stats_lock);
+        g_wifi_stats.full_scans++;
+        taskEXIT_CRITICAL(&g_wifi_stats_lock);
+    }
+
+    uint32_t delay = wifi_backoff_ms(g_wifi_fail_cnt);
+    ESP_LOGI(TAG, "Disconnected, reason:%d, retry %d in %"PRIu32" ms", event->reason, g_wifi_fail_cnt, delay);
+
+    esp_timer_stop(g_wifi_retry_timer);
+    esp_timer_start_once(g_wifi_retry_timer, delay * 1000);
+
+    return g_wifi_fail_cnt;
+}
+
+void wifi_reconnect_on_got_ip(void)
+{
+    if (g_wifi_down_us == 0) {
+        return;
+    }
+
+    uint32_t latency = (esp_timer_get_time() - g_wifi_down_us) / 1000;
+    ESP_LOGI(TAG, "Connected in %"PRIu32" ms (%s, %d failures)", latency, g_wifi_directed ? "directed" : "full scan", g_wifi_fail_cnt);
+
+    taskENTER_CRITICAL(&g_wifi_stats_lock);
+    g_wifi_latency_ms[g_wifi_latency_idx] = latency;
+    g_wifi_latency_idx = (g_wifi_latency_idx + 1) % WIFI_LATENCY_SAMPLES;
+    if (g_wifi_stats.samples < WIFI_LATENCY_SAMPLES) {
+        g_wifi_stats.samples++;
+    }
+    g_wifi_stats.connects++;
+    if (g_wifi_directed) {
+        g_wifi_stats.directed_ok++;
+    }
+    taskEXIT_CRITICAL(&g_wifi_stats_lock);
+
+    g_wifi_down_us = 0;
+    g_wifi_fail_cnt = 0;
+}
+
+static int latency_cmp(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+int wifi_reconnect_get_stats(wifi_reconnect_stats_t *stats)
+{
+    uint32_t sorted[WIFI_LATENCY_SAMPLES];
+
+    taskENTER_CRITICAL(&g_wifi_stats_lock);
+    *stats = g_wifi_stats;
+    memcpy(sorted, g_wifi_latency_ms, sizeof(sorted));
+    taskEXIT_CRITICAL(&g_wifi_stats_lock);
+
+    int n = stats->samples;
+    if (n == 0) {
+        return 0;
+    }
+
+    // 未写满时样本都在数组前部
+    qsort(sorted, n, sizeof(uint32_t), latency_cmp);
+    stats->p50_ms = sorted[(n - 1) * 50 / 100];
+    stats->p90_ms = sorted[(n - 1) * 90 / 100];
+    stats->p99_ms = sorted[(n - 1) * 99 / 100];
+    stats->max_ms = sorted[n - 1];
+
+    return 0;
+}
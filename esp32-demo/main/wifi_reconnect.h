@@ -0,0 +1,44 @@
+#ifndef __WIFI_RECONNECT_H__
+#define __WIFI_RECONNECT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_wifi.h"
+
+/*
+ * STA 快速重连
+ * 缓存上次连接成功的 BSSID、信道和加密方式，启动和断线后先在该信道定向连接，
+ * 连续失败 WIFI_DIRECTED_MAX_FAIL 次后回退到全信道扫描；重试间隔按指数退避。
+ */
+
+#define WIFI_DIRECTED_MAX_FAIL      2
+#define WIFI_BACKOFF_BASE_MS        200
+#define WIFI_BACKOFF_MAX_MS         30000
+#define WIFI_LATENCY_SAMPLES        32
+
+typedef struct {
+    uint32_t attempts;          // 连接尝试次数
+    uint32_t connects;          // 成功获取 IP 次数
+    uint32_t directed_ok;       // 其中定向连接成功的次数
+    uint32_t full_scans;        // 回退全信道扫描的次数
+    uint32_t samples;           // 参与统计的样本数
+    uint32_t p50_ms;            // 从断线（或启动）到获取 IP 的耗时
+    uint32_t p90_ms;
+    uint32_t p99_ms;
+    uint32_t max_ms;
+} wifi_reconnect_stats_t;
+
+// esp_wifi_start() 之前调用，有缓存时改为定向连接
+int wifi_reconnect_init(void);
+// 修改 SSID/密码后调用，清除缓存
+void wifi_reconnect_forget(void);
+
+void wifi_reconnect_on_connected(const wifi_event_sta_connected_t *event);
+// 返回连续失败次数
+int wifi_reconnect_on_disconnected(const wifi_event_sta_disconnected_t *event);
+void wifi_reconnect_on_got_ip(void);
+
+int wifi_reconnect_get_stats(wifi_reconnect_stats_t *stats);
+
+#endif
@@ -0,0 +1,190 @@
+#!/usr/bin/env python3
+"""
+在局域网内对比本地控制和经巴法云控制开关的延迟。
+
+    bench_control_latency.py --device 192.168.1.50 -n 50
+    bench_control_latency.py --device 192.168.1.50 --uid <私钥> --topic light002 -n 50
+
+- local: 经 keep-alive 连接 POST /api/switch，响应在开关状态更新之后才返回，计时即为控制延迟
+- cloud: 以控制端身份连接巴法云 TCP 服务，发布 cmd=2 on/off，再经局域网轮询 /api/state
+  直到设备上的开关变为目标状态；轮询间隔就是本地往返时间，这部分作为误差一并给出
+- 每轮在 on/off 之间切换，保证每次都是一次真实的状态变化
+- 不提供 --uid 时只测本地路径
+"""
+
+import argparse
+import http.client
+import json
+import socket
+import statistics
+import sys
+import time
+
+CLOUD_HOST = 'bemfa.com'
+CLOUD_PORT = 8344
+CLOUD_TIMEOUT_S = 10.0
+HTTP_TIMEOUT_S = 5.0
+
+
+def now_us():
+    return time.perf_counter_ns() // 1000
+
+
+class Device:
+    """与设备 HTTP 服务的一条 keep-alive 连接，连接被关闭时重连一次"""
+
+    def __init__(self, host, port):
+        self.host = host
+        self.port = port
+        self.conn = None
+
+    def request(self, method, path, body=None):
+        for attempt in range(2):
+            if self.conn is None:
+                self.conn = http.client.HTTPConnection(self.host, self.port, timeout=HTTP_TIMEOUT_S)
+                # 关掉 Nagle，避免与设备的延迟 ACK 叠加出 40ms 级的停顿
+                self.conn.connect()
+                self.conn.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+            try:
+                headers = {'Content-Type': 'application/json'} if body is not None else {}
+                self.conn.request(method, path, body=body, headers=headers)
+                resp = self.conn.getresponse()
+                data = resp.read()
+            except (OSError, http.client.HTTPException):
+                self.conn.close()
+                self.conn = None
+                if attempt:
+                    raise
+                continue
+            if resp.status != 200:
+                sys.exit('%s %s: HTTP %d %s' % (method, path, resp.status, data[:120]))
+            return json.loads(data)
+
+    def get_switch(self):
+        return self.request('GET', '/api/state')['switch']
+
+    def set_switch(self, on):
+        state = self.request('POST', '/api/switch', json.dumps({'switch': on}).encode())
+        if state['switch'] != on:
+            sys.exit('/api/switch returned switch=%s, expected %s' % (state['switch'], on))
+
+
+class Cloud:
+    """巴法云 TCP 文本协议的控制端，只发布不订阅"""
+
+    def __init__(self, host, port, uid):
+        self.uid = uid
+        self.sock = socket.create_connection((host, port), timeout=CLOUD_TIMEOUT_S)
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.rx = b''
+
+    def read_line(self):
+        while b'\r\n' not in self.rx:
+            data = self.sock.recv(512)
+            if not data:
+                sys.exit('cloud connection closed')
+            self.rx += data
+        line, self.rx = self.rx.split(b'\r\n', 1)
+        return line.decode(errors='replace')
+
+    def publish(self, topic, msg):
+        self.sock.sendall(('cmd=2&uid=%s&topic=%s&msg=%s\r\n' % (self.uid, topic, msg)).encode())
+
+    def wait_ack(self):
+        # 发布应答 cmd=2&res=1，其余行（心跳应答等）跳过
+        while True:
+            line = self.read_line()
+            if line.startswith('cmd=2') and 'msg=' not in line:
+                if 'res=1' not in line:
+                    sys.exit('cloud publish rejected: %s' % line)
+                return
+
+    def close(self):
+        self.sock.close()
+
+
+def bench_local(dev, rounds):
+    samples = []
+    on = not dev.get_switch()
+    for _ in range(rounds):
+        t0 = now_us()
+        dev.set_switch(on)
+        samples.append(now_us() - t0)
+        on = not on
+    return samples
+
+
+def bench_cloud(dev, cloud, topic, rounds):
+    samples = []
+    polls = []
+    on = not dev.get_switch()
+    for _ in range(rounds):
+        t0 = now_us()
+        cloud.publish(topic, 'on' if on else 'off')
+        n = 0
+        while True:
+            n += 1
+            if dev.get_switch() == on:
+                break
+            if now_us() - t0 > CLOUD_TIMEOUT_S * 1000000:
+                sys.exit('device did not switch %s within %.0f s' % ('on' if on else 'off', CLOUD_TIMEOUT_S))
+        samples.append(now_us() - t0)
+        polls.append(n)
+        cloud.wait_ack()
+        on = not on
+    return samples, polls
+
+
+def percentile(sorted_samples, p):
+    idx = min(len(sorted_samples) - 1, int(len(sorted_samples) * p / 100))
+    return sorted_samples[idx]
+
+
+def report(name, samples):
+    s = sorted(samples)
+    print('%-6s n=%-4d min %8.1f  p50 %8.1f  p95 %8.1f  max %8.1f  mean %8.1f ms'
+          % (name, len(s), s[0] / 1000, percentile(s, 50) / 1000, percentile(s, 95) / 1000,
+             s[-1] / 1000, statistics.mean(s) / 1000))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('--device', required=True, help='设备的 IP 或主机名')
+    parser.add_argument('--port', type=int, default=80, help='设备 HTTP 端口')
+    parser.add_argument('--uid', help='巴法云私钥，不填时只测本地路径')
+    parser.add_argument('--topic', help='设备订阅的开关主题（/api/config 中的 bemfa_topic）')
+    parser.add_argument('--cloud-host', default=CLOUD_HOST)
+    parser.add_argument('--cloud-port', type=int, default=CLOUD_PORT)
+    parser.add_argument('-n', '--rounds', type=int, default=20, help='每条路径的开关次数')
+    args = parser.parse_args()
+
+    if args.rounds <= 0:
+        parser.error('--rounds must be positive')
+
+    dev = Device(args.device, args.port)
+    initial = dev.get_switch()
+
+    local = bench_local(dev, args.rounds)
+    report('local', local)
+
+    if args.uid:
+        topic = args.topic or dev.request('GET', '/api/config')['bemfa_topic']
+        if not topic:
+            sys.exit('device has no bemfa_topic, pass --topic')
+        cloud = Cloud(args.cloud_host, args.cloud_port, args.uid)
+        try:
+            samples, polls = bench_cloud(dev, cloud, topic, args.rounds)
+        finally:
+            cloud.close()
+        report('cloud', samples)
+        # 云端路径的计时包含最后一次轮询，误差不超过一次本地往返
+        print('cloud  polls/round %.1f, resolution ~%.1f ms (local p50)'
+              % (statistics.mean(polls), percentile(sorted(local), 50) / 1000))
+        print('cloud/local p50 ratio %.1fx'
+              % (percentile(sorted(samples), 50) / max(1, percentile(sorted(local), 50))))
+
+    dev.set_switch(initial)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,292 @@
+#!/usr/bin/env python3
+"""
+把网页资源预先 gzip 压缩并计算强 ETag，生成固件内置的资源表或独立的资源镜像。
+
+    gen_assets.py table  --root main/www -o http_assets_data.c main/www/index.html
+    gen_assets.py image  --root main/www -o assets.bin main/www/...
+    gen_assets.py verify --root main/www assets.bin main/www/...
+
+- table: 生成 http_assets.h 中声明的 g_http_assets[]，编进固件，作为没有资源分区时的后备
+- image: 生成写入 assets 分区的镜像，路由用完美哈希查找，格式见 asset_fs.h
+- verify: 按固件的查找算法解析镜像，检查每个文件都能找到且内容一致，不存在的路径都找不到
+- 以 mtime=0 压缩，同样的输入总是得到同样的输出和 ETag
+- 压缩后不够小（比原文件节省不到 5%）的资源（图片等）保留原文
+- ETag 是实际发送内容的 sha256 前 16 个十六进制字符
+"""
+
+import argparse
+import gzip
+import hashlib
+import os
+import struct
+import sys
+import zlib
+
+MIME_TYPES = {
+    '.html': 'text/html; charset=utf-8',
+    '.htm':  'text/html; charset=utf-8',
+    '.css':  'text/css',
+    '.js':   'application/javascript',
+    '.json': 'application/json',
+    '.svg':  'image/svg+xml',
+    '.png':  'image/png',
+    '.jpg':  'image/jpeg',
+    '.jpeg': 'image/jpeg',
+    '.gif':  'image/gif',
+    '.ico':  'image/x-icon',
+    '.txt':  'text/plain',
+    '.woff2': 'font/woff2',
+}
+
+GZIP_MIN_SAVING = 0.05
+
+# 与 asset_fs.h 保持一致
+IMAGE_MAGIC = 0x31545341            # "AST1"
+IMAGE_VERSION = 1
+HEADER_FMT = '<IHHHHII12x'          # magic version count buckets slots image_len crc32
+ENTRY_FMT = '<IIIIHBx20s'           # uri_off mime_off data_off data_len uri_len flags etag
+EMPTY_SLOT = 0xFFFF
+FLAG_GZIP = 0x01
+MAX_DISPLACEMENT = 0xFFFE
+
+
+def load_asset(root, path):
+    with open(path, 'rb') as f:
+        raw = f.read()
+
+    uri = '/' + os.path.relpath(path, root).replace(os.sep, '/')
+    ext = os.path.splitext(path)[1].lower()
+    mime = MIME_TYPES.get(ext, 'application/octet-stream')
+
+    packed = gzip.compress(raw, compresslevel=9, mtime=0)
+    use_gzip = len(packed) <= len(raw) * (1 - GZIP_MIN_SAVING)
+    data = packed if use_gzip else raw
+
+    return {
+        'uri': uri,
+        'mime': mime,
+        'gzip': use_gzip,
+        'data': data,
+        'raw': raw,
+        'etag': '"%s"' % hashlib.sha256(data).hexdigest()[:16],
+    }
+
+
+def load_assets(root, files):
+    assets = sorted((load_asset(root, p) for p in files), key=lambda a: a['uri'])
+    uris = [a['uri'] for a in assets]
+    if len(set(uris)) != len(uris):
+        sys.exit('duplicate uri')
+    if len(assets) >= EMPTY_SLOT:
+        sys.exit('too many assets')
+    return assets
+
+
+def asset_hash(key, seed):
+    """FNV-1a 加 murmur3 的 fmix32，与 asset_fs.c 的 asset_fs_hash() 相同"""
+    h = (2166136261 ^ seed) & 0xFFFFFFFF
+    for b in key:
+        h ^= b
+        h = (h * 16777619) & 0xFFFFFFFF
+    h ^= h >> 16
+    h = (h * 0x85EBCA6B) & 0xFFFFFFFF
+    h ^= h >> 13
+    h = (h * 0xC2B2AE35) & 0xFFFFFFFF
+    h ^= h >> 16
+    return h
+
+
+def slot_of(key, buckets, slots, disp):
+    d = disp[asset_hash(key, 0) % buckets]
+    return asset_hash(key, d + 1) % slots
+
+
+def build_perfect_hash(keys):
+    """hash-and-displace：先按一级哈希分桶，再从大桶开始为每个桶找一个不冲突的位移"""
+    n = len(keys)
+    buckets = max(1, (n + 3) // 4)
+    slots = max(1, n + n // 4)
+
+    groups = [[] for _ in range(buckets)]
+    for i, k in enumerate(keys):
+        groups[asset_hash(k, 0) % buckets].append(i)
+
+    disp = [0] * buckets
+    slot = [EMPTY_SLOT] * slots
+    for b in sorted(range(buckets), key=lambda b: -len(groups[b])):
+        if not groups[b]:
+            continue
+        for d in range(MAX_DISPLACEMENT + 1):
+            pos = [asset_hash(keys[i], d + 1) % slots for i in groups[b]]
+            if len(set(pos)) == len(pos) and all(slot[p] == EMPTY_SLOT for p in pos):
+                break
+        else:
+            sys.exit('no perfect hash found')
+        disp[b] = d
+        for i, p in zip(groups[b], pos):
+            slot[p] = i
+
+    return buckets, slots, disp, slot
+
+
+def align4(buf):
+    buf.extend(b'\0' * (-len(buf) % 4))
+
+
+def build_image(assets):
+    keys = [a['uri'].encode() for a in assets]
+    buckets, slots, disp, slot = build_perfect_hash(keys)
+
+    header_len = struct.calcsize(HEADER_FMT)
+    tables = struct.pack('<%dH' % buckets, *disp) + struct.pack('<%dH' % slots, *slot)
+    entries_off = header_len + len(tables) + (-(header_len + len(tables)) % 4)
+    pool_off = entries_off + len(assets) * struct.calcsize(ENTRY_FMT)
+
+    # 字符串以 '\0' 结尾，固件可以直接使用映射后的指针
+    pool = bytearray()
+    strings = {}
+    for s in [a['uri'] for a in assets] + [a['mime'] for a in assets]:
+        if s not in strings:
+            strings[s] = pool_off + len(pool)
+            pool += s.encode() + b'\0'
+    align4(pool)
+
+    data = bytearray()
+    data_off = pool_off + len(pool)
+    entries = bytearray()
+    for a in assets:
+        entries += struct.pack(ENTRY_FMT, strings[a['uri']], strings[a['mime']], data_off + len(data),
+                               len(a['data']), len(a['uri']), FLAG_GZIP if a['gzip'] else 0,
+                               a['etag'].encode())
+        data += a['data']
+        align4(data)
+
+    body = bytearray(tables)
+    body.extend(b'\0' * (entries_off - header_len - len(body)))
+    body += entries + pool + data
+    header = struct.pack(HEADER_FMT, IMAGE_MAGIC, IMAGE_VERSION, len(assets), buckets, slots,
+                         header_len + len(body), zlib.crc32(body))
+    return header + body
+
+
+def image_find(image, uri):
+    magic, version, count, buckets, slots, image_len, crc = struct.unpack_from(HEADER_FMT, image)
+    header_len = struct.calcsize(HEADER_FMT)
+    disp = struct.unpack_from('<%dH' % buckets, image, header_len)
+    slot = struct.unpack_from('<%dH' % slots, image, header_len + 2 * buckets)
+    entries_off = header_len + 2 * (buckets + slots)
+    entries_off += -entries_off % 4
+
+    key = uri.encode()
+    index = slot[slot_of(key, buckets, slots, disp)]
+    if index == EMPTY_SLOT:
+        return None
+    uri_off, mime_off, data_off, data_len, uri_len, flags, etag = \
+        struct.unpack_from(ENTRY_FMT, image, entries_off + index * struct.calcsize(ENTRY_FMT))
+    if image[uri_off:uri_off + uri_len] != key:
+        return None
+    return {
+        'mime': image[mime_off:image.index(b'\0', mime_off)].decode(),
+        'data': image[data_off:data_off + data_len],
+        'gzip': bool(flags & FLAG_GZIP),
+        'etag': etag.rstrip(b'\0').decode(),
+    }
+
+
+def verify_image(image, assets):
+    magic, version, count, buckets, slots, image_len, crc = struct.unpack_from(HEADER_FMT, image)
+    header_len = struct.calcsize(HEADER_FMT)
+    errors = []
+    if magic != IMAGE_MAGIC or version != IMAGE_VERSION:
+        errors.append('bad magic or version')
+    elif image_len > len(image) or zlib.crc32(image[header_len:image_len]) != crc:
+        errors.append('bad length or crc')
+    elif count != len(assets):
+        errors.append('asset count %d, expected %d' % (count, len(assets)))
+    if errors:
+        return errors
+
+    for a in assets:
+        e = image_find(image, a['uri'])
+        if e is None:
+            errors.append('%s: not found' % a['uri'])
+            continue
+        body = gzip.decompress(e['data']) if e['gzip'] else e['data']
+        if body != a['raw'] or e['mime'] != a['mime'] or e['etag'] != a['etag']:
+            errors.append('%s: content mismatch' % a['uri'])
+
+    known = {a['uri'] for a in assets}
+    probes = ['/', '/missing', '/index.htm'] + [a['uri'] + 'x' for a in assets] + [a['uri'][:-1] for a in assets]
+    for uri in probes:
+        if uri not in known and image_find(image, uri) is not None:
+            errors.append('%s: false match' % uri)
+
+    return errors
+
+
+def c_bytes(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append('    ' + ' '.join('0x%02x,' % b for b in data[i:i + 16]))
+    return '\n'.join(lines)
+
+
+def write_table(out, assets):
+    with open(out, 'w', newline='\n') as f:
+        f.write('// 由 tools/gen_assets.py 生成，不要手动修改\n\n')
+        f.write('#include "http_assets.h"\n\n')
+        for i, a in enumerate(assets):
+            f.write('// %s: %d -> %d bytes\n' % (a['uri'], len(a['raw']), len(a['data'])))
+            f.write('static const uint8_t asset_%d[] = {\n%s\n};\n\n' % (i, c_bytes(a['data'])))
+        f.write('const http_asset_t g_http_assets[] = {\n')
+        for i, a in enumerate(assets):
+            f.write('    { "%s", "%s", "%s", asset_%d, %d, %s },\n'
+                    % (a['uri'], a['mime'], a['etag'].replace('"', '\\"'), i, len(a['data']),
+                       'true' if a['gzip'] else 'false'))
+        f.write('};\n\n')
+        f.write('const int g_http_assets_count = %d;\n' % len(assets))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('mode', choices=['table', 'image', 'verify'])
+    parser.add_argument('--root', required=True, help='资源根目录，对应 URI 的 /')
+    parser.add_argument('-o', '--output', help='生成的 C 文件或镜像')
+    parser.add_argument('--max-size', type=lambda s: int(s, 0), default=0, help='镜像的最大字节数（分区大小）')
+    parser.add_argument('files', nargs='+', help='资源文件；verify 时第一个参数是镜像')
+    args = parser.parse_args()
+
+    if args.mode == 'verify':
+        with open(args.files[0], 'rb') as f:
+            image = f.read()
+        assets = load_assets(args.root, args.files[1:])
+        errors = verify_image(image, assets)
+        for e in errors:
+            print('FAIL %s' % e)
+        print('%d assets, %s' % (len(assets), 'FAIL' if errors else 'OK'))
+        sys.exit(1 if errors else 0)
+
+    if not args.output:
+        parser.error('-o is required')
+
+    assets = load_assets(args.root, args.files)
+    for a in assets:
+        print('asset %-24s %6d -> %6d bytes %s' % (a['uri'], len(a['raw']), len(a['data']), a['etag']))
+
+    if args.mode == 'table':
+        write_table(args.output, assets)
+        return
+
+    image = build_image(assets)
+    if args.max_size and len(image) > args.max_size:
+        sys.exit('image %d bytes exceeds %d' % (len(image), args.max_size))
+    errors = verify_image(image, assets)
+    if errors:
+        sys.exit('\n'.join(errors))
+    with open(args.output, 'wb') as f:
+        f.write(image)
+    print('image %d bytes, %d assets' % (len(image), len(assets)))
+
+
+if __name__ == '__main__':
+    main()
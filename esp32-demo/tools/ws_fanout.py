@@ -0,0 +1,202 @@
+#!/usr/bin/env python3
+"""
+在 Linux 上用 N 个 WebSocket 客户端测量设备 /ws 推送的扇出延迟。
+
+    ws_fanout.py --device 192.168.1.50 -c 4 -n 100
+
+- N 个客户端连接 ws://<device>/ws，每轮经 POST /api/switch 翻转开关，
+  设备把变化的字段 {"switch":...} 广播给所有客户端
+- 计时从发出 POST 开始，到每个客户端收到对应的推送为止；
+  每轮最后一个客户端收到的时间就是这一轮的扇出时间
+- 客户端数超过设备的 HTTP_WS_MAX_CLIENTS 时多出的连接会被拒绝
+- 只用标准库，WebSocket 握手和帧解析按 RFC 6455 的最小子集实现
+"""
+
+import argparse
+import base64
+import http.client
+import json
+import os
+import socket
+import statistics
+import sys
+import threading
+import time
+
+HTTP_TIMEOUT_S = 5.0
+ROUND_TIMEOUT_S = 5.0
+
+
+def now_us():
+    return time.perf_counter_ns() // 1000
+
+
+class WsClient:
+    """一个 WebSocket 客户端，后台线程读取推送并记录到达时间"""
+
+    def __init__(self, host, port, path):
+        self.sock = socket.create_connection((host, port), timeout=HTTP_TIMEOUT_S)
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        key = base64.b64encode(os.urandom(16)).decode()
+        self.sock.sendall(('GET %s HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n'
+                           'Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n'
+                           % (path, host, key)).encode())
+        self.rx = b''
+        while b'\r\n\r\n' not in self.rx:
+            data = self.sock.recv(1024)
+            if not data:
+                raise ConnectionError('handshake closed')
+            self.rx += data
+        head, self.rx = self.rx.split(b'\r\n\r\n', 1)
+        if not head.startswith(b'HTTP/1.1 101'):
+            raise ConnectionError(head.split(b'\r\n', 1)[0].decode(errors='replace'))
+
+        self.sock.settimeout(None)
+        self.arrivals = []          # (到达时间, 内容)
+        self.cond = threading.Condition()
+        self.closed = False
+        self.thread = threading.Thread(target=self.run, daemon=True)
+        self.thread.start()
+
+    def recv_exact(self, n):
+        while len(self.rx) < n:
+            data = self.sock.recv(4096)
+            if not data:
+                raise ConnectionError('closed')
+            self.rx += data
+        data, self.rx = self.rx[:n], self.rx[n:]
+        return data
+
+    def run(self):
+        try:
+            while True:
+                b0, b1 = self.recv_exact(2)
+                plen = b1 & 0x7F
+                if plen == 126:
+                    plen = int.from_bytes(self.recv_exact(2), 'big')
+                elif plen == 127:
+                    plen = int.from_bytes(self.recv_exact(8), 'big')
+                if b1 & 0x80:
+                    self.recv_exact(4)      # 服务器的帧不应带掩码，这里只是跳过
+                payload = self.recv_exact(plen)
+                t = now_us()
+                if b0 & 0x0F == 0x8:
+                    break
+                if b0 & 0x0F == 0x1:
+                    with self.cond:
+                        self.arrivals.append((t, payload.decode(errors='replace')))
+                        self.cond.notify_all()
+        except OSError:
+            pass
+        with self.cond:
+            self.closed = True
+            self.cond.notify_all()
+
+    def wait_count(self, n, deadline):
+        with self.cond:
+            while len(self.arrivals) < n and not self.closed:
+                left = deadline - time.monotonic()
+                if left <= 0:
+                    return False
+                self.cond.wait(left)
+            return len(self.arrivals) >= n
+
+    def close(self):
+        try:
+            # 带掩码的关闭帧，掩码为 0
+            self.sock.sendall(b'\x88\x80\x00\x00\x00\x00')
+        except OSError:
+            pass
+        self.sock.close()
+
+
+def set_switch(conn, on):
+    conn.request('POST', '/api/switch', body=json.dumps({'switch': on}).encode(),
+                 headers={'Content-Type': 'application/json'})
+    resp = conn.getresponse()
+    data = resp.read()
+    if resp.status != 200:
+        sys.exit('POST /api/switch: HTTP %d %s' % (resp.status, data[:120]))
+    return json.loads(data)['switch']
+
+
+def percentile(sorted_samples, p):
+    idx = min(len(sorted_samples) - 1, int(len(sorted_samples) * p / 100))
+    return sorted_samples[idx]
+
+
+def report(name, samples):
+    s = sorted(samples)
+    print('%-10s n=%-5d min %7.1f  p50 %7.1f  p95 %7.1f  p99 %7.1f  max %7.1f ms'
+          % (name, len(s), s[0] / 1000, percentile(s, 50) / 1000, percentile(s, 95) / 1000,
+             percentile(s, 99) / 1000, s[-1] / 1000))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('--device', required=True, help='设备的 IP 或主机名')
+    parser.add_argument('--port', type=int, default=80, help='设备 HTTP 端口')
+    parser.add_argument('--path', default='/ws')
+    parser.add_argument('-c', '--clients', type=int, default=4, help='WebSocket 客户端数')
+    parser.add_argument('-n', '--rounds', type=int, default=50, help='开关翻转次数')
+    args = parser.parse_args()
+
+    if args.clients <= 0 or args.rounds <= 0:
+        parser.error('--clients and --rounds must be positive')
+
+    clients = []
+    for i in range(args.clients):
+        try:
+            clients.append(WsClient(args.device, args.port, args.path))
+        except (OSError, ConnectionError) as e:
+            print('client %d rejected: %s' % (i, e))
+    if not clients:
+        sys.exit('no WebSocket client connected')
+    # 等握手期间可能在途的推送到达，之后只统计本程序触发的
+    time.sleep(0.2)
+    base = [len(c.arrivals) for c in clients]
+
+    conn = http.client.HTTPConnection(args.device, args.port, timeout=HTTP_TIMEOUT_S)
+    conn.connect()
+    conn.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    conn.request('GET', '/api/state')
+    initial = json.loads(conn.getresponse().read())['switch']
+
+    per_client = []
+    fanout = []
+    lost = 0
+    on = initial
+    for r in range(1, args.rounds + 1):
+        on = not on
+        t0 = now_us()
+        if set_switch(conn, on) != on:
+            sys.exit('/api/switch did not apply')
+
+        deadline = time.monotonic() + ROUND_TIMEOUT_S
+        last = 0
+        for c, b in zip(clients, base):
+            if not c.wait_count(b + r, deadline):
+                lost += 1
+                continue
+            t, text = c.arrivals[b + r - 1]
+            if json.loads(text).get('switch') != on:
+                sys.exit('round %d: client got %s, expected switch=%s' % (r, text, on))
+            per_client.append(t - t0)
+            last = max(last, t - t0)
+        if lost:
+            sys.exit('round %d: %d client(s) missed the push or were dropped' % (r, lost))
+        fanout.append(last)
+
+    print('%d clients, %d rounds' % (len(clients), args.rounds))
+    report('per-client', per_client)
+    report('fan-out', fanout)
+
+    if on != initial:
+        set_switch(conn, initial)
+    conn.close()
+    for c in clients:
+        c.close()
+
+
+if __name__ == '__main__':
+    main()